@@ -0,0 +1,2206 @@
+#include "app.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "button_browser.h"
+#include "button_cache.h"
+#include "fingerprint.h"
+#include "fixed_string.h"
+#include "ir_codec.h"
+#include "ir_import.h"
+#include "ir_waveform.h"
+#include "key_input.h"
+#include "macro.h"
+#include "radio_service.h"
+#include "remote_library.h"
+#include "rf24_sniffer.h"
+#include "rf24_spectrum.h"
+#include "rf433_codec.h"
+#include "scheduler.h"
+#include "signal_index.h"
+#include "static_arena.h"
+#include "trace.h"
+#include "ui.h"
+#include "ui_heatmap.h"
+
+#define REMOTE_FILE_DIR "/remote_names/"
+#define REMOTE_PATH_MAX 64
+#define SNIFF_LOG_PATH "/rf24_sniff.bin"
+#define SNIFF_LOG_BATCH 16             // Records per SD write
+#define IMPORT_DIR "/import"
+#define IMPORT_NAME_MAX 64
+#define IMPORT_CHUNKS_PER_RUN 4        // Read and parsed per import task run
+#define SIGNAL_INDEX_PATH "/signal_index.bin"
+#define SIGNAL_INDEX_SPARE 256         // Buttons and remotes a rebuilt index has room for beyond the card's
+#define INDEX_FILES_PER_RUN 4          // Libraries checked per index task run
+#define INDEX_RECORDS_PER_RUN 32       // Buttons indexed per index task run
+#define INDEX_FORMAT_BYTES_PER_RUN 16384
+#define SPECTRUM_ROW_HEIGHT 3
+#define SPECTRUM_HEADER_FRAMES 10      // Header text refresh, in heatmap frames
+#define BROWSER_TOP 12
+#define BROWSER_ROW_HEIGHT 12
+#define MACRO_PICKER_MAX 16            // Macros of one remote the picker lists
+
+// Task rates
+#define INPUT_POLL_US 10000
+#define RADIO_POLL_US 5000
+#define STORAGE_SERVICE_US 5000
+#define BATTERY_METER_US 1000000
+#define UI_FRAME_US 33333
+#define SNIFF_DISPLAY_US 200000
+#define SPECTRUM_FRAME_US 50000
+#define LEARN_DISPLAY_US 500000
+#define IMPORT_SERVICE_US 5000
+#define INDEX_SERVICE_US 10000
+#define INTRO_FRAME_US 200000
+#define INTRO_HOLD_US 2000000
+#define SD_RETRY_US 1000000
+#define SD_MOUNT_ATTEMPTS 3
+#define INTRO_BITS 10
+#define MESSAGE_TIMEOUT_MS 2000
+
+#ifndef LEARN_TIMEOUT_US
+#define LEARN_TIMEOUT_US 20000000      // Learn mode gives up after this long without a frame
+#endif
+
+#ifndef CAPTURE_REPEAT_WINDOW_US
+#define CAPTURE_REPEAT_WINDOW_US 400000    // The same frame again this soon is the button still held
+#endif
+
+// Replaying the same button this soon counts as holding it down
+#ifndef IR_HOLD_WINDOW_US
+#define IR_HOLD_WINDOW_US 250000
+#endif
+
+uint32_t bootStage(const char* stage, uint32_t startUs);
+void introTask();
+void sdMountTask();
+void initializeUI();
+void updatePowerMeter();
+void scanRF24();
+void scanRF433();
+void scanIR();
+bool holdCapture(const RadioEvent& event);
+void saveCapture(const char* buttonName, uint8_t band);
+void saveRemoteButton(const char* buttonName);
+void saveRemoteData(const char* buttonName, const ButtonRecord& record, const PulseTrain* raw);
+const CachedButton* loadRemoteButton(const char* buttonName);
+void playbackSavedButton(const char* buttonName);
+bool selectRemote(const char* name);
+bool openRemoteLibrary(const char* remoteName);
+void closeRemoteLibrary();
+void* allocateCacheMemory(size_t size);
+void sendIRSignal(const ButtonRecord& record, const IrWaveform& waveform, bool repeat);
+void sendRF24Signal(StringView data);
+void sendRF433Waveform(const ButtonRecord& record, const IrWaveform& waveform);
+void toggleRF24Sniffer();
+void drainSniffer();
+void flushSniffLog();
+void sniffDisplayTask();
+void toggleRF24Spectrum();
+void selectQuietestChannel();
+void spectrumFrameTask();
+void openButtonBrowser();
+void closeButtonBrowser();
+void hideBrowserRows();
+void browserMove(int32_t rows);
+void browserUp();
+void browserDown();
+void browserPageUp();
+void browserPageDown();
+void browserPlay();
+void showButtonBrowser();
+void playMacro(const char* name);
+void stopMacro();
+size_t readMacroLine(StorageFile& file, char* line, size_t size);
+bool loadMacro(const char* name, uint8_t& count);
+const CachedButton* macroButton(const char* buttonName);
+void toggleLearnMode();
+void stopLearning(const char* message);
+void learnTask();
+void saveCustomButton();
+void playCustomButton();
+void openMacroPicker();
+void closeMacroPicker();
+void macroPickerUp();
+void macroPickerDown();
+void macroPickerPlay();
+void showMacroPicker();
+void clearRemote();
+void startRemoteEntry();
+void showRemoteEntry();
+void remoteEntryKey(const KeyEvent& event);
+void dumpTrace();
+void toggleImport();
+bool openNextImport();
+void stopImport(const char* message);
+void importTask();
+bool openSignalIndex();
+void requestIndexRebuild();
+void startIndexCheck();
+bool openIndexLibrary(const char* remote);
+void closeIndexLibrary();
+bool nextIndexLibrary();
+void endIndexCheck();
+void finishIndexBuild();
+void stopIndexing(const char* message);
+void indexTask();
+void indexStoredButton(SignalIndex& index, bool indexed, const char* remote, const ButtonRecord& record,
+                       const PulseCode* raw);
+bool findKnownRemote(const Fingerprint& print, SignalHit& hit);
+void keyboardTask();
+void showTimedMessage(const char* message, uint32_t durationMs);
+void inputTask();
+void submitTransmit(const ButtonRecord& record, const IrWaveform* waveform, bool repeat);
+void radioTask();
+void storageTask();
+void batteryTask();
+void restoreMenuTask();
+void uiTask();
+void showMessage(const char* message, uint16_t color = UI_WHITE);
+void appendMessage(const char* text);
+void logMessage(const char* format, ...);
+
+// ButtonStore over the per-remote library files on the SD card
+class SdButtonStore : public ButtonStore {
+public:
+    bool load(const char* remote, const char* button, ButtonRecord& record, PulseCode& raw) override;
+    bool loadAt(const char* remote, uint32_t index, ButtonRecord& record, PulseCode& raw) override;
+    bool store(const char* remote, const ButtonRecord& record, const PulseCode* raw) override;
+};
+
+Hal* hal = nullptr;
+
+// The radios belong to the radio task; the UI only queues commands
+RadioService* radioService = nullptr;
+bool radioInline = false;
+RadioCommand radioCommand;
+RadioEvent radioEvent;
+
+typedef FixedString<REMOTE_NAME_MAX> RemoteName;
+typedef FixedString<REMOTE_PATH_MAX> RemotePath;
+typedef FixedString<MACRO_NAME_MAX> MacroName;
+
+void remoteFilePath(const char* remoteName, const char* extension, RemotePath& path);
+
+RemoteName currentRemoteName;
+FixedString<IR_MAX_PULSES * 6 + 16> remoteData;
+
+// Temporaries for one capture, save or load; released when it returns
+uint8_t scratchMemory[SCRATCH_ARENA_SIZE];
+StaticArena scratchArena(scratchMemory, sizeof(scratchMemory));
+
+// Last captured signal, waiting to be saved
+ButtonRecord capturedRecord;
+PulseTrain capturedRaw;
+bool capturedHasRaw = false;
+
+RemoteLibrary remoteLibrary;
+StorageFile* remoteLibraryFile = nullptr;
+RemoteName openRemoteName;
+
+SdButtonStore sdButtonStore;
+ButtonCache buttonCache;
+
+// Last replayed button, for hold detection
+const CachedButton* lastPlayback = nullptr;
+uint32_t lastPlaybackUs = 0;
+
+// nRF24 sniffer: counts and the capture log are kept on this side of the ring
+bool rf24Sniffing = false;
+Rf24ChannelCounts sniffCounts;
+Rf24SniffRecord sniffRecord;
+Rf24SniffRecord lastSniffRecord;
+Rf24SniffRecord sniffLogBatch[SNIFF_LOG_BATCH];
+uint8_t sniffLogPending = 0;
+uint32_t sniffLogOffset = 0;
+StorageFile* sniffLog = nullptr;
+int8_t sniffTaskId = -1;
+
+// Spectrum scan: a header widget over a heatmap drawn straight onto the display
+bool rf24Scanning = false;
+Rf24SpectrumConfig spectrumConfig;
+UiHeatmap* heatmap = nullptr;
+uint8_t spectrumLevels[RF24_CHANNELS];
+bool spectrumCovered = true;
+uint32_t spectrumFrames = 0;
+uint32_t spectrumSweeps = 0;
+uint32_t spectrumHeaderUs = 0;
+int8_t spectrumTaskId = -1;
+uint8_t rf24Channel = RF24_DEFAULT_CHANNEL;
+
+// Learn mode: every receiver armed, the first capture from any band is kept
+bool learning = false;
+uint32_t learnStartUs = 0;
+uint32_t learnDropBase[RADIO_BANDS];
+int8_t learnTaskId = -1;
+
+// Import: the files in IMPORT_DIR streamed into the remote libraries, a few
+// chunks per run
+IrImporter irImporter;
+bool importing = false;
+StorageDir* importDir = nullptr;
+StorageFile* importFile = nullptr;
+char importFileName[IMPORT_NAME_MAX];
+char importChunk[IMPORT_CHUNK_SIZE];
+ImportStats importTotals;
+uint32_t importFiles = 0;
+uint32_t importStartUs = 0;
+int8_t importTaskId = -1;
+
+// Signal index: which remotes hold a signal, across the whole card. Saves
+// keep it up to date; at boot every library is checked against it, and a
+// fresh one is built in the background when any changed behind its back.
+enum IndexStage : uint8_t {
+    INDEX_IDLE,
+    INDEX_CHECK,                   // Comparing each library with the size it was indexed at
+    INDEX_FORMAT,                  // Laying out the new index, a slice per run
+    INDEX_BUILD                    // Adding every library to it
+};
+
+SignalIndex signalIndex;
+StorageFile* signalIndexFile = nullptr;
+SignalIndex newSignalIndex;
+StorageFile* newSignalIndexFile = nullptr;
+IndexStage indexStage = INDEX_IDLE;
+bool indexStale = false;           // Rebuild after the next check, whatever it finds
+StorageDir* indexDir = nullptr;
+char indexRemote[REMOTE_NAME_MAX]; // Library being read, empty between libraries
+RemoteLibrary* indexLibrary = nullptr;
+RemoteLibrary indexOwnLibrary;
+StorageFile* indexOwnFile = nullptr;
+uint32_t indexNext = 0;
+uint32_t indexRemotes = 0;
+uint32_t indexButtons = 0;
+uint32_t indexCapacity = 0;
+uint32_t indexRemoteCapacity = 0;
+uint32_t indexFormatOffset = 0;
+uint32_t indexStartUs = 0;
+int8_t indexTaskId = -1;
+
+// Button browser: a header over one widget per row, so moving the selection
+// redraws the two rows it left and entered
+ButtonBrowser buttonBrowser;
+int8_t browserHeaderWidget = -1;
+int8_t browserRowWidgets[BROWSER_ROWS];
+
+// Macro being played; the radio task reads the schedule until it reports done
+MacroStep macroSteps[MACRO_MAX_STEPS];
+MacroSchedule macroSchedule;
+bool macroPlaying = false;
+
+// Macro picker: the remote's macro names on the browser's rows
+MacroName macroNames[MACRO_PICKER_MAX];
+uint8_t macroNameCount = 0;
+uint8_t macroSelected = 0;
+bool macroPicking = false;
+
+// Latest capture per band, held until a scan consumes it
+RadioEvent pendingCaptures[BAND_RF433 + 1];
+bool hasPendingCapture[BAND_RF433 + 1] = {};
+
+// Fingerprint of the latest capture per band and how often it was heard
+Fingerprint capturePrints[RADIO_BANDS];
+bool capturePrinted[RADIO_BANDS] = {};
+uint32_t captureLastUs[RADIO_BANDS];
+uint16_t captureRepeats[RADIO_BANDS];
+
+// Keys read on their own timer, dispatched from the input task
+KeyInput keyInput;
+
+// A remote name being typed; 'r' starts it and Enter selects the remote
+bool remoteEntering = false;
+RemoteName remoteEntry;
+
+static constexpr KeyBinding kMainKeymap[] = {
+    {'s', saveCustomButton, false},
+    {'p', playCustomButton, true},     // Held, an IR button repeats
+    {'n', toggleRF24Sniffer, false},
+    {'w', toggleRF24Spectrum, false},
+    {'q', selectQuietestChannel, false},
+    {'l', toggleLearnMode, false},
+    {'m', openMacroPicker, false},
+    {'b', openButtonBrowser, false},
+    {'c', clearRemote, false},
+    {'r', startRemoteEntry, false},
+    {'t', dumpTrace, false},
+    {'i', toggleImport, false},
+};
+
+// The Cardputer's own arrow keys are ; . , / and its Esc is `
+static constexpr KeyBinding kBrowserKeymap[] = {
+    {KEY_UP, browserUp, true},
+    {';', browserUp, true},
+    {KEY_DOWN, browserDown, true},
+    {'.', browserDown, true},
+    {KEY_LEFT, browserPageUp, true},
+    {',', browserPageUp, true},
+    {KEY_RIGHT, browserPageDown, true},
+    {'/', browserPageDown, true},
+    {KEY_ENTER, browserPlay, true},
+    {KEY_ESC, closeButtonBrowser, false},
+    {'`', closeButtonBrowser, false},
+};
+
+static constexpr KeyBinding kMacroPickerKeymap[] = {
+    {KEY_UP, macroPickerUp, true},
+    {';', macroPickerUp, true},
+    {KEY_DOWN, macroPickerDown, true},
+    {'.', macroPickerDown, true},
+    {KEY_ENTER, macroPickerPlay, false},
+    {KEY_ESC, closeMacroPicker, false},
+    {'`', closeMacroPicker, false},
+};
+
+static_assert(keymapUnique(kMainKeymap), "A key is bound twice in kMainKeymap");
+static_assert(keymapUnique(kBrowserKeymap), "A key is bound twice in kBrowserKeymap");
+static_assert(keymapUnique(kMacroPickerKeymap), "A key is bound twice in kMacroPickerKeymap");
+
+// Boot: the intro and the SD mount run from the scheduler while the radios
+// already listen. Each stage is logged with the time since reset.
+bool introShowing = false;
+uint8_t introFrame = 0;
+int8_t introTaskId = -1;
+uint8_t sdAttempts = 0;
+bool sdMounted = false;
+int8_t sdMountTaskId = -1;
+bool bootCaptured = false;
+
+uint32_t schedulerClock() {
+    return hal->system.micros();
+}
+
+uint8_t traceCore() {
+    return hal->system.coreId();
+}
+
+Scheduler scheduler(schedulerClock);
+int8_t restoreMenuTaskId = -1;
+
+// Retained widgets; only the ones that change are pushed to the panel
+Ui* ui = nullptr;
+int8_t statusWidget = -1;
+int8_t menuWidget = -1;
+int8_t messageWidget = -1;
+int8_t spectrumWidget = -1;
+
+void appSetup(Hal& platform) {
+    hal = &platform;
+    traceBegin(schedulerClock, traceCore);
+    uint32_t stageUs = hal->system.micros();
+    logMessage("Starting setup...");
+
+    static RadioService service(hal->radio);
+    static Ui screen(hal->display);
+    static UiHeatmap waterfall(hal->display);
+    radioService = &service;
+    ui = &screen;
+    heatmap = &waterfall;
+
+    int16_t width = hal->display.width();
+    int16_t height = hal->display.height();
+    statusWidget = ui->addWidget({0, 0, width, 10}, 1, UI_WHITE, UI_BLACK);
+    menuWidget = ui->addWidget({0, 20, width, (int16_t)(height - 20)}, 1, UI_WHITE, UI_BLACK);
+    messageWidget = ui->addWidget({0, 12, width, (int16_t)(height - 12)}, 1, UI_WHITE, UI_BLACK);
+    ui->setVisible(messageWidget, false);
+    spectrumWidget = ui->addWidget({0, 12, width, 2 * UI_GLYPH_HEIGHT}, 1, UI_WHITE, UI_BLACK);
+    ui->setVisible(spectrumWidget, false);
+    browserHeaderWidget = ui->addWidget({0, BROWSER_TOP, width, 10}, 1, UI_LIGHTCYAN, UI_BLACK);
+    ui->setVisible(browserHeaderWidget, false);
+    for (uint8_t row = 0; row < BROWSER_ROWS; row++) {
+        int16_t y = BROWSER_TOP + BROWSER_ROW_HEIGHT * (row + 1);
+        browserRowWidgets[row] = ui->addWidget({0, y, width, 10}, 1, UI_WHITE, UI_BLACK);
+        ui->setVisible(browserRowWidgets[row], false);
+    }
+    stageUs = bootStage("widgets", stageUs);
+
+    // The radios come first, so capture starts as early as possible
+    hal->radio.begin(BAND_IR);
+    stageUs = bootStage("IR receiver", stageUs);
+
+    if (!hal->radio.begin(BAND_RF24)) {
+        appendMessage("2.4 GHz RF init failed!\n");
+        logMessage("RF24 failed to initialize!");
+    }
+    stageUs = bootStage("RF24", stageUs);
+
+    hal->radio.begin(BAND_RF433);
+    stageUs = bootStage("433 MHz RF", stageUs);
+
+    // From here on only the radio task touches the radios
+    radioCommand.type = RADIO_SET_LISTEN;
+    radioCommand.listenMask = RADIO_LISTEN_ALL;
+    radioService->submit(radioCommand);
+    radioCommand.type = RADIO_SET_RF24_TX;
+    rf24TxDefaults(radioCommand.rf24Tx);
+    radioService->submit(radioCommand);
+    radioInline = !hal->system.startRadioTask(*radioService);
+    if (radioInline) {
+        logMessage("No radio task, stepping radios from the loop.");
+    }
+    stageUs = bootStage("receivers armed", stageUs);
+
+    hal->keyboard.begin();
+    stageUs = bootStage("CardKB", stageUs);
+
+    // Hot-button cache in front of the SD library; it writes nothing until the card is mounted
+    if (!buttonCache.begin(BUTTON_CACHE_ENTRIES, &sdButtonStore, allocateCacheMemory)) {
+        logMessage("Button cache allocation failed.");
+    }
+    stageUs = bootStage("button cache", stageUs);
+
+    initializeUI();
+
+    // Each subsystem runs at its own rate; none of them may block
+    scheduler.add("keys", keyboardTask, KEY_POLL_US);
+    scheduler.add("input", inputTask, INPUT_POLL_US);
+    scheduler.add("radio", radioTask, RADIO_POLL_US);
+    scheduler.add("storage", storageTask, STORAGE_SERVICE_US);
+    scheduler.add("battery", batteryTask, BATTERY_METER_US);
+    scheduler.add("ui", uiTask, UI_FRAME_US);
+    restoreMenuTaskId = scheduler.add("menu", restoreMenuTask, 0);
+    sniffTaskId = scheduler.add("sniff", sniffDisplayTask, 0);
+    spectrumTaskId = scheduler.add("spectrum", spectrumFrameTask, 0);
+    learnTaskId = scheduler.add("learn", learnTask, 0);
+    importTaskId = scheduler.add("import", importTask, 0);
+    indexTaskId = scheduler.add("index", indexTask, 0);
+
+    // Drawn while the SD card mounts; the menu appears once it is over
+    introShowing = true;
+    introTaskId = scheduler.add("intro", introTask, INTRO_FRAME_US);
+    sdMountTaskId = scheduler.add("sd", sdMountTask, 0);
+    scheduler.runIn(sdMountTaskId, 0);
+    bootStage("setup", stageUs);
+}
+
+// One line of the boot timeline. Returns the time it was logged, where the
+// next stage starts.
+uint32_t bootStage(const char* stage, uint32_t startUs) {
+    uint32_t now = hal->system.micros();
+    logMessage("Boot: %s in %lu us, at %lu ms", stage, (unsigned long)(now - startUs), (unsigned long)(now / 1000));
+    return now;
+}
+
+// Retried in the background; nothing else waits for the card
+void sdMountTask() {
+    uint32_t start = hal->system.micros();
+    sdAttempts++;
+    if (hal->storage.begin()) {
+        sdMounted = true;
+        bootStage("SD card", start);
+        startIndexCheck();
+        return;
+    }
+    logMessage("SD Card initialization failed. Attempt %u of %u", sdAttempts, SD_MOUNT_ATTEMPTS);
+    if (sdAttempts < SD_MOUNT_ATTEMPTS) {
+        scheduler.runIn(sdMountTaskId, SD_RETRY_US);
+        return;
+    }
+    showMessage("SD Card Mount Failed\n", UI_RED);
+    logMessage("Please check if the SD card is inserted properly or try using a different SD card.");
+}
+
+void appLoop() {
+    // Sleep only until the next deadline; capture keeps running in its ISR
+    hal->system.sleepUs(scheduler.runDue());
+}
+
+void inputTask() {
+    hal->buttons.update();
+
+    KeyEvent event;
+    while (keyInput.next(event)) {
+        if (remoteEntering) {
+            remoteEntryKey(event);
+            continue;
+        }
+        if (buttonBrowser.isOpen()) {
+            // Any other key brings the browser back after a message
+            if (!dispatchKey(kBrowserKeymap, event)) {
+                showButtonBrowser();
+            }
+            continue;
+        }
+        if (macroPicking) {
+            if (!dispatchKey(kMacroPickerKeymap, event)) {
+                showMacroPicker();
+            }
+            continue;
+        }
+        if (!event.repeat) {
+            char echo[2] = {(char)event.key, '\0'};
+            appendMessage(echo);
+        }
+        dispatchKey(kMainKeymap, event);
+    }
+
+    if (hal->buttons.wasPressed(BUTTON_A)) {
+        scanRF24();
+    } else if (hal->buttons.wasPressed(BUTTON_B)) {
+        scanRF433();
+    } else if (hal->buttons.wasPressed(BUTTON_C)) {
+        scanIR();
+    }
+}
+
+// Collects captures and transmit results published by the radio task
+void radioTask() {
+    if (radioInline) {
+        radioService->step();
+    }
+    if (rf24Sniffing) {
+        drainSniffer();
+    }
+    while (radioService->poll(radioEvent)) {
+        if (radioEvent.type == RADIO_SNIFF_STARTED) {
+            if (!radioEvent.ok) {
+                appendMessage("RF24 sniffer failed to start.");
+                toggleRF24Sniffer();
+            }
+            continue;
+        }
+        if (radioEvent.type == RADIO_SPECTRUM_STARTED) {
+            if (!radioEvent.ok && rf24Scanning) {
+                toggleRF24Spectrum();
+                showTimedMessage("Spectrum scan failed to start.", MESSAGE_TIMEOUT_MS);
+            }
+            continue;
+        }
+        if (radioEvent.type == RADIO_MACRO_DONE) {
+            macroPlaying = false;
+            char text[48];
+            if (radioEvent.ok) {
+                snprintf(text, sizeof(text), "Macro done, %lu us late at worst.", (unsigned long)radioEvent.lateUs);
+            } else {
+                snprintf(text, sizeof(text), "Macro stopped.");
+            }
+            showTimedMessage(text, MESSAGE_TIMEOUT_MS);
+            continue;
+        }
+        if (radioEvent.type == RADIO_CAPTURED) {
+            if (!bootCaptured) {
+                bootCaptured = true;
+                logMessage("Boot: first capture at %lu ms", (unsigned long)(radioEvent.timestampUs / 1000));
+            }
+            if (radioEvent.band > BAND_RF433 || !holdCapture(radioEvent)) {
+                continue;
+            }
+            // Events arrive oldest first, so this is the first frame heard
+            if (learning && (int32_t)(radioEvent.timestampUs - learnStartUs) >= 0) {
+                stopLearning(nullptr);
+                if (radioEvent.band == BAND_IR) {
+                    scanIR();
+                } else if (radioEvent.band == BAND_RF24) {
+                    scanRF24();
+                } else if (radioEvent.band == BAND_RF433) {
+                    scanRF433();
+                }
+            }
+            continue;
+        }
+
+        if (radioEvent.band == BAND_RF24) {
+            char text[64];
+            snprintf(text, sizeof(text), "RF24 Signal %s (%u pkts, %u retries)",
+                     radioEvent.ok ? "Sent!" : "Send Failed!", radioEvent.packets, radioEvent.retries);
+            appendMessage(text);
+        } else if (radioEvent.band == BAND_RF433) {
+            appendMessage("RF433 Signal Sent!");
+        }
+    }
+}
+
+// A held button or a quick second press sends the same frame again. The
+// first one is kept and the rest only counted; returns false for those.
+bool holdCapture(const RadioEvent& event) {
+    uint8_t band = event.band;
+    Fingerprint print;
+    bool printed = fingerprintRecord(event.record, event.hasFrame ? &event.frame : nullptr, print);
+    bool repeat = printed && capturePrinted[band] && print.key == capturePrints[band].key &&
+                  event.timestampUs - captureLastUs[band] < CAPTURE_REPEAT_WINDOW_US;
+    captureLastUs[band] = event.timestampUs;
+    if (repeat) {
+        if (captureRepeats[band] < 0xFFFF) {
+            captureRepeats[band]++;
+        }
+        return false;
+    }
+    capturePrints[band] = print;
+    capturePrinted[band] = printed;
+    captureRepeats[band] = 1;
+    pendingCaptures[band] = event;
+    hasPendingCapture[band] = true;
+    return true;
+}
+
+// An import holds the libraries; write-backs wait until it is over
+void storageTask() {
+    if (sdMounted && !importing) {
+        buttonCache.service();
+    }
+}
+
+void batteryTask() {
+    updatePowerMeter();
+}
+
+void restoreMenuTask() {
+    if (buttonBrowser.isOpen()) {
+        showButtonBrowser();
+        return;
+    }
+    // The spectrum heatmap stays up under its messages
+    if (rf24Scanning) {
+        ui->setVisible(messageWidget, false);
+        return;
+    }
+    initializeUI();
+}
+
+// Nothing is drawn over the intro
+void uiTask() {
+    if (!introShowing) {
+        TRACE_SCOPE(TRACE_UI_RENDER, 0);
+        ui->render();
+    }
+}
+
+// Replaces the menu with a message; render() pushes it on the next frame
+void showMessage(const char* message, uint16_t color) {
+    ui->setText(messageWidget, message);
+    ui->setColors(messageWidget, color, UI_BLACK);
+    ui->setVisible(menuWidget, false);
+    ui->setVisible(messageWidget, true);
+}
+
+void appendMessage(const char* text) {
+    ui->appendText(messageWidget, text);
+    ui->setVisible(menuWidget, false);
+    ui->setVisible(messageWidget, true);
+}
+
+// Shows a message, then puts the menu back once it has been read
+void showTimedMessage(const char* message, uint32_t durationMs) {
+    showMessage(message);
+    scheduler.runIn(restoreMenuTaskId, durationMs * 1000UL);
+}
+
+void keyboardTask() {
+    keyInput.poll(hal->keyboard, hal->system.micros());
+}
+
+void saveCustomButton() {
+    saveRemoteButton("CustomButton");
+}
+
+void playCustomButton() {
+    playbackSavedButton("CustomButton");
+}
+
+void clearRemote() {
+    if (!selectRemote("")) {
+        showTimedMessage("Unsaved buttons, remote kept.", MESSAGE_TIMEOUT_MS);
+        return;
+    }
+    showMessage("Cleared Remote Name");
+}
+
+void startRemoteEntry() {
+    remoteEntering = true;
+    remoteEntry.clear();
+    showRemoteEntry();
+}
+
+void showRemoteEntry() {
+    showMessage("Remote name: ", UI_LIGHTCYAN);
+    appendMessage(remoteEntry.c_str());
+    appendMessage("_\n\nEnter selects, Esc cancels.");
+}
+
+// The name is made safe for a file name the way imported ones are
+void remoteEntryKey(const KeyEvent& event) {
+    if (event.key == KEY_ESC || event.key == '`') {
+        remoteEntering = false;
+        initializeUI();
+        return;
+    }
+    if (event.key == KEY_ENTER) {
+        remoteEntering = false;
+        char name[REMOTE_NAME_MAX];
+        importRemoteName(remoteEntry.c_str(), name);
+        if (!selectRemote(name)) {
+            showTimedMessage("Unsaved buttons, remote kept.", MESSAGE_TIMEOUT_MS);
+            return;
+        }
+        char text[48];
+        snprintf(text, sizeof(text), "Remote: %s", name[0] ? name : "none");
+        showTimedMessage(text, MESSAGE_TIMEOUT_MS);
+        return;
+    }
+    if (event.key == KEY_BACKSPACE && !remoteEntry.empty()) {
+        remoteEntry.assign(StringView(remoteEntry.c_str(), remoteEntry.length() - 1));
+    } else if (event.key >= ' ' && event.key < 0x7F) {
+        remoteEntry.append((char)event.key);
+    }
+    showRemoteEntry();
+}
+
+static void writeTraceLine(const char* line) {
+    hal->system.log(line);
+}
+
+// Over serial, for tools/trace2json.py; the task names label the task slices
+void dumpTrace() {
+    if (!TRACE_ENABLED) {
+        showTimedMessage("Tracing is not built in; use the trace env.", MESSAGE_TIMEOUT_MS);
+        return;
+    }
+    uint32_t records = traceRecorded();
+    for (uint8_t id = 0; id < scheduler.taskCount(); id++) {
+        logMessage(TRACE_DUMP_PREFIX "TASK %u %s", id, scheduler.name(id));
+    }
+    traceDump(writeTraceLine);
+    char text[40];
+    snprintf(text, sizeof(text), "Trace dumped, %lu records.", (unsigned long)records);
+    showTimedMessage(text, MESSAGE_TIMEOUT_MS);
+}
+
+// Streams every file in IMPORT_DIR into the remote libraries; pressed again,
+// stops. Pending saves are written first, so the import replaces them.
+void toggleImport() {
+    if (importing) {
+        stopImport("Import stopped.");
+        return;
+    }
+    if (!sdMounted) {
+        showTimedMessage("No SD card.", MESSAGE_TIMEOUT_MS);
+        return;
+    }
+    importDir = hal->storage.openDir(IMPORT_DIR);
+    if (!importDir) {
+        showTimedMessage("Nothing to import in " IMPORT_DIR ".", MESSAGE_TIMEOUT_MS);
+        return;
+    }
+    buttonCache.flush();
+    importing = true;
+    importFiles = 0;
+    importTotals = {};
+    importStartUs = hal->system.micros();
+    showMessage("Importing from " IMPORT_DIR "...", UI_LIGHTCYAN);
+    scheduler.setPeriod(importTaskId, IMPORT_SERVICE_US);
+    scheduler.runIn(importTaskId, 0);
+}
+
+// The file's name without its extension is the remote for formats that
+// carry none
+bool openNextImport() {
+    char path[sizeof(IMPORT_DIR) + IMPORT_NAME_MAX];
+    while (importDir->next(importFileName, sizeof(importFileName))) {
+        snprintf(path, sizeof(path), IMPORT_DIR "/%s", importFileName);
+        importFile = hal->storage.open(path, STORAGE_READ);
+        if (importFile) {
+            char remote[IMPORT_NAME_MAX];
+            strcpy(remote, importFileName);
+            char* extension = strrchr(remote, '.');
+            if (extension && extension != remote) {
+                *extension = '\0';
+            }
+            irImporter.begin(remote, sdButtonStore);
+            return true;
+        }
+        logMessage("Could not open %s.", path);
+    }
+    return false;
+}
+
+void stopImport(const char* message) {
+    importing = false;
+    scheduler.cancel(importTaskId);
+    if (importFile) {
+        importFile->close();
+        importFile = nullptr;
+    }
+    importDir->close();
+    importDir = nullptr;
+    // The cache may hold buttons the import replaced
+    if (!buttonCache.selectRemote(currentRemoteName.c_str())) {
+        logMessage("Unsaved buttons kept for %s.", currentRemoteName.c_str());
+    }
+    char text[112];
+    snprintf(text, sizeof(text), "%s\n%lu buttons from %lu files,\n%lu skipped, in %lu ms.", message,
+             (unsigned long)importTotals.buttons, (unsigned long)importFiles, (unsigned long)importTotals.skipped,
+             (unsigned long)((hal->system.micros() - importStartUs) / 1000));
+    logMessage("%s", text);
+    showTimedMessage(text, MESSAGE_TIMEOUT_MS);
+}
+
+// A few chunks a run, so the rest of the loop keeps its rates
+void importTask() {
+    TRACE_SCOPE(TRACE_IMPORT, importFiles);
+    for (uint8_t chunk = 0; chunk < IMPORT_CHUNKS_PER_RUN; chunk++) {
+        if (!importFile && !openNextImport()) {
+            stopImport("Import done.");
+            return;
+        }
+        size_t length = importFile->read(importChunk, sizeof(importChunk));
+        if (!(length ? irImporter.feed(importChunk, length) : irImporter.finish())) {
+            stopImport("Import failed writing a library.");
+            return;
+        }
+        if (length == 0) {
+            const ImportStats& stats = irImporter.stats();
+            importTotals.bytes += stats.bytes;
+            importTotals.buttons += stats.buttons;
+            importTotals.decoded += stats.decoded;
+            importTotals.raw += stats.raw;
+            importTotals.skipped += stats.skipped;
+            importFiles++;
+            logMessage("Imported %s: %lu buttons (%lu decoded, %lu raw), %lu skipped", importFileName,
+                       (unsigned long)stats.buttons, (unsigned long)stats.decoded, (unsigned long)stats.raw,
+                       (unsigned long)stats.skipped);
+            importFile->close();
+            importFile = nullptr;
+        }
+    }
+    char text[96];
+    snprintf(text, sizeof(text), "Importing %s\n%lu buttons", importFileName,
+             (unsigned long)(importTotals.buttons + irImporter.stats().buttons));
+    showMessage(text, UI_LIGHTCYAN);
+}
+
+bool openSignalIndex() {
+    signalIndexFile = hal->storage.open(SIGNAL_INDEX_PATH, STORAGE_UPDATE);
+    if (signalIndexFile && signalIndex.open(signalIndexFile)) {
+        return true;
+    }
+    if (signalIndexFile) {
+        signalIndexFile->close();
+        signalIndexFile = nullptr;
+    }
+    return false;
+}
+
+// A save the index had no room for; the check sizes the next one to the card
+void requestIndexRebuild() {
+    indexStale = true;
+    if (indexStage == INDEX_IDLE) {
+        startIndexCheck();
+    }
+}
+
+void startIndexCheck() {
+    if (!signalIndex.isOpen() && !openSignalIndex()) {
+        indexStale = true;
+    }
+    indexDir = hal->storage.openDir(REMOTE_FILE_DIR);
+    if (!indexDir) {
+        return;
+    }
+    indexStage = INDEX_CHECK;
+    indexRemotes = 0;
+    indexButtons = 0;
+    indexStartUs = hal->system.micros();
+    scheduler.setPeriod(indexTaskId, INDEX_SERVICE_US);
+    scheduler.runIn(indexTaskId, 0);
+}
+
+// Points indexLibrary at a remote's buttons without moving the app's
+// handle: the remote in use is read through that handle, which sees every
+// save, and any other through one of the task's own, read-only, so a v1
+// file is left for the app to upgrade. Closed at the end of every run, as
+// a save may grow the library into a new file before the next.
+bool openIndexLibrary(const char* remote) {
+    closeIndexLibrary();
+    if (remoteLibrary.isOpen() && openRemoteName == remote) {
+        indexLibrary = &remoteLibrary;
+        return true;
+    }
+    RemotePath path;
+    remoteFilePath(remote, LIBRARY_EXTENSION, path);
+    indexOwnFile = hal->storage.open(path.c_str(), STORAGE_READ);
+    if (!indexOwnFile || !indexOwnLibrary.open(indexOwnFile)) {
+        closeIndexLibrary();
+        return false;
+    }
+    indexLibrary = &indexOwnLibrary;
+    return true;
+}
+
+void closeIndexLibrary() {
+    indexLibrary = nullptr;
+    indexOwnLibrary.close();
+    if (indexOwnFile) {
+        indexOwnFile->close();
+        indexOwnFile = nullptr;
+    }
+}
+
+// Opens the next library in REMOTE_FILE_DIR
+bool nextIndexLibrary() {
+    char name[REMOTE_NAME_MAX + sizeof(LIBRARY_EXTENSION)];
+    while (indexDir->next(name, sizeof(name))) {
+        size_t length = strlen(name);
+        size_t extension = strlen(LIBRARY_EXTENSION);
+        if (length <= extension || strcmp(name + length - extension, LIBRARY_EXTENSION) != 0) {
+            continue;
+        }
+        name[length - extension] = '\0';
+        if (openIndexLibrary(name)) {
+            strcpy(indexRemote, name);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Up to date unless a library changed, appeared or went away; otherwise a
+// new index is laid out with room for every button on the card
+void endIndexCheck() {
+    indexDir->close();
+    indexDir = nullptr;
+    if (!indexStale && indexRemotes == signalIndex.remoteCount()) {
+        logMessage("Signal index: %lu signals from %lu remotes, up to date.", (unsigned long)signalIndex.count(),
+                   (unsigned long)indexRemotes);
+        indexStage = INDEX_IDLE;
+        scheduler.cancel(indexTaskId);
+        return;
+    }
+    indexStale = false;
+    indexCapacity = indexButtons + indexButtons / 2 + SIGNAL_INDEX_SPARE;
+    indexRemoteCapacity = indexRemotes + indexRemotes / 2 + SIGNAL_INDEX_SPARE;
+    indexFormatOffset = 0;
+    newSignalIndexFile = hal->storage.open(SIGNAL_INDEX_PATH ".new", STORAGE_CREATE);
+    if (!newSignalIndexFile) {
+        stopIndexing("Could not create the signal index.");
+        return;
+    }
+    indexStage = INDEX_FORMAT;
+}
+
+void finishIndexBuild() {
+    closeIndexLibrary();
+    indexDir->close();
+    indexDir = nullptr;
+    newSignalIndex.close();
+    newSignalIndexFile->close();
+    newSignalIndexFile = nullptr;
+    signalIndex.close();
+    if (signalIndexFile) {
+        signalIndexFile->close();
+        signalIndexFile = nullptr;
+    }
+    hal->storage.remove(SIGNAL_INDEX_PATH);
+    hal->storage.rename(SIGNAL_INDEX_PATH ".new", SIGNAL_INDEX_PATH);
+    openSignalIndex();
+    logMessage("Signal index: %lu signals from %lu remotes, rebuilt in %lu ms.", (unsigned long)signalIndex.count(),
+               (unsigned long)signalIndex.remoteCount(), (unsigned long)((hal->system.micros() - indexStartUs) / 1000));
+    indexStage = INDEX_IDLE;
+    scheduler.cancel(indexTaskId);
+    // Saves the new index had no room for
+    if (indexStale) {
+        startIndexCheck();
+    }
+}
+
+// The index in use stays as it was
+void stopIndexing(const char* message) {
+    logMessage("%s", message);
+    indexRemote[0] = '\0';
+    closeIndexLibrary();
+    if (indexDir) {
+        indexDir->close();
+        indexDir = nullptr;
+    }
+    newSignalIndex.close();
+    if (newSignalIndexFile) {
+        newSignalIndexFile->close();
+        newSignalIndexFile = nullptr;
+        hal->storage.remove(SIGNAL_INDEX_PATH ".new");
+    }
+    indexStage = INDEX_IDLE;
+    scheduler.cancel(indexTaskId);
+}
+
+// A slice of the check or the rebuild a run. An import's saves reach the
+// index as they happen, so the task waits until it is over.
+void indexTask() {
+    TRACE_SCOPE(TRACE_SIGNAL_INDEX, indexStage);
+    if (importing) {
+        return;
+    }
+    switch (indexStage) {
+    case INDEX_CHECK:
+        for (uint8_t i = 0; i < INDEX_FILES_PER_RUN; i++) {
+            if (!nextIndexLibrary()) {
+                endIndexCheck();
+                return;
+            }
+            if (indexLibrary->count() > 0) {
+                indexRemotes++;
+                indexButtons += indexLibrary->count();
+            }
+            if (!signalIndex.current(indexRemote, *indexLibrary)) {
+                indexStale = true;
+            }
+            closeIndexLibrary();
+        }
+        return;
+    case INDEX_FORMAT:
+        if (!SignalIndex::format(*newSignalIndexFile, indexCapacity, indexRemoteCapacity, indexFormatOffset,
+                                 INDEX_FORMAT_BYTES_PER_RUN)) {
+            stopIndexing("Could not write the signal index.");
+            return;
+        }
+        if (indexFormatOffset < SignalIndex::fileSize(indexCapacity, indexRemoteCapacity)) {
+            return;
+        }
+        indexDir = hal->storage.openDir(REMOTE_FILE_DIR);
+        if (!newSignalIndex.open(newSignalIndexFile) || !indexDir) {
+            stopIndexing("Could not open the new signal index.");
+            return;
+        }
+        indexRemote[0] = '\0';
+        indexStage = INDEX_BUILD;
+        return;
+    case INDEX_BUILD: {
+        // Opening a library costs a button's worth, so empty ones still end the run
+        uint32_t budget = INDEX_RECORDS_PER_RUN;
+        while (budget > 0) {
+            if (indexRemote[0] == '\0') {
+                if (!nextIndexLibrary()) {
+                    finishIndexBuild();
+                    return;
+                }
+                indexNext = 0;
+                budget--;
+            } else if (!indexLibrary && !openIndexLibrary(indexRemote)) {
+                indexRemote[0] = '\0';
+                continue;
+            }
+            uint32_t first = indexNext;
+            if (!newSignalIndex.addLibrary(indexRemote, *indexLibrary, indexNext, budget)) {
+                stopIndexing("Signal index rebuild failed.");
+                return;
+            }
+            budget -= indexNext - first;
+            if (indexNext == indexLibrary->count()) {
+                indexRemote[0] = '\0';
+                closeIndexLibrary();
+            }
+        }
+        closeIndexLibrary();
+        return;
+    }
+    default:
+        scheduler.cancel(indexTaskId);
+        return;
+    }
+}
+
+// Keeps an index in step with a save. A library that was indexed before it
+// still is afterwards; one that was not is left for the next rebuild.
+void indexStoredButton(SignalIndex& index, bool indexed, const char* remote, const ButtonRecord& record,
+                       const PulseCode* raw) {
+    if (!index.isOpen()) {
+        return;
+    }
+    if (!index.add(remote, record, raw) || (indexed && !index.markIndexed(remote, remoteLibrary))) {
+        requestIndexRebuild();
+    }
+}
+
+// Reads a hit's button through a handle of its own, so the shared library
+// stays on the remote in use. A library deleted since it was indexed is
+// skipped, not created again.
+static bool loadIndexedButton(const char* remote, const char* button, ButtonRecord& record, PulseCode& raw) {
+    raw.length = 0;
+    if (remoteLibrary.isOpen() && openRemoteName == remote) {
+        return remoteLibrary.find(button, record) &&
+               (record.rawLength == 0 || remoteLibrary.readRaw(record, raw));
+    }
+    RemotePath path;
+    remoteFilePath(remote, LIBRARY_EXTENSION, path);
+    if (!hal->storage.exists(path.c_str())) {
+        return false;
+    }
+    StorageFile* file = hal->storage.open(path.c_str(), STORAGE_READ);
+    if (!file) {
+        return false;
+    }
+    RemoteLibrary library;
+    bool found = library.open(file) && library.find(button, record) &&
+                 (record.rawLength == 0 || library.readRaw(record, raw));
+    library.close();
+    file->close();
+    return found;
+}
+
+// The first remote other than the current one holding the signal. Each hit
+// is checked against its library, since an overwritten button stays in the
+// index until the next rebuild.
+bool findKnownRemote(const Fingerprint& print, SignalHit& hit) {
+    TRACE_SCOPE(TRACE_SIGNAL_FIND, print.band);
+    SignalHit hits[SIGNAL_INDEX_MAX_HITS];
+    uint8_t found = signalIndex.find(print, hits, SIGNAL_INDEX_MAX_HITS);
+
+    ArenaScope scope(scratchArena);
+    PulseCode* rawCode = scratchArena.allocate<PulseCode>();
+    PulseTrain* raw = scratchArena.allocate<PulseTrain>();
+    if (!rawCode || !raw) {
+        return false;
+    }
+    ButtonRecord record;
+    Fingerprint stored;
+    for (uint8_t i = 0; i < found; i++) {
+        if (currentRemoteName == hits[i].remote || !loadIndexedButton(hits[i].remote, hits[i].button, record, *rawCode)) {
+            continue;
+        }
+        bool hasRaw = rawCode->length && decodePulses(rawCode->bytes, rawCode->length, *raw);
+        if (fingerprintRecord(record, hasRaw ? raw : nullptr, stored) && stored.key == print.key) {
+            hit = hits[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+// Drawn straight onto the surface, a frame per run, then handed over to
+// the widgets
+void introTask() {
+    UiSurface& display = hal->display;
+    UiRect screen = {0, 0, display.width(), display.height()};
+    if (introFrame == INTRO_BITS) {
+        display.fillRect(screen, UI_BLACK);
+        display.push(screen);
+        introShowing = false;
+        scheduler.cancel(introTaskId);
+        ui->invalidate();
+        logMessage("Boot: intro over at %lu ms", (unsigned long)(hal->system.micros() / 1000));
+        return;
+    }
+    if (introFrame == 0) {
+        display.fillRect(screen, UI_BLACK);
+        display.drawText(40, 50, "Remote Possibility", 18, 2, UI_LIGHTCYAN);
+        display.drawText(60, 80, "by salvadorData", 15, 2, UI_LIGHTCYAN);
+        display.push(screen);
+    }
+    int16_t x = 50 + 10 * introFrame;
+    display.drawText(x, 100, "1010101 ", 8, 2, UI_LIGHTCYAN);
+    display.push({x, 100, 8 * 2 * UI_GLYPH_WIDTH, 2 * UI_GLYPH_HEIGHT});
+    if (++introFrame == INTRO_BITS) {
+        scheduler.setPeriod(introTaskId, INTRO_FRAME_US + INTRO_HOLD_US);
+    }
+}
+
+void initializeUI() {
+    ui->setText(menuWidget,
+               "Remote Possibility Interface\n\n"
+               "1. Scan Remote Buttons\n\n"
+               "2. Save Remote Buttons\n\n"
+               "3. Load Remote Files\n\n"
+               "4. Settings");
+    ui->setVisible(messageWidget, false);
+    ui->setVisible(menuWidget, true);
+}
+
+void updatePowerMeter() {
+    char status[24];
+    snprintf(status, sizeof(status), "Power: %d%%", hal->power.batteryLevel());
+    // Unchanged text leaves the widget clean, so nothing is pushed
+    ui->setText(statusWidget, status);
+}
+
+void scanRF24() {
+    TRACE_SCOPE(TRACE_SCAN_RF24, 0);
+    showMessage("Scanning 2.4 GHz RF...");
+
+    if (hasPendingCapture[BAND_RF24]) {
+        hasPendingCapture[BAND_RF24] = false;
+        // The payload is kept whole, binary included; only the display escapes it
+        char text[48];
+        capturedRecord = pendingCaptures[BAND_RF24].record;
+        capturedHasRaw = false;
+        formatRecordData(capturedRecord, text, sizeof(text));
+        remoteData = text;
+        appendMessage("RF24 Button Detected: ");
+        appendMessage(text);
+        saveCapture("RF24Button", BAND_RF24);
+    } else {
+        appendMessage("No 2.4 GHz RF signal found.");
+    }
+}
+
+void scanRF433() {
+    TRACE_SCOPE(TRACE_SCAN_RF433, 0);
+    showMessage("Scanning 433 MHz RF...");
+
+    if (hasPendingCapture[BAND_RF433]) {
+        hasPendingCapture[BAND_RF433] = false;
+        const RadioEvent& event = pendingCaptures[BAND_RF433];
+        // Unknown codes are kept too; the timings replay them all the same
+        char text[48];
+        capturedRecord = event.record;
+        capturedHasRaw = true;
+        capturedRaw = event.frame;
+        if (event.record.protocol == RF433_PROTO_RAW) {
+            snprintf(text, sizeof(text), "RAW %u pulses x%u", event.frame.count, event.record.repeats);
+        } else {
+            formatRecordData(capturedRecord, text, sizeof(text));
+        }
+        remoteData = text;
+        appendMessage("RF433 Button Detected: ");
+        appendMessage(text);
+        saveCapture("RF433Button", BAND_RF433);
+    } else {
+        appendMessage("No 433 MHz RF signal detected.");
+    }
+}
+
+void scanIR() {
+    TRACE_SCOPE(TRACE_SCAN_IR, 0);
+    showMessage("Scanning IR...");
+
+    if (!hasPendingCapture[BAND_IR]) {
+        appendMessage("No IR signal detected.");
+        return;
+    }
+    hasPendingCapture[BAND_IR] = false;
+    const RadioEvent& event = pendingCaptures[BAND_IR];
+
+    ArenaScope scope(scratchArena);
+    const size_t textSize = remoteData.capacity() + 1;
+    char* text = scratchArena.allocate<char>(textSize);
+    if (!text) {
+        appendMessage("Out of scratch memory.");
+        return;
+    }
+    IrCode code;
+    if (event.hasFrame || !recordToIrCode(event.record, code)) {
+        formatIrRaw(event.frame, IR_DEFAULT_CARRIER_KHZ, text, textSize);
+    } else {
+        formatIrCode(code, text, textSize);
+    }
+    remoteData = text;
+
+    capturedRecord = event.record;
+    capturedHasRaw = event.hasFrame;
+    if (capturedHasRaw) {
+        capturedRaw = event.frame;
+    }
+
+    appendMessage("IR Button Detected: ");
+    appendMessage(capturedHasRaw ? "RAW" : text);
+    saveCapture("IRButton", BAND_IR);
+}
+
+// Queues a transmission for the radio task; the result arrives as an event
+void submitTransmit(const ButtonRecord& record, const IrWaveform* waveform, bool repeat) {
+    radioCommand.type = RADIO_TRANSMIT;
+    radioCommand.record = record;
+    radioCommand.irRepeat = repeat;
+    radioCommand.waveform.frameSymbols = 0;
+    if (waveform) {
+        radioCommand.waveform = *waveform;
+    }
+    if (!radioService->submit(radioCommand)) {
+        appendMessage("Radio busy, signal dropped.");
+    }
+}
+
+// Starts or stops capturing nRF24 traffic on every pipe, hopping channels
+void toggleRF24Sniffer() {
+    if (rf24Sniffing) {
+        radioCommand.type = RADIO_SNIFF_STOP;
+        radioService->submit(radioCommand);
+        rf24Sniffing = false;
+        scheduler.cancel(sniffTaskId);
+        drainSniffer();
+        flushSniffLog();
+        if (sniffLog) {
+            sniffLog->close();
+            sniffLog = nullptr;
+        }
+        showTimedMessage("RF24 sniffer stopped.", MESSAGE_TIMEOUT_MS);
+        return;
+    }
+
+    if (rf24Scanning) {
+        toggleRF24Spectrum();
+    }
+    radioCommand.type = RADIO_SNIFF_START;
+    rf24SniffDefaults(radioCommand.sniff);
+    if (!radioService->submit(radioCommand)) {
+        appendMessage("Radio busy, sniffer not started.");
+        return;
+    }
+    rf24Sniffing = true;
+    sniffCounts.clear();
+    lastSniffRecord.length = 0;
+    sniffLogPending = 0;
+    sniffLogOffset = 0;
+    sniffLog = hal->storage.open(SNIFF_LOG_PATH, STORAGE_CREATE);
+    if (!sniffLog) {
+        logMessage("No sniff log, counting only.");
+    }
+    scheduler.setPeriod(sniffTaskId, SNIFF_DISPLAY_US);
+    scheduler.runIn(sniffTaskId, 0);
+}
+
+void drainSniffer() {
+    Rf24Sniffer& sniffer = radioService->sniffer();
+    while (sniffer.pop(sniffRecord)) {
+        sniffCounts.add(sniffRecord);
+        lastSniffRecord = sniffRecord;
+        sniffLogBatch[sniffLogPending++] = sniffRecord;
+        if (sniffLogPending == SNIFF_LOG_BATCH) {
+            flushSniffLog();
+        }
+    }
+}
+
+// Appends the batched records to the capture log as raw 40-byte records
+void flushSniffLog() {
+    size_t length = sniffLogPending * sizeof(Rf24SniffRecord);
+    if (sniffLog && length > 0 && sniffLog->writeAt(sniffLogOffset, sniffLogBatch, length)) {
+        sniffLogOffset += length;
+    }
+    sniffLogPending = 0;
+}
+
+void sniffDisplayTask() {
+    Rf24Sniffer& sniffer = radioService->sniffer();
+    FixedString<UI_TEXT_MAX - 1> text;
+    char line[64];
+
+    snprintf(line, sizeof(line), "RF24 sniff ch %u\n%lu pkts, %lu lost\nTop", sniffer.channel(),
+             (unsigned long)sniffCounts.total, (unsigned long)(sniffer.dropped() + sniffer.overflows()));
+    text.assign(line);
+
+    uint8_t busiest[4];
+    uint8_t found = sniffCounts.busiest(busiest, sizeof(busiest));
+    for (uint8_t i = 0; i < found; i++) {
+        snprintf(line, sizeof(line), " %u:%lu", busiest[i], (unsigned long)sniffCounts.packets[busiest[i]]);
+        text.append(line);
+    }
+
+    if (lastSniffRecord.length > 0) {
+        snprintf(line, sizeof(line), "\nLast ch%u p%u %uB ", lastSniffRecord.channel, lastSniffRecord.pipe,
+                 lastSniffRecord.length);
+        text.append(line);
+        for (uint8_t i = 0; i < lastSniffRecord.length && i < 12; i++) {
+            snprintf(line, sizeof(line), "%02X", lastSniffRecord.payload[i]);
+            text.append(line);
+        }
+    }
+    showMessage(text.c_str());
+}
+
+// Starts or stops sweeping the nRF24 channels for carriers, shown as a heatmap
+void toggleRF24Spectrum() {
+    if (rf24Scanning) {
+        radioCommand.type = RADIO_SPECTRUM_STOP;
+        radioService->submit(radioCommand);
+        rf24Scanning = false;
+        scheduler.cancel(spectrumTaskId);
+        ui->setVisible(spectrumWidget, false);
+        showTimedMessage("Spectrum scan stopped.", MESSAGE_TIMEOUT_MS);
+        return;
+    }
+
+    if (rf24Sniffing) {
+        toggleRF24Sniffer();
+    }
+    radioCommand.type = RADIO_SPECTRUM_START;
+    rf24SpectrumDefaults(radioCommand.spectrum);
+    if (!radioService->submit(radioCommand)) {
+        appendMessage("Radio busy, scan not started.");
+        return;
+    }
+    rf24Scanning = true;
+    spectrumConfig = radioCommand.spectrum;
+    spectrumFrames = 0;
+    spectrumSweeps = 0;
+    spectrumHeaderUs = hal->system.micros();
+
+    int16_t top = 12 + 2 * UI_GLYPH_HEIGHT + 2;
+    heatmap->begin({0, top, hal->display.width(), (int16_t)(hal->display.height() - top)},
+                   spectrumConfig.lastChannel - spectrumConfig.firstChannel + 1, SPECTRUM_ROW_HEIGHT);
+    spectrumCovered = true;
+    ui->setText(spectrumWidget, "2.4 GHz spectrum scan\nw: stop  q: use quietest");
+    ui->setVisible(spectrumWidget, true);
+    ui->setVisible(messageWidget, false);
+    ui->setVisible(menuWidget, false);
+    scheduler.setPeriod(spectrumTaskId, SPECTRUM_FRAME_US);
+    scheduler.runIn(spectrumTaskId, 0);
+}
+
+static uint8_t occupancyPercent(uint16_t occupancy) {
+    return (uint8_t)(((uint32_t)occupancy * 100 + RF24_OCCUPANCY_FULL / 2) / RF24_OCCUPANCY_FULL);
+}
+
+// One heatmap row per frame at a fixed rate, however fast the sweeps run
+void spectrumFrameTask() {
+    // Whatever is shown over the heatmap is painted over once it is gone
+    if (ui->visible(messageWidget) || ui->visible(menuWidget)) {
+        spectrumCovered = true;
+        return;
+    }
+
+    Rf24Spectrum& spectrum = radioService->spectrum();
+    uint8_t first = spectrumConfig.firstChannel;
+    uint8_t last = spectrumConfig.lastChannel;
+    uint8_t busiest = first;
+    for (uint8_t channel = first; channel <= last; channel++) {
+        uint16_t occupancy = spectrum.occupancy(channel);
+        spectrumLevels[channel - first] = occupancy >> 8;
+        if (occupancy > spectrum.occupancy(busiest)) {
+            busiest = channel;
+        }
+    }
+
+    // Erase hidden widgets now, before the heatmap goes on top of them
+    ui->render();
+    if (spectrumCovered) {
+        heatmap->redraw();
+        spectrumCovered = false;
+    }
+    heatmap->addRow(spectrumLevels);
+
+    if (++spectrumFrames % SPECTRUM_HEADER_FRAMES != 0) {
+        return;
+    }
+    uint32_t now = hal->system.micros();
+    uint32_t sweeps = spectrum.sweeps();
+    uint32_t elapsedUs = now - spectrumHeaderUs;
+    uint32_t tenths = elapsedUs ? (uint32_t)((uint64_t)(sweeps - spectrumSweeps) * 10000000ULL / elapsedUs) : 0;
+    spectrumSweeps = sweeps;
+    spectrumHeaderUs = now;
+
+    uint8_t quietest = spectrum.quietest(first, last, rf24Channel);
+    char header[UI_TEXT_MAX];
+    snprintf(header, sizeof(header), "2.4 GHz %lu.%lu sweeps/s  tx ch %u\nQuiet %u %u%%  Busy %u %u%%  q: use",
+             (unsigned long)(tenths / 10), (unsigned long)(tenths % 10), rf24Channel, quietest,
+             occupancyPercent(spectrum.occupancy(quietest)), busiest, occupancyPercent(spectrum.occupancy(busiest)));
+    ui->setText(spectrumWidget, header);
+}
+
+// Moves nRF24 listening and transmits to the quietest channel the last scan saw
+void selectQuietestChannel() {
+    Rf24Spectrum& spectrum = radioService->spectrum();
+    if (spectrum.sweeps() == 0) {
+        showTimedMessage("No spectrum scan yet (w).", MESSAGE_TIMEOUT_MS);
+        return;
+    }
+    radioCommand.type = RADIO_SET_RF24_CHANNEL;
+    radioCommand.channel = spectrum.quietest(spectrumConfig.firstChannel, spectrumConfig.lastChannel, rf24Channel);
+    if (!radioService->submit(radioCommand)) {
+        appendMessage("Radio busy, channel not changed.");
+        return;
+    }
+    rf24Channel = radioCommand.channel;
+
+    char text[48];
+    snprintf(text, sizeof(text), "RF24 now on channel %u (%u MHz).", rf24Channel, 2400 + rf24Channel);
+    showTimedMessage(text, MESSAGE_TIMEOUT_MS);
+}
+
+// Lists the active remote's buttons straight from its library. Pending
+// saves are written first so the list is complete.
+void openButtonBrowser() {
+    if (currentRemoteName.empty()) {
+        showTimedMessage("No remote name set!", MESSAGE_TIMEOUT_MS);
+        return;
+    }
+    buttonCache.flush();
+    if (!openRemoteLibrary(currentRemoteName.c_str())) {
+        showTimedMessage("Could not open remote.", MESSAGE_TIMEOUT_MS);
+        return;
+    }
+    buttonBrowser.open(remoteLibrary);
+    showButtonBrowser();
+}
+
+// The macro picker shares these rows
+void hideBrowserRows() {
+    ui->setVisible(browserHeaderWidget, false);
+    for (uint8_t row = 0; row < BROWSER_ROWS; row++) {
+        ui->setVisible(browserRowWidgets[row], false);
+    }
+    initializeUI();
+}
+
+void closeButtonBrowser() {
+    buttonBrowser.close();
+    hideBrowserRows();
+}
+
+// The library may have been grown into a new file since the last key
+void browserMove(int32_t rows) {
+    if (!openRemoteLibrary(currentRemoteName.c_str())) {
+        closeButtonBrowser();
+        showTimedMessage("Could not open remote.", MESSAGE_TIMEOUT_MS);
+        return;
+    }
+    if (!buttonBrowser.move(rows)) {
+        showTimedMessage("Error reading remote.", MESSAGE_TIMEOUT_MS);
+        return;
+    }
+    showButtonBrowser();
+}
+
+void browserUp() {
+    browserMove(-1);
+}
+
+void browserDown() {
+    browserMove(1);
+}
+
+void browserPageUp() {
+    browserMove(-BROWSER_ROWS);
+}
+
+void browserPageDown() {
+    browserMove(BROWSER_ROWS);
+}
+
+// The browser comes back once the message has been read
+void browserPlay() {
+    if (!buttonBrowser.selectedRecord()) {
+        return;
+    }
+    playbackSavedButton(buttonBrowser.selectedRecord()->name);
+    scheduler.runIn(restoreMenuTaskId, MESSAGE_TIMEOUT_MS * 1000UL);
+}
+
+// Rows are set every time; the Ui pushes only those whose text or colours changed
+void showButtonBrowser() {
+    static const char* const kBandTags[] = {"IR", "2.4G", "433"};
+    char text[REMOTE_NAME_MAX + 32];
+    snprintf(text, sizeof(text), "%s  %lu/%lu", currentRemoteName.c_str(),
+             (unsigned long)(buttonBrowser.count() ? buttonBrowser.selected() + 1 : 0),
+             (unsigned long)buttonBrowser.count());
+    ui->setText(browserHeaderWidget, text);
+    ui->setVisible(browserHeaderWidget, true);
+
+    for (uint8_t row = 0; row < BROWSER_ROWS; row++) {
+        const ButtonRecord* record = buttonBrowser.row(row);
+        bool selected = record && row == buttonBrowser.selectedRow();
+        text[0] = '\0';
+        if (record) {
+            const char* tag = record->band <= BAND_RF433 ? kBandTags[record->band] : "HEX";
+            snprintf(text, sizeof(text), "%5lu %-*.*s %s", (unsigned long)(buttonBrowser.top() + row + 1),
+                     BUTTON_NAME_MAX - 1, BUTTON_NAME_MAX - 1, record->name, tag);
+        }
+        ui->setText(browserRowWidgets[row], text);
+        ui->setColors(browserRowWidgets[row], selected ? UI_BLACK : UI_WHITE, selected ? UI_LIGHTCYAN : UI_BLACK);
+        ui->setVisible(browserRowWidgets[row], true);
+    }
+    ui->setVisible(menuWidget, false);
+    ui->setVisible(messageWidget, false);
+}
+
+// Compiles the macro against the active remote's buttons and hands the
+// schedule to the radio task; playing again while it plays stops it. An
+// empty name plays the first macro of the remote.
+void playMacro(const char* name) {
+    if (macroPlaying) {
+        stopMacro();
+        return;
+    }
+    if (currentRemoteName.empty()) {
+        showTimedMessage("No remote name set!", MESSAGE_TIMEOUT_MS);
+        return;
+    }
+
+    uint8_t count = 0;
+    uint8_t failedStep = 0;
+    if (!loadMacro(name, count) || count == 0) {
+        showTimedMessage("Macro not found.", MESSAGE_TIMEOUT_MS);
+        return;
+    }
+    if (!compileMacro(macroSteps, count, macroButton, macroSchedule, failedStep)) {
+        char text[64];
+        snprintf(text, sizeof(text), "Macro step %u failed: %s", failedStep + 1, macroSteps[failedStep].button);
+        showTimedMessage(text, MESSAGE_TIMEOUT_MS);
+        return;
+    }
+
+    radioCommand.type = RADIO_MACRO_START;
+    radioCommand.macro = &macroSchedule;
+    if (!radioService->submit(radioCommand)) {
+        appendMessage("Radio busy, macro not started.");
+        return;
+    }
+    macroPlaying = true;
+    char text[64];
+    snprintf(text, sizeof(text), "Playing macro: %u sends over %lu ms", macroSchedule.eventCount,
+             (unsigned long)(macroSchedule.lengthUs / 1000));
+    showMessage(text, UI_LIGHTCYAN);
+}
+
+void stopMacro() {
+    radioCommand.type = RADIO_MACRO_STOP;
+    radioService->submit(radioCommand);
+}
+
+// One line of a macro file, without its line ending
+size_t readMacroLine(StorageFile& file, char* line, size_t size) {
+    size_t length = file.readLine(line, size - 1);
+    line[length] = '\0';
+    if (length > 0 && line[length - 1] == '\r') {
+        line[--length] = '\0';
+    }
+    return length;
+}
+
+// Macros live next to the remote's library, in sections:
+//   [name]
+//   <button> [band] [delay ms] [presses]
+bool loadMacro(const char* name, uint8_t& count) {
+    RemotePath path;
+    remoteFilePath(currentRemoteName.c_str(), MACRO_EXTENSION, path);
+    StorageFile* file = hal->storage.open(path.c_str(), STORAGE_READ);
+    if (!file) {
+        return false;
+    }
+
+    char line[64];
+    bool inMacro = false;
+    bool found = false;
+    count = 0;
+    while (file->available()) {
+        readMacroLine(*file, line, sizeof(line));
+        if (line[0] == '[') {
+            char* end = strchr(line, ']');
+            if (found) {
+                break;
+            }
+            if (end) {
+                *end = '\0';
+                inMacro = name[0] == '\0' || strncmp(line + 1, name, MACRO_NAME_MAX) == 0;
+                found = inMacro;
+            }
+            continue;
+        }
+        if (!inMacro || line[0] == '\0' || line[0] == '#') {
+            continue;
+        }
+        if (count == MACRO_MAX_STEPS || !parseMacroStep(line, macroSteps[count])) {
+            logMessage("Bad macro line: %s", line);
+            found = false;
+            break;
+        }
+        count++;
+    }
+    file->close();
+    return found;
+}
+
+const CachedButton* macroButton(const char* buttonName) {
+    return buttonCache.get(buttonName);
+}
+
+// The [name] of every section in the remote's macro file, in file order
+uint8_t listMacros(MacroName* names, uint8_t maxNames) {
+    RemotePath path;
+    remoteFilePath(currentRemoteName.c_str(), MACRO_EXTENSION, path);
+    StorageFile* file = hal->storage.open(path.c_str(), STORAGE_READ);
+    if (!file) {
+        return 0;
+    }
+
+    char line[64];
+    uint8_t count = 0;
+    while (count < maxNames && file->available()) {
+        readMacroLine(*file, line, sizeof(line));
+        char* end = strchr(line, ']');
+        if (line[0] == '[' && end) {
+            *end = '\0';
+            names[count++] = line + 1;
+        }
+    }
+    file->close();
+    return count;
+}
+
+// Lists the remote's macros for Enter to play. While one plays, the key
+// stops it instead.
+void openMacroPicker() {
+    if (macroPlaying) {
+        stopMacro();
+        return;
+    }
+    if (currentRemoteName.empty()) {
+        showTimedMessage("No remote name set!", MESSAGE_TIMEOUT_MS);
+        return;
+    }
+    macroNameCount = listMacros(macroNames, MACRO_PICKER_MAX);
+    if (macroNameCount == 0) {
+        showTimedMessage("Macro not found.", MESSAGE_TIMEOUT_MS);
+        return;
+    }
+    macroSelected = 0;
+    macroPicking = true;
+    showMacroPicker();
+}
+
+void closeMacroPicker() {
+    macroPicking = false;
+    hideBrowserRows();
+}
+
+void macroPickerUp() {
+    if (macroSelected > 0) {
+        macroSelected--;
+    }
+    showMacroPicker();
+}
+
+void macroPickerDown() {
+    if (macroSelected + 1 < macroNameCount) {
+        macroSelected++;
+    }
+    showMacroPicker();
+}
+
+void macroPickerPlay() {
+    MacroName name = macroNames[macroSelected];
+    closeMacroPicker();
+    playMacro(name.c_str());
+}
+
+// The window scrolls to keep the selection on its last row
+void showMacroPicker() {
+    char text[REMOTE_NAME_MAX + 32];
+    snprintf(text, sizeof(text), "%s macros  %u/%u", currentRemoteName.c_str(), macroSelected + 1, macroNameCount);
+    ui->setText(browserHeaderWidget, text);
+    ui->setVisible(browserHeaderWidget, true);
+
+    uint8_t top = macroSelected < BROWSER_ROWS ? 0 : macroSelected - BROWSER_ROWS + 1;
+    for (uint8_t row = 0; row < BROWSER_ROWS; row++) {
+        uint8_t index = top + row;
+        bool selected = index == macroSelected;
+        text[0] = '\0';
+        if (index < macroNameCount) {
+            snprintf(text, sizeof(text), "%5u %s", index + 1, macroNames[index].c_str());
+        }
+        ui->setText(browserRowWidgets[row], text);
+        ui->setColors(browserRowWidgets[row], selected ? UI_BLACK : UI_WHITE, selected ? UI_LIGHTCYAN : UI_BLACK);
+        ui->setVisible(browserRowWidgets[row], true);
+    }
+    ui->setVisible(menuWidget, false);
+    ui->setVisible(messageWidget, false);
+}
+
+// Arms every receiver and waits for whichever band is heard first. Sniffing
+// and scanning hold the nRF24 receiver, so they stop.
+void toggleLearnMode() {
+    if (learning) {
+        stopLearning("Learn mode stopped.");
+        return;
+    }
+    if (rf24Sniffing) {
+        toggleRF24Sniffer();
+    }
+    if (rf24Scanning) {
+        toggleRF24Spectrum();
+    }
+    radioCommand.type = RADIO_SET_LISTEN;
+    radioCommand.listenMask = RADIO_LISTEN_ALL;
+    if (!radioService->submit(radioCommand)) {
+        appendMessage("Radio busy, learn mode not started.");
+        return;
+    }
+    for (uint8_t band = 0; band < RADIO_BANDS; band++) {
+        hasPendingCapture[band] = false;
+        capturePrinted[band] = false;
+        learnDropBase[band] = radioService->droppedCaptures(band);
+    }
+    learning = true;
+    learnStartUs = hal->system.micros();
+    scheduler.cancel(restoreMenuTaskId);
+    scheduler.setPeriod(learnTaskId, LEARN_DISPLAY_US);
+    scheduler.runIn(learnTaskId, 0);
+}
+
+// `message` is shown briefly; nullptr leaves the screen to the caller
+void stopLearning(const char* message) {
+    learning = false;
+    scheduler.cancel(learnTaskId);
+    if (message) {
+        showTimedMessage(message, MESSAGE_TIMEOUT_MS);
+    }
+}
+
+void learnTask() {
+    uint32_t elapsedUs = hal->system.micros() - learnStartUs;
+    if (elapsedUs >= LEARN_TIMEOUT_US) {
+        stopLearning("Nothing heard on any band.");
+        return;
+    }
+    char text[96];
+    snprintf(text, sizeof(text),
+             "Learning: press a remote button (%lus)\n\nDropped IR %lu  RF24 %lu  433 %lu",
+             (unsigned long)((LEARN_TIMEOUT_US - elapsedUs) / 1000000),
+             (unsigned long)(radioService->droppedCaptures(BAND_IR) - learnDropBase[BAND_IR]),
+             (unsigned long)(radioService->droppedCaptures(BAND_RF24) - learnDropBase[BAND_RF24]),
+             (unsigned long)(radioService->droppedCaptures(BAND_RF433) - learnDropBase[BAND_RF433]));
+    showMessage(text, UI_LIGHTCYAN);
+}
+
+void sendRF24Signal(StringView data) {
+    TRACE_SCOPE(TRACE_SEND_RF24, data.length);
+    showMessage("Sending 2.4 GHz RF signal...");
+
+    // Longer than one payload goes out in fragments
+    uint16_t length = data.length < RF24_MESSAGE_MAX ? data.length : RF24_MESSAGE_MAX;
+    memcpy(radioCommand.message, data.data, length);
+    radioCommand.messageLength = length;
+
+    ButtonRecord record;
+    recordClear(record, "");
+    record.band = BAND_RF24;
+    record.payloadLength = length < BUTTON_PAYLOAD_MAX ? length : BUTTON_PAYLOAD_MAX;
+    memcpy(record.payload, data.data, record.payloadLength);
+    submitTransmit(record, nullptr, false);
+}
+
+void sendRF433Waveform(const ButtonRecord& record, const IrWaveform& waveform) {
+    TRACE_SCOPE(TRACE_SEND_RF433, 0);
+    showMessage("Sending 433 MHz RF signal...");
+    submitTransmit(record, &waveform, false);
+}
+
+void sendIRSignal(const ButtonRecord& record, const IrWaveform& waveform, bool repeat) {
+    TRACE_SCOPE(TRACE_SEND_IR, repeat);
+    showMessage(repeat ? "Repeating IR signal..." : "Sending IR signal...");
+
+    // Legacy records were compiled as NEC
+    ButtonRecord named = record;
+    named.band = BAND_IR;
+    submitTransmit(named, &waveform, repeat);
+}
+
+void remoteFilePath(const char* remoteName, const char* extension, RemotePath& path) {
+    path.assign(REMOTE_FILE_DIR).append(remoteName).append(extension);
+}
+
+// Rewrites the open library into a fresh file with `capacity` slots and swaps
+// it in. The library is closed afterwards either way.
+bool rebuildRemoteLibrary(uint32_t capacity) {
+    RemotePath path;
+    RemotePath tempPath;
+    remoteFilePath(openRemoteName.c_str(), LIBRARY_EXTENSION, path);
+    remoteFilePath(openRemoteName.c_str(), LIBRARY_EXTENSION ".tmp", tempPath);
+    StorageFile* rebuiltFile = hal->storage.open(tempPath.c_str(), STORAGE_CREATE);
+    bool rebuilt = rebuiltFile && RemoteLibrary::rebuild(remoteLibrary, *rebuiltFile, capacity);
+    if (rebuiltFile) {
+        rebuiltFile->close();
+    }
+    closeRemoteLibrary();
+
+    if (!rebuilt) {
+        hal->storage.remove(tempPath.c_str());
+        return false;
+    }
+    hal->storage.remove(path.c_str());
+    hal->storage.rename(tempPath.c_str(), path.c_str());
+    return true;
+}
+
+// Stores a library entry, growing the file into a copy with twice the capacity
+// when full. Raw timings left behind by overwrites are compacted away the
+// same way, at the same capacity, once there are enough of them.
+bool putLibraryRecord(const ButtonRecord& record, const PulseCode* raw) {
+    const uint8_t* rawBytes = raw && raw->length ? raw->bytes : nullptr;
+    uint16_t rawLength = rawBytes ? raw->length : 0;
+    RemoteName remoteName = openRemoteName;
+
+    if (remoteLibrary.put(record, rawBytes, rawLength)) {
+        if (remoteLibrary.needsCompaction() &&
+            (!rebuildRemoteLibrary(remoteLibrary.capacity()) || !openRemoteLibrary(remoteName.c_str()))) {
+            logMessage("Could not compact %s", remoteName.c_str());
+        }
+        return true;
+    }
+    if (!remoteLibrary.full()) {
+        return false;
+    }
+
+    return rebuildRemoteLibrary(remoteLibrary.capacity() * 2) && openRemoteLibrary(remoteName.c_str()) &&
+           remoteLibrary.put(record, rawBytes, rawLength);
+}
+
+// One-time conversion of a "name,data" text remote; the .txt file is left in place
+bool migrateLegacyRemote(const char* legacyPath) {
+    ArenaScope scope(scratchArena);
+    const size_t lineSize = IR_MAX_PULSES * 6 + 64;
+    char* line = scratchArena.allocate<char>(lineSize);
+    PulseTrain* raw = scratchArena.allocate<PulseTrain>();
+    PulseCode* rawCode = scratchArena.allocate<PulseCode>();
+    if (!line || !raw || !rawCode) {
+        return false;
+    }
+    StorageFile* legacyFile = hal->storage.open(legacyPath, STORAGE_READ);
+    if (!legacyFile) {
+        return false;
+    }
+
+    ButtonRecord record;
+    ButtonRecord existing;
+    bool hasRaw;
+
+    while (legacyFile->available()) {
+        size_t length = legacyFile->readLine(line, lineSize - 1);
+        line[length] = '\0';
+        char* separator = strchr(line, ',');
+        if (!separator) {
+            continue;
+        }
+        *separator = '\0';
+
+        recordClear(record, line);
+        // The old loader stopped at the first match, so earlier lines win
+        if (remoteLibrary.find(record.name, existing) ||
+            !recordFromLegacyText(record, separator + 1, *raw, hasRaw)) {
+            continue;
+        }
+        if (hasRaw && !encodePulses(*raw, *rawCode)) {
+            continue;
+        }
+        putLibraryRecord(record, hasRaw ? rawCode : nullptr);
+    }
+
+    legacyFile->close();
+    return true;
+}
+
+void closeRemoteLibrary() {
+    remoteLibrary.close();
+    if (remoteLibraryFile) {
+        remoteLibraryFile->close();
+        remoteLibraryFile = nullptr;
+    }
+    openRemoteName.clear();
+}
+
+static bool openLibraryFile(const char* remoteName, const RemotePath& path) {
+    remoteLibraryFile = hal->storage.open(path.c_str(), STORAGE_UPDATE);
+    if (!remoteLibraryFile || !remoteLibrary.open(remoteLibraryFile)) {
+        closeRemoteLibrary();
+        return false;
+    }
+    openRemoteName = remoteName;
+    return true;
+}
+
+bool openRemoteLibrary(const char* remoteName) {
+    if (remoteName[0] == '\0') {
+        return false;
+    }
+    if (remoteLibrary.isOpen() && openRemoteName == remoteName) {
+        return true;
+    }
+
+    closeRemoteLibrary();
+
+    RemotePath path;
+    remoteFilePath(remoteName, LIBRARY_EXTENSION, path);
+    bool created = false;
+    if (!hal->storage.exists(path.c_str())) {
+        if (!hal->storage.exists(REMOTE_FILE_DIR)) {
+            hal->storage.mkdir(REMOTE_FILE_DIR);
+        }
+        StorageFile* file = hal->storage.open(path.c_str(), STORAGE_CREATE);
+        bool formatted = file && RemoteLibrary::format(*file);
+        if (file) {
+            file->close();
+        }
+        if (!formatted) {
+            return false;
+        }
+        created = true;
+    }
+
+    if (!openLibraryFile(remoteName, path)) {
+        return false;
+    }
+
+    // Version 1 files hold uncompressed timings and are converted once; if
+    // that fails they stay readable
+    if (remoteLibrary.version() < LIBRARY_VERSION) {
+        if (!rebuildRemoteLibrary(remoteLibrary.capacity())) {
+            logMessage("Could not upgrade %s", path.c_str());
+        }
+        if (!openLibraryFile(remoteName, path)) {
+            return false;
+        }
+    }
+
+    RemotePath legacyPath;
+    remoteFilePath(remoteName, ".txt", legacyPath);
+    if (created && hal->storage.exists(legacyPath.c_str())) {
+        migrateLegacyRemote(legacyPath.c_str());
+    }
+    return true;
+}
+
+// Saves the capture unless the remote already has it, under any name.
+// Near matches are saved but pointed out: a toggle bit, or the wrong button.
+void saveCapture(const char* buttonName, uint8_t band) {
+    char text[72];
+    // An IR press can be several full frames; replay sends as many. A 433 MHz
+    // burst already holds its frame count.
+    if (band == BAND_IR) {
+        capturedRecord.repeats = captureRepeats[band] < 0xFF ? (uint8_t)captureRepeats[band] : 0xFF;
+    }
+    if (captureRepeats[band] > 1) {
+        snprintf(text, sizeof(text), "Heard %u times, kept once.", captureRepeats[band]);
+        appendMessage(text);
+    }
+    const char* existing = nullptr;
+    FingerprintMatch match = FINGERPRINT_NEW;
+    if (capturePrinted[band]) {
+        match = buttonCache.fingerprints().match(capturePrints[band], existing);
+    }
+    if (match == FINGERPRINT_DUPLICATE) {
+        snprintf(text, sizeof(text), "Already saved as %s.", existing);
+        appendMessage(text);
+        return;
+    }
+    if (match == FINGERPRINT_NEAR) {
+        snprintf(text, sizeof(text), "Similar to %s.", existing);
+        appendMessage(text);
+    }
+    SignalHit hit;
+    if (capturePrinted[band] && findKnownRemote(capturePrints[band], hit)) {
+        snprintf(text, sizeof(text), "Known as %s in %s.", hit.button, hit.remote);
+        appendMessage(text);
+    }
+    saveRemoteButton(buttonName);
+}
+
+void saveRemoteButton(const char* buttonName) {
+    if (currentRemoteName.empty()) {
+        appendMessage("No remote name set!");
+        return;
+    }
+    saveRemoteData(buttonName, capturedRecord, capturedHasRaw ? &capturedRaw : nullptr);
+}
+
+void saveRemoteData(const char* buttonName, const ButtonRecord& record, const PulseTrain* raw) {
+    TRACE_SCOPE(TRACE_SAVE_REMOTE_DATA, record.band);
+    RemotePath path;
+    remoteFilePath(currentRemoteName.c_str(), LIBRARY_EXTENSION, path);
+    showMessage("Saving button to ");
+    appendMessage(path.c_str());
+
+    // Written back to the card from loop() by the cache
+    ButtonRecord named = record;
+    recordSetName(named, buttonName);
+    if (!buttonCache.put(named, raw)) {
+        appendMessage("Error writing file.");
+        return;
+    }
+    appendMessage("Button Saved!");
+}
+
+static bool readRecordRaw(const ButtonRecord& record, PulseCode& raw) {
+    raw.length = 0;
+    return record.rawLength == 0 || remoteLibrary.readRaw(record, raw);
+}
+
+bool SdButtonStore::load(const char* remote, const char* button, ButtonRecord& record, PulseCode& raw) {
+    TRACE_SCOPE(TRACE_SD_LOAD, 0);
+    return openRemoteLibrary(remote) && remoteLibrary.find(button, record) && readRecordRaw(record, raw);
+}
+
+bool SdButtonStore::loadAt(const char* remote, uint32_t index, ButtonRecord& record, PulseCode& raw) {
+    TRACE_SCOPE(TRACE_SD_LOAD, index);
+    return openRemoteLibrary(remote) && remoteLibrary.recordAt(index, record) && readRecordRaw(record, raw);
+}
+
+bool SdButtonStore::store(const char* remote, const ButtonRecord& record, const PulseCode* raw) {
+    TRACE_SCOPE(TRACE_SD_STORE, record.band);
+    if (!openRemoteLibrary(remote)) {
+        return false;
+    }
+    bool indexed = signalIndex.current(remote, remoteLibrary);
+    bool newIndexed = newSignalIndex.current(remote, remoteLibrary);
+    if (!putLibraryRecord(record, raw)) {
+        return false;
+    }
+    indexStoredButton(signalIndex, indexed, remote, record, raw);
+    indexStoredButton(newSignalIndex, newIndexed, remote, record, raw);
+    return true;
+}
+
+// Cached buttons live in PSRAM when the board has it
+void* allocateCacheMemory(size_t size) {
+    return hal->system.allocate(size);
+}
+
+// Keeps the current remote while saves to it are still unwritten
+bool selectRemote(const char* name) {
+    if (!buttonCache.selectRemote(name)) {
+        return false;
+    }
+    currentRemoteName = name;
+    return true;
+}
+
+const CachedButton* loadRemoteButton(const char* buttonName) {
+    TRACE_SCOPE(TRACE_LOAD_REMOTE_BUTTON, 0);
+    if (currentRemoteName.empty()) {
+        appendMessage("No remote name set!");
+        return nullptr;
+    }
+
+    const CachedButton* button = buttonCache.get(buttonName);
+    if (!button) {
+        return nullptr;
+    }
+
+    char text[48];
+    formatRecordData(button->record, text, sizeof(text));
+    remoteData = text;
+    return button;
+}
+
+void playbackSavedButton(const char* buttonName) {
+    const CachedButton* button = loadRemoteButton(buttonName);
+
+    if (button) {
+        // Transmit first; the cached waveform is ready to go
+        uint32_t now = hal->system.micros();
+        bool held = button == lastPlayback && now - lastPlaybackUs < IR_HOLD_WINDOW_US;
+        lastPlayback = button;
+        lastPlaybackUs = now;
+        // Only on the button's own band; legacy values were compiled as NEC
+        if (button->record.band == BAND_RF433) {
+            sendRF433Waveform(button->record, button->waveform);
+        } else if (button->record.band == BAND_RF24) {
+            sendRF24Signal(StringView((const char*)button->record.payload, button->record.payloadLength));
+        } else if (button->waveform.frameSymbols > 0) {
+            sendIRSignal(button->record, button->waveform, held);
+        }
+
+        showMessage("Playing back button...\n\n");
+        appendMessage("Data: ");
+        appendMessage(remoteData.c_str());
+    } else {
+        showTimedMessage("Button not found.", MESSAGE_TIMEOUT_MS);
+    }
+}
+
+void logMessage(const char* format, ...) {
+    char line[160];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    hal->system.log(line);
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "hal.h"
+
+// The firmware proper: menus, scanning, the remote library and playback.
+// Everything it touches goes through `hal`, so the same code runs on the
+// device and in the native simulator.
+void appSetup(Hal& hal);
+
+// One scheduler pass; sleeps through the HAL until the next deadline.
+void appLoop();
@@ -0,0 +1,2404 @@
+#include "bench.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "button_cache.h"
+#include "fingerprint.h"
+#include "fixed_string.h"
+#include "frame_assembler.h"
+#include "ir_capture.h"
+#include "ir_codec.h"
+#include "ir_import.h"
+#include "ir_waveform.h"
+#include "key_input.h"
+#include "macro.h"
+#include "pulse_codec.h"
+#include "radio_hardware.h"
+#include "radio_service.h"
+#include "remote_library.h"
+#include "rf24_tx_queue.h"
+#include "scheduler.h"
+#include "signal_index.h"
+#include "spsc_ring.h"
+#include "trace.h"
+#include "ui.h"
+
+#define BENCH_PLAYBACK_BUTTONS 100
+#define BENCH_OVERWRITES 1000
+#define BENCH_PRESS_BUTTONS 48         // All fit in the cache once it is warm
+#define BENCH_SOAK_NAMES 32
+#define BENCH_FRAME_GAP_US 40000
+#define BENCH_REPLAY_PRESSES 200
+#define BENCH_REPLAY_MAX_REPEATS 6     // Repeat codes of the longest hold
+#define BENCH_REPLAY_STALL_EVERY 16    // Presses between radio task stalls
+#define BENCH_REPLAY_POLL_US 5000      // The radio task's rate
+#define BENCH_CODEC_VARIANTS 4         // Jittered copies per protocol and frame count
+#define BENCH_CODEC_MAX_FRAMES 3       // Held-button captures repeat the frame
+#define BENCH_CODEC_PASSES 16          // Decodes per capture, for stable timings
+#define BENCH_FINGERPRINT_FRAMES 2000
+#define BENCH_RF24_MESSAGES 400
+#define BENCH_RF24_CALL_US 12          // One SPI transaction with the chip
+#define BENCH_RF24_SETTLE_US 130       // PLL settling before each packet
+#define BENCH_RF24_PACKET_US 328       // Preamble, address, PCF, 32 bytes and CRC at 1 Mbps
+#define BENCH_RF24_ACK_US 202          // Turnaround and an empty ACK packet
+#define BENCH_SNIFF_SECONDS 10
+#define BENCH_SNIFF_PACKET_US 300      // 32 bytes at 2 Mbps, back to back after the sender's PLL settles
+#define BENCH_SNIFF_FIFO 3             // The chip's receive FIFO
+#define BENCH_SNIFF_READ_US 60         // Status, length and a 32-byte payload over SPI
+#define BENCH_SNIFF_TICK_US 1000       // FreeRTOS tick; the radio task yields until the next one
+#define BENCH_SNIFF_DRAIN_US 5000      // The app's radio task rate
+#define BENCH_SNIFF_STALL_EVERY 40     // Drains between slow app loop iterations
+#define BENCH_SNIFF_STALL_US 25000     // A UI frame and an SD write back to back
+#define BENCH_MACRO_RUNS 20
+#define BENCH_KEY_PRESSES 2000
+#define BENCH_SCHED_PRESSES 2000
+#define BENCH_SCHED_GAP_MIN_US 20000   // Between presses, at most a fast typist's pace
+#define BENCH_SCHED_GAP_SPREAD_US 60000
+#define BENCH_MACRO_TICK_US 1000       // The radio task's sleep when nothing is due
+#define BENCH_MACRO_STEP_US 40         // Upper bound of one step's cost while polling
+#define BENCH_MACRO_SEND_US 150        // Handing a frame to the transmitter
+#define BENCH_MACRO_LATE_US 1000
+#define BENCH_TRACE_SCOPES 20000
+#define BENCH_UI_WIDTH 240             // The Cardputer's panel
+#define BENCH_UI_HEIGHT 135
+#define BENCH_UI_FRAMES 900            // 30 s at the UI task's 30 Hz
+#define BENCH_UI_MAX_PERCENT 10        // Of a full screen per frame, on average
+#define BENCH_TRACE_RECORD_NS 1000     // Budget for one record, clock read included
+#define BENCH_IMPORT_BUTTONS 8000      // Per generated database, half NEC and half raw
+#define BENCH_IMPORT_RAW_PAIRS 60
+#define BENCH_SIGNAL_BUTTONS 16        // Per remote of the signal index benchmark
+
+static const uint32_t kLibrarySizes[] = {10, 100, 1000};
+static const uint32_t kSignalIndexRemotes[] = {10, 100, 1000};
+static const uint8_t kRf24LossPercent[] = {0, 10, 30};
+static const uint32_t kStorageReadUs[] = {500, 5000};    // Per read: a quick card, one busy wear-levelling
+static const uint32_t kKeyGapsMs[][2] = {{60, 250}, {12, 40}};  // Between keystrokes: a fast typist, a burst
+
+// Codes that survive an encode/decode round trip unchanged
+static const IrCode kBenchCodes[] = {
+    {IR_PROTO_NEC, 32, false, 0x20DF10EFULL},
+    {IR_PROTO_NEC_EXT, 32, false, 0x1D2A40BFULL},  // Address bytes that are not each other's inverse
+    {IR_PROTO_SAMSUNG, 32, false, 0xE0E040BFULL},
+    {IR_PROTO_PANASONIC, 48, false, 0x40040100BCBDULL},
+    {IR_PROTO_SONY, 12, false, 0xA90ULL},
+    {IR_PROTO_RC6, 21, false, 0x10000CULL},
+    {IR_PROTO_RC5, 14, false, 0x300CULL},
+};
+
+static Hal* hal = nullptr;
+
+// One JSON object per line, built without touching the heap
+class JsonLine {
+public:
+    explicit JsonLine(const char* bench) {
+        _text.assign("{\"bench\":\"").append(bench).append('"');
+    }
+
+    JsonLine& add(const char* key, uint64_t value) {
+        char digits[24];
+        snprintf(digits, sizeof(digits), "%llu", (unsigned long long)value);
+        field(key).append(digits);
+        return *this;
+    }
+
+    JsonLine& add(const char* key, const char* value) {
+        field(key).append('"').append(value).append('"');
+        return *this;
+    }
+
+    JsonLine& add(const char* key, bool value) {
+        field(key).append(value ? "true" : "false");
+        return *this;
+    }
+
+    void emit() {
+        _text.append('}');
+        hal->system.log(_text.c_str());
+    }
+
+private:
+    FixedString<320>& field(const char* key) {
+        return _text.append(",\"").append(key).append("\":");
+    }
+
+    FixedString<320> _text;
+};
+
+struct Latency {
+    uint32_t count = 0;
+    uint64_t totalNs = 0;
+    uint32_t maxNs = 0;
+
+    void add(uint32_t ns) {
+        count++;
+        totalNs += ns;
+        if (ns > maxNs) {
+            maxNs = ns;
+        }
+    }
+
+    uint32_t averageNs() const { return count ? (uint32_t)(totalNs / count) : 0; }
+};
+
+// Appends to a file written front to back through the HAL's offset writes
+class BenchWriter {
+public:
+    explicit BenchWriter(StorageFile* file) : _file(file) {}
+
+    BenchWriter& line(const char* format, ...) {
+        char text[IMPORT_LINE_MAX];
+        va_list args;
+        va_start(args, format);
+        int length = vsnprintf(text, sizeof(text), format, args);
+        va_end(args);
+        if (length < 0 || (size_t)length >= sizeof(text) - 1) {
+            _ok = false;
+            return *this;
+        }
+        text[length++] = '\n';
+        _ok = _file->writeAt(_offset, text, length) && _ok;
+        _offset += length;
+        return *this;
+    }
+
+    bool ok() const { return _ok; }
+    uint32_t bytes() const { return _offset; }
+
+private:
+    StorageFile* _file;
+    uint32_t _offset = 0;
+    bool _ok = true;
+};
+
+static uint32_t cyclesToNs(uint32_t cycles) {
+    return (uint32_t)((uint64_t)cycles * 1000 / hal->system.cyclesPerUs());
+}
+
+static uint32_t elapsedNs(uint32_t startCycles) {
+    return cyclesToNs(hal->system.cycleCount() - startCycles);
+}
+
+// Deterministic, so runs on different builds see the same inputs
+static uint32_t benchRandom() {
+    static uint32_t state = 0x12345678;
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+// Stretches marks and shrinks spaces the way a real receiver does
+static void jitter(PulseTrain& train) {
+    for (uint16_t i = 0; i < train.count; i++) {
+        int32_t offset = (int32_t)(benchRandom() % 121) - 40;
+        int32_t duration = train.durations[i] + ((i & 1) ? -offset : offset);
+        train.durations[i] = duration > 50 ? duration : 50;
+    }
+}
+
+static void benchName(char* name, size_t size, const char* prefix, uint32_t index) {
+    snprintf(name, size, "%s%04lu", prefix, (unsigned long)index);
+}
+
+// Next capture of a corpus file: "RAW:38:9000 4500 ...", or the same
+// labelled with the code it carries, "NEC:32:20DF10EF:RAW:38:9000 ...".
+// `label`, when given, is left IR_PROTO_RAW for an unlabelled line.
+static bool corpusCapture(StorageFile* corpus, PulseTrain& train, IrCode* label = nullptr) {
+    static char line[IR_MAX_PULSES * 6 + 48];
+    uint8_t carrierKhz;
+    while (corpus->available()) {
+        size_t length = corpus->readLine(line, sizeof(line) - 1);
+        line[length] = '\0';
+        const char* raw = strncmp(line, "RAW:", 4) == 0 ? line : strstr(line, ":RAW:");
+        if (!raw || !parseIrRaw(raw == line ? raw : raw + 1, train, carrierKhz)) {
+            continue;
+        }
+        if (label && (raw == line || !parseIrCode(line, *label))) {
+            label->protocol = IR_PROTO_RAW;
+        }
+        return true;
+    }
+    return false;
+}
+
+static StorageFile* openCorpus(bool storage) {
+    return storage && hal->storage.exists(BENCH_CORPUS) ? hal->storage.open(BENCH_CORPUS, STORAGE_READ) : nullptr;
+}
+
+// What one reference protocol's frames decoded as
+struct DecodeTally {
+    uint32_t frames;
+    uint32_t decodedAs[IR_PROTO_COUNT];
+    uint32_t wrongValue;
+    uint64_t totalNs;
+};
+
+static void tallyDecode(const PulseTrain& train, const IrCode& reference, DecodeTally& tally) {
+    IrCode code;
+    uint32_t start = hal->system.cycleCount();
+    decodeIr(train, code);
+    tally.totalNs += elapsedNs(start);
+    tally.frames++;
+    tally.decodedAs[code.protocol < IR_PROTO_COUNT ? code.protocol : IR_PROTO_RAW]++;
+    tally.wrongValue += code.protocol == reference.protocol && code.value != reference.value;
+}
+
+// One row of the confusion matrix: what the reference protocol's frames
+// came out as, "as_<protocol>" for every other protocol they were taken for
+static bool emitDecode(IrProtocol reference, const DecodeTally& tally, const char* source) {
+    uint32_t misclassified = tally.frames - tally.decodedAs[reference];
+    bool passed = misclassified == 0 && tally.wrongValue == 0;
+    uint32_t nsPerFrame = tally.frames ? (uint32_t)(tally.totalNs / tally.frames) : 0;
+    JsonLine line("decode");
+    line.add("source", source)
+        .add("protocol", irProtocolName(reference))
+        .add("frames", (uint64_t)tally.frames)
+        .add("misclassified", (uint64_t)misclassified)
+        .add("misclassified_ppm", (uint64_t)(tally.frames ? misclassified * 1000000ULL / tally.frames : 0))
+        .add("wrong_value", (uint64_t)tally.wrongValue);
+    for (uint8_t protocol = 0; protocol < IR_PROTO_COUNT; protocol++) {
+        if (protocol != reference && tally.decodedAs[protocol] > 0) {
+            char key[24];
+            snprintf(key, sizeof(key), "as_%s", irProtocolName((IrProtocol)protocol));
+            line.add(key, (uint64_t)tally.decodedAs[protocol]);
+        }
+    }
+    line.add("ns_per_frame", (uint64_t)nsPerFrame)
+        .add("frames_per_s", (uint64_t)(nsPerFrame ? 1000000000ULL / nsPerFrame : 0))
+        .add("ok", passed)
+        .emit();
+    return passed;
+}
+
+// Labelled recorded frames from BENCH_CORPUS through the decoder, a row
+// per protocol they were labelled with. Unlabelled lines are left out;
+// `labelled` counts the rest.
+static bool benchDecodeCorpus(StorageFile* corpus, uint32_t& labelled) {
+    static PulseTrain capture;
+    static DecodeTally tallies[IR_PROTO_COUNT];
+    memset(tallies, 0, sizeof(tallies));
+    IrCode label;
+    while (corpusCapture(corpus, capture, &label)) {
+        if (label.protocol != IR_PROTO_RAW && label.protocol < IR_PROTO_COUNT) {
+            tallyDecode(capture, label, tallies[label.protocol]);
+        }
+    }
+    corpus->close();
+
+    bool ok = true;
+    labelled = 0;
+    for (uint8_t protocol = 0; protocol < IR_PROTO_COUNT; protocol++) {
+        if (tallies[protocol].frames > 0) {
+            ok = emitDecode((IrProtocol)protocol, tallies[protocol], "corpus") && ok;
+            labelled += tallies[protocol].frames;
+        }
+    }
+    return ok;
+}
+
+// Recorded frames from the card's corpus when it has labelled ones,
+// otherwise jittered frames of every protocol. Synthetic frames only show
+// the decoder agrees with the encoder; recorded ones measure how real
+// captures are classified.
+static bool benchDecode(const BenchOptions& options, bool storage) {
+    static PulseTrain variants[8];
+    StorageFile* corpus = openCorpus(storage);
+    uint32_t labelled = 0;
+    if (corpus) {
+        bool ok = benchDecodeCorpus(corpus, labelled);
+        if (labelled > 0) {
+            return ok;
+        }
+    }
+
+    bool ok = true;
+    for (const IrCode& reference : kBenchCodes) {
+        for (PulseTrain& variant : variants) {
+            encodeIr(reference, variant);
+            jitter(variant);
+        }
+        DecodeTally tally = {};
+        for (uint32_t i = 0; i < options.decodeFrames; i++) {
+            tallyDecode(variants[i % 8], reference, tally);
+        }
+        ok = emitDecode(reference.protocol, tally, "synthetic") && ok;
+    }
+    return ok;
+}
+
+struct ReplayTally {
+    uint32_t received;
+    uint32_t frames;
+    uint32_t repeats;
+    uint32_t errors;
+};
+
+// Pops every queued frame and checks it against the next one sent
+static void readReplayFrames(IrFramePipeline& pipeline, const IrCode* sent, uint32_t sentCount, ReplayTally& tally) {
+    static PulseTrain received;
+    IrCode code;
+    while (pipeline.read(received)) {
+        const IrCode* expected = tally.received < sentCount ? &sent[tally.received] : nullptr;
+        tally.received++;
+        if (!expected || !decodeIr(received, code) || code.repeat != expected->repeat ||
+            (!code.repeat && code.value != expected->value)) {
+            tally.errors++;
+            continue;
+        }
+        tally.frames += !code.repeat;
+        tally.repeats += code.repeat;
+    }
+}
+
+// Held NEC buttons replayed as edges through the capture path at the real
+// cadence: a frame, a repeat code every 108 ms while the button is held,
+// then the next button straight after. Every BENCH_REPLAY_STALL_EVERY
+// presses the radio task stalls until the edge ring is nearly full, so the
+// backlog has to come out through a full frame queue. Every frame and
+// repeat has to arrive, in order, with nothing dropped.
+static bool benchReplay() {
+    static IrFramePipeline pipeline;
+    static IrCode sent[BENCH_REPLAY_PRESSES * (1 + BENCH_REPLAY_MAX_REPEATS)];
+    static PulseTrain train;
+    const uint32_t periodUs = irRepeatPeriodUs(IR_PROTO_NEC);
+    const size_t frameEdges = 2 * 34;     // A full NEC frame's edges
+    uint32_t sentCount = 0;
+    uint32_t sentRepeats = 0;
+    uint32_t stalls = 0;
+    size_t peakEdges = 0;
+    bool stalled = false;
+    uint32_t pollUs = 0;
+    uint32_t frameUs = 0;
+    ReplayTally tally = {};
+    Latency service;
+
+    for (uint32_t press = 0; press < BENCH_REPLAY_PRESSES; press++) {
+        uint8_t command = (uint8_t)(press * 7);
+        IrCode code = {IR_PROTO_NEC, 32, false, 0x20DF0000ULL | (uint32_t)command << 8 | (uint8_t)~command};
+        uint32_t repeats = benchRandom() % (BENCH_REPLAY_MAX_REPEATS + 1);
+        if (press % BENCH_REPLAY_STALL_EVERY == BENCH_REPLAY_STALL_EVERY - 1) {
+            stalled = true;
+            stalls++;
+        }
+        for (uint32_t r = 0; r <= repeats; r++, frameUs += periodUs) {
+            code.repeat = r > 0;
+            sent[sentCount++] = code;
+            sentRepeats += code.repeat;
+            encodeIr(code, train);
+            jitter(train);
+
+            uint32_t edgeUs = frameUs;
+            for (uint16_t i = 0; i <= train.count; i++) {
+                // The radio task's runs that came before this edge
+                while (!stalled && (int32_t)(edgeUs - pollUs) >= 0) {
+                    uint32_t start = hal->system.cycleCount();
+                    pipeline.service(pollUs);
+                    service.add(elapsedNs(start));
+                    readReplayFrames(pipeline, sent, sentCount, tally);
+                    pollUs += BENCH_REPLAY_POLL_US;
+                }
+                pipeline.pushEdge({edgeUs, (uint8_t)((i & 1) == 0 && i < train.count)});
+                peakEdges = pipeline.pendingEdges() > peakEdges ? pipeline.pendingEdges() : peakEdges;
+                if (stalled && pipeline.pendingEdges() + frameEdges > IR_EDGE_RING_SIZE) {
+                    stalled = false;
+                    pollUs = edgeUs;
+                }
+                edgeUs += i < train.count ? train.durations[i] : 0;
+            }
+        }
+    }
+    stalled = false;
+    for (uint32_t tail = 0; tail < 2 * IR_EDGE_RING_SIZE / IR_FRAME_QUEUE_SIZE; tail++) {
+        pipeline.service(pollUs);
+        readReplayFrames(pipeline, sent, sentCount, tally);
+        pollUs += BENCH_REPLAY_POLL_US;
+    }
+
+    uint32_t dropped = pipeline.droppedEdges() + pipeline.droppedFrames();
+    bool ok = dropped == 0 && tally.errors == 0 && tally.received == sentCount &&
+              tally.repeats == sentRepeats && peakEdges + frameEdges > IR_EDGE_RING_SIZE;
+    JsonLine("replay")
+        .add("presses", (uint64_t)BENCH_REPLAY_PRESSES)
+        .add("frames_sent", (uint64_t)(sentCount - sentRepeats))
+        .add("repeats_sent", (uint64_t)sentRepeats)
+        .add("frames_received", (uint64_t)tally.frames)
+        .add("repeats_received", (uint64_t)tally.repeats)
+        .add("stalls", (uint64_t)stalls)
+        .add("ring_peak", (uint64_t)peakEdges)
+        .add("ring_size", (uint64_t)IR_EDGE_RING_SIZE)
+        .add("dropped", (uint64_t)dropped)
+        .add("errors", (uint64_t)tally.errors)
+        .add("service_max_ns", (uint64_t)service.maxNs)
+        .add("ok", ok)
+        .emit();
+    return ok;
+}
+
+// A capture of 1 to BENCH_CODEC_MAX_FRAMES frames, as a held button gives
+static bool syntheticCapture(uint32_t index, PulseTrain& train) {
+    const size_t codeCount = sizeof(kBenchCodes) / sizeof(kBenchCodes[0]);
+    if (index >= codeCount * BENCH_CODEC_MAX_FRAMES * BENCH_CODEC_VARIANTS) {
+        return false;
+    }
+    static PulseTrain frame;
+    encodeIr(kBenchCodes[index % codeCount], frame);
+    uint32_t frames = 1 + (index / codeCount) % BENCH_CODEC_MAX_FRAMES;
+
+    train.startUs = 0;
+    train.count = 0;
+    for (uint32_t f = 0; f < frames && train.count + frame.count + 1 <= IR_MAX_PULSES; f++) {
+        if (f > 0) {
+            train.durations[train.count++] = BENCH_FRAME_GAP_US;
+        }
+        memcpy(train.durations + train.count, frame.durations, frame.count * sizeof(frame.durations[0]));
+        train.count += frame.count;
+    }
+    jitter(train);
+    return true;
+}
+
+// Compression ratio and decode speed of the raw timing format, over the
+// captures in BENCH_CORPUS when the card has one, otherwise over jittered
+// single and held frames of every benchmark protocol.
+static bool benchCodec(bool storage) {
+    static PulseTrain capture;
+    static PulseCode code;
+    static PulseDecoder decoder;
+    static IrWaveform waveform;
+
+    StorageFile* corpus = openCorpus(storage);
+    uint32_t captures = 0;
+    uint32_t pulses = 0;
+    uint32_t codeBytes = 0;
+    uint32_t errors = 0;
+    uint32_t maxErrorUs = 0;
+    uint64_t decodeNs = 0;
+    uint64_t decodedPulses = 0;
+    Latency encode;
+    Latency compile;
+
+    while (corpus ? corpusCapture(corpus, capture) : syntheticCapture(captures, capture)) {
+        captures++;
+        pulses += capture.count;
+
+        uint32_t start = hal->system.cycleCount();
+        bool encoded = encodePulses(capture, code);
+        encode.add(elapsedNs(start));
+        if (!encoded) {
+            errors++;
+            continue;
+        }
+        codeBytes += code.length;
+
+        for (uint32_t pass = 0; pass < BENCH_CODEC_PASSES; pass++) {
+            uint16_t duration;
+            uint16_t index = 0;
+            start = hal->system.cycleCount();
+            decoder.begin(code.bytes, code.length);
+            while (decoder.next(duration)) {
+                if (pass == 0 && index < capture.count) {
+                    uint32_t error = duration > capture.durations[index] ? duration - capture.durations[index]
+                                                                         : capture.durations[index] - duration;
+                    maxErrorUs = error > maxErrorUs ? error : maxErrorUs;
+                }
+                index++;
+            }
+            decodeNs += elapsedNs(start);
+            decodedPulses += index;
+            errors += pass == 0 && index != capture.count;
+        }
+
+        start = hal->system.cycleCount();
+        bool compiled = compileIrPulseCode(code.bytes, code.length, IR_DEFAULT_CARRIER_KHZ, waveform);
+        compile.add(elapsedNs(start));
+        errors += !compiled;
+    }
+    if (corpus) {
+        corpus->close();
+    }
+
+    JsonLine("codec")
+        .add("source", corpus ? "corpus" : "synthetic")
+        .add("captures", (uint64_t)captures)
+        .add("pulses", (uint64_t)pulses)
+        .add("raw_bytes", (uint64_t)pulses * 2)
+        .add("code_bytes", (uint64_t)codeBytes)
+        .add("ratio_x100", (uint64_t)(codeBytes ? pulses * 200ULL / codeBytes : 0))
+        .add("encode_avg_ns", (uint64_t)encode.averageNs())
+        .add("decode_ns_per_pulse", (uint64_t)(decodedPulses ? decodeNs / decodedPulses : 0))
+        .add("compile_avg_ns", (uint64_t)compile.averageNs())
+        .add("max_error_us", (uint64_t)maxErrorUs)
+        .add("errors", (uint64_t)errors)
+        .add("ok", captures > 0 && errors == 0)
+        .emit();
+    return captures > 0 && errors == 0;
+}
+
+// A remote's worth of buttons, half decoded and half raw, then captures
+// checked against it: jittered copies of stored raw buttons must come back
+// as duplicates, and never a button the remote does not have.
+static bool benchFingerprint() {
+    static FingerprintIndex index;
+    static PulseTrain train;
+    const size_t codeCount = sizeof(kBenchCodes) / sizeof(kBenchCodes[0]);
+    const uint32_t stored = FINGERPRINT_INDEX_SIZE / 2;
+    char name[BUTTON_NAME_MAX];
+    ButtonRecord record;
+    Fingerprint print;
+    uint32_t errors = 0;
+
+    index.clear();
+    for (uint32_t i = 0; i < stored; i++) {
+        IrCode code = kBenchCodes[i % codeCount];
+        code.value ^= i / codeCount;
+        recordClear(record, "");
+        recordFromIrCode(record, code);
+        benchName(name, sizeof(name), "code", i);
+        errors += !fingerprintRecord(record, nullptr, print) || !index.add(name, print);
+
+        code.value ^= 0x80;
+        benchName(name, sizeof(name), "raw", i);
+        errors += !encodeIr(code, train) || !fingerprintTrain(BAND_IR, train, print) || !index.add(name, print);
+    }
+
+    Latency fingerprint;
+    Latency lookup;
+    uint32_t frames = 0;
+    uint32_t found = 0;
+    uint32_t near = 0;
+    uint32_t falseDuplicates = 0;
+    for (uint32_t frame = 0; frame < BENCH_FINGERPRINT_FRAMES; frame++) {
+        // Even frames repeat a stored raw button, odd ones are new to the remote
+        uint32_t button = benchRandom() % stored;
+        bool known = (frame & 1) == 0;
+        IrCode code = kBenchCodes[button % codeCount];
+        code.value ^= (button / codeCount) ^ (known ? 0x80 : 0x180);
+        if (!encodeIr(code, train)) {
+            errors++;
+            continue;
+        }
+        jitter(train);
+        frames++;
+
+        uint32_t start = hal->system.cycleCount();
+        bool printed = fingerprintTrain(BAND_IR, train, print);
+        fingerprint.add(elapsedNs(start));
+        const char* match;
+        start = hal->system.cycleCount();
+        FingerprintMatch result = index.match(print, match);
+        lookup.add(elapsedNs(start));
+
+        errors += !printed;
+        if (known) {
+            found += result == FINGERPRINT_DUPLICATE;
+        } else {
+            falseDuplicates += result == FINGERPRINT_DUPLICATE;
+            near += result == FINGERPRINT_NEAR;
+        }
+    }
+
+    uint32_t expected = (frames + 1) / 2;
+    bool ok = errors == 0 && frames > 0 && found == expected && falseDuplicates == 0;
+    JsonLine("fingerprint")
+        .add("buttons", (uint64_t)index.count())
+        .add("frames", (uint64_t)frames)
+        .add("fingerprint_avg_ns", (uint64_t)fingerprint.averageNs())
+        .add("fingerprint_max_ns", (uint64_t)fingerprint.maxNs)
+        .add("lookup_avg_ns", (uint64_t)lookup.averageNs())
+        .add("lookup_max_ns", (uint64_t)lookup.maxNs)
+        .add("duplicates_found", (uint64_t)found)
+        .add("duplicates_expected", (uint64_t)expected)
+        .add("false_duplicates", (uint64_t)falseDuplicates)
+        .add("near_flagged", (uint64_t)near)
+        .add("errors", (uint64_t)errors)
+        .add("ok", ok)
+        .emit();
+    return ok;
+}
+
+static void benchRecord(ButtonRecord& record, const char* name, uint32_t index) {
+    recordClear(record, name);
+    IrCode code = kBenchCodes[index % (sizeof(kBenchCodes) / sizeof(kBenchCodes[0]))];
+    code.value ^= index & 0xFF;
+    recordFromIrCode(record, code);
+}
+
+// The text format the library replaced: "name,data" lines, read from the
+// top on every lookup and parsed at the first matching name, as the old
+// loader did
+static bool textFind(const char* path, const char* name, ButtonRecord& record, uint32_t& bytes) {
+    static char line[IR_MAX_PULSES * 6 + 64];
+    static PulseTrain raw;
+    StorageFile* file = hal->storage.open(path, STORAGE_READ);
+    if (!file) {
+        return false;
+    }
+    size_t nameLength = strlen(name);
+    bool found = false;
+    while (!found && file->available()) {
+        size_t length = file->readLine(line, sizeof(line) - 1);
+        bytes += length + 1;
+        line[length] = '\0';
+        if (strncmp(line, name, nameLength) != 0 || line[nameLength] != ',') {
+            continue;
+        }
+        bool hasRaw;
+        recordClear(record, name);
+        found = recordFromLegacyText(record, line + nameLength + 1, raw, hasRaw);
+    }
+    file->close();
+    return found;
+}
+
+// The same buttons as a text file, for the old format's side of the lookup
+static bool writeTextLibrary(const char* path, uint32_t buttons, const PulseTrain& raw) {
+    static char data[IR_MAX_PULSES * 6 + 16];
+    char name[BUTTON_NAME_MAX];
+    ButtonRecord record;
+    IrCode code;
+    StorageFile* file = hal->storage.open(path, STORAGE_CREATE);
+    if (!file) {
+        return false;
+    }
+    BenchWriter out(file);
+    for (uint32_t i = 0; i < buttons; i++) {
+        benchName(name, sizeof(name), "BTN", i);
+        benchRecord(record, name, i);
+        if ((i & 7) == 0) {
+            formatIrRaw(raw, IR_DEFAULT_CARRIER_KHZ, data, sizeof(data));
+        } else {
+            recordToIrCode(record, code);
+            formatIrCode(code, data, sizeof(data));
+        }
+        out.line("%s,%s", name, data);
+    }
+    file->close();
+    return out.ok();
+}
+
+// Put and lookup latency of the binary library, with the text format it
+// replaced looked up beside it: time and bytes read per lookup for each.
+static bool benchLibrary(const BenchOptions& options, uint32_t buttons) {
+    static PulseCode rawCode;
+    static PulseTrain raw;
+    char path[48];
+    char textPath[48];
+    char name[BUTTON_NAME_MAX];
+    snprintf(path, sizeof(path), BENCH_DIR "/lib_%lu" LIBRARY_EXTENSION, (unsigned long)buttons);
+    snprintf(textPath, sizeof(textPath), BENCH_DIR "/lib_%lu.txt", (unsigned long)buttons);
+
+    StorageFile* file = hal->storage.open(path, STORAGE_CREATE);
+    RemoteLibrary library;
+    if (!file || !RemoteLibrary::format(*file, buttons) || !library.open(file)) {
+        if (file) {
+            file->close();
+        }
+        JsonLine("library").add("buttons", (uint64_t)buttons).add("ok", false).emit();
+        return false;
+    }
+
+    encodeIr(kBenchCodes[0], raw);
+    encodePulses(raw, rawCode);
+
+    bool ok = true;
+    Latency put;
+    ButtonRecord record;
+    for (uint32_t i = 0; i < buttons; i++) {
+        benchName(name, sizeof(name), "BTN", i);
+        benchRecord(record, name, i);
+        // Every eighth button carries raw timings, like captured unknown codes
+        bool withRaw = (i & 7) == 0;
+        uint32_t start = hal->system.cycleCount();
+        ok = library.put(record, withRaw ? rawCode.bytes : nullptr, withRaw ? rawCode.length : 0) && ok;
+        put.add(elapsedNs(start));
+    }
+
+    Latency lookup;
+    uint32_t bytesBefore = library.bytesRead();
+    for (uint32_t i = 0; i < options.lookups; i++) {
+        benchName(name, sizeof(name), "BTN", benchRandom() % buttons);
+        uint32_t start = hal->system.cycleCount();
+        ok = library.find(name, record) && ok;
+        lookup.add(elapsedNs(start));
+    }
+    uint32_t bytesPerLookup = options.lookups ? (library.bytesRead() - bytesBefore) / options.lookups : 0;
+
+    library.close();
+    file->close();
+    hal->storage.remove(path);
+
+    // Opened per lookup, as the old playback path did
+    Latency textLookup;
+    uint32_t textBytes = 0;
+    ok = writeTextLibrary(textPath, buttons, raw) && ok;
+    for (uint32_t i = 0; i < options.lookups && ok; i++) {
+        benchName(name, sizeof(name), "BTN", benchRandom() % buttons);
+        uint32_t start = hal->system.cycleCount();
+        ok = textFind(textPath, name, record, textBytes);
+        textLookup.add(elapsedNs(start));
+    }
+    hal->storage.remove(textPath);
+
+    JsonLine("library")
+        .add("buttons", (uint64_t)buttons)
+        .add("put_avg_ns", (uint64_t)put.averageNs())
+        .add("put_max_ns", (uint64_t)put.maxNs)
+        .add("lookups", (uint64_t)lookup.count)
+        .add("lookup_avg_ns", (uint64_t)lookup.averageNs())
+        .add("lookup_max_ns", (uint64_t)lookup.maxNs)
+        .add("lookup_bytes", (uint64_t)bytesPerLookup)
+        .add("text_lookup_avg_ns", (uint64_t)textLookup.averageNs())
+        .add("text_lookup_max_ns", (uint64_t)textLookup.maxNs)
+        .add("text_lookup_bytes", (uint64_t)(textLookup.count ? textBytes / textLookup.count : 0))
+        .add("ok", ok)
+        .emit();
+    return ok;
+}
+
+// One button saved over and over under the same name, as scans do, with
+// raw timings of varying length, and compacted when the library asks the
+// way the app does it. The raw region has to stay bounded.
+static bool benchLibraryOverwrite() {
+    const char* path = BENCH_DIR "/overwrite" LIBRARY_EXTENSION;
+    const char* tempPath = BENCH_DIR "/overwrite" LIBRARY_EXTENSION ".tmp";
+    static PulseCode captures[3];
+    static PulseTrain train;
+    ButtonRecord record;
+    recordClear(record, "IRButton");
+    record.band = BAND_IR;
+    record.protocol = IR_PROTO_RAW;
+    record.carrierKhz = IR_DEFAULT_CARRIER_KHZ;
+
+    bool ok = true;
+    for (uint8_t i = 0; i < 3; i++) {
+        ok = encodeIr(kBenchCodes[i], train) && encodePulses(train, captures[i]) && ok;
+    }
+    StorageFile* file = hal->storage.open(path, STORAGE_CREATE);
+    RemoteLibrary library;
+    ok = ok && file && RemoteLibrary::format(*file) && library.open(file);
+
+    uint32_t saves = 0;
+    uint32_t inPlace = 0;
+    uint32_t compactions = 0;
+    uint32_t maxRawBytes = 0;
+    Latency compact;
+    for (uint32_t i = 0; i < BENCH_OVERWRITES && ok; i++) {
+        const PulseCode& raw = captures[benchRandom() % 3];
+        uint32_t rawBytes = library.rawBytes();
+        ok = library.put(record, raw.bytes, raw.length);
+        saves++;
+        inPlace += library.rawBytes() == rawBytes;
+        maxRawBytes = library.rawBytes() > maxRawBytes ? library.rawBytes() : maxRawBytes;
+        if (!ok || !library.needsCompaction()) {
+            continue;
+        }
+        uint32_t start = hal->system.cycleCount();
+        StorageFile* rebuilt = hal->storage.open(tempPath, STORAGE_CREATE);
+        ok = rebuilt && RemoteLibrary::rebuild(library, *rebuilt, library.capacity());
+        if (rebuilt) {
+            rebuilt->close();
+        }
+        library.close();
+        file->close();
+        hal->storage.remove(path);
+        hal->storage.rename(tempPath, path);
+        file = hal->storage.open(path, STORAGE_UPDATE);
+        ok = ok && file && library.open(file);
+        compact.add(elapsedNs(start));
+        compactions++;
+    }
+    ok = ok && library.count() == 1 && maxRawBytes <= LIBRARY_COMPACT_BYTES + 2 * PULSE_CODE_MAX;
+
+    library.close();
+    if (file) {
+        file->close();
+    }
+    hal->storage.remove(path);
+
+    JsonLine("library_overwrite")
+        .add("saves", (uint64_t)saves)
+        .add("in_place", (uint64_t)inPlace)
+        .add("compactions", (uint64_t)compactions)
+        .add("compact_avg_ns", (uint64_t)compact.averageNs())
+        .add("raw_bytes_max", (uint64_t)maxRawBytes)
+        .add("ok", ok)
+        .emit();
+    return ok;
+}
+
+static void signalRemoteName(char* name, size_t size, uint32_t remote) {
+    snprintf(name, size, "sig%04lu", (unsigned long)remote);
+}
+
+// A code of its own for every button of every remote
+static void signalRecord(ButtonRecord& record, uint32_t remote, uint32_t button) {
+    char name[BUTTON_NAME_MAX];
+    benchName(name, sizeof(name), "BTN", button);
+    recordClear(record, name);
+    IrCode code = {IR_PROTO_NEC, 32, false, 0x10000000ULL | (remote * BENCH_SIGNAL_BUTTONS + button)};
+    recordFromIrCode(record, code);
+}
+
+static bool openSignalLibrary(uint32_t remote, StorageMode mode, StorageFile*& file, RemoteLibrary& library) {
+    char name[REMOTE_NAME_MAX];
+    char path[48];
+    signalRemoteName(name, sizeof(name), remote);
+    snprintf(path, sizeof(path), BENCH_DIR "/%s" LIBRARY_EXTENSION, name);
+    file = hal->storage.open(path, mode);
+    if (file && (mode != STORAGE_CREATE || RemoteLibrary::format(*file, BENCH_SIGNAL_BUTTONS)) && library.open(file)) {
+        return true;
+    }
+    if (file) {
+        file->close();
+    }
+    return false;
+}
+
+static void removeSignalLibraries(uint32_t remotes) {
+    char name[REMOTE_NAME_MAX];
+    char path[48];
+    for (uint32_t i = 0; i < remotes; i++) {
+        signalRemoteName(name, sizeof(name), i);
+        snprintf(path, sizeof(path), BENCH_DIR "/%s" LIBRARY_EXTENSION, name);
+        hal->storage.remove(path);
+    }
+}
+
+// The card-wide signal index over `remotes` libraries: the time to build it
+// from them, as the background rebuild does, its size on the card, and the
+// cost of asking it which remote holds a signal
+static bool benchSignalIndex(const BenchOptions& options, uint32_t remotes) {
+    const char* indexPath = BENCH_DIR "/signals.bin";
+    static PulseCode rawCode;
+    static PulseTrain raw;
+    encodeIr(kBenchCodes[0], raw);
+    encodePulses(raw, rawCode);
+
+    bool ok = true;
+    StorageFile* file;
+    RemoteLibrary library;
+    ButtonRecord record;
+    for (uint32_t i = 0; i < remotes && ok; i++) {
+        ok = openSignalLibrary(i, STORAGE_CREATE, file, library);
+        for (uint32_t button = 0; ok && button < BENCH_SIGNAL_BUTTONS; button++) {
+            signalRecord(record, i, button);
+            // Every eighth button carries raw timings, like captured unknown codes
+            bool withRaw = (button & 7) == 0;
+            ok = library.put(record, withRaw ? rawCode.bytes : nullptr, withRaw ? rawCode.length : 0);
+        }
+        if (file) {
+            library.close();
+            file->close();
+        }
+    }
+
+    uint32_t buttons = remotes * BENCH_SIGNAL_BUTTONS;
+    uint32_t capacity = buttons + buttons / 2;
+    uint32_t remoteCapacity = remotes + remotes / 2;
+    uint32_t offset = 0;
+    SignalIndex index;
+    char name[REMOTE_NAME_MAX];
+    StorageFile* indexFile = ok ? hal->storage.open(indexPath, STORAGE_CREATE) : nullptr;
+    uint32_t start = hal->system.cycleCount();
+    ok = indexFile && SignalIndex::format(*indexFile, capacity, remoteCapacity, offset) && index.open(indexFile);
+    // The cycle counter wraps within seconds; fold it in per library
+    uint64_t buildNs = elapsedNs(start);
+    for (uint32_t i = 0; i < remotes && ok; i++) {
+        uint32_t next = 0;
+        signalRemoteName(name, sizeof(name), i);
+        start = hal->system.cycleCount();
+        ok = openSignalLibrary(i, STORAGE_READ, file, library) && index.addLibrary(name, library, next, 0xFFFFFFFF);
+        if (file) {
+            library.close();
+            file->close();
+        }
+        buildNs += elapsedNs(start);
+    }
+
+    // Half the lookups are for signals the card does not hold
+    Latency hit;
+    Latency miss;
+    uint32_t bytesBefore = index.bytesRead();
+    for (uint32_t i = 0; i < options.lookups && ok; i++) {
+        uint32_t remote = benchRandom() % remotes;
+        uint32_t button = benchRandom() % BENCH_SIGNAL_BUTTONS;
+        bool known = i & 1;
+        signalRecord(record, known ? remote : remotes + remote, button);
+        Fingerprint print;
+        SignalHit hits[SIGNAL_INDEX_MAX_HITS];
+        fingerprintRecord(record, nullptr, print);
+        uint32_t start = hal->system.cycleCount();
+        uint8_t found = index.find(print, hits, SIGNAL_INDEX_MAX_HITS);
+        (known ? hit : miss).add(elapsedNs(start));
+        signalRemoteName(name, sizeof(name), remote);
+        ok = known ? found == 1 && strcmp(hits[0].remote, name) == 0 && strcmp(hits[0].button, record.name) == 0
+                   : found == 0;
+    }
+    uint32_t bytesPerLookup = options.lookups ? (index.bytesRead() - bytesBefore) / options.lookups : 0;
+    ok = ok && index.count() == buttons && index.remoteCount() == remotes;
+
+    index.close();
+    if (indexFile) {
+        indexFile->close();
+    }
+    hal->storage.remove(indexPath);
+    removeSignalLibraries(remotes);
+
+    JsonLine("signal_index")
+        .add("remotes", (uint64_t)remotes)
+        .add("buttons", (uint64_t)buttons)
+        .add("build_ms", (uint64_t)(buildNs / 1000000))
+        .add("index_bytes", (uint64_t)SignalIndex::fileSize(capacity, remoteCapacity))
+        .add("hit_avg_ns", (uint64_t)hit.averageNs())
+        .add("hit_max_ns", (uint64_t)hit.maxNs)
+        .add("miss_avg_ns", (uint64_t)miss.averageNs())
+        .add("miss_max_ns", (uint64_t)miss.maxNs)
+        .add("lookup_bytes", (uint64_t)bytesPerLookup)
+        .add("ok", ok)
+        .emit();
+    return ok;
+}
+
+// ButtonStore over one open library, for the cache benchmarks
+class BenchStore : public ButtonStore {
+public:
+    explicit BenchStore(RemoteLibrary& library) : _library(library) {}
+
+    bool load(const char*, const char* button, ButtonRecord& record, PulseCode& raw) override {
+        return _library.find(button, record) && readRaw(record, raw);
+    }
+
+    bool loadAt(const char*, uint32_t index, ButtonRecord& record, PulseCode& raw) override {
+        return _library.recordAt(index, record) && readRaw(record, raw);
+    }
+
+    bool store(const char*, const ButtonRecord& record, const PulseCode* raw) override {
+        return _library.put(record, raw ? raw->bytes : nullptr, raw ? raw->length : 0);
+    }
+
+private:
+    bool readRaw(const ButtonRecord& record, PulseCode& raw) {
+        raw.length = 0;
+        return record.rawLength == 0 || _library.readRaw(record, raw);
+    }
+
+    RemoteLibrary& _library;
+};
+
+// Playback and soak share one library object, reopened on a fresh file
+static RemoteLibrary cacheLibrary;
+static BenchStore cacheStore(cacheLibrary);
+
+static void* benchAllocate(size_t size) {
+    return hal->system.allocate(size);
+}
+
+// The cache is allocated once and reused, as the firmware does
+static ButtonCache* benchCache() {
+    static ButtonCache cache;
+    static bool ready = false;
+    if (!ready) {
+        ready = cache.begin(BUTTON_CACHE_ENTRIES, &cacheStore, benchAllocate);
+    }
+    return ready ? &cache : nullptr;
+}
+
+static StorageFile* openCacheLibrary(const char* path, uint32_t capacity) {
+    StorageFile* file = hal->storage.open(path, STORAGE_CREATE);
+    if (file && RemoteLibrary::format(*file, capacity) && cacheLibrary.open(file)) {
+        return file;
+    }
+    if (file) {
+        file->close();
+    }
+    return nullptr;
+}
+
+static void closeCacheLibrary(StorageFile* file, const char* path) {
+    cacheLibrary.close();
+    file->close();
+    hal->storage.remove(path);
+}
+
+static bool benchPlayback(const BenchOptions& options) {
+    const char* path = BENCH_DIR "/playback" LIBRARY_EXTENSION;
+    char name[BUTTON_NAME_MAX];
+
+    StorageFile* file = openCacheLibrary(path, BENCH_PLAYBACK_BUTTONS * 2);
+    if (!file) {
+        JsonLine("playback").add("ok", false).emit();
+        return false;
+    }
+
+    ButtonRecord record;
+    for (uint32_t i = 0; i < BENCH_PLAYBACK_BUTTONS; i++) {
+        benchName(name, sizeof(name), "BTN", i);
+        benchRecord(record, name, i);
+        cacheLibrary.put(record, nullptr, 0);
+    }
+
+    ButtonCache* cache = benchCache();
+    bool ok = cache != nullptr;
+    Latency hit;
+    Latency miss;
+    if (cache) {
+        cache->selectRemote("bench");
+        for (uint32_t i = 0; i < options.lookups; i++) {
+            benchName(name, sizeof(name), "BTN", benchRandom() % BENCH_PLAYBACK_BUTTONS);
+            uint32_t misses = cache->misses();
+            uint32_t start = hal->system.cycleCount();
+            const CachedButton* button = cache->get(name);
+            uint32_t ns = elapsedNs(start);
+            ok = button && button->waveform.frameSymbols > 0 && ok;
+            (cache->misses() != misses ? miss : hit).add(ns);
+        }
+        cache->selectRemote("");
+    }
+    closeCacheLibrary(file, path);
+
+    JsonLine("playback")
+        .add("buttons", (uint64_t)BENCH_PLAYBACK_BUTTONS)
+        .add("cache_entries", (uint64_t)BUTTON_CACHE_ENTRIES)
+        .add("hits", (uint64_t)hit.count)
+        .add("hit_avg_ns", (uint64_t)hit.averageNs())
+        .add("hit_max_ns", (uint64_t)hit.maxNs)
+        .add("misses", (uint64_t)miss.count)
+        .add("miss_avg_ns", (uint64_t)miss.averageNs())
+        .add("miss_max_ns", (uint64_t)miss.maxNs)
+        .add("ok", ok)
+        .emit();
+    return ok;
+}
+
+// A library file whose every read costs a fixed time, counted rather than
+// slept so the figures do not depend on the host's card
+class SlowLibraryFile : public LibraryFile {
+public:
+    explicit SlowLibraryFile(StorageFile* file) : _file(file) {}
+
+    bool readAt(uint32_t offset, void* buffer, size_t length) override {
+        _reads++;
+        return _file->readAt(offset, buffer, length);
+    }
+    bool writeAt(uint32_t offset, const void* buffer, size_t length) override {
+        return _file->writeAt(offset, buffer, length);
+    }
+
+    uint32_t reads() const { return _reads; }
+
+private:
+    StorageFile* _file;
+    uint32_t _reads = 0;
+};
+
+// Press to transmit-ready symbols, through the cache, with every library
+// read taking `readUs`: cold right after the remote is selected, warm once
+// the background preload is done. A warm press must not touch the card.
+static bool benchPressLatency(uint32_t readUs) {
+    const char* path = BENCH_DIR "/press" LIBRARY_EXTENSION;
+    static PulseTrain raw;
+    char name[BUTTON_NAME_MAX];
+
+    StorageFile* file = hal->storage.open(path, STORAGE_CREATE);
+    SlowLibraryFile slow(file);
+    ButtonCache* cache = benchCache();
+    bool ok = file && cache && RemoteLibrary::format(*file, BENCH_PRESS_BUTTONS * 2) && cacheLibrary.open(&slow) &&
+              encodeIr(kBenchCodes[0], raw);
+
+    // Every eighth button has raw timings, so a cold press reads those too
+    ButtonRecord record;
+    for (uint32_t i = 0; i < BENCH_PRESS_BUTTONS && ok; i++) {
+        benchName(name, sizeof(name), "BTN", i);
+        benchRecord(record, name, i);
+        ok = (i & 7 ? cacheLibrary.put(record, nullptr, 0) : cache->put(record, &raw)) && ok;
+    }
+    if (ok) {
+        cache->flush();
+    }
+
+    // Each button once, in an order unrelated to how they were saved
+    Latency cold;
+    Latency warm;
+    uint32_t coldReads = 0;
+    uint32_t warmReads = 0;
+    uint32_t preloadReads = 0;
+    for (uint8_t pass = 0; pass < 2 && ok; pass++) {
+        ok = cache->selectRemote("press");
+        uint32_t reads = slow.reads();
+        while (pass == 1 && cache->service()) {
+        }
+        preloadReads += slow.reads() - reads;
+        for (uint32_t i = 0; i < BENCH_PRESS_BUTTONS && ok; i++) {
+            benchName(name, sizeof(name), "BTN", i * 7 % BENCH_PRESS_BUTTONS);
+            reads = slow.reads();
+            uint32_t start = hal->system.cycleCount();
+            const CachedButton* button = cache->get(name);
+            uint32_t ns = elapsedNs(start);
+            ok = button && button->waveform.frameSymbols > 0;
+            reads = slow.reads() - reads;
+            (pass == 0 ? cold : warm).add(ns + reads * readUs * 1000);
+            (pass == 0 ? coldReads : warmReads) += reads;
+        }
+    }
+    if (cache) {
+        cache->selectRemote("");
+    }
+    cacheLibrary.close();
+    if (file) {
+        file->close();
+    }
+    hal->storage.remove(path);
+    ok = ok && warmReads == 0;
+
+    JsonLine("press_latency")
+        .add("read_us", (uint64_t)readUs)
+        .add("buttons", (uint64_t)BENCH_PRESS_BUTTONS)
+        .add("cold_avg_us", (uint64_t)cold.averageNs() / 1000)
+        .add("cold_max_us", (uint64_t)cold.maxNs / 1000)
+        .add("cold_reads", (uint64_t)(cold.count ? coldReads / cold.count : 0))
+        .add("preload_ms", (uint64_t)preloadReads * readUs / 1000)
+        .add("warm_avg_ns", (uint64_t)warm.averageNs())
+        .add("warm_max_ns", (uint64_t)warm.maxNs)
+        .add("warm_reads", (uint64_t)warmReads)
+        .add("ok", ok)
+        .emit();
+    return ok;
+}
+
+struct SoakStats {
+    uint64_t elapsedUs;
+    uint32_t framesSent;
+    uint32_t framesDecoded;
+    uint32_t framesDropped;
+    uint32_t edgesDropped;
+    uint32_t saves;
+    uint32_t saveErrors;
+    uint32_t playbacks;
+    uint32_t playbackErrors;
+    uint32_t maxIterationUs;
+    uint32_t allocations;          // Once every soak name has been saved
+    size_t heapStart;
+    size_t heapHighWater;
+};
+
+static void reportSoak(const SoakStats& stats, bool final) {
+    JsonLine("soak")
+        .add("elapsed_s", stats.elapsedUs / 1000000)
+        .add("frames_sent", (uint64_t)stats.framesSent)
+        .add("frames_decoded", (uint64_t)stats.framesDecoded)
+        .add("frames_dropped", (uint64_t)stats.framesDropped)
+        .add("edges_dropped", (uint64_t)stats.edgesDropped)
+        .add("saves", (uint64_t)stats.saves)
+        .add("save_errors", (uint64_t)stats.saveErrors)
+        .add("playbacks", (uint64_t)stats.playbacks)
+        .add("playback_errors", (uint64_t)stats.playbackErrors)
+        .add("max_iteration_us", (uint64_t)stats.maxIterationUs)
+        .add("allocations", (uint64_t)stats.allocations)
+        .add("heap_start", (uint64_t)stats.heapStart)
+        .add("heap_high_water", (uint64_t)stats.heapHighWater)
+        .add("final", final)
+        .emit();
+}
+
+// Frames are turned into edges, pushed through an edge ring and the frame
+// assembler like the capture path, decoded, saved through the cache and
+// played back, until the time budget is spent. Once every name has been
+// saved once, the loop must not allocate.
+static bool benchSoak(const BenchOptions& options) {
+    const char* path = BENCH_DIR "/soak" LIBRARY_EXTENSION;
+    static SpscRing<IrEdge, IR_EDGE_RING_SIZE> edges;
+    static FrameAssembler assembler;
+    static PulseTrain sent;
+    static PulseTrain received;
+    char name[BUTTON_NAME_MAX];
+
+    StorageFile* file = openCacheLibrary(path, BENCH_SOAK_NAMES * 2);
+    ButtonCache* cache = benchCache();
+    if (!file || !cache) {
+        if (file) {
+            closeCacheLibrary(file, path);
+        }
+        JsonLine("soak").add("ok", false).emit();
+        return false;
+    }
+    cache->selectRemote("soak");
+
+    SoakStats stats = {};
+    stats.heapStart = hal->system.heapUsed();
+    stats.heapHighWater = stats.heapStart;
+
+    const uint64_t budgetUs = (uint64_t)options.soakSeconds * 1000000;
+    uint64_t nextReportUs = (uint64_t)BENCH_SOAK_REPORT_SECONDS * 1000000;
+    uint32_t lineUs = 0;
+    uint32_t iterationStart = hal->system.cycleCount();
+    const size_t codeCount = sizeof(kBenchCodes) / sizeof(kBenchCodes[0]);
+    uint32_t allocationsStart = 0;
+
+    while (stats.elapsedUs < budgetUs) {
+        if (stats.framesSent == BENCH_SOAK_NAMES) {
+            allocationsStart = hal->system.allocations();
+        }
+        IrCode reference = kBenchCodes[stats.framesSent % codeCount];
+        encodeIr(reference, sent);
+        jitter(sent);
+        stats.framesSent++;
+
+        // Producer side: the edges an interrupt would timestamp
+        bool mark = true;
+        for (uint16_t i = 0; i < sent.count; i++) {
+            edges.push({lineUs, mark});
+            lineUs += sent.durations[i];
+            mark = !mark;
+        }
+        edges.push({lineUs, false});
+        lineUs += BENCH_FRAME_GAP_US;
+
+        // Consumer side: drain, assemble and decode
+        bool framed = false;
+        IrEdge edge;
+        while (edges.pop(edge)) {
+            framed = assembler.pushEdge(edge, received) || framed;
+        }
+        framed = framed || assembler.poll(lineUs, received);
+        IrCode code;
+        bool decoded = framed && decodeIr(received, code) && code.value == reference.value;
+        stats.framesDecoded += decoded;
+        stats.framesDropped += !decoded;
+
+        if (decoded) {
+            ButtonRecord record;
+            benchName(name, sizeof(name), "SOAK", stats.framesSent % BENCH_SOAK_NAMES);
+            recordClear(record, name);
+            recordFromIrCode(record, code);
+            stats.saves++;
+            stats.saveErrors += !cache->put(record, nullptr);
+        }
+        cache->service();
+
+        benchName(name, sizeof(name), "SOAK", benchRandom() % BENCH_SOAK_NAMES);
+        if (stats.framesSent > BENCH_SOAK_NAMES) {
+            const CachedButton* button = cache->get(name);
+            stats.playbacks++;
+            stats.playbackErrors += !button || button->waveform.frameSymbols == 0;
+        }
+
+        if (stats.framesSent > BENCH_SOAK_NAMES) {
+            stats.allocations = hal->system.allocations() - allocationsStart;
+        }
+
+        uint32_t now = hal->system.cycleCount();
+        uint32_t iterationUs = cyclesToNs(now - iterationStart) / 1000;
+        iterationStart = now;
+        stats.elapsedUs += iterationUs;
+        if (iterationUs > stats.maxIterationUs) {
+            stats.maxIterationUs = iterationUs;
+        }
+
+        if ((stats.framesSent & 63) == 0) {
+            size_t heap = hal->system.heapUsed();
+            if (heap > stats.heapHighWater) {
+                stats.heapHighWater = heap;
+            }
+        }
+        if (stats.elapsedUs >= nextReportUs) {
+            reportSoak(stats, false);
+            nextReportUs += (uint64_t)BENCH_SOAK_REPORT_SECONDS * 1000000;
+        }
+    }
+
+    cache->flush();
+    cache->selectRemote("");
+    closeCacheLibrary(file, path);
+
+    stats.edgesDropped = edges.dropped();
+    reportSoak(stats, true);
+    return stats.framesDropped == 0 && stats.saveErrors == 0 && stats.playbackErrors == 0 && stats.allocations == 0;
+}
+
+// An nRF24 link on a virtual clock: a three-packet FIFO sent back to back at
+// 1 Mbps, auto-retransmits after the configured delay, and a chance that
+// each attempt or its ACK is lost. Running out of retransmits halts the FIFO
+// until it is flushed, as on the chip. Every call costs one SPI transaction.
+class BenchRf24Link : public RadioBackend {
+public:
+    void reset(uint8_t lossPercent) {
+        _lossPercent = lossPercent;
+        _queued = 0;
+        _tries = 0;
+        _acked = false;
+        _halted = false;
+    }
+
+    bool begin(uint8_t) override { return true; }
+    uint32_t nowUs() override { return _nowUs; }
+    void setListening(uint8_t) override {}
+    bool readIrFrame(PulseTrain&) override { return false; }
+    bool readRf24(uint8_t*, uint8_t&) override { return false; }
+    uint32_t irWaitUs() override { return 0; }
+    bool sendIr(const IrWaveform&, bool) override { return false; }
+    uint32_t dropped(uint8_t) override { return 0; }
+    bool readRf433(PulseTrain&, uint8_t&) override { return false; }
+    bool sendRf433(const IrWaveform&, uint8_t) override { return false; }
+    bool startRf24Sniff(const Rf24SniffConfig&) override { return false; }
+    void stopRf24Sniff() override {}
+    void setRf24Channel(uint8_t) override {}
+    bool readRf24Packet(Rf24Packet&) override { return false; }
+    bool startRf24Scan() override { return false; }
+    void stopRf24Scan() override {}
+    bool readRf24Carrier() override { return false; }
+    void selectRf24Channel(uint8_t) override {}
+
+    void setRf24Tx(const Rf24TxConfig& config) override { _config = config; }
+
+    bool beginRf24Tx() override {
+        call();
+        return true;
+    }
+
+    bool queueRf24(const uint8_t*, uint8_t) override {
+        call();
+        if (_halted || _queued == RF24_TX_FIFO_DEPTH) {
+            return false;
+        }
+        if (_queued++ == 0) {
+            attempt(_nowUs);
+        }
+        return true;
+    }
+
+    void pollRf24Tx(Rf24TxStatus& status) override {
+        call();
+        status.empty = _queued == 0;
+        status.acked = _acked;
+        status.failed = _halted;
+        status.retries = _retries;
+        _acked = false;
+        if (_halted) {
+            flush();
+        }
+    }
+
+    void endRf24Tx() override {
+        call();
+        flush();
+    }
+
+private:
+    void call() {
+        _nowUs += BENCH_RF24_CALL_US;
+        while (_queued > 0 && !_halted && (int32_t)(_nowUs - _attemptEndUs) >= 0) {
+            settle();
+        }
+    }
+
+    void attempt(uint32_t startUs) {
+        _lost = benchRandom() % 100 < _lossPercent;
+        uint32_t waitUs = _lost ? (_config.retryDelay + 1) * 250 : BENCH_RF24_ACK_US;
+        _attemptEndUs = startUs + BENCH_RF24_SETTLE_US + BENCH_RF24_PACKET_US + waitUs;
+    }
+
+    void settle() {
+        if (!_lost) {
+            _acked = true;
+            _retries = _tries;
+            _tries = 0;
+            if (--_queued > 0) {
+                attempt(_attemptEndUs);
+            }
+        } else if (_tries++ < _config.retryCount) {
+            attempt(_attemptEndUs);
+        } else {
+            _halted = true;
+        }
+    }
+
+    void flush() {
+        _queued = 0;
+        _tries = 0;
+        _halted = false;
+    }
+
+    Rf24TxConfig _config = {};
+    uint8_t _lossPercent = 0;
+    uint32_t _nowUs = 0;
+    uint32_t _attemptEndUs = 0;
+    uint8_t _queued = 0;
+    uint8_t _tries = 0;
+    uint8_t _retries = 0;
+    bool _lost = false;
+    bool _acked = false;
+    bool _halted = false;
+};
+
+// Single-packet and fragmented messages through the transmit queue over an
+// increasingly lossy link. The link runs on virtual time, so the throughput
+// is what the pipeline would reach on air; the CPU cost is measured.
+static bool benchRf24Tx() {
+    static BenchRf24Link link;
+    static Rf24TxQueue queue;
+    uint8_t message[RF24_MESSAGE_MAX];
+    for (uint16_t i = 0; i < sizeof(message); i++) {
+        message[i] = (uint8_t)i;
+    }
+    Rf24TxConfig config;
+    rf24TxDefaults(config);
+    link.setRf24Tx(config);
+    queue.configure(config);
+    bool ok = true;
+
+    for (uint8_t lossPercent : kRf24LossPercent) {
+        link.reset(lossPercent);
+        Rf24TxStats before;
+        queue.stats(before);
+        uint32_t startUs = link.nowUs();
+        uint64_t cpuNs = 0;
+        uint32_t submitted = 0;
+        uint32_t finished = 0;
+        uint32_t failedMessages = 0;
+
+        while (finished < BENCH_RF24_MESSAGES) {
+            // Every fourth message takes four fragments
+            while (submitted < BENCH_RF24_MESSAGES &&
+                   queue.submit(message, submitted % 4 == 3 ? 90 : RF24_MAX_PAYLOAD)) {
+                submitted++;
+            }
+            uint32_t start = hal->system.cycleCount();
+            queue.service(link);
+            cpuNs += elapsedNs(start);
+            Rf24TxResult result;
+            while (queue.popResult(result)) {
+                finished++;
+                failedMessages += !result.ok;
+            }
+        }
+
+        Rf24TxStats after;
+        queue.stats(after);
+        uint32_t linkUs = link.nowUs() - startUs;
+        uint32_t acked = after.acked - before.acked;
+        uint32_t failed = after.failed - before.failed;
+        uint32_t timeouts = after.timeouts - before.timeouts;
+        bool passed = timeouts == 0 && (lossPercent > 0 || (failed == 0 && failedMessages == 0));
+        ok = ok && passed;
+
+        JsonLine("rf24_tx")
+            .add("loss_pct", (uint64_t)lossPercent)
+            .add("messages", (uint64_t)finished)
+            .add("messages_failed", (uint64_t)failedMessages)
+            .add("packets", (uint64_t)(acked + failed))
+            .add("delivered", (uint64_t)acked)
+            .add("delivery_pct", (uint64_t)(acked + failed ? acked * 100ULL / (acked + failed) : 0))
+            .add("loaded", (uint64_t)(after.packets - before.packets))
+            .add("resent", (uint64_t)(after.resent - before.resent))
+            .add("retries", (uint64_t)(after.retries - before.retries))
+            .add("timeouts", (uint64_t)timeouts)
+            .add("link_ms", (uint64_t)(linkUs / 1000))
+            .add("packets_per_s", (uint64_t)(linkUs ? acked * 1000000ULL / linkUs : 0))
+            .add("cpu_ns_per_packet", (uint64_t)(acked + failed ? cpuNs / (acked + failed) : 0))
+            .add("ok", passed)
+            .emit();
+    }
+    return ok;
+}
+
+// Sends on a virtual clock, noting when each one went out. An IR frame is
+// refused until the one before has had its period; a 433 MHz send holds
+// the caller for all its frames, as the transmitters do. nRF24 packets are
+// acknowledged at once.
+class BenchMacroLink : public BenchRf24Link {
+public:
+    uint32_t nowUs() override { return _clockUs; }
+    void advance(uint32_t us) { _clockUs += us; }
+    void clear() { _sends = 0; }
+
+    uint32_t irWaitUs() override {
+        uint32_t elapsed = _clockUs - _irStartUs;
+        return elapsed < _irPeriodUs ? _irPeriodUs - elapsed : 0;
+    }
+
+    bool sendIr(const IrWaveform& waveform, bool) override {
+        if (irWaitUs() > 0) {
+            return false;
+        }
+        note();
+        _irStartUs = _clockUs;
+        _irPeriodUs = waveform.periodUs;
+        _clockUs += BENCH_MACRO_SEND_US;
+        return true;
+    }
+
+    bool sendRf433(const IrWaveform& waveform, uint8_t repeats) override {
+        note();
+        _clockUs += waveform.periodUs * repeats;
+        return true;
+    }
+
+    bool queueRf24(const uint8_t*, uint8_t) override {
+        note();
+        return true;
+    }
+
+    void pollRf24Tx(Rf24TxStatus& status) override {
+        status.empty = true;
+        status.acked = true;
+        status.failed = false;
+        status.retries = 0;
+    }
+
+    uint16_t sends() const { return _sends; }
+    uint32_t sentUs(uint16_t send) const { return _sentUs[send]; }
+
+private:
+    void note() {
+        if (_sends < MACRO_MAX_EVENTS) {
+            _sentUs[_sends] = _clockUs;
+        }
+        _sends++;
+    }
+
+    uint32_t _clockUs = 0;
+    uint32_t _irStartUs = 0;
+    uint32_t _irPeriodUs = 0;
+    uint16_t _sends = 0;
+    uint32_t _sentUs[MACRO_MAX_EVENTS];
+};
+
+// An nRF24 receiver on a virtual clock, on a channel carrying packets at
+// the highest rate the air allows. The FIFO holds three; a packet arriving
+// to a full FIFO is lost. Each payload carries its sequence number.
+class BenchRf24Air : public RadioBackend {
+public:
+    bool begin(uint8_t) override { return true; }
+    uint32_t nowUs() override { return _nowUs; }
+    void setListening(uint8_t) override {}
+    bool readIrFrame(PulseTrain&) override { return false; }
+    bool readRf24(uint8_t*, uint8_t&) override { return false; }
+    uint32_t irWaitUs() override { return 0; }
+    bool sendIr(const IrWaveform&, bool) override { return false; }
+    uint32_t dropped(uint8_t) override { return 0; }
+    bool readRf433(PulseTrain&, uint8_t&) override { return false; }
+    bool sendRf433(const IrWaveform&, uint8_t) override { return false; }
+    bool startRf24Sniff(const Rf24SniffConfig&) override { return true; }
+    void stopRf24Sniff() override {}
+    void setRf24Channel(uint8_t) override {}
+    bool startRf24Scan() override { return false; }
+    void stopRf24Scan() override {}
+    bool readRf24Carrier() override { return false; }
+    void selectRf24Channel(uint8_t) override {}
+    void setRf24Tx(const Rf24TxConfig&) override {}
+    bool beginRf24Tx() override { return false; }
+    bool queueRf24(const uint8_t*, uint8_t) override { return false; }
+    void pollRf24Tx(Rf24TxStatus&) override {}
+    void endRf24Tx() override {}
+
+    bool readRf24Packet(Rf24Packet& packet) override {
+        advance(BENCH_RF24_CALL_US);
+        if (_fifoCount == 0) {
+            return false;
+        }
+        packet.fifoFull = _fifoCount == BENCH_SNIFF_FIFO;
+        packet.pipe = 1;
+        packet.length = RF24_MAX_PAYLOAD;
+        memset(packet.payload, 0, sizeof(packet.payload));
+        memcpy(packet.payload, &_fifo[_fifoHead], sizeof(uint32_t));
+        _fifoHead = (_fifoHead + 1) % BENCH_SNIFF_FIFO;
+        _fifoCount--;
+        advance(BENCH_SNIFF_READ_US - BENCH_RF24_CALL_US);
+        return true;
+    }
+
+    // Time passes; whatever was sent meanwhile lands in the FIFO
+    void advance(uint32_t us) {
+        _nowUs += us;
+        while ((int32_t)(_nowUs - _nextPacketUs) >= 0) {
+            if (_fifoCount < BENCH_SNIFF_FIFO) {
+                _fifo[(_fifoHead + _fifoCount) % BENCH_SNIFF_FIFO] = _sent;
+                _fifoCount++;
+            } else {
+                _lost++;
+            }
+            _sent++;
+            _nextPacketUs += BENCH_SNIFF_PACKET_US;
+        }
+    }
+
+    uint32_t sent() const { return _sent; }
+    uint32_t lost() const { return _lost; }
+
+private:
+    uint32_t _nowUs = 0;
+    uint32_t _nextPacketUs = BENCH_SNIFF_PACKET_US;
+    uint32_t _fifo[BENCH_SNIFF_FIFO];
+    uint8_t _fifoHead = 0;
+    uint8_t _fifoCount = 0;
+    uint32_t _sent = 0;
+    uint32_t _lost = 0;
+};
+
+// The sniffer on one channel at the air's maximum packet rate, serviced
+// the way the radio task does while sniffing: polling without a break
+// except once per busy slice, late in a tick, until the next. The app
+// drains the records at its radio task rate, with an occasional slow loop
+// iteration. Every packet must come out, once and in order.
+static bool benchSniffer() {
+    static BenchRf24Air air;
+    static Rf24Sniffer sniffer;
+    Rf24SniffConfig config;
+    rf24SniffDefaults(config);
+    config.dwellUs = 0;
+    bool ok = sniffer.start(config, air);
+
+    const uint32_t endUs = BENCH_SNIFF_SECONDS * 1000000UL;
+    uint32_t sliceStartUs = 0;
+    uint32_t nextDrainUs = BENCH_SNIFF_DRAIN_US;
+    uint32_t drains = 0;
+    uint32_t received = 0;
+    uint32_t outOfOrder = 0;
+    uint32_t ringPeak = 0;
+    Rf24SniffRecord record;
+    while (ok && (int32_t)(air.nowUs() - endUs) < 0) {
+        sniffer.service(air);
+        if (air.nowUs() - sliceStartUs >= RADIO_BUSY_SLICE_US &&
+            air.nowUs() % BENCH_SNIFF_TICK_US >= BENCH_SNIFF_TICK_US - RADIO_YIELD_US) {
+            air.advance(BENCH_SNIFF_TICK_US - air.nowUs() % BENCH_SNIFF_TICK_US);
+            sliceStartUs = air.nowUs();
+        }
+        if ((int32_t)(air.nowUs() - nextDrainUs) < 0) {
+            continue;
+        }
+        uint32_t pending = 0;
+        while (sniffer.pop(record)) {
+            uint32_t sequence;
+            memcpy(&sequence, record.payload, sizeof(sequence));
+            outOfOrder += sequence != received + air.lost();
+            received++;
+            pending++;
+        }
+        ringPeak = pending > ringPeak ? pending : ringPeak;
+        nextDrainUs += ++drains % BENCH_SNIFF_STALL_EVERY ? BENCH_SNIFF_DRAIN_US : BENCH_SNIFF_STALL_US;
+    }
+    sniffer.stop(air);
+    while (sniffer.pop(record)) {
+        received++;
+    }
+
+    uint32_t lost = air.lost() + sniffer.dropped();
+    ok = ok && lost == 0 && outOfOrder == 0 && received + BENCH_SNIFF_FIFO >= air.sent();
+    JsonLine("rf24_sniff")
+        .add("seconds", (uint64_t)BENCH_SNIFF_SECONDS)
+        .add("packets_per_s", (uint64_t)(1000000 / BENCH_SNIFF_PACKET_US))
+        .add("sent", (uint64_t)air.sent())
+        .add("received", (uint64_t)received)
+        .add("fifo_lost", (uint64_t)air.lost())
+        .add("fifo_full", (uint64_t)sniffer.overflows())
+        .add("ring_dropped", (uint64_t)sniffer.dropped())
+        .add("ring_peak", (uint64_t)ringPeak)
+        .add("ring_size", (uint64_t)RF24_SNIFF_RING_SIZE)
+        .add("out_of_order", (uint64_t)outOfOrder)
+        .add("ok", ok)
+        .emit();
+    return ok;
+}
+
+static CachedButton macroButtons[4];
+
+static const CachedButton* benchMacroButton(const char* name) {
+    for (const CachedButton& button : macroButtons) {
+        if (strcmp(button.record.name, name) == 0) {
+            return &button;
+        }
+    }
+    return nullptr;
+}
+
+static bool benchMacroButtons() {
+    IrCode power = {IR_PROTO_NEC, 32, false, 0x20DF10EFULL};
+    IrCode volume = {IR_PROTO_SAMSUNG, 32, false, 0xE0E0E01FULL};
+    Rf433Code light = {1, 24, 0, 0x5551ULL};
+    CachedButton& fan = macroButtons[3];
+
+    recordClear(macroButtons[0].record, "Power");
+    recordFromIrCode(macroButtons[0].record, power);
+    recordClear(macroButtons[1].record, "Volume");
+    recordFromIrCode(macroButtons[1].record, volume);
+    recordClear(macroButtons[2].record, "Light");
+    recordFromRf433Code(macroButtons[2].record, light, RF433_TX_REPEATS);
+    recordClear(fan.record, "Fan");
+    fan.record.band = BAND_RF24;
+    fan.record.payloadLength = 4;
+    memcpy(fan.record.payload, "\x01\x02\x03\x04", 4);
+    fan.waveform.frameSymbols = 0;
+    return compileIrCode(power, macroButtons[0].waveform) && compileIrCode(volume, macroButtons[1].waveform) &&
+           compileRf433Code(light, macroButtons[2].waveform);
+}
+
+// A compiled macro played through the radio service on a virtual clock,
+// stepped the way the radio task does: continuously while a send is close,
+// a tick at a time otherwise, each step costing a random slice of time.
+// Every send has to leave within BENCH_MACRO_LATE_US of its deadline.
+static bool benchMacro() {
+    static BenchMacroLink link;
+    static RadioService service(link);
+    static MacroSchedule schedule;
+    static RadioCommand command;
+    static RadioEvent event;
+    static const char* const kSteps[] = {"Power", "Volume ir 300 5", "Light rf433 250 2", "Fan rf24 40",
+                                         "Power ir 1000", "Light auto 0 1", "Fan rf24 5 3"};
+    const uint8_t stepCount = sizeof(kSteps) / sizeof(kSteps[0]);
+    MacroStep steps[stepCount];
+    uint8_t failedStep = 0;
+    uint32_t errors = !benchMacroButtons();
+
+    for (uint8_t i = 0; i < stepCount; i++) {
+        errors += !parseMacroStep(kSteps[i], steps[i]);
+    }
+    Latency compile;
+    uint32_t start = hal->system.cycleCount();
+    bool compiled = errors == 0 && compileMacro(steps, stepCount, benchMacroButton, schedule, failedStep);
+    compile.add(elapsedNs(start));
+    if (!compiled) {
+        JsonLine("macro").add("failed_step", (uint64_t)failedStep).add("ok", false).emit();
+        return false;
+    }
+
+    Latency step;
+    uint32_t runs = 0;
+    uint32_t sends = 0;
+    uint32_t missed = 0;
+    uint32_t maxLateUs = 0;
+    uint64_t totalLateUs = 0;
+    for (uint32_t run = 0; run < BENCH_MACRO_RUNS; run++) {
+        // Start anywhere in a tick, with the clock about to wrap now and then
+        link.advance(benchRandom() % BENCH_MACRO_TICK_US + (run % 4 == 3 ? 0xFFF00000UL : 0));
+        link.clear();
+        command.type = RADIO_MACRO_START;
+        command.macro = &schedule;
+        service.submit(command);
+
+        uint32_t startUs = link.nowUs();
+        bool done = false;
+        while (!done) {
+            start = hal->system.cycleCount();
+            service.step();
+            step.add(elapsedNs(start));
+            while (service.poll(event)) {
+                done = done || event.type == RADIO_MACRO_DONE;
+                errors += event.type == RADIO_MACRO_DONE && !event.ok;
+            }
+            link.advance(service.busy() ? 1 + benchRandom() % BENCH_MACRO_STEP_US : BENCH_MACRO_TICK_US);
+            if (link.nowUs() - startUs > schedule.lengthUs + 1000000) {
+                errors++;
+                break;
+            }
+        }
+        runs++;
+
+        missed += link.sends() != schedule.eventCount;
+        for (uint16_t i = 0; i < link.sends() && i < schedule.eventCount; i++) {
+            int32_t lateUs = (int32_t)(link.sentUs(i) - startUs - schedule.events[i].atUs);
+            uint32_t late = lateUs > 0 ? (uint32_t)lateUs : 0;
+            errors += lateUs < 0;
+            maxLateUs = late > maxLateUs ? late : maxLateUs;
+            totalLateUs += late;
+            sends++;
+        }
+    }
+
+    bool ok = errors == 0 && missed == 0 && maxLateUs < BENCH_MACRO_LATE_US;
+    JsonLine("macro")
+        .add("runs", (uint64_t)runs)
+        .add("events", (uint64_t)schedule.eventCount)
+        .add("length_ms", (uint64_t)(schedule.lengthUs / 1000))
+        .add("sends", (uint64_t)sends)
+        .add("late_avg_us", (uint64_t)(sends ? totalLateUs / sends : 0))
+        .add("late_max_us", (uint64_t)maxLateUs)
+        .add("compile_ns", (uint64_t)compile.maxNs)
+        .add("step_avg_ns", (uint64_t)step.averageNs())
+        .add("step_max_ns", (uint64_t)step.maxNs)
+        .add("missed_runs", (uint64_t)missed)
+        .add("errors", (uint64_t)errors)
+        .add("ok", ok)
+        .emit();
+    return ok;
+}
+
+// A CardKB on a virtual clock: the last key pressed sits in one register
+// until a read takes it, so a key pressed before the previous one was read
+// overwrites it and is lost. Every read is one I2C transaction.
+class BenchCardKb : public KeyboardHal {
+public:
+    void begin() override {}
+
+    bool read(char& key) override {
+        _transactions++;
+        if (_latched == 0) {
+            return false;
+        }
+        key = (char)_latched;
+        _latched = 0;
+        return true;
+    }
+
+    void press(uint8_t key) {
+        _overwritten += _latched != 0;
+        _latched = key;
+    }
+
+    uint32_t transactions() const { return _transactions; }
+    uint32_t overwritten() const { return _overwritten; }
+
+private:
+    uint8_t _latched = 0;
+    uint32_t _transactions = 0;
+    uint32_t _overwritten = 0;
+};
+
+// Scripted typing through the keyboard poll and event queue, drained at
+// the input task's rate: every key has to come out once, in order, at a
+// brisk typist's pace and at a burst no one can keep up.
+static bool benchKeyboard() {
+    static BenchCardKb keyboards[sizeof(kKeyGapsMs) / sizeof(kKeyGapsMs[0])];
+    static KeyInput inputs[sizeof(kKeyGapsMs) / sizeof(kKeyGapsMs[0])];
+    bool ok = true;
+
+    for (size_t rate = 0; rate < sizeof(kKeyGapsMs) / sizeof(kKeyGapsMs[0]); rate++) {
+        BenchCardKb& keyboard = keyboards[rate];
+        KeyInput& input = inputs[rate];
+        const uint32_t minGapUs = kKeyGapsMs[rate][0] * 1000;
+        const uint32_t spreadUs = (kKeyGapsMs[rate][1] - kKeyGapsMs[rate][0]) * 1000;
+        uint32_t nowUs = 0;
+        uint32_t nextKeyUs = minGapUs;
+        uint32_t typed = 0;
+        uint32_t received = 0;
+        uint32_t outOfOrder = 0;
+        uint32_t repeats = 0;
+        uint32_t maxLatencyUs = 0;
+        uint32_t pressedUs[KEY_QUEUE_SIZE * 4];
+        Latency poll;
+
+        while (received < BENCH_KEY_PRESSES && nowUs < BENCH_KEY_PRESSES * kKeyGapsMs[rate][1] * 2000) {
+            while (typed < BENCH_KEY_PRESSES && (int32_t)(nowUs - nextKeyUs) >= 0) {
+                pressedUs[typed % (KEY_QUEUE_SIZE * 4)] = nextKeyUs;
+                keyboard.press((uint8_t)('a' + typed % 26));
+                typed++;
+                nextKeyUs += minGapUs + benchRandom() % (spreadUs + 1);
+            }
+
+            uint32_t start = hal->system.cycleCount();
+            input.poll(keyboard, nowUs);
+            poll.add(elapsedNs(start));
+
+            // The input task runs every other poll
+            if ((nowUs / KEY_POLL_US) % 2 == 1) {
+                KeyEvent event;
+                while (input.next(event)) {
+                    outOfOrder += event.key != (uint8_t)('a' + received % 26);
+                    repeats += event.repeat;
+                    uint32_t latencyUs = nowUs - pressedUs[received % (KEY_QUEUE_SIZE * 4)];
+                    maxLatencyUs = latencyUs > maxLatencyUs ? latencyUs : maxLatencyUs;
+                    received++;
+                }
+            }
+            nowUs += KEY_POLL_US;
+        }
+
+        uint32_t lost = typed - received;
+        bool passed = lost == 0 && outOfOrder == 0 && keyboard.overwritten() == 0 && input.dropped() == 0;
+        ok = ok && passed;
+        JsonLine("keyboard")
+            .add("gap_min_ms", (uint64_t)kKeyGapsMs[rate][0])
+            .add("gap_max_ms", (uint64_t)kKeyGapsMs[rate][1])
+            .add("typed", (uint64_t)typed)
+            .add("received", (uint64_t)received)
+            .add("lost", (uint64_t)lost)
+            .add("overwritten", (uint64_t)keyboard.overwritten())
+            .add("queue_dropped", (uint64_t)input.dropped())
+            .add("out_of_order", (uint64_t)outOfOrder)
+            .add("repeats", (uint64_t)repeats)
+            .add("i2c_per_key", (uint64_t)(received ? keyboard.transactions() / received : 0))
+            .add("latency_max_us", (uint64_t)maxLatencyUs)
+            .add("poll_avg_ns", (uint64_t)poll.averageNs())
+            .add("poll_max_ns", (uint64_t)poll.maxNs)
+            .add("ok", passed)
+            .emit();
+    }
+    return ok;
+}
+
+// The app's periodic tasks with what one run costs at worst: an I2C read,
+// a radio poll, an SD write-back, a full-screen push and a run of import
+// chunks. Together they keep the CPU about 85% busy.
+struct BenchTask {
+    const char* name;
+    uint32_t periodUs;
+    uint32_t costUs;
+};
+
+static const BenchTask kSchedTasks[] = {
+    {"keys", KEY_POLL_US, 200},
+    {"input", 10000, 100},
+    {"radio", 5000, 300},
+    {"storage", 5000, 1000},
+    {"battery", 1000000, 150},
+    {"ui", 33333, 8000},
+    {"import", 5000, 1500},
+};
+
+static uint32_t schedNowUs;
+static BenchCardKb schedKeyboard;
+static KeyInput schedInput;
+static uint32_t schedPressedUs[KEY_QUEUE_SIZE * 4];
+static uint32_t schedReceived;
+static uint32_t schedOutOfOrder;
+static uint32_t schedMaxLatencyUs;
+static uint64_t schedTotalLatencyUs;
+
+static uint32_t benchSchedClock() {
+    return schedNowUs;
+}
+
+// Every task spends its cost on the fake clock; the first two are the
+// app's keyboard poll and input dispatch
+template <uint8_t I>
+static void runBenchTask() {
+    schedNowUs += kSchedTasks[I].costUs;
+    if (I == 0) {
+        schedInput.poll(schedKeyboard, schedNowUs);
+    } else if (I == 1) {
+        KeyEvent event;
+        while (schedInput.next(event)) {
+            schedOutOfOrder += event.key != (uint8_t)('a' + schedReceived % 26);
+            uint32_t latencyUs = schedNowUs - schedPressedUs[schedReceived % (KEY_QUEUE_SIZE * 4)];
+            schedMaxLatencyUs = latencyUs > schedMaxLatencyUs ? latencyUs : schedMaxLatencyUs;
+            schedTotalLatencyUs += latencyUs;
+            schedReceived++;
+        }
+    }
+}
+
+static const Scheduler::TaskFunction kSchedFunctions[] = {
+    runBenchTask<0>, runBenchTask<1>, runBenchTask<2>, runBenchTask<3>,
+    runBenchTask<4>, runBenchTask<5>, runBenchTask<6>,
+};
+
+static_assert(sizeof(kSchedFunctions) / sizeof(kSchedFunctions[0]) == sizeof(kSchedTasks) / sizeof(kSchedTasks[0]),
+              "One function per scheduler bench task");
+
+// Key press to its action through the real scheduler and key queue on a
+// fake clock, with every other task as slow as it gets and an import
+// running. A press waits for the keyboard poll and then
+// for the input task, and each wait can be pushed back by one run of every
+// task: the worst case has to stay within that.
+static bool benchScheduler() {
+    static Scheduler scheduler(benchSchedClock);
+    uint32_t costsUs = 0;
+    for (uint8_t i = 0; i < sizeof(kSchedTasks) / sizeof(kSchedTasks[0]); i++) {
+        scheduler.add(kSchedTasks[i].name, kSchedFunctions[i], kSchedTasks[i].periodUs);
+        costsUs += kSchedTasks[i].costUs;
+    }
+    const uint32_t boundUs = KEY_POLL_US + kSchedTasks[1].periodUs + 2 * costsUs;
+
+    uint32_t typed = 0;
+    uint32_t nextPressUs = BENCH_SCHED_GAP_MIN_US;
+    uint32_t endUs = BENCH_SCHED_PRESSES * (BENCH_SCHED_GAP_MIN_US + BENCH_SCHED_GAP_SPREAD_US);
+    while (schedReceived < BENCH_SCHED_PRESSES && (int32_t)(schedNowUs - endUs) < 0) {
+        while (typed < BENCH_SCHED_PRESSES && (int32_t)(schedNowUs - nextPressUs) >= 0) {
+            schedPressedUs[typed % (KEY_QUEUE_SIZE * 4)] = nextPressUs;
+            schedKeyboard.press((uint8_t)('a' + typed % 26));
+            typed++;
+            nextPressUs += BENCH_SCHED_GAP_MIN_US + benchRandom() % (BENCH_SCHED_GAP_SPREAD_US + 1);
+        }
+        // Sleeps as runDue() says, but wakes for the next press
+        uint32_t sleepUs = scheduler.runDue();
+        uint32_t untilPressUs = nextPressUs - schedNowUs;
+        if (typed < BENCH_SCHED_PRESSES && (int32_t)untilPressUs > 0 && untilPressUs < sleepUs) {
+            sleepUs = untilPressUs;
+        }
+        schedNowUs += sleepUs;
+    }
+
+    uint32_t lateMaxUs = 0;
+    for (uint8_t i = 0; i < scheduler.taskCount(); i++) {
+        lateMaxUs = scheduler.stats(i).maxLateUs > lateMaxUs ? scheduler.stats(i).maxLateUs : lateMaxUs;
+    }
+    bool ok = schedReceived == typed && schedOutOfOrder == 0 && schedKeyboard.overwritten() == 0 &&
+              schedInput.dropped() == 0 && schedMaxLatencyUs <= boundUs;
+    JsonLine("scheduler")
+        .add("tasks", (uint64_t)scheduler.taskCount())
+        .add("presses", (uint64_t)typed)
+        .add("received", (uint64_t)schedReceived)
+        .add("overwritten", (uint64_t)schedKeyboard.overwritten())
+        .add("latency_avg_us", (uint64_t)(schedReceived ? schedTotalLatencyUs / schedReceived : 0))
+        .add("latency_max_us", (uint64_t)schedMaxLatencyUs)
+        .add("bound_us", (uint64_t)boundUs)
+        .add("late_max_us", (uint64_t)lateMaxUs)
+        .add("ok", ok)
+        .emit();
+    return ok;
+}
+
+// Counts what would reach the panel; drawing itself is not measured
+class BenchSurface : public UiSurface {
+public:
+    int16_t width() override { return BENCH_UI_WIDTH; }
+    int16_t height() override { return BENCH_UI_HEIGHT; }
+    void fillRect(const UiRect&, uint16_t) override {}
+    void drawText(int16_t, int16_t, const char*, uint16_t, uint8_t, uint16_t) override {}
+    void push(const UiRect& rect) override { _pixels += (uint32_t)rect.w * rect.h; }
+
+    uint32_t pixels() const { return _pixels; }
+
+private:
+    uint32_t _pixels = 0;
+};
+
+// The app's status, menu and message widgets through a scripted session at
+// 30 Hz: the battery meter polled every second, a capture every few seconds
+// with its message, and the menu back after it. Frames where nothing changed
+// must push nothing, a battery change only the status bar, and the average
+// frame a small part of the screen.
+static bool benchUi() {
+    static BenchSurface surface;
+    static Ui ui(surface);
+    int8_t status = ui.addWidget({0, 0, BENCH_UI_WIDTH, 10}, 1, UI_WHITE, UI_BLACK);
+    int8_t menu = ui.addWidget({0, 20, BENCH_UI_WIDTH, BENCH_UI_HEIGHT - 20}, 1, UI_WHITE, UI_BLACK);
+    int8_t message = ui.addWidget({0, 12, BENCH_UI_WIDTH, BENCH_UI_HEIGHT - 12}, 1, UI_WHITE, UI_BLACK);
+    ui.setText(menu, "Remote Possibility Interface\n\n1. Scan Remote Buttons\n\n2. Save Remote Buttons");
+    ui.setVisible(message, false);
+    ui.render();
+
+    const uint32_t fullFrame = (uint32_t)BENCH_UI_WIDTH * BENCH_UI_HEIGHT;
+    const uint32_t statusPixels = (uint32_t)BENCH_UI_WIDTH * 10;
+    uint32_t pixelsBefore = surface.pixels();
+    uint32_t maxFrame = 0;
+    uint32_t idleFrames = 0;
+    uint32_t idlePushing = 0;
+    uint32_t batteryOverrun = 0;
+    char text[24];
+    for (uint32_t frame = 0; frame < BENCH_UI_FRAMES; frame++) {
+        bool idle = true;
+        bool batteryOnly = false;
+        if (frame % 30 == 0) {
+            // The level only moves every ten seconds
+            snprintf(text, sizeof(text), "Power: %lu%%", (unsigned long)(100 - frame / 300));
+            ui.setText(status, text);
+            batteryOnly = frame % 300 == 0;
+            idle = !batteryOnly;
+        }
+        uint32_t phase = frame % 150;
+        if (phase == 40) {
+            ui.setText(message, "Scanning IR...");
+            ui.setVisible(menu, false);
+            ui.setVisible(message, true);
+            idle = batteryOnly = false;
+        } else if (phase == 45 || phase == 46) {
+            ui.appendText(message, phase == 45 ? "\nIR Button Detected: " : "NEC:32:20DF10EF");
+            idle = batteryOnly = false;
+        } else if (phase == 100) {
+            ui.setVisible(message, false);
+            ui.setVisible(menu, true);
+            idle = batteryOnly = false;
+        }
+
+        uint32_t pixels = ui.render();
+        maxFrame = pixels > maxFrame ? pixels : maxFrame;
+        idleFrames += idle;
+        idlePushing += idle && pixels > 0;
+        batteryOverrun += batteryOnly && pixels > statusPixels;
+    }
+    uint32_t perFrame = (surface.pixels() - pixelsBefore) / BENCH_UI_FRAMES;
+
+    bool ok = idlePushing == 0 && batteryOverrun == 0 && perFrame * 100 <= fullFrame * BENCH_UI_MAX_PERCENT;
+    JsonLine("ui")
+        .add("frames", (uint64_t)BENCH_UI_FRAMES)
+        .add("idle_frames", (uint64_t)idleFrames)
+        .add("idle_pushing", (uint64_t)idlePushing)
+        .add("battery_overrun", (uint64_t)batteryOverrun)
+        .add("pixels_per_frame", (uint64_t)perFrame)
+        .add("max_frame_pixels", (uint64_t)maxFrame)
+        .add("full_frame_pixels", (uint64_t)fullFrame)
+        .add("ok", ok)
+        .emit();
+    return ok;
+}
+
+static uint32_t benchTraceClock() {
+    return hal->system.micros();
+}
+
+static uint8_t benchTraceCore() {
+    return hal->system.coreId();
+}
+
+static uint32_t traceDumpLines = 0;
+static uint32_t traceDumpRecords = 0;
+
+static void countTraceLine(const char* line) {
+    traceDumpLines++;
+    if (strncmp(line, TRACE_DUMP_PREFIX "R ", strlen(TRACE_DUMP_PREFIX "R ")) == 0) {
+        traceDumpRecords += (strlen(line) - strlen(TRACE_DUMP_PREFIX "R ")) / (2 * sizeof(TraceRecord));
+    }
+}
+
+// The cost of a trace point whether or not this build has them compiled
+// in, and a dump of the full ring
+static bool benchTrace() {
+    traceBegin(benchTraceClock, benchTraceCore);
+    uint32_t start = hal->system.cycleCount();
+    for (uint32_t i = 0; i < BENCH_TRACE_SCOPES; i++) {
+        traceRecord(TRACE_TASK, TRACE_PHASE_BEGIN, i);
+        traceRecord(TRACE_TASK, TRACE_PHASE_END, 0);
+    }
+    uint32_t recordNs = elapsedNs(start) / (2 * BENCH_TRACE_SCOPES);
+
+    traceDumpLines = 0;
+    traceDumpRecords = 0;
+    start = hal->system.cycleCount();
+    traceDump(countTraceLine);
+    uint32_t dumpNs = elapsedNs(start);
+    traceBegin(nullptr, nullptr);
+
+    bool ok = traceDumpRecords == TRACE_RING_SIZE && recordNs <= BENCH_TRACE_RECORD_NS;
+    JsonLine("trace")
+        .add("compiled_in", (bool)TRACE_ENABLED)
+        .add("records", (uint64_t)(2 * BENCH_TRACE_SCOPES))
+        .add("record_ns", (uint64_t)recordNs)
+        .add("dumped", (uint64_t)traceDumpRecords)
+        .add("dump_lines", (uint64_t)traceDumpLines)
+        .add("dump_us", (uint64_t)(dumpNs / 1000))
+        .add("ok", ok)
+        .emit();
+    return ok;
+}
+
+// Timings no decoder takes: an unknown header, then uneven marks and spaces
+static void importRawTrain(uint32_t index, PulseTrain& train) {
+    train.count = 0;
+    train.durations[train.count++] = 3000;
+    train.durations[train.count++] = 3000;
+    for (uint16_t i = 0; i < BENCH_IMPORT_RAW_PAIRS; i++) {
+        train.durations[train.count++] = 400 + (i * 97 + index * 13) % 700;
+        train.durations[train.count++] = 300 + (i * 53 + index * 7) % 1500;
+    }
+    train.durations[train.count++] = 600;
+}
+
+static IrCode importNecCode(uint32_t index) {
+    uint8_t command = (uint8_t)(index >> 1);
+    return {IR_PROTO_NEC, 32, 0, (uint64_t)(0x20DF0000UL | (command << 8) | (uint8_t)~command)};
+}
+
+// Space-separated durations, in microseconds or in carrier periods
+static void importDurations(const PulseTrain& train, uint32_t periodNs, char* text, size_t size) {
+    size_t length = 0;
+    text[0] = '\0';
+    for (uint16_t i = 0; i < train.count && length < size; i++) {
+        uint32_t value = periodNs ? (uint32_t)(((uint64_t)train.durations[i] * 1000 + periodNs / 2) / periodNs)
+                                  : train.durations[i];
+        length += snprintf(text + length, size - length, periodNs ? "%s%04lX" : "%s%lu", i ? " " : "",
+                           (unsigned long)value);
+    }
+}
+
+// One generated database: even buttons are NEC codes, odd ones raw timings
+static bool writeImportFile(StorageFile* file, ImportFormat format, uint32_t& bytes) {
+    static PulseTrain train;
+    static char durations[IMPORT_LINE_MAX - 32];
+    const uint32_t prontoPeriodNs = 0x6D * 241246UL / 1000;
+    BenchWriter out(file);
+    char name[BUTTON_NAME_MAX];
+
+    if (format == IMPORT_FLIPPER) {
+        out.line("Filetype: IR signals file").line("Version: 1");
+    }
+    // LIRC keeps a remote's codes together: the NEC remote, then the raw one
+    for (uint8_t pass = 0; pass < (format == IMPORT_LIRC ? 2 : 1); pass++) {
+        if (format == IMPORT_LIRC) {
+            out.line("begin remote").line("  name bench_%s", pass ? "raw" : "nec");
+            if (pass == 0) {
+                out.line("  bits 16").line("  flags SPACE_ENC|CONST_LENGTH").line("  header 9000 4500");
+                out.line("  one 560 1690").line("  zero 560 560").line("  ptrail 560");
+                out.line("  pre_data_bits 16").line("  pre_data 0x20DF").line("  begin codes");
+            } else {
+                out.line("  flags RAW_CODES").line("  begin raw_codes");
+            }
+        }
+        for (uint32_t i = 0; i < BENCH_IMPORT_BUTTONS; i++) {
+            bool raw = i & 1;
+            if (format == IMPORT_LIRC && raw != (pass == 1)) {
+                continue;
+            }
+            benchName(name, sizeof(name), "IMP", i);
+            IrCode code = importNecCode(i);
+            if (raw) {
+                importRawTrain(i, train);
+            } else {
+                encodeIr(code, train);
+            }
+            switch (format) {
+            case IMPORT_PRONTO:
+                importDurations(train, prontoPeriodNs, durations, sizeof(durations));
+                // An odd count leaves the last pair without its space
+                out.line("%s 0000 006D %04X 0000 %s%s", name, (train.count + 1) / 2, durations,
+                         train.count & 1 ? " 0400" : "");
+                break;
+            case IMPORT_LIRC:
+                if (raw) {
+                    importDurations(train, 0, durations, sizeof(durations));
+                    out.line("    name %s", name).line("      %s", durations);
+                } else {
+                    out.line("    %s 0x%04X", name, (unsigned)(code.value & 0xFFFF));
+                }
+                break;
+            default:
+                out.line("#").line("name: %s", name);
+                if (raw) {
+                    importDurations(train, 0, durations, sizeof(durations));
+                    out.line("type: raw").line("frequency: 38000").line("duty_cycle: 0.330000");
+                    out.line("data: %s", durations);
+                } else {
+                    uint8_t command = (uint8_t)(code.value >> 8);
+                    out.line("type: parsed").line("protocol: NEC").line("address: 04 00 00 00");
+                    out.line("command: %02X 00 00 00", command);
+                }
+                break;
+            }
+        }
+        if (format == IMPORT_LIRC) {
+            out.line(pass ? "  end raw_codes" : "  end codes").line("end remote");
+        }
+    }
+    bytes = out.bytes();
+    return out.ok();
+}
+
+static const ImportFormat kImportFormats[] = {IMPORT_PRONTO, IMPORT_LIRC, IMPORT_FLIPPER};
+static const char* const kImportFormatNames[] = {"unknown", "pronto", "lirc", "flipper"};
+
+// Generated multi-megabyte databases streamed through the importer into a
+// library the way the import task does it, chunk by chunk
+static bool benchImport(ImportFormat format) {
+    static IrImporter importer;
+    static char chunk[IMPORT_CHUNK_SIZE];
+    const char* sourcePath = BENCH_DIR "/import.txt";
+    const char* libraryPath = BENCH_DIR "/import" LIBRARY_EXTENSION;
+    const char* formatName = kImportFormatNames[format];
+
+    uint32_t bytes = 0;
+    StorageFile* source = hal->storage.open(sourcePath, STORAGE_CREATE);
+    bool ok = source && writeImportFile(source, format, bytes);
+    if (source) {
+        source->close();
+    }
+    StorageFile* file = ok ? hal->storage.open(libraryPath, STORAGE_CREATE) : nullptr;
+    RemoteLibrary library;
+    source = file ? hal->storage.open(sourcePath, STORAGE_READ) : nullptr;
+    if (!source || !RemoteLibrary::format(*file, BENCH_IMPORT_BUTTONS) || !library.open(file)) {
+        if (source) {
+            source->close();
+        }
+        if (file) {
+            file->close();
+        }
+        hal->storage.remove(sourcePath);
+        JsonLine("import").add("format", formatName).add("ok", false).emit();
+        return false;
+    }
+
+    BenchStore store(library);
+    size_t heapStart = hal->system.heapUsed();
+    size_t heapHighWater = heapStart;
+    Latency feed;
+    uint32_t start = hal->system.cycleCount();
+    uint64_t totalNs = 0;
+    importer.begin("bench", store);
+    size_t length;
+    while ((length = source->read(chunk, sizeof(chunk))) > 0) {
+        uint32_t feedStart = hal->system.cycleCount();
+        ok = importer.feed(chunk, length) && ok;
+        feed.add(elapsedNs(feedStart));
+        size_t heap = hal->system.heapUsed();
+        heapHighWater = heap > heapHighWater ? heap : heapHighWater;
+        // The cycle counter wraps within seconds; fold it in per chunk
+        totalNs += elapsedNs(start);
+        start = hal->system.cycleCount();
+    }
+    ok = importer.finish() && ok;
+    totalNs += elapsedNs(start);
+
+    const ImportStats& stats = importer.stats();
+    uint32_t stored = library.count();
+    library.close();
+    file->close();
+    source->close();
+    hal->storage.remove(libraryPath);
+    hal->storage.remove(sourcePath);
+
+    ok = ok && importer.format() == format && stats.buttons == BENCH_IMPORT_BUTTONS && stored == stats.buttons &&
+         stats.decoded == BENCH_IMPORT_BUTTONS / 2 && stats.raw == BENCH_IMPORT_BUTTONS - stats.decoded &&
+         stats.skipped == 0 && stats.bytes == bytes;
+    JsonLine("import")
+        .add("format", formatName)
+        .add("bytes", (uint64_t)bytes)
+        .add("buttons", (uint64_t)stats.buttons)
+        .add("decoded", (uint64_t)stats.decoded)
+        .add("raw", (uint64_t)stats.raw)
+        .add("skipped", (uint64_t)stats.skipped)
+        .add("buttons_per_s", (uint64_t)(totalNs ? stats.buttons * 1000000000ULL / totalNs : 0))
+        .add("kb_per_s", (uint64_t)(totalNs ? bytes * 1000000000ULL / 1024 / totalNs : 0))
+        .add("chunk_max_us", (uint64_t)(feed.maxNs / 1000))
+        .add("importer_bytes", (uint64_t)sizeof(IrImporter))
+        .add("heap_growth", (uint64_t)(heapHighWater - heapStart))
+        .add("ok", ok)
+        .emit();
+    return ok;
+}
+
+bool runBenchmarks(Hal& platform, const BenchOptions& options) {
+    hal = &platform;
+
+    JsonLine("start")
+        .add("build", __DATE__ " " __TIME__)
+        .add("cycles_per_us", (uint64_t)hal->system.cyclesPerUs())
+        .add("heap_used", (uint64_t)hal->system.heapUsed())
+        .emit();
+
+    bool storage = hal->storage.begin();
+    if (storage && !hal->storage.exists(BENCH_DIR)) {
+        storage = hal->storage.mkdir(BENCH_DIR);
+    }
+
+    bool ok = benchDecode(options, storage);
+    ok = benchReplay() && ok;
+    ok = benchCodec(storage) && ok;
+    ok = benchFingerprint() && ok;
+    ok = benchRf24Tx() && ok;
+    ok = benchSniffer() && ok;
+    ok = benchMacro() && ok;
+    ok = benchKeyboard() && ok;
+    ok = benchScheduler() && ok;
+    ok = benchUi() && ok;
+    ok = benchTrace() && ok;
+    if (storage) {
+        for (uint32_t buttons : kLibrarySizes) {
+            ok = benchLibrary(options, buttons) && ok;
+        }
+        ok = benchLibraryOverwrite() && ok;
+        for (uint32_t remotes : kSignalIndexRemotes) {
+            ok = benchSignalIndex(options, remotes) && ok;
+        }
+        ok = benchPlayback(options) && ok;
+        for (uint32_t readUs : kStorageReadUs) {
+            ok = benchPressLatency(readUs) && ok;
+        }
+        for (ImportFormat format : kImportFormats) {
+            ok = benchImport(format) && ok;
+        }
+        ok = benchSoak(options) && ok;
+    }
+
+    JsonLine("end").add("storage", storage).add("ok", ok && storage).emit();
+    return ok && storage;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "hal.h"
+
+#ifndef BENCH_DECODE_FRAMES
+#define BENCH_DECODE_FRAMES 2000   // Per protocol
+#endif
+
+#ifndef BENCH_LOOKUPS
+#define BENCH_LOOKUPS 200
+#endif
+
+#ifndef BENCH_SOAK_SECONDS
+#define BENCH_SOAK_SECONDS 60
+#endif
+
+#ifndef BENCH_SOAK_REPORT_SECONDS
+#define BENCH_SOAK_REPORT_SECONDS 60
+#endif
+
+#define BENCH_DIR "/bench"
+#define BENCH_CORPUS BENCH_DIR "/corpus.txt"   // Optional real captures, one RAW line each, optionally labelled
+
+struct BenchOptions {
+    uint32_t decodeFrames;
+    uint32_t lookups;
+    uint32_t soakSeconds;
+};
+
+#define BENCH_DEFAULT_OPTIONS {BENCH_DECODE_FRAMES, BENCH_LOOKUPS, BENCH_SOAK_SECONDS}
+
+// Benchmarks the capture -> store -> replay pipeline. Each result is logged
+// through hal.system.log() as one JSON object per line, named by its bench:
+//   decode             IR classification per protocol, over the labelled corpus if any
+//   replay             held buttons through the capture path, nothing dropped
+//   codec              raw timing compression ratio and decode speed
+//   fingerprint        duplicate lookup of jittered captures against a remote
+//   rf24_tx            nRF24 transmit throughput over a lossy link
+//   rf24_sniff         sniffing at the maximum packet rate, no packet lost
+//   macro              macro send lateness on a virtual clock
+//   keyboard           keys lost and I2C reads per keystroke
+//   scheduler          key press to action latency under a full task load
+//   ui                 pixels pushed per frame of a scripted session
+//   trace              trace point cost and a full ring dump
+//   library            put and lookup latency by size, against the text format
+//   library_overwrite  raw region growth under repeated saves of one button
+//   signal_index       index build time, size and query cost by remote count
+//   playback           cached button lookup, hits and misses
+//   press_latency      press to transmit-ready, cold and warm, on a slow card
+//   import             Pronto, LIRC and Flipper import rate and memory
+//   soak               heap high-water, dropped frames and steady-state allocations
+// The benches from library on need the card. Timing uses the HAL cycle
+// counter, so the same code runs on the device and in the native build.
+// Returns false if any stage failed.
+bool runBenchmarks(Hal& hal, const BenchOptions& options);
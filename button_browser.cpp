@@ -0,0 +1,67 @@
+#include "button_browser.h"
+
+#include <string.h>
+
+void ButtonBrowser::open(RemoteLibrary& library) {
+    _library = &library;
+    _top = 0;
+    _selected = 0;
+    _filled = 0;
+    _reads = 0;
+    readRows(0, BROWSER_ROWS);
+}
+
+bool ButtonBrowser::move(int32_t rows) {
+    uint32_t count = this->count();
+    if (count == 0) {
+        _selected = 0;
+        return scrollTo(0);
+    }
+    int64_t target = (int64_t)_selected + rows;
+    _selected = target < 0 ? 0 : target >= count ? count - 1 : (uint32_t)target;
+
+    uint32_t top = _top;
+    if (_selected < top) {
+        top = _selected;
+    } else if (_selected >= top + BROWSER_ROWS) {
+        top = _selected - BROWSER_ROWS + 1;
+    }
+    return scrollTo(top);
+}
+
+bool ButtonBrowser::scrollTo(uint32_t top) {
+    // Rows still in view are moved rather than read again
+    uint32_t distance = top > _top ? top - _top : _top - top;
+    if (distance >= BROWSER_ROWS) {
+        _top = top;
+        return readRows(0, BROWSER_ROWS);
+    }
+    uint8_t kept = (uint8_t)(BROWSER_ROWS - distance);
+    if (top >= _top) {
+        memmove(&_rows[0], &_rows[distance], kept * sizeof(ButtonRecord));
+        _top = top;
+        // Rows left empty at the end may have been saved since
+        uint32_t valid = _filled > top ? _filled - top : 0;
+        return readRows((uint8_t)(valid < kept ? valid : kept), BROWSER_ROWS);
+    }
+    memmove(&_rows[distance], &_rows[0], kept * sizeof(ButtonRecord));
+    uint32_t filled = _filled;
+    _top = top;
+    bool ok = readRows(0, (uint8_t)distance);
+    _filled = filled < top + BROWSER_ROWS ? filled : top + BROWSER_ROWS;
+    return ok;
+}
+
+// Reads rows [first, last) and sets how far they are filled
+bool ButtonBrowser::readRows(uint8_t first, uint8_t last) {
+    uint32_t count = this->count();
+    _filled = _top + first;
+    for (uint8_t row = first; row < last && _top + row < count; row++) {
+        _reads++;
+        if (!_library->recordAt(_top + row, _rows[row])) {
+            return false;
+        }
+        _filled = _top + row + 1;
+    }
+    return true;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "button_record.h"
+#include "remote_library.h"
+
+#ifndef BROWSER_ROWS
+#define BROWSER_ROWS 8
+#endif
+
+// A window of BROWSER_ROWS buttons over a remote's library, in the order
+// they were saved. Records sit in fixed slots, so any row is one seek away
+// and paging costs the same at the end of a big remote as at the start.
+// Only rows that scroll into view are read; the rest move in memory.
+class ButtonBrowser {
+public:
+    // Starts at the first button. `library` must stay open while browsing;
+    // buttons saved meanwhile show up at the end.
+    void open(RemoteLibrary& library);
+    void close() { _library = nullptr; }
+    bool isOpen() const { return _library != nullptr; }
+
+    // Moves the selection, scrolling when it leaves the window. Clamped to
+    // the first and last buttons. Returns false if a row could not be read.
+    bool move(int32_t rows);
+    bool page(int32_t pages) { return move(pages * BROWSER_ROWS); }
+
+    uint32_t count() const { return _library ? _library->count() : 0; }
+    uint32_t top() const { return _top; }
+    uint32_t selected() const { return _selected; }
+    uint8_t selectedRow() const { return (uint8_t)(_selected - _top); }
+
+    // A visible row: nullptr past the last button.
+    const ButtonRecord* row(uint8_t row) const { return _top + row < _filled ? &_rows[row] : nullptr; }
+    const ButtonRecord* selectedRecord() const { return row(selectedRow()); }
+
+    // Records fetched from the library since open().
+    uint32_t reads() const { return _reads; }
+
+private:
+    bool scrollTo(uint32_t top);
+    bool readRows(uint8_t first, uint8_t last);
+
+    RemoteLibrary* _library = nullptr;
+    uint32_t _top = 0;
+    uint32_t _selected = 0;
+    uint32_t _filled = 0;          // Index past the last row holding a record
+    uint32_t _reads = 0;
+    ButtonRecord _rows[BROWSER_ROWS];
+};
@@ -0,0 +1,261 @@
+#include "button_cache.h"
+
+#include <string.h>
+
+#include "remote_library.h"
+
+static PulseCode rawScratch;
+static PulseTrain trainScratch;
+
+bool ButtonCache::begin(uint16_t capacity, ButtonStore* store, Allocator allocate) {
+    _entries = (CachedButton*)allocate(capacity * sizeof(CachedButton));
+    _buckets = (uint16_t*)allocate(capacity * sizeof(uint16_t));
+    if (!_entries || !_buckets || capacity == 0 || capacity == NONE) {
+        _capacity = 0;
+        return false;
+    }
+    _capacity = capacity;
+    _store = store;
+    invalidate();
+    return true;
+}
+
+void ButtonCache::invalidate() {
+    for (uint16_t i = 0; i < _capacity; i++) {
+        _buckets[i] = NONE;
+    }
+    _used = 0;
+    _lruHead = NONE;
+    _lruTail = NONE;
+    _dirtyCount = 0;
+    _fingerprints.clear();
+}
+
+bool ButtonCache::selectRemote(const char* remote) {
+    flush();
+    if (_dirtyCount > 0) {
+        return false;
+    }
+    invalidate();
+    strncpy(_remote, remote, REMOTE_NAME_MAX - 1);
+    _remote[REMOTE_NAME_MAX - 1] = '\0';
+    _preloadIndex = 0;
+    _preloading = _remote[0] != '\0';
+    return true;
+}
+
+uint16_t ButtonCache::find(uint32_t key, const char* button) {
+    if (_capacity == 0) {
+        return NONE;
+    }
+    for (uint16_t i = _buckets[key % _capacity]; i != NONE; i = _entries[i].chainNext) {
+        if (_entries[i].key == key && strncmp(_entries[i].record.name, button, BUTTON_NAME_MAX - 1) == 0) {
+            return i;
+        }
+    }
+    return NONE;
+}
+
+void ButtonCache::unlinkLru(uint16_t index) {
+    CachedButton& entry = _entries[index];
+    if (entry.lruPrev != NONE) {
+        _entries[entry.lruPrev].lruNext = entry.lruNext;
+    } else {
+        _lruHead = entry.lruNext;
+    }
+    if (entry.lruNext != NONE) {
+        _entries[entry.lruNext].lruPrev = entry.lruPrev;
+    } else {
+        _lruTail = entry.lruPrev;
+    }
+}
+
+void ButtonCache::pushFront(uint16_t index) {
+    CachedButton& entry = _entries[index];
+    entry.lruPrev = NONE;
+    entry.lruNext = _lruHead;
+    if (_lruHead != NONE) {
+        _entries[_lruHead].lruPrev = index;
+    }
+    _lruHead = index;
+    if (_lruTail == NONE) {
+        _lruTail = index;
+    }
+}
+
+void ButtonCache::unlinkChain(uint16_t index) {
+    uint16_t* link = &_buckets[_entries[index].key % _capacity];
+    while (*link != NONE) {
+        if (*link == index) {
+            *link = _entries[index].chainNext;
+            return;
+        }
+        link = &_entries[*link].chainNext;
+    }
+}
+
+bool ButtonCache::writeBack(uint16_t index) {
+    CachedButton& entry = _entries[index];
+    if (!entry.dirty) {
+        return true;
+    }
+    if (!_store || !_store->store(_remote, entry.record, entry.raw.length ? &entry.raw : nullptr)) {
+        return false;
+    }
+    entry.dirty = false;
+    _dirtyCount--;
+    _writeBacks++;
+    return true;
+}
+
+uint16_t ButtonCache::acquire() {
+    if (_used < _capacity) {
+        return _used++;
+    }
+
+    // Prefer the least recently used clean entry, then the least recently
+    // used dirty one that writes back. A save the store refused is kept.
+    uint16_t victim = NONE;
+    for (uint16_t i = _lruTail; i != NONE && victim == NONE; i = _entries[i].lruPrev) {
+        if (!_entries[i].dirty) {
+            victim = i;
+        }
+    }
+    for (uint16_t i = _lruTail; i != NONE && victim == NONE; i = _entries[i].lruPrev) {
+        if (writeBack(i)) {
+            victim = i;
+        }
+    }
+    if (victim == NONE) {
+        return NONE;
+    }
+
+    unlinkLru(victim);
+    unlinkChain(victim);
+    _evictions++;
+    return victim;
+}
+
+void ButtonCache::fill(uint16_t index, const ButtonRecord& record, const PulseCode* raw) {
+    CachedButton& entry = _entries[index];
+    IrCode code;
+    Rf433Code rf433;
+
+    entry.record = record;
+    entry.key = RemoteLibrary::hashName(record.name);
+    entry.dirty = false;
+    entry.raw.length = 0;
+    entry.waveform.frameSymbols = 0;
+
+    // Compiled once here, so playback hands the transmitter ready symbols
+    if (raw && raw->length) {
+        memcpy(entry.raw.bytes, raw->bytes, raw->length);
+        entry.raw.length = raw->length;
+        compileIrPulseCode(raw->bytes, raw->length, record.carrierKhz, entry.waveform);
+    } else if (recordToIrCode(record, code)) {
+        compileIrCode(code, entry.waveform);
+    } else if (recordToRf433Code(record, rf433)) {
+        compileRf433Code(rf433, entry.waveform);
+    }
+
+    uint16_t bucket = entry.key % _capacity;
+    entry.chainNext = _buckets[bucket];
+    _buckets[bucket] = index;
+    pushFront(index);
+    fingerprint(record, raw);
+}
+
+void ButtonCache::fingerprint(const ButtonRecord& record, const PulseCode* raw) {
+    Fingerprint print;
+    bool hasTrain = raw && raw->length && decodePulses(raw->bytes, raw->length, trainScratch);
+    if (fingerprintRecord(record, hasTrain ? &trainScratch : nullptr, print)) {
+        _fingerprints.add(record.name, print);
+    }
+}
+
+const CachedButton* ButtonCache::get(const char* button) {
+    uint32_t key = RemoteLibrary::hashName(button);
+    uint16_t index = find(key, button);
+    if (index != NONE) {
+        _hits++;
+        unlinkLru(index);
+        pushFront(index);
+        return &_entries[index];
+    }
+
+    _misses++;
+    ButtonRecord record;
+    if (_capacity == 0 || !_store || !_store->load(_remote, button, record, rawScratch)) {
+        return nullptr;
+    }
+    index = acquire();
+    if (index == NONE) {
+        return nullptr;
+    }
+    fill(index, record, &rawScratch);
+    return &_entries[index];
+}
+
+bool ButtonCache::put(const ButtonRecord& record, const PulseTrain* raw) {
+    if (_capacity == 0 || (raw && !encodePulses(*raw, rawScratch))) {
+        return false;
+    }
+
+    uint16_t index = find(RemoteLibrary::hashName(record.name), record.name);
+    bool wasDirty = false;
+    if (index == NONE) {
+        index = acquire();
+        if (index == NONE) {
+            return false;
+        }
+    } else {
+        wasDirty = _entries[index].dirty;
+        unlinkLru(index);
+        unlinkChain(index);
+    }
+
+    fill(index, record, raw ? &rawScratch : nullptr);
+    _entries[index].dirty = true;
+    if (!wasDirty) {
+        _dirtyCount++;
+    }
+    return true;
+}
+
+bool ButtonCache::service() {
+    if (_dirtyCount > 0) {
+        // Oldest saves first
+        for (uint16_t i = _lruTail; i != NONE; i = _entries[i].lruPrev) {
+            if (_entries[i].dirty) {
+                writeBack(i);
+                return true;
+            }
+        }
+    }
+
+    if (!_preloading || !_store) {
+        return false;
+    }
+
+    // Preloading never evicts; buttons used before it finishes stay hot.
+    // Once the cache is full the rest are only fingerprinted.
+    ButtonRecord record;
+    if (!_store->loadAt(_remote, _preloadIndex++, record, rawScratch)) {
+        _preloading = false;
+        return false;
+    }
+    if (find(RemoteLibrary::hashName(record.name), record.name) == NONE) {
+        if (_used < _capacity) {
+            fill(acquire(), record, &rawScratch);
+        } else {
+            fingerprint(record, &rawScratch);
+        }
+    }
+    return true;
+}
+
+void ButtonCache::flush() {
+    for (uint16_t i = _lruHead; i != NONE && _dirtyCount > 0; i = _entries[i].lruNext) {
+        writeBack(i);
+    }
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "button_record.h"
+#include "fingerprint.h"
+#include "ir_waveform.h"
+#include "pulse_codec.h"
+
+#ifndef BUTTON_CACHE_ENTRIES
+#define BUTTON_CACHE_ENTRIES 64
+#endif
+
+#define REMOTE_NAME_MAX 32
+
+// Backing store the cache reads through and writes back to. Raw timings
+// travel compressed; raw.length is 0 for buttons without them.
+class ButtonStore {
+public:
+    virtual ~ButtonStore() {}
+    virtual bool load(const char* remote, const char* button, ButtonRecord& record, PulseCode& raw) = 0;
+    virtual bool loadAt(const char* remote, uint32_t index, ButtonRecord& record, PulseCode& raw) = 0;
+    virtual bool store(const char* remote, const ButtonRecord& record, const PulseCode* raw) = 0;
+};
+
+// A button decoded once and kept ready to transmit.
+struct CachedButton {
+    ButtonRecord record;
+    IrWaveform waveform;           // Compiled IR or 433 MHz symbols, empty for nRF24
+    PulseCode raw;                 // Compressed raw timings, written back with the record
+    bool dirty;
+    uint32_t key;
+    uint16_t lruPrev;
+    uint16_t lruNext;
+    uint16_t chainNext;
+};
+
+// LRU cache of transmit-ready buttons for the active remote. Saves are
+// written back to the store from service() instead of blocking the caller.
+// Every button of the remote, cached or not, is fingerprinted on the way
+// through so captures can be checked for duplicates.
+class ButtonCache {
+public:
+    typedef void* (*Allocator)(size_t size);
+
+    bool begin(uint16_t capacity, ButtonStore* store, Allocator allocate);
+
+    // Flushes pending saves, then preloads the new remote a record at a time.
+    // Fails, keeping the current remote, when a save could not be written.
+    bool selectRemote(const char* remote);
+    const char* remote() const { return _remote; }
+
+    // Returns the button for the active remote, reading through on a miss.
+    // A save waiting for the store is never evicted to make room.
+    const CachedButton* get(const char* button);
+
+    // Caches a save and queues it for write-back. Raw timings are
+    // compressed here. Fails when every entry holds a save the store has
+    // not taken yet.
+    bool put(const ButtonRecord& record, const PulseTrain* raw);
+
+    // Does one step of background work: a write-back or a preload read.
+    // Returns false when there is nothing left to do.
+    bool service();
+
+    void flush();
+
+    const FingerprintIndex& fingerprints() const { return _fingerprints; }
+
+    uint32_t hits() const { return _hits; }
+    uint32_t misses() const { return _misses; }
+    uint32_t evictions() const { return _evictions; }
+    uint32_t writeBacks() const { return _writeBacks; }
+    uint16_t dirtyCount() const { return _dirtyCount; }
+
+private:
+    static const uint16_t NONE = 0xFFFF;
+
+    uint16_t find(uint32_t key, const char* button);
+    uint16_t acquire();
+    void fill(uint16_t index, const ButtonRecord& record, const PulseCode* raw);
+    void fingerprint(const ButtonRecord& record, const PulseCode* raw);
+    void unlinkLru(uint16_t index);
+    void pushFront(uint16_t index);
+    void unlinkChain(uint16_t index);
+    bool writeBack(uint16_t index);
+    void invalidate();
+
+    CachedButton* _entries = nullptr;
+    uint16_t* _buckets = nullptr;
+    uint16_t _capacity = 0;
+    uint16_t _used = 0;
+    uint16_t _lruHead = NONE;
+    uint16_t _lruTail = NONE;
+    uint16_t _dirtyCount = 0;
+    ButtonStore* _store = nullptr;
+
+    char _remote[REMOTE_NAME_MAX] = "";
+    uint32_t _preloadIndex = 0;
+    bool _preloading = false;
+    FingerprintIndex _fingerprints;
+
+    uint32_t _hits = 0;
+    uint32_t _misses = 0;
+    uint32_t _evictions = 0;
+    uint32_t _writeBacks = 0;
+};
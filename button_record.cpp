@@ -0,0 +1,159 @@
+#include "button_record.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void recordSetName(ButtonRecord& record, const char* name) {
+    strncpy(record.name, name, BUTTON_NAME_MAX - 1);
+    record.name[BUTTON_NAME_MAX - 1] = '\0';
+}
+
+void recordClear(ButtonRecord& record, const char* name) {
+    memset(&record, 0, sizeof(record));
+    recordSetName(record, name);
+}
+
+uint8_t recordRepeats(const ButtonRecord& record) {
+    if (record.repeats) {
+        return record.repeats;
+    }
+    return record.band == BAND_RF433 ? RF433_TX_REPEATS : 1;
+}
+
+void recordSetValue(ButtonRecord& record, uint64_t value) {
+    for (uint8_t i = 0; i < 8; i++) {
+        record.payload[i] = (uint8_t)(value >> (8 * i));
+    }
+    record.payloadLength = 8;
+}
+
+uint64_t recordValue(const ButtonRecord& record) {
+    uint64_t value = 0;
+    uint8_t length = record.payloadLength < 8 ? record.payloadLength : 8;
+    for (uint8_t i = 0; i < length; i++) {
+        value |= (uint64_t)record.payload[i] << (8 * i);
+    }
+    return value;
+}
+
+void recordFromIrCode(ButtonRecord& record, const IrCode& code) {
+    record.band = BAND_IR;
+    record.protocol = code.protocol;
+    record.bits = code.bits;
+    record.carrierKhz = irCarrierKhz(code.protocol);
+    recordSetValue(record, code.value);
+}
+
+bool recordToIrCode(const ButtonRecord& record, IrCode& code) {
+    if (record.band == BAND_LEGACY) {
+        code.protocol = IR_PROTO_NEC;
+        code.bits = 32;
+    } else if (record.band == BAND_IR && record.protocol != IR_PROTO_RAW && record.protocol < IR_PROTO_COUNT) {
+        code.protocol = (IrProtocol)record.protocol;
+        code.bits = record.bits;
+    } else {
+        return false;
+    }
+    code.repeat = false;
+    code.value = recordValue(record);
+    return true;
+}
+
+void recordFromRf433Code(ButtonRecord& record, const Rf433Code& code, uint8_t repeats) {
+    record.band = BAND_RF433;
+    record.protocol = code.protocol;
+    record.bits = code.bits;
+    record.repeats = repeats;
+    recordSetValue(record, code.value);
+    record.payload[8] = (uint8_t)code.pulseUs;
+    record.payload[9] = (uint8_t)(code.pulseUs >> 8);
+    record.payloadLength = 10;
+}
+
+// Records from before pulse widths were kept replay at the nominal one
+bool recordToRf433Code(const ButtonRecord& record, Rf433Code& code) {
+    if (record.band != BAND_RF433 || record.protocol == RF433_PROTO_RAW) {
+        return false;
+    }
+    code.protocol = record.protocol;
+    code.bits = record.bits;
+    code.pulseUs = record.payloadLength >= 10 ? (uint16_t)(record.payload[8] | (record.payload[9] << 8)) : 0;
+    code.value = recordValue(record);
+    return true;
+}
+
+bool rawToPulseTrain(const uint8_t* raw, uint16_t length, PulseTrain& train) {
+    if ((length & 1) || length / 2 > IR_MAX_PULSES) {
+        return false;
+    }
+    train.startUs = 0;
+    train.count = length / 2;
+    for (uint16_t i = 0; i < train.count; i++) {
+        train.durations[i] = (uint16_t)(raw[2 * i] | (raw[2 * i + 1] << 8));
+    }
+    return true;
+}
+
+bool recordFromLegacyText(ButtonRecord& record, const char* data, PulseTrain& raw, bool& hasRaw) {
+    hasRaw = false;
+
+    uint8_t carrierKhz;
+    if (parseIrRaw(data, raw, carrierKhz)) {
+        record.band = BAND_IR;
+        record.protocol = IR_PROTO_RAW;
+        record.carrierKhz = carrierKhz;
+        hasRaw = true;
+        return true;
+    }
+
+    IrCode code;
+    if (parseIrCode(data, code)) {
+        if (strchr(data, ':')) {
+            recordFromIrCode(record, code);
+        } else {
+            // Old firmware wrote IR and 433 MHz values alike as bare hex
+            record.band = BAND_LEGACY;
+            record.bits = 32;
+            recordSetValue(record, code.value);
+        }
+        return true;
+    }
+
+    // Anything else was an nRF24 payload written as text
+    size_t length = strlen(data);
+    while (length > 0 && (data[length - 1] == '\r' || data[length - 1] == '\n')) {
+        length--;
+    }
+    if (length == 0 || length > BUTTON_PAYLOAD_MAX) {
+        return false;
+    }
+    record.band = BAND_RF24;
+    record.payloadLength = (uint8_t)length;
+    memcpy(record.payload, data, length);
+    return true;
+}
+
+size_t formatRecordData(const ButtonRecord& record, char* out, size_t outLen) {
+    int written;
+    IrCode code;
+    Rf433Code rf433;
+
+    if ((record.band == BAND_IR && record.protocol == IR_PROTO_RAW) ||
+        (record.band == BAND_RF433 && record.protocol == RF433_PROTO_RAW)) {
+        written = snprintf(out, outLen, "RAW %u bytes", record.rawLength);
+    } else if (recordToIrCode(record, code)) {
+        return formatIrCode(code, out, outLen);
+    } else if (recordToRf433Code(record, rf433)) {
+        return formatRf433Code(rf433, out, outLen);
+    } else {
+        size_t length = record.payloadLength < outLen - 1 ? record.payloadLength : outLen - 1;
+        for (size_t i = 0; i < length; i++) {
+            char c = (char)record.payload[i];
+            out[i] = c >= 0x20 && c < 0x7F ? c : '.';
+        }
+        out[length] = '\0';
+        return length;
+    }
+    return written < 0 || (size_t)written >= outLen ? 0 : (size_t)written;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "frame_assembler.h"
+#include "ir_codec.h"
+#include "rf433_codec.h"
+
+#define BUTTON_NAME_MAX 20         // Including the terminating NUL
+#define BUTTON_PAYLOAD_MAX 32      // nRF24 maximum payload
+
+enum SignalBand : uint8_t {
+    BAND_IR = 0,
+    BAND_RF24,
+    BAND_RF433,
+    BAND_LEGACY = 0xFF             // Imported bare hex value, band never recorded
+};
+
+// Fixed 64-byte layout shared by the on-card library and the RAM cache.
+struct ButtonRecord {
+    char name[BUTTON_NAME_MAX];
+    uint8_t band;                  // SignalBand
+    uint8_t protocol;              // IrProtocol for IR, Rf433Code protocol for 433 MHz
+    uint8_t bits;
+    uint8_t repeats;               // Frames per press as captured, 0 = recordRepeats()'s default
+    uint32_t rawOffset;            // Into the library's raw timing region
+    uint16_t rawLength;            // Bytes, 0 = no raw timings
+    uint8_t payloadLength;
+    uint8_t carrierKhz;            // IR carrier, 0 for other bands
+    uint8_t payload[BUTTON_PAYLOAD_MAX];
+};
+
+static_assert(sizeof(ButtonRecord) == 64, "ButtonRecord must stay 64 bytes on disk");
+
+void recordClear(ButtonRecord& record, const char* name);
+void recordSetName(ButtonRecord& record, const char* name);
+
+// Frames to send per press: as captured, or when the capture did not say,
+// RF433_TX_REPEATS for 433 MHz and one otherwise.
+uint8_t recordRepeats(const ButtonRecord& record);
+
+// Little-endian integer payload used by IR codes and 433 MHz values.
+void recordSetValue(ButtonRecord& record, uint64_t value);
+uint64_t recordValue(const ButtonRecord& record);
+
+void recordFromIrCode(ButtonRecord& record, const IrCode& code);
+bool recordToIrCode(const ButtonRecord& record, IrCode& code);
+
+// 433 MHz codes keep the measured pulse width after the value.
+void recordFromRf433Code(ButtonRecord& record, const Rf433Code& code, uint8_t repeats);
+bool recordToRf433Code(const ButtonRecord& record, Rf433Code& code);
+
+// Version 1 libraries kept raw timings as little-endian uint16 durations.
+bool rawToPulseTrain(const uint8_t* raw, uint16_t length, PulseTrain& train);
+
+// Reads the data column of a legacy "name,data" line. Fills `raw` and sets
+// `hasRaw` for RAW entries.
+bool recordFromLegacyText(ButtonRecord& record, const char* data, PulseTrain& raw, bool& hasRaw);
+
+// Short human-readable form for the display.
+size_t formatRecordData(const ButtonRecord& record, char* out, size_t outLen);
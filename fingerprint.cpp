@@ -0,0 +1,189 @@
+#include "fingerprint.h"
+
+#include <string.h>
+
+static uint32_t hashByte(uint32_t hash, uint8_t byte) {
+    return (hash ^ byte) * 16777619UL;
+}
+
+static uint32_t hashStart(uint8_t band, uint8_t protocol, uint16_t length) {
+    uint32_t hash = 2166136261UL;
+    hash = hashByte(hash, band);
+    hash = hashByte(hash, protocol);
+    hash = hashByte(hash, (uint8_t)length);
+    return hashByte(hash, (uint8_t)(length >> 8));
+}
+
+// Mean of the marks (first = 0) or spaces (first = 1) close to the shortest
+static uint32_t shortestUnit(const PulseTrain& train, uint16_t first) {
+    uint16_t shortest = 0xFFFF;
+    for (uint16_t i = first; i < train.count; i += 2) {
+        shortest = train.durations[i] < shortest ? train.durations[i] : shortest;
+    }
+    uint32_t limit = shortest + (uint32_t)shortest * FINGERPRINT_UNIT_PCT / 100;
+    uint32_t total = 0;
+    uint16_t pulses = 0;
+    for (uint16_t i = first; i < train.count; i += 2) {
+        if (train.durations[i] <= limit) {
+            total += train.durations[i];
+            pulses++;
+        }
+    }
+    return pulses && total ? total / pulses : 1;
+}
+
+// Whole units up to 8, then steps 1.25 times apart (each one divides by
+// 5/4), so the jitter of a long leader or gap stays in one step
+static uint8_t quantize(uint32_t durationUs, uint32_t unitUs) {
+    uint32_t units = (durationUs + unitUs / 2) / unitUs;
+    uint8_t step = 0;
+    while (units > 8) {
+        units = units * 4 / 5;
+        step++;
+    }
+    return step ? (uint8_t)(8 + step) : (uint8_t)units;
+}
+
+static bool unitsClose(uint16_t a, uint16_t b) {
+    uint32_t larger = a > b ? a : b;
+    uint32_t difference = a > b ? a - b : b - a;
+    return difference * 100 <= larger * FINGERPRINT_UNIT_PCT;
+}
+
+static bool fingerprintCode(uint8_t band, uint8_t protocol, uint16_t bits, uint64_t value, Fingerprint& out) {
+    out.key = hashStart(band, protocol, bits);
+    for (uint8_t i = 0; i < 8; i++) {
+        out.key = hashByte(out.key, (uint8_t)(value >> (8 * i)));
+    }
+    out.band = band;
+    out.protocol = protocol;
+    out.length = bits;
+    out.unitUs = 0;
+    out.sketch = value;
+    return true;
+}
+
+bool fingerprintTrain(uint8_t band, const PulseTrain& train, Fingerprint& out) {
+    if (train.count == 0) {
+        return false;
+    }
+    // Receivers stretch marks and shrink spaces, so each has its own unit
+    uint32_t markUs = shortestUnit(train, 0);
+    uint32_t spaceUs = train.count > 1 ? shortestUnit(train, 1) : markUs;
+
+    out.key = hashStart(band, 0, train.count);
+    out.band = band;
+    out.protocol = 0;
+    out.length = train.count;
+    out.unitUs = (uint16_t)((markUs + spaceUs) / 2);
+    out.sketch = 0;
+    for (uint16_t i = 0; i < train.count; i++) {
+        uint32_t unitUs = i & 1 ? spaceUs : markUs;
+        out.key = hashByte(out.key, quantize(train.durations[i], unitUs));
+        if (train.durations[i] * 2 > unitUs * 3) {
+            out.sketch ^= 1ULL << (i & 63);
+        }
+    }
+    return true;
+}
+
+bool fingerprintRecord(const ButtonRecord& record, const PulseTrain* raw, Fingerprint& out) {
+    IrCode ir;
+    Rf433Code rf433;
+    if (recordToIrCode(record, ir)) {
+        return fingerprintCode(BAND_IR, ir.protocol, ir.bits, ir.value, out);
+    }
+    if (recordToRf433Code(record, rf433)) {
+        return fingerprintCode(BAND_RF433, rf433.protocol, rf433.bits, rf433.value, out);
+    }
+    if (record.band == BAND_RF24) {
+        if (record.payloadLength == 0 || record.payloadLength > BUTTON_PAYLOAD_MAX) {
+            return false;
+        }
+        uint64_t sketch = 0;
+        out.key = hashStart(BAND_RF24, 0, record.payloadLength);
+        for (uint8_t i = 0; i < record.payloadLength; i++) {
+            out.key = hashByte(out.key, record.payload[i]);
+            sketch ^= (uint64_t)record.payload[i] << (8 * (i & 7));
+        }
+        out.band = BAND_RF24;
+        out.protocol = 0;
+        out.length = record.payloadLength;
+        out.unitUs = 0;
+        out.sketch = sketch;
+        return true;
+    }
+    return raw && fingerprintTrain(record.band, *raw, out);
+}
+
+void FingerprintIndex::clear() {
+    for (uint16_t i = 0; i < FINGERPRINT_INDEX_SIZE; i++) {
+        _buckets[i] = NONE;
+    }
+    _count = 0;
+}
+
+void FingerprintIndex::link(uint16_t index) {
+    uint16_t bucket = _entries[index].fingerprint.key % FINGERPRINT_INDEX_SIZE;
+    _entries[index].chainNext = _buckets[bucket];
+    _buckets[bucket] = index;
+}
+
+void FingerprintIndex::unlink(uint16_t index) {
+    uint16_t* link = &_buckets[_entries[index].fingerprint.key % FINGERPRINT_INDEX_SIZE];
+    while (*link != NONE) {
+        if (*link == index) {
+            *link = _entries[index].chainNext;
+            return;
+        }
+        link = &_entries[*link].chainNext;
+    }
+}
+
+bool FingerprintIndex::add(const char* name, const Fingerprint& fingerprint) {
+    uint16_t index = 0;
+    while (index < _count && strncmp(_entries[index].name, name, BUTTON_NAME_MAX - 1) != 0) {
+        index++;
+    }
+    if (index < _count) {
+        unlink(index);
+    } else if (_count == FINGERPRINT_INDEX_SIZE) {
+        return false;
+    } else {
+        _count++;
+        strncpy(_entries[index].name, name, BUTTON_NAME_MAX - 1);
+        _entries[index].name[BUTTON_NAME_MAX - 1] = '\0';
+    }
+    _entries[index].fingerprint = fingerprint;
+    link(index);
+    return true;
+}
+
+FingerprintMatch FingerprintIndex::match(const Fingerprint& fingerprint, const char*& name) const {
+    name = nullptr;
+    for (uint16_t i = _buckets[fingerprint.key % FINGERPRINT_INDEX_SIZE]; i != NONE; i = _entries[i].chainNext) {
+        const Fingerprint& stored = _entries[i].fingerprint;
+        if (stored.key == fingerprint.key && stored.band == fingerprint.band && stored.length == fingerprint.length) {
+            name = _entries[i].name;
+            return FINGERPRINT_DUPLICATE;
+        }
+    }
+
+    int closest = FINGERPRINT_NEAR_BITS + 1;
+    for (uint16_t i = 0; i < _count; i++) {
+        const Fingerprint& stored = _entries[i].fingerprint;
+        if (stored.band != fingerprint.band || stored.protocol != fingerprint.protocol ||
+            stored.length != fingerprint.length || !unitsClose(stored.unitUs, fingerprint.unitUs)) {
+            continue;
+        }
+        int distance = __builtin_popcountll(stored.sketch ^ fingerprint.sketch);
+        if (distance < closest) {
+            closest = distance;
+            name = _entries[i].name;
+        }
+    }
+    if (!name) {
+        return FINGERPRINT_NEW;
+    }
+    return closest == 0 ? FINGERPRINT_DUPLICATE : FINGERPRINT_NEAR;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "button_record.h"
+#include "frame_assembler.h"
+
+#ifndef FINGERPRINT_INDEX_SIZE
+#define FINGERPRINT_INDEX_SIZE 128     // Buttons of one remote checked against a capture
+#endif
+
+#ifndef FINGERPRINT_NEAR_BITS
+#define FINGERPRINT_NEAR_BITS 1        // Sketch bits a near-duplicate may differ in, e.g. a toggle bit
+#endif
+
+#ifndef FINGERPRINT_UNIT_PCT
+#define FINGERPRINT_UNIT_PCT 25        // Base pulse difference still taken for the same transmitter
+#endif
+
+// What a signal is, whatever its name and the jitter of the capture.
+// Decoded codes are fingerprinted by value. Raw timings are fingerprinted
+// by their shape in units of the frame's own shortest mark and space, in
+// steps coarse enough that receiver jitter stays in one.
+struct Fingerprint {
+    uint32_t key;                  // Equal keys are the same signal
+    uint8_t band;
+    uint8_t protocol;              // 0 for raw timings and nRF24 payloads
+    uint16_t length;               // Bits, payload bytes or pulses
+    uint16_t unitUs;               // Shortest pulse of raw timings, 0 otherwise
+    uint64_t sketch;               // Code value, or a long/short bit per pulse folded into 64
+};
+
+bool fingerprintTrain(uint8_t band, const PulseTrain& train, Fingerprint& out);
+
+// From the decoded value when the record has one, `raw` otherwise.
+bool fingerprintRecord(const ButtonRecord& record, const PulseTrain* raw, Fingerprint& out);
+
+enum FingerprintMatch : uint8_t {
+    FINGERPRINT_NEW,
+    FINGERPRINT_NEAR,              // Same kind of signal, FINGERPRINT_NEAR_BITS apart
+    FINGERPRINT_DUPLICATE
+};
+
+// Fingerprints of the active remote's buttons, by name. An exact match is
+// a hash lookup; a near one scans the buttons of the same band.
+class FingerprintIndex {
+public:
+    FingerprintIndex() { clear(); }
+
+    void clear();
+
+    // Replaces the entry with the same name. Returns false when full.
+    bool add(const char* name, const Fingerprint& fingerprint);
+
+    // `name` is the closest button found, nullptr for FINGERPRINT_NEW. Raw
+    // timings with the same units and sketch count as duplicates even when
+    // a duration fell into the next step.
+    FingerprintMatch match(const Fingerprint& fingerprint, const char*& name) const;
+
+    uint16_t count() const { return _count; }
+
+private:
+    static const uint16_t NONE = 0xFFFF;
+
+    struct Entry {
+        Fingerprint fingerprint;
+        char name[BUTTON_NAME_MAX];
+        uint16_t chainNext;
+    };
+
+    void link(uint16_t index);
+    void unlink(uint16_t index);
+
+    Entry _entries[FINGERPRINT_INDEX_SIZE];
+    uint16_t _buckets[FINGERPRINT_INDEX_SIZE];
+    uint16_t _count = 0;
+};
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// Non-owning view of a character range. Not necessarily NUL-terminated.
+struct StringView {
+    const char* data;
+    size_t length;
+
+    StringView() : data(""), length(0) {}
+    StringView(const char* text) : data(text), length(strlen(text)) {}
+    StringView(const char* text, size_t size) : data(text), length(size) {}
+
+    bool empty() const { return length == 0; }
+    bool equals(const char* text) const { return strncmp(data, text, length) == 0 && text[length] == '\0'; }
+};
+
+// NUL-terminated string in a fixed inline buffer. Writes past the capacity
+// are truncated; nothing here ever touches the heap.
+template <size_t N>
+class FixedString {
+public:
+    FixedString() { clear(); }
+    FixedString(const char* text) { assign(text); }
+
+    void clear() {
+        _length = 0;
+        _text[0] = '\0';
+    }
+
+    FixedString& assign(const char* text) { return assign(StringView(text)); }
+    FixedString& assign(StringView text) {
+        clear();
+        return append(text);
+    }
+
+    FixedString& append(const char* text) { return append(StringView(text)); }
+    FixedString& append(StringView text) {
+        size_t room = N - 1 - _length;
+        size_t count = text.length < room ? text.length : room;
+        memcpy(_text + _length, text.data, count);
+        _length += count;
+        _text[_length] = '\0';
+        return *this;
+    }
+
+    FixedString& append(char c) { return append(StringView(&c, 1)); }
+
+    FixedString& appendUnsigned(uint32_t value, uint8_t base = 10) {
+        char digits[11];
+        snprintf(digits, sizeof(digits), base == 16 ? "%lx" : "%lu", (unsigned long)value);
+        return append(digits);
+    }
+
+    FixedString& operator=(const char* text) { return assign(text); }
+    FixedString& operator+=(const char* text) { return append(text); }
+
+    bool operator==(const char* text) const { return strcmp(_text, text) == 0; }
+    bool operator!=(const char* text) const { return !(*this == text); }
+
+    const char* c_str() const { return _text; }
+    StringView view() const { return StringView(_text, _length); }
+    size_t length() const { return _length; }
+    bool empty() const { return _length == 0; }
+    static constexpr size_t capacity() { return N - 1; }
+
+private:
+    char _text[N];
+    size_t _length;
+};
@@ -0,0 +1,103 @@
+#include "frame_assembler.h"
+
+#include <string.h>
+
+FrameAssembler::FrameAssembler(uint32_t frameGapUs, uint16_t minPulses)
+    : _frameGapUs(frameGapUs), _minPulses(minPulses) {
+    _current.startUs = 0;
+    _current.count = 0;
+}
+
+void FrameAssembler::reset() {
+    _inFrame = false;
+    _lastMark = false;
+    _overflow = false;
+    _current.count = 0;
+}
+
+void FrameAssembler::startFrame(uint32_t timestampUs) {
+    _inFrame = true;
+    _lastMark = true;
+    _overflow = false;
+    _lastEdgeUs = timestampUs;
+    _current.startUs = timestampUs;
+    _current.count = 0;
+}
+
+bool FrameAssembler::finishFrame(PulseTrain& out) {
+    _inFrame = false;
+
+    // A valid frame ends on a mark, so the count is always odd
+    if (_overflow || _current.count < _minPulses || (_current.count & 1) == 0) {
+        _framesDiscarded++;
+        return false;
+    }
+
+    out.startUs = _current.startUs;
+    out.count = _current.count;
+    memcpy(out.durations, _current.durations, _current.count * sizeof(_current.durations[0]));
+    _framesCompleted++;
+    return true;
+}
+
+bool FrameAssembler::pushEdge(const IrEdge& edge, PulseTrain& out) {
+    bool mark = edge.mark != 0;
+
+    if (!_inFrame) {
+        // Idle line: only the leading edge of a mark can open a frame
+        if (mark) {
+            startFrame(edge.timestampUs);
+        }
+        return false;
+    }
+
+    // Repeated level means we missed an edge; keep timing from the first one
+    if (mark == _lastMark) {
+        return false;
+    }
+
+    uint32_t duration = edge.timestampUs - _lastEdgeUs;
+    _lastEdgeUs = edge.timestampUs;
+    _lastMark = mark;
+
+    if (mark && duration >= _frameGapUs) {
+        bool completed = finishFrame(out);
+        startFrame(edge.timestampUs);
+        return completed;
+    }
+
+    if (_current.count >= IR_MAX_PULSES) {
+        _overflow = true;
+        return false;
+    }
+    _current.durations[_current.count++] = duration > 0xFFFF ? 0xFFFF : (uint16_t)duration;
+    return false;
+}
+
+bool FrameAssembler::poll(uint32_t nowUs, PulseTrain& out) {
+    if (!_inFrame || _lastMark) {
+        return false;
+    }
+    if (nowUs - _lastEdgeUs < _frameGapUs) {
+        return false;
+    }
+    return finishFrame(out);
+}
+
+void IrFramePipeline::service(uint32_t nowUs) {
+    IrEdge edge;
+    while (!queueFull() && _edges.pop(edge)) {
+        if (_assembler.pushEdge(edge, _scratch)) {
+            _frames.push(_scratch);
+        }
+    }
+    // The line only counts as idle once every edge it produced is in
+    if (!queueFull() && _edges.empty() && _assembler.poll(nowUs, _scratch)) {
+        _frames.push(_scratch);
+    }
+}
+
+void IrFramePipeline::flush() {
+    while (_frames.pop(_scratch)) {
+    }
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "spsc_ring.h"
+
+#ifndef IR_MAX_PULSES
+#define IR_MAX_PULSES 256          // Longest mark/space train kept per frame
+#endif
+
+#ifndef IR_FRAME_GAP_US
+#define IR_FRAME_GAP_US 10000      // Space long enough to end a frame
+#endif
+
+#ifndef IR_MIN_FRAME_PULSES
+#define IR_MIN_FRAME_PULSES 3      // NEC repeat code is the shortest valid frame
+#endif
+
+#ifndef IR_EDGE_RING_SIZE
+#define IR_EDGE_RING_SIZE 1024     // Edges buffered between loop passes
+#endif
+
+#ifndef IR_FRAME_QUEUE_SIZE
+#define IR_FRAME_QUEUE_SIZE 8      // Assembled frames waiting for the UI
+#endif
+
+// One level change on the receiver, already converted to carrier polarity.
+struct IrEdge {
+    uint32_t timestampUs;
+    uint8_t mark;                  // 1 = carrier present, 0 = idle
+};
+
+// Alternating mark/space durations in microseconds, starting and ending with a mark.
+struct PulseTrain {
+    uint32_t startUs;
+    uint16_t count;
+    uint16_t durations[IR_MAX_PULSES];
+};
+
+// Turns a stream of timestamped edges into framed pulse trains. Has no
+// hardware dependencies so recorded edge streams can be replayed on a host.
+class FrameAssembler {
+public:
+    explicit FrameAssembler(uint32_t frameGapUs = IR_FRAME_GAP_US,
+                            uint16_t minPulses = IR_MIN_FRAME_PULSES);
+
+    // Feeds one edge. Returns true when it closed a frame, which is copied to `out`.
+    bool pushEdge(const IrEdge& edge, PulseTrain& out);
+
+    // Closes the pending frame once the line has been idle for the frame gap.
+    bool poll(uint32_t nowUs, PulseTrain& out);
+
+    void reset();
+
+    uint32_t framesCompleted() const { return _framesCompleted; }
+    uint32_t framesDiscarded() const { return _framesDiscarded; }
+
+private:
+    bool finishFrame(PulseTrain& out);
+    void startFrame(uint32_t timestampUs);
+
+    uint32_t _frameGapUs;
+    uint16_t _minPulses;
+    bool _inFrame = false;
+    bool _lastMark = false;
+    bool _overflow = false;
+    uint32_t _lastEdgeUs = 0;
+    uint32_t _framesCompleted = 0;
+    uint32_t _framesDiscarded = 0;
+    PulseTrain _current;
+};
+
+// The capture path between the edge interrupt and the reader: an edge ring,
+// the assembler and a queue of finished frames. Edges stay in the ring
+// while the frame queue is full, so a reader that falls behind delays
+// frames instead of losing them; only a full edge ring drops anything.
+class IrFramePipeline {
+public:
+    // Producer side, safe from an ISR.
+    bool pushEdge(const IrEdge& edge) { return _edges.push(edge); }
+
+    // Moves pending edges through the assembler into the frame queue.
+    void service(uint32_t nowUs);
+
+    bool read(PulseTrain& frame) { return _frames.pop(frame); }
+    void flush();
+
+    size_t pendingEdges() const { return _edges.size(); }
+    uint32_t droppedEdges() const { return _edges.dropped(); }
+    uint32_t droppedFrames() const { return _frames.dropped(); }
+    uint32_t framesCaptured() const { return _assembler.framesCompleted(); }
+
+private:
+    bool queueFull() const { return _frames.size() == _frames.capacity(); }
+
+    SpscRing<IrEdge, IR_EDGE_RING_SIZE> _edges;
+    SpscRing<PulseTrain, IR_FRAME_QUEUE_SIZE> _frames;
+    FrameAssembler _assembler;
+    PulseTrain _scratch;
+};
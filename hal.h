@@ -0,0 +1,141 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "radio_service.h"
+#include "remote_library.h"
+#include "ui.h"
+
+// Hardware abstraction for the firmware logic in app.cpp. The device build
+// implements these on M5Unified, SD and the radio drivers; the native build
+// implements them with file-backed and scripted fakes.
+
+class SystemHal {
+public:
+    virtual ~SystemHal() {}
+    virtual uint32_t micros() = 0;
+    virtual void sleepUs(uint32_t us) = 0;
+    virtual void log(const char* line) = 0;
+
+    // Large, long-lived buffers; the device prefers PSRAM.
+    virtual void* allocate(size_t size) = 0;
+
+    // Free-running cycle counter for benchmarks; wraps, so only short
+    // intervals can be measured directly.
+    virtual uint32_t cycleCount() = 0;
+    virtual uint32_t cyclesPerUs() = 0;
+
+    // Bytes currently allocated from the heap.
+    virtual size_t heapUsed() = 0;
+
+    // Calls to allocate() and operator new since boot, so a loop that must
+    // not allocate can be checked. Counted in the simulator and in BENCH_MODE
+    // device builds; zero elsewhere.
+    virtual uint32_t allocations() = 0;
+
+    // Runs service.step() on its own task. Returns false when the platform
+    // has none, in which case the app steps the service itself.
+    virtual bool startRadioTask(RadioService& service) = 0;
+
+    // Core the caller runs on, for the tracer; 0 where there is only one.
+    virtual uint8_t coreId() = 0;
+};
+
+enum StorageMode : uint8_t {
+    STORAGE_READ,                  // Existing file, read only
+    STORAGE_UPDATE,                // Existing file, read and write in place
+    STORAGE_CREATE                 // New or truncated file, read and write
+};
+
+#ifndef STORAGE_MAX_OPEN_FILES
+#define STORAGE_MAX_OPEN_FILES 6
+#endif
+
+#ifndef STORAGE_MAX_OPEN_DIRS
+#define STORAGE_MAX_OPEN_DIRS 2
+#endif
+
+// An open file. Handles come from StorageHal::open() and go back to it on
+// close().
+class StorageFile : public LibraryFile {
+public:
+    virtual void close() = 0;
+    virtual bool available() = 0;
+
+    // Reads up to the next '\n', which is consumed but not stored. No
+    // terminator is added; returns the bytes copied.
+    virtual size_t readLine(char* line, size_t maxLength) = 0;
+
+    // Reads on from the current position. Returns the bytes read, 0 at the
+    // end of the file.
+    virtual size_t read(void* buffer, size_t maxLength) = 0;
+};
+
+// An open directory listing, kept between calls so a long one can be walked
+// over many task runs. Handles come from StorageHal::openDir() and go back
+// to it on close().
+class StorageDir {
+public:
+    virtual ~StorageDir() {}
+    virtual void close() = 0;
+
+    // Name of the next file, leaving out subdirectories and dot files such
+    // as macOS's "._" copies; false after the last one.
+    virtual bool next(char* name, size_t size) = 0;
+};
+
+class StorageHal {
+public:
+    virtual ~StorageHal() {}
+    virtual bool begin() = 0;
+    virtual bool exists(const char* path) = 0;
+    virtual bool mkdir(const char* path) = 0;
+    virtual bool remove(const char* path) = 0;
+    virtual bool rename(const char* from, const char* to) = 0;
+
+    // Returns nullptr if the file cannot be opened or every handle is in use.
+    virtual StorageFile* open(const char* path, StorageMode mode) = 0;
+
+    // Returns nullptr if `path` is not a directory or every handle is in use.
+    virtual StorageDir* openDir(const char* path) = 0;
+};
+
+class PowerHal {
+public:
+    virtual ~PowerHal() {}
+    virtual int batteryLevel() = 0;
+};
+
+class KeyboardHal {
+public:
+    virtual ~KeyboardHal() {}
+    virtual void begin() = 0;
+
+    // One read of the keyboard, a single bus transaction on the CardKB.
+    // False when no key was pressed since the last read.
+    virtual bool read(char& key) = 0;
+};
+
+enum HalButton : uint8_t {
+    BUTTON_A,
+    BUTTON_B,
+    BUTTON_C
+};
+
+class ButtonsHal {
+public:
+    virtual ~ButtonsHal() {}
+    virtual void update() = 0;
+    virtual bool wasPressed(HalButton button) = 0;
+};
+
+struct Hal {
+    SystemHal& system;
+    StorageHal& storage;
+    RadioBackend& radio;
+    UiSurface& display;
+    PowerHal& power;
+    KeyboardHal& keyboard;
+    ButtonsHal& buttons;
+};
@@ -0,0 +1,151 @@
+#include "hal_m5.h"
+
+#include <Arduino.h>
+#include <M5Unified.h>
+#include <Wire.h>
+#ifdef BENCH_MODE
+#include <atomic>
+#include <new>
+#endif
+
+#include "radio_hardware.h"
+
+#define CARDKB_ADDR 0x5F
+
+// The benchmarks count heap allocations; the app keeps the toolchain's
+// allocator
+#ifdef BENCH_MODE
+// Both cores allocate
+static std::atomic<uint32_t> heapAllocations{0};
+
+void* operator new(size_t size) {
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    void* memory = malloc(size ? size : 1);
+    if (!memory) {
+        abort();
+    }
+    return memory;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    return malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept {
+    return operator new(size, tag);
+}
+
+void operator delete(void* memory) noexcept {
+    free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    free(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept {
+    free(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept {
+    free(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept {
+    free(memory);
+}
+#endif
+
+uint32_t M5System::micros() {
+    return ::micros();
+}
+
+// Sub-millisecond waits are not worth a context switch
+void M5System::sleepUs(uint32_t us) {
+    if (us >= 1000) {
+        delay(us / 1000);
+    }
+}
+
+void M5System::log(const char* line) {
+    Serial.println(line);
+}
+
+// PSRAM when the board has it
+void* M5System::allocate(size_t size) {
+#ifdef BENCH_MODE
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+#endif
+    void* memory = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    return memory ? memory : malloc(size);
+}
+
+uint32_t M5System::cycleCount() {
+    return ESP.getCycleCount();
+}
+
+uint32_t M5System::cyclesPerUs() {
+    return ESP.getCpuFreqMHz();
+}
+
+size_t M5System::heapUsed() {
+    return ESP.getHeapSize() - ESP.getFreeHeap();
+}
+
+uint32_t M5System::allocations() {
+#ifdef BENCH_MODE
+    return heapAllocations.load(std::memory_order_relaxed);
+#else
+    return 0;
+#endif
+}
+
+bool M5System::startRadioTask(RadioService& service) {
+    return ::startRadioTask(service);
+}
+
+uint8_t M5System::coreId() {
+    return (uint8_t)xPortGetCoreID();
+}
+
+int M5Power::batteryLevel() {
+    return M5.Power.getBatteryLevel();
+}
+
+void M5_KB::begin() {
+    Wire.begin();
+}
+
+// The CardKB answers every read with the last key pressed, once, then 0
+bool M5_KB::read(char& key) {
+    if (Wire.requestFrom(CARDKB_ADDR, 1) != 1) {
+        return false;
+    }
+    key = (char)Wire.read();
+    return key != 0;
+}
+
+void M5Buttons::update() {
+    M5.update();
+}
+
+bool M5Buttons::wasPressed(HalButton button) {
+    switch (button) {
+    case BUTTON_A:
+        return M5.BtnA.wasPressed();
+    case BUTTON_B:
+        return M5.BtnB.wasPressed();
+    case BUTTON_C:
+        return M5.BtnC.wasPressed();
+    }
+    return false;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "hal.h"
+
+class M5System : public SystemHal {
+public:
+    uint32_t micros() override;
+    void sleepUs(uint32_t us) override;
+    void log(const char* line) override;
+    void* allocate(size_t size) override;
+    uint32_t cycleCount() override;
+    uint32_t cyclesPerUs() override;
+    size_t heapUsed() override;
+    uint32_t allocations() override;
+    bool startRadioTask(RadioService& service) override;
+    uint8_t coreId() override;
+};
+
+class M5Power : public PowerHal {
+public:
+    int batteryLevel() override;
+};
+
+// CardKB I2C keyboard
+class M5_KB : public KeyboardHal {
+public:
+    void begin() override;
+    bool read(char& key) override;
+};
+
+class M5Buttons : public ButtonsHal {
+public:
+    void update() override;
+    bool wasPressed(HalButton button) override;
+};
@@ -0,0 +1,45 @@
+#include "ir_capture.h"
+
+#include <Arduino.h>
+#include <driver/gpio.h>
+
+static IrFramePipeline irPipeline;
+static gpio_num_t irCapturePin;
+
+// TSOP-style receivers pull the line low while the carrier is present
+static void IRAM_ATTR onIrEdge() {
+    IrEdge edge;
+    edge.timestampUs = micros();
+    edge.mark = gpio_get_level(irCapturePin) == 0;
+    irPipeline.pushEdge(edge);
+}
+
+void IrCapture::begin(uint8_t pin) {
+    irCapturePin = (gpio_num_t)pin;
+    pinMode(pin, INPUT);
+    attachInterrupt(digitalPinToInterrupt(pin), onIrEdge, CHANGE);
+}
+
+void IrCapture::service() {
+    irPipeline.service(micros());
+}
+
+bool IrCapture::read(PulseTrain& frame) {
+    return irPipeline.read(frame);
+}
+
+void IrCapture::flush() {
+    irPipeline.flush();
+}
+
+uint32_t IrCapture::droppedEdges() const {
+    return irPipeline.droppedEdges();
+}
+
+uint32_t IrCapture::droppedFrames() const {
+    return irPipeline.droppedFrames();
+}
+
+uint32_t IrCapture::framesCaptured() const {
+    return irPipeline.framesCaptured();
+}
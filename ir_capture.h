@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "frame_assembler.h"
+
+// Always-on IR capture. A GPIO edge interrupt timestamps every level change
+// into a lock-free ring; service() drains it through the frame assembler.
+class IrCapture {
+public:
+    void begin(uint8_t pin);
+
+    // Drains pending edges into frames. Call from loop() as often as possible.
+    void service();
+
+    // Pops the oldest captured frame.
+    bool read(PulseTrain& frame);
+
+    // Discards every queued frame, e.g. before arming a fresh scan.
+    void flush();
+
+    uint32_t droppedEdges() const;
+    uint32_t droppedFrames() const;
+    uint32_t framesCaptured() const;
+};
@@ -0,0 +1,419 @@
+#include "ir_codec.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum IrEncoding : uint8_t {
+    IR_PULSE_DISTANCE,             // Each bit is a mark/space pair of distinct lengths
+    IR_MANCHESTER                  // Each bit is two half-bit levels of one unit
+};
+
+struct IrProtocolTiming {
+    IrProtocol protocol;
+    IrEncoding encoding;
+    uint8_t carrierKhz;
+    uint8_t bitCounts[3];          // Accepted frame lengths, 0 = unused slot
+    bool stopBit;                  // Pulse distance: trailing mark after the last bit
+    bool oneIsMarkFirst;           // Manchester polarity
+    uint8_t longBit;               // Manchester bit sent at double width, 0xFF = none
+    uint16_t headerMark;
+    uint16_t headerSpace;
+    uint16_t oneMark;
+    uint16_t oneSpace;
+    uint16_t zeroMark;
+    uint16_t zeroSpace;
+    uint16_t unitUs;               // Manchester half-bit length
+    uint8_t repeatMs;              // Frame start to frame start while a button is held
+};
+
+#define NO_LONG_BIT 0xFF
+
+// decodeIr() tries the templates whose header matches, closest first.
+// NEC-extended shares the NEC template.
+static constexpr IrProtocolTiming kIrProtocols[] = {
+    // protocol            encoding           kHz  bit counts    stop   1=mark longBit       hdrM  hdrS  1M    1S    0M    0S    unit  rptMs
+    {IR_PROTO_NEC,       IR_PULSE_DISTANCE, 38, {32, 0, 0},   true,  false, NO_LONG_BIT, 9000, 4500, 560,  1690, 560,  560,  0,    108},
+    {IR_PROTO_SAMSUNG,   IR_PULSE_DISTANCE, 38, {32, 0, 0},   true,  false, NO_LONG_BIT, 4500, 4500, 560,  1690, 560,  560,  0,    108},
+    {IR_PROTO_PANASONIC, IR_PULSE_DISTANCE, 37, {48, 0, 0},   true,  false, NO_LONG_BIT, 3456, 1728, 432,  1296, 432,  432,  0,    130},
+    {IR_PROTO_SONY,      IR_PULSE_DISTANCE, 40, {12, 15, 20}, false, false, NO_LONG_BIT, 2400, 600,  1200, 600,  600,  600,  0,    45},
+    {IR_PROTO_RC6,       IR_MANCHESTER,     36, {21, 0, 0},   false, true,  4,           2664, 888,  0,    0,    0,    0,    444,  107},
+    {IR_PROTO_RC5,       IR_MANCHESTER,     36, {14, 0, 0},   false, false, NO_LONG_BIT, 0,    0,    0,    0,    0,    0,    889,  114},
+};
+
+#define NEC_REPEAT_SPACE 2250
+#define MANCHESTER_MAX_HALVES 96
+
+// The NEC repeat code is the NEC header mark, NEC_REPEAT_SPACE and a bit mark
+static constexpr const IrProtocolTiming& kNecTiming = kIrProtocols[0];
+static_assert(kNecTiming.protocol == IR_PROTO_NEC, "The repeat code takes its timings from the NEC row");
+
+static const char* const kIrProtocolNames[IR_PROTO_COUNT] = {
+    "RAW", "NEC", "NECX", "RC5", "RC6", "SONY", "SAMSUNG", "PANASONIC"
+};
+
+static const IrProtocolTiming* findTiming(IrProtocol protocol) {
+    if (protocol == IR_PROTO_NEC_EXT) {
+        protocol = IR_PROTO_NEC;
+    }
+    for (const IrProtocolTiming& timing : kIrProtocols) {
+        if (timing.protocol == protocol) {
+            return &timing;
+        }
+    }
+    return nullptr;
+}
+
+// Receivers stretch marks and shrink spaces by up to ~100 us
+static bool irMatch(uint16_t measured, uint16_t expected) {
+    uint16_t tolerance = expected / 4 + 100;
+    return measured + tolerance >= expected && measured <= expected + tolerance;
+}
+
+static uint16_t irDistance(uint16_t a, uint16_t b) {
+    return a > b ? a - b : b - a;
+}
+
+static bool bitCountAccepted(const IrProtocolTiming& timing, uint16_t bits) {
+    for (uint8_t count : timing.bitCounts) {
+        if (count != 0 && count == bits) {
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* irProtocolName(IrProtocol protocol) {
+    return protocol < IR_PROTO_COUNT ? kIrProtocolNames[protocol] : kIrProtocolNames[IR_PROTO_RAW];
+}
+
+uint8_t irCarrierKhz(IrProtocol protocol) {
+    const IrProtocolTiming* timing = findTiming(protocol);
+    return timing ? timing->carrierKhz : IR_DEFAULT_CARRIER_KHZ;
+}
+
+uint32_t irRepeatPeriodUs(IrProtocol protocol) {
+    const IrProtocolTiming* timing = findTiming(protocol);
+    return timing ? timing->repeatMs * 1000UL : 0;
+}
+
+static bool decodePulseDistance(const IrProtocolTiming& t, const PulseTrain& train, IrCode& code) {
+    const uint16_t* d = train.durations;
+    uint16_t payload = train.count - 2 - (t.stopBit ? 1 : 0);
+
+    // Sony drops the space after its final bit, so the payload is odd
+    uint16_t bits = t.stopBit ? payload / 2 : (payload + 1) / 2;
+    if ((t.stopBit && (payload & 1)) || (!t.stopBit && !(payload & 1)) || !bitCountAccepted(t, bits)) {
+        return false;
+    }
+
+    uint64_t value = 0;
+    for (uint16_t b = 0; b < bits; b++) {
+        uint16_t mark = d[2 + 2 * b];
+        bool hasSpace = 3 + 2 * b < train.count - (t.stopBit ? 1 : 0);
+        uint16_t space = hasSpace ? d[3 + 2 * b] : t.zeroSpace;
+
+        uint32_t oneCost = irDistance(mark, t.oneMark) + (hasSpace ? irDistance(space, t.oneSpace) : 0);
+        uint32_t zeroCost = irDistance(mark, t.zeroMark) + (hasSpace ? irDistance(space, t.zeroSpace) : 0);
+        bool one = oneCost < zeroCost;
+
+        if (!irMatch(mark, one ? t.oneMark : t.zeroMark) ||
+            (hasSpace && !irMatch(space, one ? t.oneSpace : t.zeroSpace))) {
+            return false;
+        }
+        value = (value << 1) | (one ? 1 : 0);
+    }
+
+    if (t.stopBit && !irMatch(d[train.count - 1], t.zeroMark)) {
+        return false;
+    }
+
+    code.protocol = t.protocol;
+    code.bits = (uint8_t)bits;
+    code.value = value;
+
+    if (t.protocol == IR_PROTO_NEC) {
+        // Standard NEC sends the address and its inverse; extended NEC uses all 16 bits
+        uint8_t addr = (uint8_t)(value >> 24);
+        uint8_t addrInv = (uint8_t)(value >> 16);
+        if ((uint8_t)(addr ^ addrInv) != 0xFF) {
+            code.protocol = IR_PROTO_NEC_EXT;
+        }
+    }
+    return true;
+}
+
+static bool decodeManchester(const IrProtocolTiming& t, const PulseTrain& train, IrCode& code) {
+    uint8_t halves[MANCHESTER_MAX_HALVES];
+    uint16_t n = 0;
+    uint16_t first = t.headerMark ? 2 : 0;
+
+    // A leading space half is indistinguishable from the idle line
+    if (!t.oneIsMarkFirst) {
+        halves[n++] = 0;
+    }
+
+    for (uint16_t i = first; i < train.count; i++) {
+        uint16_t units = (train.durations[i] + t.unitUs / 2) / t.unitUs;
+        if (units < 1 || units > 3 || n + units > MANCHESTER_MAX_HALVES) {
+            return false;
+        }
+        uint8_t level = (i & 1) == 0 ? 1 : 0;
+        while (units--) {
+            halves[n++] = level;
+        }
+    }
+
+    // Likewise a trailing space half is lost in the inter-frame gap
+    if (n & 1) {
+        halves[n++] = 0;
+    }
+
+    uint64_t value = 0;
+    uint16_t bits = 0;
+    uint16_t p = 0;
+    while (p < n) {
+        uint16_t width = bits == t.longBit ? 2 : 1;
+        if (p + 2 * width > n || bits >= 64) {
+            return false;
+        }
+        uint8_t firstHalf = halves[p];
+        for (uint16_t k = 0; k < width; k++) {
+            if (halves[p + k] != firstHalf || halves[p + width + k] == firstHalf) {
+                return false;
+            }
+        }
+        bool one = (firstHalf == 1) == t.oneIsMarkFirst;
+        value = (value << 1) | (one ? 1 : 0);
+        bits++;
+        p += 2 * width;
+    }
+
+    if (!bitCountAccepted(t, bits)) {
+        return false;
+    }
+
+    code.protocol = t.protocol;
+    code.bits = (uint8_t)bits;
+    code.value = value;
+    return true;
+}
+
+bool decodeIr(const PulseTrain& train, IrCode& code) {
+    code.protocol = IR_PROTO_RAW;
+    code.bits = 0;
+    code.repeat = false;
+    code.value = 0;
+
+    if (train.count < 3) {
+        return false;
+    }
+
+    const uint16_t* d = train.durations;
+    if (train.count == 3 && irMatch(d[0], kNecTiming.headerMark) && irMatch(d[1], NEC_REPEAT_SPACE) &&
+        irMatch(d[2], kNecTiming.zeroMark)) {
+        code.protocol = IR_PROTO_NEC;
+        code.repeat = true;
+        return true;
+    }
+
+    // Headers overlap once jittered (RC6 can pass for Sony), so candidates
+    // are tried closest header first; headerless protocols go last
+    const size_t protocolCount = sizeof(kIrProtocols) / sizeof(kIrProtocols[0]);
+    const IrProtocolTiming* candidates[protocolCount];
+    uint32_t distances[protocolCount];
+    size_t candidateCount = 0;
+    for (const IrProtocolTiming& t : kIrProtocols) {
+        uint32_t distance = UINT32_MAX;
+        if (t.headerMark) {
+            if (!irMatch(d[0], t.headerMark) || !irMatch(d[1], t.headerSpace)) {
+                continue;
+            }
+            distance = irDistance(d[0], t.headerMark) + irDistance(d[1], t.headerSpace);
+        }
+        size_t pos = candidateCount++;
+        while (pos > 0 && distances[pos - 1] > distance) {
+            candidates[pos] = candidates[pos - 1];
+            distances[pos] = distances[pos - 1];
+            pos--;
+        }
+        candidates[pos] = &t;
+        distances[pos] = distance;
+    }
+
+    for (size_t i = 0; i < candidateCount; i++) {
+        const IrProtocolTiming& t = *candidates[i];
+        bool decoded = t.encoding == IR_PULSE_DISTANCE ? decodePulseDistance(t, train, code)
+                                                       : decodeManchester(t, train, code);
+        if (decoded) {
+            return true;
+        }
+    }
+
+    code.protocol = IR_PROTO_RAW;
+    return false;
+}
+
+static bool appendPulse(PulseTrain& train, uint16_t duration) {
+    if (train.count >= IR_MAX_PULSES) {
+        return false;
+    }
+    train.durations[train.count++] = duration;
+    return true;
+}
+
+// Adds one half-bit level, merging it into the previous duration when the level repeats
+static bool appendHalf(PulseTrain& train, bool mark, uint16_t unit) {
+    bool lastIsMark = (train.count & 1) == 1;
+    if (train.count > 0 && lastIsMark == mark) {
+        train.durations[train.count - 1] += unit;
+        return true;
+    }
+    if (train.count == 0 && !mark) {
+        return true;
+    }
+    return appendPulse(train, unit);
+}
+
+bool encodeIr(const IrCode& code, PulseTrain& train) {
+    train.startUs = 0;
+    train.count = 0;
+
+    if (code.protocol == IR_PROTO_NEC && code.repeat) {
+        return appendPulse(train, kNecTiming.headerMark) && appendPulse(train, NEC_REPEAT_SPACE) &&
+               appendPulse(train, kNecTiming.zeroMark);
+    }
+
+    const IrProtocolTiming* t = findTiming(code.protocol);
+    if (!t || !bitCountAccepted(*t, code.bits)) {
+        return false;
+    }
+
+    if (t->headerMark) {
+        appendPulse(train, t->headerMark);
+        appendPulse(train, t->headerSpace);
+    }
+
+    for (uint8_t b = 0; b < code.bits; b++) {
+        bool one = (code.value >> (code.bits - 1 - b)) & 1;
+
+        if (t->encoding == IR_PULSE_DISTANCE) {
+            if (!appendPulse(train, one ? t->oneMark : t->zeroMark)) {
+                return false;
+            }
+            bool lastBit = b == code.bits - 1;
+            if (!lastBit || t->stopBit) {
+                if (!appendPulse(train, one ? t->oneSpace : t->zeroSpace)) {
+                    return false;
+                }
+            }
+        } else {
+            uint16_t unit = b == t->longBit ? 2 * t->unitUs : t->unitUs;
+            bool firstMark = one == t->oneIsMarkFirst;
+            if (!appendHalf(train, firstMark, unit) || !appendHalf(train, !firstMark, unit)) {
+                return false;
+            }
+        }
+    }
+
+    if (t->encoding == IR_PULSE_DISTANCE && t->stopBit) {
+        return appendPulse(train, t->zeroMark);
+    }
+
+    // Manchester frames end on a mark; the final space half is just idle line
+    if ((train.count & 1) == 0) {
+        train.count--;
+    }
+    return true;
+}
+
+size_t formatIrCode(const IrCode& code, char* out, size_t outLen) {
+    unsigned long high = (unsigned long)(code.value >> 32);
+    unsigned long low = (unsigned long)(code.value & 0xFFFFFFFFUL);
+    int written = high ? snprintf(out, outLen, "%s:%u:%lX%08lX", irProtocolName(code.protocol), code.bits, high, low)
+                       : snprintf(out, outLen, "%s:%u:%lX", irProtocolName(code.protocol), code.bits, low);
+    return written < 0 || (size_t)written >= outLen ? 0 : (size_t)written;
+}
+
+size_t formatIrRaw(const PulseTrain& train, uint8_t carrierKhz, char* out, size_t outLen) {
+    int written = snprintf(out, outLen, "RAW:%u:", carrierKhz);
+    if (written < 0 || (size_t)written >= outLen) {
+        return 0;
+    }
+    size_t used = (size_t)written;
+    for (uint16_t i = 0; i < train.count; i++) {
+        written = snprintf(out + used, outLen - used, i ? " %u" : "%u", train.durations[i]);
+        if (written < 0 || (size_t)written >= outLen - used) {
+            return 0;
+        }
+        used += (size_t)written;
+    }
+    return used;
+}
+
+bool parseIrCode(const char* text, IrCode& code) {
+    code.repeat = false;
+
+    const char* colon = strchr(text, ':');
+    if (!colon) {
+        // Legacy entries hold only the hex value IRremote reported for NEC
+        char* end;
+        code.value = strtoull(text, &end, 16);
+        if (end == text || (*end != '\0' && *end != '\r')) {
+            return false;
+        }
+        code.protocol = IR_PROTO_NEC;
+        code.bits = 32;
+        return true;
+    }
+
+    size_t nameLen = (size_t)(colon - text);
+    code.protocol = IR_PROTO_RAW;
+    for (uint8_t p = IR_PROTO_NEC; p < IR_PROTO_COUNT; p++) {
+        const char* name = kIrProtocolNames[p];
+        if (strlen(name) == nameLen && strncmp(name, text, nameLen) == 0) {
+            code.protocol = (IrProtocol)p;
+            break;
+        }
+    }
+    if (code.protocol == IR_PROTO_RAW) {
+        return false;
+    }
+
+    char* end;
+    unsigned long bits = strtoul(colon + 1, &end, 10);
+    if (*end != ':' || bits == 0 || bits > 64) {
+        return false;
+    }
+    code.bits = (uint8_t)bits;
+    code.value = strtoull(end + 1, nullptr, 16);
+    return true;
+}
+
+bool parseIrRaw(const char* text, PulseTrain& train, uint8_t& carrierKhz) {
+    if (strncmp(text, "RAW:", 4) != 0) {
+        return false;
+    }
+
+    char* end;
+    unsigned long khz = strtoul(text + 4, &end, 10);
+    if (*end != ':' || khz == 0 || khz > 255) {
+        return false;
+    }
+    carrierKhz = (uint8_t)khz;
+
+    train.startUs = 0;
+    train.count = 0;
+    const char* cursor = end + 1;
+    while (*cursor) {
+        unsigned long duration = strtoul(cursor, &end, 10);
+        if (end == cursor) {
+            break;
+        }
+        if (!appendPulse(train, duration > 0xFFFF ? 0xFFFF : (uint16_t)duration)) {
+            return false;
+        }
+        cursor = end;
+    }
+    return train.count > 0 && (train.count & 1) == 1;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "frame_assembler.h"
+
+#define IR_DEFAULT_CARRIER_KHZ 38
+
+enum IrProtocol : uint8_t {
+    IR_PROTO_RAW = 0,
+    IR_PROTO_NEC,
+    IR_PROTO_NEC_EXT,
+    IR_PROTO_RC5,
+    IR_PROTO_RC6,
+    IR_PROTO_SONY,
+    IR_PROTO_SAMSUNG,
+    IR_PROTO_PANASONIC,
+    IR_PROTO_COUNT
+};
+
+// A decoded frame. Bits are stored in transmission order, first bit in the
+// most significant position, matching the hex values IRremote produced.
+struct IrCode {
+    IrProtocol protocol;
+    uint8_t bits;
+    bool repeat;                   // NEC repeat code, carries no data
+    uint64_t value;
+};
+
+const char* irProtocolName(IrProtocol protocol);
+uint8_t irCarrierKhz(IrProtocol protocol);
+
+// Frame start to frame start while a button is held; 0 for raw frames.
+uint32_t irRepeatPeriodUs(IrProtocol protocol);
+
+// Classifies a pulse train against the protocol table. On failure `code`
+// is set to IR_PROTO_RAW and the caller should keep the timings.
+bool decodeIr(const PulseTrain& train, IrCode& code);
+
+// Expands a decoded frame back into mark/space timings for transmission.
+bool encodeIr(const IrCode& code, PulseTrain& train);
+
+// Text forms stored in remote files: "NEC:32:20DF10EF" and
+// "RAW:38:9000 4500 560 ...". A bare hex value is read as a legacy NEC code.
+size_t formatIrCode(const IrCode& code, char* out, size_t outLen);
+size_t formatIrRaw(const PulseTrain& train, uint8_t carrierKhz, char* out, size_t outLen);
+bool parseIrCode(const char* text, IrCode& code);
+bool parseIrRaw(const char* text, PulseTrain& train, uint8_t& carrierKhz);
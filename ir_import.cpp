@@ -0,0 +1,581 @@
+#include "ir_import.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PRONTO_PERIOD_PS 241246        // Carrier period per step of a Pronto frequency word
+
+static char* skipSpace(char* text) {
+    while (*text == ' ' || *text == '\t') {
+        text++;
+    }
+    return text;
+}
+
+// Next whitespace-separated word, terminated in place; nullptr at the end of the line
+static char* nextWord(char*& cursor) {
+    cursor = skipSpace(cursor);
+    if (*cursor == '\0') {
+        return nullptr;
+    }
+    char* word = cursor;
+    while (*cursor && *cursor != ' ' && *cursor != '\t') {
+        cursor++;
+    }
+    if (*cursor) {
+        *cursor++ = '\0';
+    }
+    return word;
+}
+
+static bool isDelimiter(char c) {
+    return c == ' ' || c == '\t' || c == ',' || c == ';' || c == ':' || c == '=';
+}
+
+// The code starts at the first four-digit hex word; anything before it is the name
+static char* findProntoCode(char* text) {
+    for (char* p = text; *p; p++) {
+        if ((p == text || isDelimiter(p[-1])) && isxdigit((unsigned char)p[0]) && isxdigit((unsigned char)p[1]) &&
+            isxdigit((unsigned char)p[2]) && isxdigit((unsigned char)p[3]) && (p[4] == '\0' || isDelimiter(p[4]))) {
+            return p;
+        }
+    }
+    return nullptr;
+}
+
+static bool nextHexWord(char*& cursor, uint16_t& value) {
+    cursor = skipSpace(cursor);
+    char* end;
+    unsigned long parsed = strtoul(cursor, &end, 16);
+    if (end == cursor || parsed > 0xFFFF) {
+        return false;
+    }
+    value = (uint16_t)parsed;
+    cursor = end;
+    return true;
+}
+
+static uint64_t shiftIn(uint64_t value, uint8_t bits, uint64_t data) {
+    if (bits == 0) {
+        return value;
+    }
+    uint64_t mask = bits >= 64 ? ~0ULL : (1ULL << bits) - 1;
+    return (bits >= 64 ? 0 : value << bits) | (data & mask);
+}
+
+static uint32_t reverseBits(uint32_t value, uint8_t bits) {
+    uint32_t reversed = 0;
+    for (uint8_t i = 0; i < bits; i++) {
+        reversed = (reversed << 1) | ((value >> i) & 1);
+    }
+    return reversed;
+}
+
+// Flipper keeps address and command as they are sent, LSB first; IrCode
+// keeps the bits in transmission order
+static bool flipperCode(const char* protocol, uint32_t address, uint32_t command, IrCode& code) {
+    uint8_t a = (uint8_t)address;
+    uint8_t c = (uint8_t)command;
+    code.repeat = false;
+    if (strcmp(protocol, "NEC") == 0 || strcmp(protocol, "NECext") == 0) {
+        bool extended = protocol[3] != '\0';
+        uint8_t a2 = extended ? (uint8_t)(address >> 8) : (uint8_t)~a;
+        uint8_t c2 = extended ? (uint8_t)(command >> 8) : (uint8_t)~c;
+        code.protocol = IR_PROTO_NEC;
+        code.bits = 32;
+        code.value = reverseBits(a, 8) << 24 | reverseBits(a2, 8) << 16 | reverseBits(c, 8) << 8 | reverseBits(c2, 8);
+    } else if (strcmp(protocol, "Samsung32") == 0) {
+        code.protocol = IR_PROTO_SAMSUNG;
+        code.bits = 32;
+        code.value = reverseBits(a, 8) << 24 | reverseBits(a, 8) << 16 | reverseBits(c, 8) << 8 |
+                     reverseBits((uint8_t)~c, 8);
+    } else if (strncmp(protocol, "SIRC", 4) == 0) {
+        uint8_t bits = strcmp(protocol, "SIRC") == 0 ? 12 : (uint8_t)atoi(protocol + 4);
+        if (bits != 12 && bits != 15 && bits != 20) {
+            return false;
+        }
+        uint32_t data = (command & 0x7F) | (address & ((1UL << (bits - 7)) - 1)) << 7;
+        code.protocol = IR_PROTO_SONY;
+        code.bits = bits;
+        code.value = reverseBits(data, bits);
+    } else if (strcmp(protocol, "RC5") == 0 || strcmp(protocol, "RC5X") == 0) {
+        // Start bit, then the field bit, which is command bit 6 inverted
+        code.protocol = IR_PROTO_RC5;
+        code.bits = 14;
+        code.value = 1UL << 13 | (uint32_t)!(command & 0x40) << 12 | (address & 0x1F) << 6 | (command & 0x3F);
+    } else if (strcmp(protocol, "RC6") == 0) {
+        code.protocol = IR_PROTO_RC6;
+        code.bits = 21;
+        code.value = 1UL << 20 | (address & 0xFF) << 8 | (command & 0xFF);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void importRemoteName(const char* text, char* out) {
+    size_t length = 0;
+    for (; text[length] && length < REMOTE_NAME_MAX - 1; length++) {
+        char c = text[length];
+        out[length] = isalnum((unsigned char)c) || c == '-' || c == '_' ? c : '_';
+    }
+    out[length] = '\0';
+}
+
+void IrImporter::begin(const char* remote, ButtonStore& store) {
+    _store = &store;
+    _format = IMPORT_UNKNOWN;
+    _stats = {};
+    importRemoteName(remote, _remote);
+    _lineLength = 0;
+    _overlong = false;
+    _pending = false;
+    _unnamed = 0;
+    _lircSection = LIRC_OUTSIDE;
+}
+
+bool IrImporter::feed(const char* data, size_t length) {
+    _stats.bytes += length;
+    while (length > 0) {
+        const char* end = (const char*)memchr(data, '\n', length);
+        size_t take = end ? (size_t)(end - data) : length;
+        size_t room = IMPORT_LINE_MAX - 1 - _lineLength;
+        if (take > room) {
+            _overlong = true;
+        }
+        memcpy(_line + _lineLength, data, take < room ? take : room);
+        _lineLength += take < room ? take : room;
+        if (!end) {
+            break;
+        }
+        data = end + 1;
+        length -= take + 1;
+        if (!endLine()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool IrImporter::finish() {
+    if ((_lineLength > 0 || _overlong) && !endLine()) {
+        return false;
+    }
+    if (_format == IMPORT_FLIPPER) {
+        return flushFlipper();
+    }
+    return _format != IMPORT_LIRC || flushLircRaw();
+}
+
+// A line that did not fit loses the button it belongs to
+bool IrImporter::endLine() {
+    _stats.lines++;
+    bool overlong = _overlong;
+    while (_lineLength > 0 && isspace((unsigned char)_line[_lineLength - 1])) {
+        _lineLength--;
+    }
+    _line[_lineLength] = '\0';
+    _lineLength = 0;
+    _overlong = false;
+    if (overlong) {
+        _stats.longLines++;
+        if (_pending) {
+            _broken = true;
+        } else if (_format == IMPORT_PRONTO) {
+            _stats.skipped++;
+        }
+        return true;
+    }
+    return processLine(_line);
+}
+
+bool IrImporter::processLine(char* text) {
+    text = skipSpace(text);
+    if (_format == IMPORT_UNKNOWN) {
+        if (*text == '\0' || *text == '#') {
+            return true;
+        }
+        if (strncmp(text, "Filetype:", 9) == 0) {
+            _format = IMPORT_FLIPPER;
+            return true;
+        }
+        _format = strncmp(text, "begin", 5) == 0 ? IMPORT_LIRC : IMPORT_PRONTO;
+    }
+    switch (_format) {
+    case IMPORT_PRONTO:
+        return prontoLine(text);
+    case IMPORT_LIRC:
+        return lircLine(text);
+    case IMPORT_FLIPPER:
+        return flipperLine(text);
+    default:
+        return true;
+    }
+}
+
+// Learned codes only (type 0000): the frequency word, then the pair counts
+// of the once and repeat sequences. The once sequence is taken, or the
+// repeat one when there is none.
+bool IrImporter::prontoLine(char* text) {
+    if (*text == '\0' || *text == '#') {
+        return true;
+    }
+    char* cursor = findProntoCode(text);
+    if (!cursor) {
+        _stats.skipped++;
+        return true;
+    }
+    if (cursor != text) {
+        cursor[-1] = '\0';
+    }
+    char* nameEnd = text + strlen(text);
+    while (nameEnd > text && isDelimiter(nameEnd[-1])) {
+        *--nameEnd = '\0';
+    }
+    startButton(cursor != text ? text : "");
+
+    uint16_t header[4];
+    for (uint16_t& word : header) {
+        if (!nextHexWord(cursor, word)) {
+            _stats.skipped++;
+            return true;
+        }
+    }
+    uint32_t periodNs = (uint32_t)header[1] * PRONTO_PERIOD_PS / 1000;
+    if (header[0] != 0 || periodNs == 0) {
+        _stats.skipped++;
+        return true;
+    }
+    uint16_t pairs = header[2] ? header[2] : header[3];
+    for (uint32_t i = 0; i < 2UL * pairs; i++) {
+        uint16_t periods;
+        if (!nextHexWord(cursor, periods)) {
+            _stats.skipped++;
+            return true;
+        }
+        appendDuration((uint32_t)((uint64_t)periods * periodNs / 1000));
+    }
+    return storeTrain(_remote, (uint8_t)((1000000 + periodNs / 2) / periodNs));
+}
+
+bool IrImporter::lircLine(char* text) {
+    if (*text == '\0' || *text == '#') {
+        return true;
+    }
+    if (_lircSection == LIRC_RAW_CODES && isdigit((unsigned char)*text)) {
+        if (_pending) {
+            appendDurations(text);
+        }
+        return true;
+    }
+
+    char* cursor = text;
+    const char* key = nextWord(cursor);
+    // Remote names may have spaces: "LG TV" is stored as LG_TV
+    if (_lircSection == LIRC_REMOTE && strcmp(key, "name") == 0) {
+        char* name = skipSpace(cursor);
+        size_t length = strlen(name);
+        while (length > 0 && (name[length - 1] == ' ' || name[length - 1] == '\t')) {
+            name[--length] = '\0';
+        }
+        if (length > 0) {
+            importRemoteName(name, _lirc.name);
+        }
+        return true;
+    }
+    const char* value = nextWord(cursor);
+    if (strcmp(key, "begin") == 0 && value) {
+        if (strcmp(value, "remote") == 0) {
+            memset(&_lirc, 0, sizeof(_lirc));
+            strcpy(_lirc.name, _remote);
+            _lirc.supported = true;
+            _lirc.carrierKhz = IR_DEFAULT_CARRIER_KHZ;
+            _lircSection = LIRC_REMOTE;
+        } else if (_lircSection == LIRC_REMOTE) {
+            _lircSection = strcmp(value, "raw_codes") == 0 ? LIRC_RAW_CODES : LIRC_CODES;
+        }
+        return true;
+    }
+    if (strcmp(key, "end") == 0 && value) {
+        bool ok = _lircSection != LIRC_RAW_CODES || flushLircRaw();
+        _lircSection = strcmp(value, "remote") == 0 ? LIRC_OUTSIDE : LIRC_REMOTE;
+        return ok;
+    }
+
+    switch (_lircSection) {
+    case LIRC_REMOTE:
+        if (value) {
+            lircSetting(key, value, cursor);
+        }
+        return true;
+    case LIRC_CODES:
+        if (!value) {
+            _stats.skipped++;
+            return true;
+        }
+        return lircCode(key, value);
+    case LIRC_RAW_CODES:
+        if (strcmp(key, "name") != 0) {
+            return true;
+        }
+        if (!flushLircRaw()) {
+            return false;
+        }
+        startButton(value ? value : "");
+        return true;
+    default:
+        return true;
+    }
+}
+
+// Bi-phase and serial encodings are not pulse/space pairs; their codes are skipped
+void IrImporter::lircSetting(const char* key, const char* value, char* cursor) {
+    static const char* const kUnsupportedFlags[] = {"RC5", "RC6", "RCMM", "SHIFT_ENC", "GRUNDIG", "BO", "SERIAL", "XMP"};
+    const char* second = nextWord(cursor);
+    unsigned long number = strtoul(value, nullptr, 0);
+    uint16_t duration = number > 0xFFFF ? 0xFFFF : (uint16_t)number;
+
+    if (strcmp(key, "bits") == 0) {
+        _lirc.bits = number > 64 ? 0xFF : (uint8_t)number;
+    } else if (strcmp(key, "pre_data_bits") == 0) {
+        _lirc.preBits = number > 64 ? 0xFF : (uint8_t)number;
+    } else if (strcmp(key, "post_data_bits") == 0) {
+        _lirc.postBits = number > 64 ? 0xFF : (uint8_t)number;
+    } else if (strcmp(key, "pre_data") == 0) {
+        _lirc.preData = strtoull(value, nullptr, 0);
+    } else if (strcmp(key, "post_data") == 0) {
+        _lirc.postData = strtoull(value, nullptr, 0);
+    } else if (strcmp(key, "header") == 0 || strcmp(key, "one") == 0 || strcmp(key, "zero") == 0) {
+        uint16_t* pair = key[0] == 'h' ? _lirc.header : key[0] == 'o' ? _lirc.one : _lirc.zero;
+        unsigned long space = second ? strtoul(second, nullptr, 0) : 0;
+        pair[0] = duration;
+        pair[1] = space > 0xFFFF ? 0xFFFF : (uint16_t)space;
+    } else if (strcmp(key, "ptrail") == 0) {
+        _lirc.ptrail = duration;
+    } else if (strcmp(key, "plead") == 0 || strcmp(key, "foot") == 0) {
+        _lirc.supported = _lirc.supported && number == 0;
+    } else if (strcmp(key, "frequency") == 0) {
+        _lirc.carrierKhz = number ? (uint8_t)((number + 500) / 1000) : IR_DEFAULT_CARRIER_KHZ;
+    } else if (strcmp(key, "flags") == 0) {
+        for (const char* flag = value; *flag; flag += strcspn(flag, "|"), flag += *flag == '|') {
+            for (const char* unsupported : kUnsupportedFlags) {
+                size_t length = strlen(unsupported);
+                if (strncmp(flag, unsupported, length) == 0 && (flag[length] == '|' || flag[length] == '\0')) {
+                    _lirc.supported = false;
+                }
+            }
+        }
+    }
+}
+
+// "KEY_POWER 0x10EF": pre_data, the code and post_data, MSB first, each bit
+// a pulse and a space
+bool IrImporter::lircCode(const char* name, const char* value) {
+    uint32_t bits = (uint32_t)_lirc.preBits + _lirc.bits + _lirc.postBits;
+    char* end;
+    uint64_t data = strtoull(value, &end, 0);
+    if (!_lirc.supported || _lirc.bits == 0 || bits > 64 || !_lirc.one[0] || !_lirc.zero[0] || end == value) {
+        _stats.skipped++;
+        return true;
+    }
+    uint64_t code = shiftIn(shiftIn(shiftIn(0, _lirc.preBits, _lirc.preData), _lirc.bits, data), _lirc.postBits,
+                            _lirc.postData);
+
+    startButton(name);
+    if (_lirc.header[0]) {
+        appendDuration(_lirc.header[0]);
+        appendDuration(_lirc.header[1]);
+    }
+    for (uint8_t bit = bits; bit > 0; bit--) {
+        const uint16_t* pair = (code >> (bit - 1)) & 1 ? _lirc.one : _lirc.zero;
+        appendDuration(pair[0]);
+        appendDuration(pair[1]);
+    }
+    if (_lirc.ptrail) {
+        appendDuration(_lirc.ptrail);
+    }
+    return storeTrain(_lirc.name, _lirc.carrierKhz);
+}
+
+bool IrImporter::flushLircRaw() {
+    if (!_pending) {
+        return true;
+    }
+    if (_broken) {
+        _pending = false;
+        _stats.skipped++;
+        return true;
+    }
+    return storeTrain(_lirc.name, _lirc.carrierKhz);
+}
+
+// "key: value" lines; a button runs from its "name:" to the next one or a '#'
+bool IrImporter::flipperLine(char* text) {
+    if (*text == '#') {
+        return flushFlipper();
+    }
+    char* value = strchr(text, ':');
+    if (!value) {
+        return true;
+    }
+    *value++ = '\0';
+    value = skipSpace(value);
+
+    if (strcmp(text, "name") == 0) {
+        if (!flushFlipper()) {
+            return false;
+        }
+        startButton(value);
+        _flipperType[0] = '\0';
+        _flipperProtocol[0] = '\0';
+        _flipperAddress = 0;
+        _flipperCommand = 0;
+        _flipperCarrierKhz = IR_DEFAULT_CARRIER_KHZ;
+        return true;
+    }
+    if (!_pending) {
+        return true;
+    }
+
+    if (strcmp(text, "type") == 0) {
+        snprintf(_flipperType, sizeof(_flipperType), "%s", value);
+    } else if (strcmp(text, "protocol") == 0) {
+        snprintf(_flipperProtocol, sizeof(_flipperProtocol), "%s", value);
+    } else if (strcmp(text, "address") == 0 || strcmp(text, "command") == 0) {
+        // Little-endian bytes: "04 00 00 00"
+        uint32_t number = 0;
+        char* cursor = value;
+        for (uint8_t i = 0; i < 4; i++) {
+            char* end;
+            unsigned long byte = strtoul(cursor, &end, 16);
+            if (end == cursor) {
+                break;
+            }
+            number |= (uint32_t)(byte & 0xFF) << (8 * i);
+            cursor = end;
+        }
+        (text[0] == 'a' ? _flipperAddress : _flipperCommand) = number;
+    } else if (strcmp(text, "frequency") == 0) {
+        unsigned long hz = strtoul(value, nullptr, 10);
+        _flipperCarrierKhz = hz ? (uint8_t)((hz + 500) / 1000) : IR_DEFAULT_CARRIER_KHZ;
+    } else if (strcmp(text, "data") == 0) {
+        appendDurations(value);
+    }
+    return true;
+}
+
+bool IrImporter::flushFlipper() {
+    if (!_pending) {
+        return true;
+    }
+    IrCode code;
+    if (!_broken && strcmp(_flipperType, "raw") == 0) {
+        return storeTrain(_remote, _flipperCarrierKhz);
+    }
+    if (!_broken && strcmp(_flipperType, "parsed") == 0 &&
+        flipperCode(_flipperProtocol, _flipperAddress, _flipperCommand, code)) {
+        return storeCode(_remote, code);
+    }
+    _pending = false;
+    _stats.skipped++;
+    return true;
+}
+
+// Names go into macros as one word, so whitespace becomes '_'
+void IrImporter::startButton(const char* text) {
+    size_t length = 0;
+    for (; text[length] && length < BUTTON_NAME_MAX - 1; length++) {
+        char c = text[length];
+        _button[length] = isspace((unsigned char)c) || c == ',' ? '_' : c;
+    }
+    _button[length] = '\0';
+    if (length == 0) {
+        snprintf(_button, sizeof(_button), "Code%lu", (unsigned long)++_unnamed);
+    }
+    _pending = true;
+    _broken = false;
+    clearTrain();
+}
+
+void IrImporter::clearTrain() {
+    _train.startUs = 0;
+    _train.count = 0;
+    _trainOverflow = false;
+}
+
+bool IrImporter::appendDuration(uint32_t durationUs) {
+    if (_train.count == IR_MAX_PULSES) {
+        _trainOverflow = true;
+        return false;
+    }
+    _train.durations[_train.count++] = durationUs > 0xFFFF ? 0xFFFF : (uint16_t)durationUs;
+    return true;
+}
+
+void IrImporter::appendDurations(const char* text) {
+    while (*text) {
+        char* end;
+        unsigned long durationUs = strtoul(text, &end, 10);
+        if (end == text) {
+            _broken = *skipSpace(end) != '\0';
+            return;
+        }
+        if (!appendDuration(durationUs)) {
+            return;
+        }
+        text = end;
+    }
+}
+
+// Cut where a receiver would end the frame: at the first long space, and
+// before the last space, which runs into the gap
+bool IrImporter::storeTrain(const char* remote, uint8_t carrierKhz) {
+    _pending = false;
+    for (uint16_t i = 1; i < _train.count; i += 2) {
+        if (_train.durations[i] >= IR_FRAME_GAP_US) {
+            _train.count = i;
+            break;
+        }
+    }
+    if ((_train.count & 1) == 0 && _train.count > 0) {
+        _train.count--;
+    }
+    if (_trainOverflow || _train.count == 0) {
+        _stats.skipped++;
+        return true;
+    }
+
+    IrCode code;
+    const PulseCode* raw = nullptr;
+    recordClear(_record, _button);
+    if (decodeIr(_train, code) && !code.repeat) {
+        recordFromIrCode(_record, code);
+        _stats.decoded++;
+    } else if (encodePulses(_train, _rawCode)) {
+        _record.band = BAND_IR;
+        _record.protocol = IR_PROTO_RAW;
+        _record.carrierKhz = carrierKhz ? carrierKhz : IR_DEFAULT_CARRIER_KHZ;
+        raw = &_rawCode;
+        _stats.raw++;
+    } else {
+        _stats.skipped++;
+        return true;
+    }
+    if (!_store->store(remote, _record, raw)) {
+        return false;
+    }
+    _stats.buttons++;
+    return true;
+}
+
+bool IrImporter::storeCode(const char* remote, const IrCode& code) {
+    if (!encodeIr(code, _train)) {
+        _pending = false;
+        _stats.skipped++;
+        return true;
+    }
+    _trainOverflow = false;
+    return storeTrain(remote, irCarrierKhz(code.protocol));
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "button_cache.h"
+#include "button_record.h"
+#include "frame_assembler.h"
+#include "ir_codec.h"
+#include "pulse_codec.h"
+
+#ifndef IMPORT_LINE_MAX
+#define IMPORT_LINE_MAX (IR_MAX_PULSES * 6 + 64)   // Longer lines are skipped
+#endif
+
+#ifndef IMPORT_CHUNK_SIZE
+#define IMPORT_CHUNK_SIZE 512          // Bytes read from the card at a time
+#endif
+
+enum ImportFormat : uint8_t {
+    IMPORT_UNKNOWN,                // Until the first line that is not a comment
+    IMPORT_PRONTO,                 // "name 0000 006D 0022 0002 0157 00AC ...", one button a line
+    IMPORT_LIRC,                   // lircd.conf: "begin remote" blocks of codes or raw_codes
+    IMPORT_FLIPPER                 // Flipper Zero .ir: "name:", "type:" ... blocks
+};
+
+struct ImportStats {
+    uint32_t bytes;
+    uint32_t lines;
+    uint32_t buttons;              // Stored, decoded or raw
+    uint32_t decoded;
+    uint32_t raw;
+    uint32_t skipped;              // Unsupported encodings, malformed or overlong codes
+    uint32_t longLines;
+};
+
+// Turns IR code databases into library buttons as they stream in, so a
+// file of any size needs only this object. The format is told from the
+// first line. Every code is expanded to timings and decoded like a capture:
+// what decodes is stored as a protocol code, the rest as raw timings. Each
+// button goes to `store` as soon as it is complete; a later button with
+// the same name replaces it.
+//
+// LIRC remotes are taken from their own "name"; Pronto and Flipper files
+// carry none and go to the remote passed to begin(). LIRC codes are
+// supported for pulse/space encodings; RC5, RC6 and other bi-phase ones
+// are skipped, as are Flipper protocols other than NEC, NECext,
+// Samsung32, SIRC, RC5 and RC6.
+class IrImporter {
+public:
+    void begin(const char* remote, ButtonStore& store);
+
+    // Chunks may split lines anywhere. Returns false once the store fails.
+    bool feed(const char* data, size_t length);
+
+    // Takes the last line and button, which may have no end marker.
+    bool finish();
+
+    ImportFormat format() const { return _format; }
+    const ImportStats& stats() const { return _stats; }
+
+private:
+    enum LircSection : uint8_t {
+        LIRC_OUTSIDE,
+        LIRC_REMOTE,
+        LIRC_CODES,
+        LIRC_RAW_CODES
+    };
+
+    struct LircRemote {
+        char name[REMOTE_NAME_MAX];
+        bool supported;
+        uint8_t bits;
+        uint8_t preBits;
+        uint8_t postBits;
+        uint64_t preData;
+        uint64_t postData;
+        uint16_t header[2];
+        uint16_t one[2];
+        uint16_t zero[2];
+        uint16_t ptrail;
+        uint8_t carrierKhz;
+    };
+
+    bool endLine();
+    bool processLine(char* text);
+    bool prontoLine(char* text);
+    bool lircLine(char* text);
+    void lircSetting(const char* key, const char* value, char* cursor);
+    bool lircCode(const char* name, const char* value);
+    bool flushLircRaw();
+    bool flipperLine(char* text);
+    bool flushFlipper();
+
+    void startButton(const char* text);
+    void clearTrain();
+    bool appendDuration(uint32_t durationUs);
+    void appendDurations(const char* text);
+    bool storeTrain(const char* remote, uint8_t carrierKhz);
+    bool storeCode(const char* remote, const IrCode& code);
+
+    ButtonStore* _store = nullptr;
+    ImportFormat _format = IMPORT_UNKNOWN;
+    ImportStats _stats = {};
+    char _remote[REMOTE_NAME_MAX];
+
+    char _line[IMPORT_LINE_MAX];
+    size_t _lineLength = 0;
+    bool _overlong = false;
+
+    // The button being collected, for formats that spread one over lines
+    char _button[BUTTON_NAME_MAX];
+    bool _pending = false;
+    bool _broken = false;          // Part of it was lost or unusable
+    uint32_t _unnamed = 0;
+
+    LircSection _lircSection = LIRC_OUTSIDE;
+    LircRemote _lirc;
+
+    char _flipperType[8];
+    char _flipperProtocol[12];
+    uint32_t _flipperAddress;
+    uint32_t _flipperCommand;
+    uint8_t _flipperCarrierKhz;
+
+    PulseTrain _train;
+    bool _trainOverflow = false;
+    PulseCode _rawCode;
+    ButtonRecord _record;
+};
+
+// Makes `text` usable as a remote's file name: letters, digits, '-' and
+// '_' kept, anything else turned into '_', cut to REMOTE_NAME_MAX - 1.
+void importRemoteName(const char* text, char* out);
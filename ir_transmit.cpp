@@ -0,0 +1,64 @@
+#include "ir_transmit.h"
+
+#include <Arduino.h>
+#include <driver/rmt.h>
+
+#ifndef IR_RMT_CHANNEL
+#define IR_RMT_CHANNEL RMT_CHANNEL_0
+#endif
+
+#define IR_RMT_SOURCE_HZ 80000000UL     // APB clock
+#define IR_RMT_CLK_DIV 80               // 1 us ticks, the unit IrSymbol durations use
+
+// Channel 0 may borrow every TX block: 4 x 48 symbols holds the longest
+// waveform, so the driver never has to refill memory mid-frame
+#define IR_RMT_MEM_BLOCKS 4
+
+static_assert(IR_WAVEFORM_MAX_SYMBOLS <= IR_RMT_MEM_BLOCKS * 48, "A waveform must fit in RMT memory");
+static_assert(sizeof(IrSymbol) == sizeof(rmt_item32_t), "IrSymbol must alias rmt_item32_t");
+
+bool IrTransmitter::begin(uint8_t pin) {
+    rmt_config_t config = RMT_DEFAULT_CONFIG_TX((gpio_num_t)pin, IR_RMT_CHANNEL);
+    config.clk_div = IR_RMT_CLK_DIV;
+    config.mem_block_num = IR_RMT_MEM_BLOCKS;
+    config.tx_config.carrier_en = true;
+    config.tx_config.carrier_freq_hz = IR_DEFAULT_CARRIER_KHZ * 1000;
+    config.tx_config.carrier_duty_percent = IR_CARRIER_DUTY_PERCENT;
+    config.tx_config.carrier_level = RMT_CARRIER_LEVEL_HIGH;
+    config.tx_config.idle_output_en = true;
+    config.tx_config.idle_level = RMT_IDLE_LEVEL_LOW;
+
+    _ready = rmt_config(&config) == ESP_OK && rmt_driver_install(IR_RMT_CHANNEL, 0, 0) == ESP_OK;
+    _carrierKhz = IR_DEFAULT_CARRIER_KHZ;
+    return _ready;
+}
+
+void IrTransmitter::setCarrier(uint8_t carrierKhz) {
+    uint32_t period = IR_RMT_SOURCE_HZ / (carrierKhz * 1000UL);
+    uint16_t high = period * IR_CARRIER_DUTY_PERCENT / 100;
+    rmt_set_tx_carrier(IR_RMT_CHANNEL, true, high, period - high, RMT_CARRIER_LEVEL_HIGH);
+    _carrierKhz = carrierKhz;
+}
+
+uint32_t IrTransmitter::waitUs() const {
+    uint32_t elapsed = micros() - _lastStartUs;
+    return elapsed < _lastPeriodUs ? _lastPeriodUs - elapsed : 0;
+}
+
+// A frame is never longer than its period, so the RMT is normally done by
+// then; it is only checked, never waited for
+bool IrTransmitter::send(const IrWaveform& waveform, bool repeat) {
+    if (!_ready || waveform.frameSymbols == 0 || waitUs() > 0 ||
+        rmt_wait_tx_done(IR_RMT_CHANNEL, 0) != ESP_OK) {
+        return false;
+    }
+    const IrSymbol* symbols = repeat ? waveform.repeat() : waveform.symbols;
+    uint16_t count = repeat ? waveform.repeatCount() : waveform.frameSymbols;
+
+    if (waveform.carrierKhz != _carrierKhz) {
+        setCarrier(waveform.carrierKhz);
+    }
+    _lastStartUs = micros();
+    _lastPeriodUs = waveform.periodUs;
+    return rmt_write_items(IR_RMT_CHANNEL, (const rmt_item32_t*)symbols, count, false) == ESP_OK;
+}
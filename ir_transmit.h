@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "ir_waveform.h"
+
+#ifndef IR_CARRIER_DUTY_PERCENT
+#define IR_CARRIER_DUTY_PERCENT 33
+#endif
+
+// Hardware-timed IR transmitter on the RMT peripheral. Compiled waveforms
+// are copied into RMT memory in one go and clocked out with the carrier
+// modulated in hardware, so interrupts cannot stretch a pulse.
+class IrTransmitter {
+public:
+    bool begin(uint8_t pin);
+
+    // Time until the previous frame's start-to-start period is over.
+    uint32_t waitUs() const;
+
+    // Starts the first frame, or the repeat frame of a held button, and
+    // returns at once. False without sending while waitUs() is not 0.
+    bool send(const IrWaveform& waveform, bool repeat);
+
+private:
+    void setCarrier(uint8_t carrierKhz);
+
+    bool _ready = false;
+    uint8_t _carrierKhz = 0;
+    uint32_t _lastStartUs = 0;
+    uint32_t _lastPeriodUs = 0;
+};
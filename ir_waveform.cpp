@@ -0,0 +1,172 @@
+#include "ir_waveform.h"
+
+#include "pulse_codec.h"
+
+// Packs (level, duration) halves into symbols as they are appended
+class SymbolWriter {
+public:
+    SymbolWriter(IrSymbol* symbols, uint16_t capacity) : _symbols(symbols), _capacity(capacity) {}
+
+    bool append(bool level, uint32_t duration) {
+        while (duration > 0) {
+            uint16_t chunk = duration > IR_SYMBOL_MAX_TICKS ? IR_SYMBOL_MAX_TICKS : (uint16_t)duration;
+            if (!appendHalf(level, chunk)) {
+                return false;
+            }
+            duration -= chunk;
+        }
+        return true;
+    }
+
+    // Closes a half-filled symbol with the zero-duration end marker.
+    bool finish() {
+        if (_pending) {
+            return emit(IrSymbol::make(_level, _duration, false, 0));
+        }
+        return true;
+    }
+
+    uint16_t count() const { return _count; }
+
+private:
+    bool appendHalf(bool level, uint16_t duration) {
+        if (!_pending) {
+            _pending = true;
+            _level = level;
+            _duration = duration;
+            return true;
+        }
+        _pending = false;
+        return emit(IrSymbol::make(_level, _duration, level, duration));
+    }
+
+    bool emit(IrSymbol symbol) {
+        if (_count >= _capacity) {
+            return false;
+        }
+        _symbols[_count++] = symbol;
+        return true;
+    }
+
+    IrSymbol* _symbols;
+    uint16_t _capacity;
+    uint16_t _count = 0;
+    bool _pending = false;
+    bool _level = false;
+    uint16_t _duration = 0;
+};
+
+static bool compileTrain(const PulseTrain& train, IrSymbol* symbols, uint16_t capacity, uint16_t& count) {
+    SymbolWriter writer(symbols, capacity);
+    for (uint16_t i = 0; i < train.count; i++) {
+        if (train.durations[i] == 0 || !writer.append((i & 1) == 0, train.durations[i])) {
+            return false;
+        }
+    }
+    if (!writer.finish()) {
+        return false;
+    }
+    count = writer.count();
+    return count > 0;
+}
+
+bool compileIrWaveform(const PulseTrain& frame, const PulseTrain* repeat, uint8_t carrierKhz,
+                       uint32_t periodUs, IrWaveform& out) {
+    out.carrierKhz = carrierKhz ? carrierKhz : IR_DEFAULT_CARRIER_KHZ;
+    out.frameSymbols = 0;
+    out.repeatSymbols = 0;
+    out.periodUs = periodUs;
+
+    if (!compileTrain(frame, out.symbols, IR_WAVEFORM_MAX_SYMBOLS, out.frameSymbols)) {
+        out.frameSymbols = 0;
+        return false;
+    }
+    if (repeat && !compileTrain(*repeat, out.symbols + out.frameSymbols,
+                                IR_WAVEFORM_MAX_SYMBOLS - out.frameSymbols, out.repeatSymbols)) {
+        out.repeatSymbols = 0;
+    }
+    return true;
+}
+
+bool compileIrCode(const IrCode& code, IrWaveform& out) {
+    static PulseTrain frame;
+    static PulseTrain repeat;
+    if (!encodeIr(code, frame)) {
+        return false;
+    }
+
+    // Held NEC buttons send the short repeat code, not the whole frame again
+    bool necFamily = code.protocol == IR_PROTO_NEC || code.protocol == IR_PROTO_NEC_EXT;
+    IrCode repeatCode = {IR_PROTO_NEC, 0, true, 0};
+    bool hasRepeat = necFamily && !code.repeat && encodeIr(repeatCode, repeat);
+    return compileIrWaveform(frame, hasRepeat ? &repeat : nullptr, irCarrierKhz(code.protocol),
+                             irRepeatPeriodUs(code.protocol), out);
+}
+
+bool compileIrRaw(const PulseTrain& frame, uint8_t carrierKhz, IrWaveform& out) {
+    uint32_t lengthUs = 0;
+    for (uint16_t i = 0; i < frame.count; i++) {
+        lengthUs += frame.durations[i];
+    }
+    return compileIrWaveform(frame, nullptr, carrierKhz, lengthUs + IR_RAW_REPEAT_GAP_US, out);
+}
+
+bool compileIrPulseCode(const uint8_t* code, uint16_t length, uint8_t carrierKhz, IrWaveform& out) {
+    static PulseDecoder decoder;
+    out.carrierKhz = carrierKhz ? carrierKhz : IR_DEFAULT_CARRIER_KHZ;
+    out.frameSymbols = 0;
+    out.repeatSymbols = 0;
+    if (!decoder.begin(code, length)) {
+        return false;
+    }
+
+    SymbolWriter writer(out.symbols, IR_WAVEFORM_MAX_SYMBOLS);
+    uint32_t lengthUs = 0;
+    uint16_t pulses = 0;
+    uint16_t duration;
+    while (decoder.next(duration)) {
+        if (!writer.append((pulses & 1) == 0, duration)) {
+            return false;
+        }
+        lengthUs += duration;
+        pulses++;
+    }
+    if (pulses == 0 || pulses != decoder.pulseCount() || !writer.finish()) {
+        return false;
+    }
+    out.frameSymbols = writer.count();
+    out.periodUs = lengthUs + IR_RAW_REPEAT_GAP_US;
+    return true;
+}
+
+bool waveformToPulseTrain(const IrSymbol* symbols, uint16_t count, PulseTrain& out) {
+    out.startUs = 0;
+    out.count = 0;
+    bool lastLevel = false;
+    for (uint16_t i = 0; i < count; i++) {
+        bool levels[2] = {symbols[i].level0(), symbols[i].level1()};
+        uint16_t durations[2] = {symbols[i].duration0(), symbols[i].duration1()};
+        for (uint8_t h = 0; h < 2; h++) {
+            if (durations[h] == 0) {
+                return out.count > 0;
+            }
+            // Split halves of one level merge back into a single duration
+            if (out.count > 0 && levels[h] == lastLevel) {
+                out.durations[out.count - 1] += durations[h];
+            } else if (out.count == 0 && !levels[h]) {
+                return false;
+            } else {
+                if (out.count >= IR_MAX_PULSES) {
+                    return false;
+                }
+                out.durations[out.count++] = durations[h];
+            }
+            lastLevel = levels[h];
+        }
+    }
+    // Trains end on a mark; a trailing space is the inter-frame gap
+    if (out.count > 0 && !lastLevel) {
+        out.count--;
+    }
+    return out.count > 0;
+}
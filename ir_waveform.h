@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "frame_assembler.h"
+#include "ir_codec.h"
+
+#define IR_SYMBOL_MAX_TICKS 0x7FFF     // 15-bit duration field
+#define IR_RAW_REPEAT_GAP_US 40000     // Silence between resent raw frames
+
+#ifndef IR_WAVEFORM_MAX_SYMBOLS
+#define IR_WAVEFORM_MAX_SYMBOLS (IR_MAX_PULSES / 2 + 16)
+#endif
+
+// One transmitter symbol in the RMT item layout: two (level, duration)
+// halves packed into 32 bits. A zero duration ends the transmission.
+struct IrSymbol {
+    uint32_t value;
+
+    static IrSymbol make(bool level0, uint16_t duration0, bool level1, uint16_t duration1) {
+        return {(uint32_t)duration0 | ((uint32_t)level0 << 15) | ((uint32_t)duration1 << 16) | ((uint32_t)level1 << 31)};
+    }
+    uint16_t duration0() const { return value & 0x7FFF; }
+    bool level0() const { return (value >> 15) & 1; }
+    uint16_t duration1() const { return (value >> 16) & 0x7FFF; }
+    bool level1() const { return value >> 31; }
+};
+
+static_assert(sizeof(IrSymbol) == 4, "IrSymbol must match the 32-bit RMT item");
+
+// A frame compiled to transmitter symbols in 1 us ticks, plus the frame a
+// held button repeats. When repeatSymbols is 0 the first frame is resent.
+struct IrWaveform {
+    uint8_t carrierKhz;
+    uint16_t frameSymbols;
+    uint16_t repeatSymbols;            // Stored right after the first frame
+    uint32_t periodUs;                 // Frame start to frame start while held
+    IrSymbol symbols[IR_WAVEFORM_MAX_SYMBOLS];
+
+    const IrSymbol* repeat() const { return repeatSymbols ? symbols + frameSymbols : symbols; }
+    uint16_t repeatCount() const { return repeatSymbols ? repeatSymbols : frameSymbols; }
+};
+
+// Compiles mark/space timings, and optionally a distinct repeat frame.
+// Durations longer than a symbol half are split across halves.
+bool compileIrWaveform(const PulseTrain& frame, const PulseTrain* repeat, uint8_t carrierKhz,
+                       uint32_t periodUs, IrWaveform& out);
+
+// Encodes and compiles a decoded code; NEC gets its dedicated repeat code.
+bool compileIrCode(const IrCode& code, IrWaveform& out);
+
+// Compiles a captured raw frame, which is resent as-is while held.
+bool compileIrRaw(const PulseTrain& frame, uint8_t carrierKhz, IrWaveform& out);
+
+// Same for a stored raw frame, decoded straight into symbols.
+bool compileIrPulseCode(const uint8_t* code, uint16_t length, uint8_t carrierKhz, IrWaveform& out);
+
+// Expands symbols back into mark/space timings, for checks and simulation.
+bool waveformToPulseTrain(const IrSymbol* symbols, uint16_t count, PulseTrain& out);
@@ -0,0 +1,38 @@
+#include "key_input.h"
+
+void KeyInput::poll(KeyboardHal& keyboard, uint32_t nowUs) {
+    char code;
+    _reads.fetch_add(1, std::memory_order_relaxed);
+    if (!keyboard.read(code)) {
+        return;
+    }
+
+    KeyEvent event;
+    event.timestampUs = nowUs;
+    event.key = (uint8_t)code;
+    event.modifiers = 0;
+    if (event.key >= 'A' && event.key <= 'Z') {
+        event.modifiers |= KEY_MOD_SHIFT;
+    } else if (event.key >= 0x80 && (event.key < KEY_LEFT || event.key > KEY_RIGHT)) {
+        event.modifiers |= KEY_MOD_FN;
+    }
+    event.repeat = event.key == _lastKey && nowUs - _lastUs < KEY_REPEAT_WINDOW_US;
+    _lastKey = event.key;
+    _lastUs = nowUs;
+
+    _keys.fetch_add(1, std::memory_order_relaxed);
+    _events.push(event);
+}
+
+bool dispatchKey(const KeyBinding* keymap, size_t count, const KeyEvent& event) {
+    for (size_t i = 0; i < count; i++) {
+        if (keymap[i].key == event.key) {
+            if (event.repeat && !keymap[i].repeats) {
+                return true;
+            }
+            keymap[i].action();
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hal.h"
+#include "spsc_ring.h"
+
+#ifndef KEY_QUEUE_SIZE
+#define KEY_QUEUE_SIZE 16
+#endif
+
+#ifndef KEY_POLL_US
+#define KEY_POLL_US 5000               // The CardKB latches one key, so this bounds the typing speed
+#endif
+
+#ifndef KEY_REPEAT_WINDOW_US
+#define KEY_REPEAT_WINDOW_US 150000    // The same key again this soon is held down or hammered
+#endif
+
+// CardKB codes beyond plain ASCII
+#define KEY_BACKSPACE 0x08
+#define KEY_ENTER 0x0D
+#define KEY_ESC 0x1B
+#define KEY_LEFT 0xB4
+#define KEY_UP 0xB5
+#define KEY_DOWN 0xB6
+#define KEY_RIGHT 0xB7
+
+enum KeyModifier : uint8_t {
+    KEY_MOD_SHIFT = 1 << 0,
+    KEY_MOD_FN = 1 << 1            // Fn layer codes, 0x80 and up, arrows excepted
+};
+
+struct KeyEvent {
+    uint32_t timestampUs;          // When the poll found it
+    uint8_t key;
+    uint8_t modifiers;             // KeyModifier bits, read back from the code
+    bool repeat;                   // Same key within KEY_REPEAT_WINDOW_US
+};
+
+// Keyboard reads on a fixed-rate timer, decoded into a bounded event queue.
+// poll() is the only code that touches the keyboard, one read per call, so
+// nothing else can consume a key; the queue is single-producer and
+// single-consumer, so poll() may move to its own task.
+class KeyInput {
+public:
+    void poll(KeyboardHal& keyboard, uint32_t nowUs);
+    bool next(KeyEvent& event) { return _events.pop(event); }
+
+    uint32_t reads() const { return _reads.load(std::memory_order_relaxed); }
+    uint32_t keys() const { return _keys.load(std::memory_order_relaxed); }
+    uint32_t dropped() const { return _events.dropped(); }
+
+private:
+    SpscRing<KeyEvent, KEY_QUEUE_SIZE> _events;
+    uint8_t _lastKey = 0;
+    uint32_t _lastUs = 0;
+    std::atomic<uint32_t> _reads{0};
+    std::atomic<uint32_t> _keys{0};
+};
+
+typedef void (*KeyAction)();
+
+struct KeyBinding {
+    uint8_t key;
+    KeyAction action;
+    bool repeats;                  // Held keys fire it again
+};
+
+// Runs the action bound to the event's key. Returns false when nothing ran.
+bool dispatchKey(const KeyBinding* keymap, size_t count, const KeyEvent& event);
+
+template <size_t N>
+bool dispatchKey(const KeyBinding (&keymap)[N], const KeyEvent& event) {
+    return dispatchKey(keymap, N, event);
+}
+
+// For a static_assert on each keymap: every key bound once.
+template <size_t N>
+constexpr bool keymapUnique(const KeyBinding (&keymap)[N]) {
+    for (size_t i = 0; i < N; i++) {
+        for (size_t j = i + 1; j < N; j++) {
+            if (keymap[i].key == keymap[j].key) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
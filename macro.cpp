@@ -0,0 +1,201 @@
+#include "macro.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define MACRO_MAX_DELAY_MS 600000      // Keeps a whole macro well inside the 32-bit microsecond clock
+
+static bool parseBand(const char* word, uint8_t& band) {
+    if (strcmp(word, "ir") == 0) {
+        band = BAND_IR;
+    } else if (strcmp(word, "rf24") == 0) {
+        band = BAND_RF24;
+    } else if (strcmp(word, "rf433") == 0) {
+        band = BAND_RF433;
+    } else if (strcmp(word, "auto") == 0) {
+        band = MACRO_BAND_AUTO;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Copies the next whitespace-separated word; false at the end of the line
+static bool nextWord(const char*& cursor, char* word, size_t size) {
+    while (*cursor == ' ' || *cursor == '\t') {
+        cursor++;
+    }
+    size_t length = strcspn(cursor, " \t\r\n");
+    if (length == 0 || length >= size) {
+        return false;
+    }
+    memcpy(word, cursor, length);
+    word[length] = '\0';
+    cursor += length;
+    return true;
+}
+
+bool parseMacroStep(const char* line, MacroStep& step) {
+    char word[BUTTON_NAME_MAX];
+    const char* cursor = line;
+    if (!nextWord(cursor, step.button, sizeof(step.button))) {
+        return false;
+    }
+    step.band = MACRO_BAND_AUTO;
+    step.delayMs = 0;
+    step.repeat = 1;
+
+    if (nextWord(cursor, word, sizeof(word)) && !parseBand(word, step.band)) {
+        return false;
+    }
+    if (nextWord(cursor, word, sizeof(word))) {
+        char* end;
+        unsigned long delayMs = strtoul(word, &end, 10);
+        if (*end || delayMs > MACRO_MAX_DELAY_MS) {
+            return false;
+        }
+        step.delayMs = delayMs;
+    }
+    if (nextWord(cursor, word, sizeof(word))) {
+        char* end;
+        unsigned long repeat = strtoul(word, &end, 10);
+        if (*end || repeat == 0 || repeat > MACRO_MAX_REPEAT) {
+            return false;
+        }
+        step.repeat = (uint8_t)repeat;
+    }
+    return !nextWord(cursor, word, sizeof(word));
+}
+
+// Legacy values were never tied to a band: IR sends them as NEC, 433 MHz
+// as RCSwitch's default 24-bit code
+static bool resolveButton(const MacroStep& step, const CachedButton& button, ButtonRecord& record,
+                          IrWaveform& waveform) {
+    record = button.record;
+    uint8_t band = step.band;
+    if (band == MACRO_BAND_AUTO) {
+        band = record.band == BAND_LEGACY ? (uint8_t)BAND_IR : record.band;
+    }
+
+    if (record.band == BAND_LEGACY && band == BAND_RF433) {
+        Rf433Code code = {1, 24, 0, recordValue(record)};
+        recordFromRf433Code(record, code, RF433_TX_REPEATS);
+        recordSetName(record, button.record.name);
+        return compileRf433Code(code, waveform);
+    }
+    if (record.band == BAND_LEGACY && band == BAND_IR) {
+        record.band = BAND_IR;
+    } else if (record.band != band) {
+        return false;
+    }
+
+    if (band == BAND_RF24) {
+        waveform.frameSymbols = 0;
+        return record.payloadLength > 0;
+    }
+    waveform = button.waveform;
+    return waveform.frameSymbols > 0;
+}
+
+static int16_t findButton(const MacroSchedule& schedule, const MacroStep& step) {
+    for (uint8_t i = 0; i < schedule.buttonCount; i++) {
+        const ButtonRecord& record = schedule.records[i];
+        if (strncmp(record.name, step.button, BUTTON_NAME_MAX - 1) == 0 &&
+            (step.band == MACRO_BAND_AUTO || record.band == step.band)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// How long one press keeps the band busy before the next may start
+static uint32_t pressUs(const ButtonRecord& record, const IrWaveform& waveform) {
+    switch (record.band) {
+    case BAND_IR:
+        return waveform.periodUs;
+    case BAND_RF433:
+        return waveform.periodUs * recordRepeats(record) + MACRO_PRESS_GAP_US;
+    }
+    return MACRO_PRESS_GAP_US;
+}
+
+bool compileMacro(const MacroStep* steps, uint8_t count, MacroLookup lookup, MacroSchedule& out,
+                  uint8_t& failedStep) {
+    out.buttonCount = 0;
+    out.eventCount = 0;
+    out.lengthUs = 0;
+
+    uint32_t atUs = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        const MacroStep& step = steps[i];
+        failedStep = i;
+
+        int16_t slot = findButton(out, step);
+        if (slot < 0) {
+            const CachedButton* button = lookup(step.button);
+            if (!button || out.buttonCount == MACRO_MAX_BUTTONS ||
+                !resolveButton(step, *button, out.records[out.buttonCount], out.waveforms[out.buttonCount])) {
+                return false;
+            }
+            slot = out.buttonCount++;
+        }
+
+        const ButtonRecord& record = out.records[slot];
+        uint32_t lengthUs = pressUs(record, out.waveforms[slot]);
+        atUs += step.delayMs * 1000;
+        for (uint8_t press = 0; press < step.repeat; press++) {
+            // The first IR press sends its frame as many times as it was heard
+            uint8_t frames = record.band == BAND_IR && press == 0 ? recordRepeats(record) : 1;
+            for (uint8_t frame = 0; frame < frames; frame++) {
+                if (out.eventCount == MACRO_MAX_EVENTS || atUs > 0x7FFFFFFFUL) {
+                    return false;
+                }
+                MacroEvent& event = out.events[out.eventCount++];
+                event.atUs = atUs;
+                event.button = (uint8_t)slot;
+                event.irRepeat = record.band == BAND_IR && press > 0;
+                atUs += lengthUs;
+            }
+        }
+    }
+    out.lengthUs = atUs;
+    return true;
+}
+
+void MacroPlayer::start(const MacroSchedule& schedule, uint32_t nowUs) {
+    _schedule = &schedule;
+    _startUs = nowUs;
+    _next = 0;
+    _maxLateUs = 0;
+}
+
+uint32_t MacroPlayer::waitUs(uint32_t nowUs) const {
+    if (!_schedule || _next == _schedule->eventCount) {
+        return 0;
+    }
+    uint32_t elapsedUs = nowUs - _startUs;
+    uint32_t atUs = _schedule->events[_next].atUs;
+    return atUs > elapsedUs ? atUs - elapsedUs : 0;
+}
+
+const MacroEvent* MacroPlayer::next() const {
+    if (!_schedule || _next == _schedule->eventCount) {
+        return nullptr;
+    }
+    return &_schedule->events[_next];
+}
+
+const MacroEvent* MacroPlayer::due(uint32_t nowUs) {
+    if (!_schedule || _next == _schedule->eventCount) {
+        return nullptr;
+    }
+    uint32_t elapsedUs = nowUs - _startUs;
+    const MacroEvent& event = _schedule->events[_next];
+    if (elapsedUs < event.atUs) {
+        return nullptr;
+    }
+    uint32_t lateUs = elapsedUs - event.atUs;
+    _maxLateUs = lateUs > _maxLateUs ? lateUs : _maxLateUs;
+    _sentUs[_next++] = elapsedUs;
+    return &event;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "button_cache.h"
+#include "button_record.h"
+#include "ir_waveform.h"
+
+#define MACRO_EXTENSION ".mac"
+#define MACRO_NAME_MAX 24
+
+#ifndef MACRO_MAX_STEPS
+#define MACRO_MAX_STEPS 32
+#endif
+
+#ifndef MACRO_MAX_BUTTONS
+#define MACRO_MAX_BUTTONS 8            // Distinct buttons one macro can use
+#endif
+
+#ifndef MACRO_MAX_EVENTS
+#define MACRO_MAX_EVENTS 128           // Sends, repeated presses included
+#endif
+
+#ifndef MACRO_PRESS_GAP_US
+#define MACRO_PRESS_GAP_US 100000      // Between presses of a repeated 433 MHz or nRF24 step
+#endif
+
+#define MACRO_MAX_REPEAT 100
+#define MACRO_BAND_AUTO 0xFE           // The button's own band; IR for legacy values
+
+// One line of a macro: press `button` `repeat` times on `band`, starting
+// `delayMs` after the previous step has finished.
+struct MacroStep {
+    char button[BUTTON_NAME_MAX];
+    uint8_t band;                  // SignalBand or MACRO_BAND_AUTO
+    uint32_t delayMs;
+    uint8_t repeat;                // IR presses after the first go out as a held button
+};
+
+// "Power ir 500 3": button, band (ir, rf24, rf433 or auto), delay in ms,
+// presses. Band, delay and presses may be left off.
+bool parseMacroStep(const char* line, MacroStep& step);
+
+struct MacroEvent {
+    uint32_t atUs;                 // From the start of the macro
+    uint8_t button;
+    bool irRepeat;
+};
+
+// A macro compiled to absolute send times over ready-to-send buttons, so
+// playing it needs no lookups, compiling or storage.
+struct MacroSchedule {
+    uint8_t buttonCount;
+    uint16_t eventCount;
+    uint32_t lengthUs;
+    ButtonRecord records[MACRO_MAX_BUTTONS];   // Band resolved, as it will be sent
+    IrWaveform waveforms[MACRO_MAX_BUTTONS];   // Empty for nRF24
+    MacroEvent events[MACRO_MAX_EVENTS];
+};
+
+typedef const CachedButton* (*MacroLookup)(const char* button);
+
+// Resolves every button through `lookup` and lays the presses out back to
+// back: an IR press lasts its repeat period, a 433 MHz one its frames.
+// On failure `failedStep` is the step that could not be placed.
+bool compileMacro(const MacroStep* steps, uint8_t count, MacroLookup lookup, MacroSchedule& out,
+                  uint8_t& failedStep);
+
+// Hands out a schedule's events as they fall due. Deadlines are absolute
+// from start(), so a late send never pushes the ones after it back.
+class MacroPlayer {
+public:
+    // `schedule` must stay untouched until the player is done.
+    void start(const MacroSchedule& schedule, uint32_t nowUs);
+    void stop() { _schedule = nullptr; }
+
+    bool active() const { return _schedule != nullptr; }
+    bool done() const { return _schedule && _next == _schedule->eventCount; }
+    const MacroSchedule* schedule() const { return _schedule; }
+
+    // Time until the next event is due, 0 when it is or nothing is left.
+    uint32_t waitUs(uint32_t nowUs) const;
+
+    // The next event once it is due, noting when it went out.
+    const MacroEvent* due(uint32_t nowUs);
+
+    // The next event, due or not; nullptr when none are left.
+    const MacroEvent* next() const;
+
+    // When each event went out, from the start, for checking the timing.
+    uint32_t sentUs(uint16_t event) const { return _sentUs[event]; }
+    uint16_t sent() const { return _next; }
+    uint32_t maxLateUs() const { return _maxLateUs; }
+
+private:
+    const MacroSchedule* _schedule = nullptr;
+    uint32_t _startUs = 0;
+    uint16_t _next = 0;
+    uint32_t _maxLateUs = 0;
+    uint32_t _sentUs[MACRO_MAX_EVENTS];
+};
@@ -0,0 +1,134 @@
+#include "host_storage.h"
+
+#include <string.h>
+#include <sys/stat.h>
+
+#define HOST_PATH_MAX 512
+
+bool HostStorageFile::open(const char* path, StorageMode mode) {
+    close();
+    const char* modes[] = {"rb", "r+b", "w+b"};
+    _file = fopen(path, modes[mode]);
+    return _file != nullptr;
+}
+
+void HostStorageFile::close() {
+    if (_file) {
+        fclose(_file);
+        _file = nullptr;
+    }
+}
+
+bool HostStorageFile::available() {
+    int c = fgetc(_file);
+    if (c == EOF) {
+        return false;
+    }
+    ungetc(c, _file);
+    return true;
+}
+
+size_t HostStorageFile::readLine(char* line, size_t maxLength) {
+    size_t length = 0;
+    int c;
+    while (length < maxLength && (c = fgetc(_file)) != EOF && c != '\n') {
+        line[length++] = (char)c;
+    }
+    return length;
+}
+
+size_t HostStorageFile::read(void* buffer, size_t maxLength) {
+    return fread(buffer, 1, maxLength, _file);
+}
+
+bool HostStorageFile::readAt(uint32_t offset, void* buffer, size_t length) {
+    if (fseek(_file, offset, SEEK_SET) != 0) {
+        return false;
+    }
+    return fread(buffer, 1, length, _file) == length;
+}
+
+bool HostStorageFile::writeAt(uint32_t offset, const void* buffer, size_t length) {
+    // Writing past the end extends the file, as it does on the card
+    if (fseek(_file, offset, SEEK_SET) != 0) {
+        return false;
+    }
+    return fwrite(buffer, 1, length, _file) == length;
+}
+
+bool HostStorageDir::open(const char* path) {
+    close();
+    _dir = opendir(path);
+    return _dir != nullptr;
+}
+
+void HostStorageDir::close() {
+    if (_dir) {
+        closedir(_dir);
+        _dir = nullptr;
+    }
+}
+
+bool HostStorageDir::next(char* name, size_t size) {
+    for (struct dirent* entry = readdir(_dir); entry; entry = readdir(_dir)) {
+        struct stat info;
+        if (entry->d_name[0] != '.' && fstatat(dirfd(_dir), entry->d_name, &info, 0) == 0 && S_ISREG(info.st_mode)) {
+            snprintf(name, size, "%s", entry->d_name);
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* HostStorage::hostPath(const char* path, char* out, size_t outLen) const {
+    snprintf(out, outLen, "%s%s", _root, path);
+    return out;
+}
+
+bool HostStorage::begin() {
+    struct stat info;
+    return stat(_root, &info) == 0 && S_ISDIR(info.st_mode);
+}
+
+bool HostStorage::exists(const char* path) {
+    char full[HOST_PATH_MAX];
+    struct stat info;
+    return stat(hostPath(path, full, sizeof(full)), &info) == 0;
+}
+
+bool HostStorage::mkdir(const char* path) {
+    char full[HOST_PATH_MAX];
+    return ::mkdir(hostPath(path, full, sizeof(full)), 0755) == 0;
+}
+
+bool HostStorage::remove(const char* path) {
+    char full[HOST_PATH_MAX];
+    return ::remove(hostPath(path, full, sizeof(full))) == 0;
+}
+
+bool HostStorage::rename(const char* from, const char* to) {
+    char fullFrom[HOST_PATH_MAX];
+    char fullTo[HOST_PATH_MAX];
+    return ::rename(hostPath(from, fullFrom, sizeof(fullFrom)), hostPath(to, fullTo, sizeof(fullTo))) == 0;
+}
+
+StorageFile* HostStorage::open(const char* path, StorageMode mode) {
+    char full[HOST_PATH_MAX];
+    for (HostStorageFile& file : _files) {
+        if (!file.isOpen()) {
+            _opens++;
+            return file.open(hostPath(path, full, sizeof(full)), mode) ? &file : nullptr;
+        }
+    }
+    return nullptr;
+}
+
+StorageDir* HostStorage::openDir(const char* path) {
+    char full[HOST_PATH_MAX];
+    for (HostStorageDir& dir : _dirs) {
+        if (!dir.isOpen()) {
+            return dir.open(hostPath(path, full, sizeof(full))) ? &dir : nullptr;
+        }
+    }
+    return nullptr;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <dirent.h>
+#include <stdio.h>
+
+#include "../hal.h"
+
+// StorageFile over a stdio FILE.
+class HostStorageFile : public StorageFile {
+public:
+    bool open(const char* path, StorageMode mode);
+    bool isOpen() const { return _file != nullptr; }
+
+    void close() override;
+    bool available() override;
+    size_t readLine(char* line, size_t maxLength) override;
+    size_t read(void* buffer, size_t maxLength) override;
+    bool readAt(uint32_t offset, void* buffer, size_t length) override;
+    bool writeAt(uint32_t offset, const void* buffer, size_t length) override;
+
+private:
+    FILE* _file = nullptr;
+};
+
+// StorageDir over a dirent stream; entries are stat()ed to leave out
+// subdirectories.
+class HostStorageDir : public StorageDir {
+public:
+    bool open(const char* path);
+    bool isOpen() const { return _dir != nullptr; }
+
+    void close() override;
+    bool next(char* name, size_t size) override;
+
+private:
+    DIR* _dir = nullptr;
+};
+
+// StorageHal rooted at a host directory standing in for the SD card.
+class HostStorage : public StorageHal {
+public:
+    explicit HostStorage(const char* root) : _root(root) {}
+
+    bool begin() override;
+    bool exists(const char* path) override;
+    bool mkdir(const char* path) override;
+    bool remove(const char* path) override;
+    bool rename(const char* from, const char* to) override;
+    StorageFile* open(const char* path, StorageMode mode) override;
+    StorageDir* openDir(const char* path) override;
+
+    uint32_t opens() const { return _opens; }
+
+private:
+    const char* hostPath(const char* path, char* out, size_t outLen) const;
+
+    const char* _root;
+    HostStorageFile _files[STORAGE_MAX_OPEN_FILES];
+    HostStorageDir _dirs[STORAGE_MAX_OPEN_DIRS];
+    uint32_t _opens = 0;
+};
@@ -0,0 +1,101 @@
+// Host simulator: runs the firmware in app.cpp against file-backed storage
+// and scripted radios, keys and buttons on a virtual clock.
+//
+//   native_sim <sd-root> <script> [screen.ppm]
+//   native_sim --bench <sd-root> [soak-seconds]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../app.h"
+#include "../bench.h"
+#include "../ui_framebuffer.h"
+#include "host_storage.h"
+#include "sim_hal.h"
+
+// pio test links the sources with each suite's own main()
+#ifndef PIO_UNIT_TESTING
+
+#define SIM_SCREEN_WIDTH 320
+#define SIM_SCREEN_HEIGHT 240
+#define SIM_TAIL_MS 2000           // Keeps running after the script so saves drain
+
+static uint16_t canvas[SIM_SCREEN_WIDTH * SIM_SCREEN_HEIGHT];
+static uint16_t panel[SIM_SCREEN_WIDTH * SIM_SCREEN_HEIGHT];
+
+static bool writeScreen(const char* path) {
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        return false;
+    }
+    fprintf(file, "P6\n%d %d\n255\n", SIM_SCREEN_WIDTH, SIM_SCREEN_HEIGHT);
+    for (uint32_t i = 0; i < SIM_SCREEN_WIDTH * SIM_SCREEN_HEIGHT; i++) {
+        uint16_t pixel = panel[i];
+        uint8_t rgb[3] = {(uint8_t)((pixel >> 8) & 0xF8), (uint8_t)((pixel >> 3) & 0xFC), (uint8_t)(pixel << 3)};
+        fwrite(rgb, 1, sizeof(rgb), file);
+    }
+    fclose(file);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    bool bench = argc > 1 && strcmp(argv[1], "--bench") == 0;
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s <sd-root> <script> [screen.ppm]\n"
+                        "       %s --bench <sd-root> [soak-seconds]\n", argv[0], argv[0]);
+        return 2;
+    }
+
+    SimSystem system;
+    HostStorage storage(argv[bench ? 2 : 1]);
+    SimRadio radio(system);
+    FramebufferSurface display(canvas, panel, SIM_SCREEN_WIDTH, SIM_SCREEN_HEIGHT);
+    SimPower power;
+    SimKeyboard keyboard;
+    SimButtons buttons;
+    Hal hal = {system, storage, radio, display, power, keyboard, buttons};
+
+    if (bench) {
+        system.setTimestamps(false);
+        BenchOptions options = BENCH_DEFAULT_OPTIONS;
+        if (argc > 3) {
+            options.soakSeconds = strtoul(argv[3], nullptr, 10);
+        }
+        return runBenchmarks(hal, options) ? 0 : 1;
+    }
+
+    SimScript script;
+    if (!script.load(argv[2])) {
+        fprintf(stderr, "cannot read script %s\n", argv[2]);
+        return 2;
+    }
+
+    SimDevices devices = {system, radio, power, keyboard, buttons};
+
+    appSetup(hal);
+
+    uint32_t endMs = 0;
+    for (;;) {
+        uint32_t nowMs = system.micros() / 1000;
+        if (!script.apply(nowMs, devices)) {
+            if (endMs == 0) {
+                endMs = nowMs + SIM_TAIL_MS;
+            } else if (nowMs >= endMs) {
+                break;
+            }
+        }
+        appLoop();
+    }
+
+    printf("script lines: %u, transmissions: %u, file opens: %u, pixels pushed: %u\n",
+           script.lineCount(), radio.transmissions(), storage.opens(), display.pixelsPushed());
+
+    if (argc > 3 && !writeScreen(argv[3])) {
+        fprintf(stderr, "cannot write %s\n", argv[3]);
+        return 1;
+    }
+    return 0;
+}
+
+#endif
@@ -0,0 +1,394 @@
+#include "sim_hal.h"
+
+#include <malloc.h>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../button_cache.h"
+#include "../ir_codec.h"
+#include "../key_input.h"
+#include "../rf433_codec.h"
+
+void SimSystem::log(const char* line) {
+    if (_timestamps) {
+        printf("[%9.3f] ", _nowUs / 1000000.0);
+    }
+    printf("%s\n", line);
+}
+
+static uint32_t heapAllocations = 0;
+
+// Counted so the soak can tell a steady state that allocates
+void* operator new(size_t size) {
+    heapAllocations++;
+    void* memory = malloc(size ? size : 1);
+    if (!memory) {
+        abort();
+    }
+    return memory;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    heapAllocations++;
+    return malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept {
+    return operator new(size, tag);
+}
+
+void operator delete(void* memory) noexcept {
+    free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    free(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept {
+    free(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept {
+    free(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept {
+    free(memory);
+}
+
+void* SimSystem::allocate(size_t size) {
+    heapAllocations++;
+    return malloc(size);
+}
+
+uint32_t SimSystem::cycleCount() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t)((uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec);
+}
+
+size_t SimSystem::heapUsed() {
+    return mallinfo2().uordblks;
+}
+
+uint32_t SimSystem::allocations() {
+    return heapAllocations;
+}
+
+bool SimRadio::begin(uint8_t band) {
+    return band != BAND_RF24 || _rf24Present;
+}
+
+// Stamped like a receiver would, with the time its first edge arrived
+void SimRadio::injectIr(const PulseTrain& frame) {
+    static PulseTrain stamped;
+    stamped = frame;
+    stamped.startUs = _system.micros();
+    _irFrames.push(stamped);
+}
+
+bool SimRadio::readIrFrame(PulseTrain& frame) {
+    return (_listenMask & RADIO_LISTEN_IR) && _irFrames.pop(frame);
+}
+
+bool SimRadio::readRf24(uint8_t* payload, uint8_t& length) {
+    SimRf24Payload received;
+    if (!(_listenMask & RADIO_LISTEN_RF24) || !_rf24Payloads.pop(received)) {
+        return false;
+    }
+    memcpy(payload, received.data, received.length);
+    length = received.length;
+    return true;
+}
+
+uint32_t SimRadio::dropped(uint8_t band) {
+    switch (band) {
+    case BAND_IR:
+        return _irFrames.dropped();
+    case BAND_RF24:
+        return _rf24Payloads.dropped();
+    case BAND_RF433:
+        return _rf433Bursts.dropped();
+    }
+    return 0;
+}
+
+bool SimRadio::injectRf433(const Rf433Code& code) {
+    static PulseTrain frame;
+    if (!encodeRf433(code, frame)) {
+        return false;
+    }
+    // Receivers stretch marks and shrink spaces by up to ~100 us
+    uint32_t edgeUs = _system.micros();
+    for (uint8_t repeat = 0; repeat < SIM_RF433_FRAMES; repeat++) {
+        for (uint16_t i = 0; i < frame.count; i++) {
+            bool mark = (i & 1) == 0;
+            if (_rf433Detector.pushEdge({edgeUs, mark}, _rf433Burst)) {
+                _rf433Bursts.push(_rf433Burst);
+            }
+            _noiseState = _noiseState * 1103515245 + 12345;
+            int32_t skew = (int32_t)((_noiseState >> 16) % 61) + (mark ? 20 : -80);
+            edgeUs += frame.durations[i] + skew;
+        }
+    }
+    if (_rf433Detector.poll(edgeUs + RF433_BURST_GAP_US, _rf433Burst)) {
+        _rf433Bursts.push(_rf433Burst);
+    }
+    return true;
+}
+
+bool SimRadio::readRf433(PulseTrain& train, uint8_t& repeats) {
+    if (!(_listenMask & RADIO_LISTEN_RF433) || !_rf433Bursts.pop(_rf433Burst)) {
+        return false;
+    }
+    train = _rf433Burst.train;
+    repeats = _rf433Burst.repeats;
+    return true;
+}
+
+uint32_t SimRadio::irWaitUs() {
+    uint32_t elapsed = _system.micros() - _irLastStartUs;
+    return elapsed < _irLastPeriodUs ? _irLastPeriodUs - elapsed : 0;
+}
+
+// Expands the symbols the RMT would play and decodes them again
+bool SimRadio::sendIr(const IrWaveform& waveform, bool repeat) {
+    static PulseTrain train;
+    char text[64];
+    if (irWaitUs() > 0) {
+        return false;
+    }
+    _irLastStartUs = _system.micros();
+    _irLastPeriodUs = waveform.periodUs;
+    IrCode code = {};
+    const IrSymbol* symbols = repeat ? waveform.repeat() : waveform.symbols;
+    uint16_t count = repeat ? waveform.repeatCount() : waveform.frameSymbols;
+    if (!waveformToPulseTrain(symbols, count, train)) {
+        snprintf(text, sizeof(text), "bad waveform");
+    } else if (decodeIr(train, code)) {
+        formatIrCode(code, text, sizeof(text));
+    } else {
+        snprintf(text, sizeof(text), "RAW %u pulses", train.count);
+    }
+    _transmissions++;
+    printf("[%9.3f] TX IR %s%s @%u kHz\n", _system.micros() / 1000000.0, text,
+           code.repeat ? " (repeat)" : "", waveform.carrierKhz);
+    return true;
+}
+
+bool SimRadio::queueRf24(const uint8_t* payload, uint8_t length) {
+    if (_rf24TxQueued == RF24_TX_FIFO_DEPTH) {
+        return false;
+    }
+    _rf24TxQueued++;
+    _transmissions++;
+    char text[RF24_MAX_PAYLOAD * 4 + 1];
+    size_t used = 0;
+    for (uint8_t i = 0; i < length && i < RF24_MAX_PAYLOAD; i++) {
+        bool printable = payload[i] >= ' ' && payload[i] < 0x7F && payload[i] != '\\';
+        used += snprintf(text + used, sizeof(text) - used, printable ? "%c" : "\\x%02X", payload[i]);
+    }
+    text[used] = '\0';
+    printf("[%9.3f] TX RF24 ch%u \"%s\"\n", _system.micros() / 1000000.0, _rf24Selected, text);
+    return true;
+}
+
+void SimRadio::pollRf24Tx(Rf24TxStatus& status) {
+    status.empty = true;
+    status.acked = _rf24TxQueued > 0;
+    status.failed = false;
+    status.retries = 0;
+    _rf24TxQueued = 0;
+}
+
+// Expands the symbols the transmitter would drive and decodes them again
+bool SimRadio::sendRf433(const IrWaveform& waveform, uint8_t repeats) {
+    static PulseTrain train;
+    char text[64];
+    Rf433Code code;
+    if (!waveformToPulseTrain(waveform.symbols, waveform.frameSymbols, train)) {
+        snprintf(text, sizeof(text), "bad waveform");
+    } else if (decodeRf433(train, code)) {
+        formatRf433Code(code, text, sizeof(text));
+    } else {
+        snprintf(text, sizeof(text), "RAW %u pulses", train.count);
+    }
+    _transmissions++;
+    printf("[%9.3f] TX RF433 %s x%u\n", _system.micros() / 1000000.0, text, repeats);
+    return true;
+}
+
+bool SimRadio::startRf24Sniff(const Rf24SniffConfig& config) {
+    _rf24Sniffing = _rf24Present;
+    _rf24Channel = config.firstChannel;
+    return _rf24Sniffing;
+}
+
+bool SimRadio::readRf24Packet(Rf24Packet& packet) {
+    SimRf24Payload received;
+    if (!_rf24Sniffing || !_rf24Payloads.pop(received)) {
+        return false;
+    }
+    packet.pipe = 1;
+    packet.length = received.length;
+    packet.fifoFull = false;
+    memcpy(packet.payload, received.data, received.length);
+    return true;
+}
+
+bool SimRadio::startRf24Scan() {
+    _rf24Scanning = _rf24Present;
+    return _rf24Scanning;
+}
+
+void SimRadio::setRf24Noise(uint8_t first, uint8_t last, uint8_t percent) {
+    for (uint16_t channel = first; channel <= last && channel < RF24_CHANNELS; channel++) {
+        _rf24Noise[channel] = percent;
+    }
+}
+
+// Pseudo-random but repeatable, like the rest of a run
+bool SimRadio::readRf24Carrier() {
+    if (!_rf24Scanning || _rf24Channel >= RF24_CHANNELS) {
+        return false;
+    }
+    _noiseState = _noiseState * 1103515245 + 12345;
+    return (_noiseState >> 16) % 100 < _rf24Noise[_rf24Channel];
+}
+
+bool SimScript::load(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    _text = (char*)malloc(size + 1);
+    bool ok = _text && fread(_text, 1, size, file) == (size_t)size;
+    fclose(file);
+    if (!ok) {
+        return false;
+    }
+    _text[size] = '\0';
+    _next = _text;
+    return true;
+}
+
+bool SimScript::apply(uint32_t nowMs, SimDevices& devices) {
+    while (!_ended && _next && *_next) {
+        char* line = _next;
+        char* end = strchr(line, '\n');
+        if (end && *end) {
+            *end = '\0';
+        }
+        char* command;
+        unsigned long atMs = strtoul(line, &command, 10);
+        bool blank = line[strspn(line, " \t\r")] == '\0' || line[0] == '#';
+        if (!blank && atMs > nowMs) {
+            if (end) {
+                *end = '\n';
+            }
+            break;
+        }
+
+        _next = end ? end + 1 : line + strlen(line);
+        if (blank) {
+            continue;
+        }
+        _lineCount++;
+        if (!dispatch(command, devices)) {
+            fprintf(stderr, "script: bad line %u: %s\n", _lineCount, line);
+        }
+    }
+    return !_ended && _next && *_next;
+}
+
+bool SimScript::dispatch(char* command, SimDevices& devices) {
+    char* verb = strtok(command, " \t\r");
+    char* argument = strtok(nullptr, "\r");
+    if (!verb) {
+        return false;
+    }
+    while (argument && (*argument == ' ' || *argument == '\t')) {
+        argument++;
+    }
+
+    if (strcmp(verb, "end") == 0) {
+        _ended = true;
+        return true;
+    }
+    if (!argument) {
+        return false;
+    }
+
+    if (strcmp(verb, "key") == 0) {
+        bool code = argument[0] == '0' && argument[1] == 'x' && argument[2];
+        devices.keyboard.press(code ? (char)strtoul(argument + 2, nullptr, 16) : argument[0]);
+    } else if (strcmp(verb, "remote") == 0) {
+        // Through the keyboard, as it is entered on the device
+        bool ok = strlen(argument) < REMOTE_NAME_MAX && devices.keyboard.press('r');
+        for (const char* c = argument; ok && *c; c++) {
+            ok = devices.keyboard.press(*c);
+        }
+        return ok && devices.keyboard.press(KEY_ENTER);
+    } else if (strcmp(verb, "button") == 0) {
+        if (argument[0] < 'A' || argument[0] > 'C') {
+            return false;
+        }
+        devices.buttons.press((HalButton)(BUTTON_A + argument[0] - 'A'));
+    } else if (strcmp(verb, "ir") == 0) {
+        static PulseTrain frame;
+        IrCode code;
+        uint8_t carrierKhz;
+        if (strncmp(argument, "RAW:", 4) == 0) {
+            if (!parseIrRaw(argument, frame, carrierKhz)) {
+                return false;
+            }
+        } else if (!parseIrCode(argument, code) || !encodeIr(code, frame)) {
+            return false;
+        }
+        devices.radio.injectIr(frame);
+    } else if (strcmp(verb, "rf24") == 0) {
+        SimRf24Payload payload = {};
+        size_t length = strlen(argument);
+        payload.length = length < sizeof(payload.data) ? length : sizeof(payload.data);
+        memcpy(payload.data, argument, payload.length);
+        devices.radio.injectRf24(payload);
+    } else if (strcmp(verb, "rf433") == 0) {
+        Rf433Code code = {1, 24, 0, 0};
+        char* cursor;
+        code.value = strtoull(argument, &cursor, 16);
+        unsigned long bits = strtoul(cursor, &cursor, 10);
+        unsigned long protocol = strtoul(cursor, &cursor, 10);
+        code.bits = bits ? bits : 24;
+        code.protocol = protocol ? protocol : 1;
+        return devices.radio.injectRf433(code);
+    } else if (strcmp(verb, "noise") == 0) {
+        char* cursor;
+        unsigned long first = strtoul(argument, &cursor, 10);
+        unsigned long last = strtoul(cursor, &cursor, 10);
+        unsigned long percent = strtoul(cursor, &cursor, 10);
+        if (first > last || last >= RF24_CHANNELS || percent > 100) {
+            return false;
+        }
+        devices.radio.setRf24Noise(first, last, percent);
+    } else if (strcmp(verb, "battery") == 0) {
+        devices.power.setLevel(atoi(argument));
+    } else {
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "../frame_assembler.h"
+#include "../hal.h"
+#include "../rf433_detector.h"
+#include "../spsc_ring.h"
+
+#define SIM_QUEUE_SIZE 16
+#define SIM_KEY_QUEUE_SIZE 64          // Room for a remote name typed in one go
+
+// Virtual clock: sleeping advances time instantly, so a run is
+// deterministic and much faster than real time. The cycle counter is the
+// host's monotonic clock in nanoseconds, for benchmarks.
+class SimSystem : public SystemHal {
+public:
+    // Bench output is parsed as JSON lines, so it goes out unprefixed.
+    void setTimestamps(bool enabled) { _timestamps = enabled; }
+
+    uint32_t micros() override { return _nowUs; }
+    void sleepUs(uint32_t us) override { _nowUs += us; }
+    void log(const char* line) override;
+    void* allocate(size_t size) override;
+    uint32_t cycleCount() override;
+    uint32_t cyclesPerUs() override { return 1000; }
+    size_t heapUsed() override;
+    uint32_t allocations() override;
+    bool startRadioTask(RadioService&) override { return false; }
+    uint8_t coreId() override { return 0; }
+
+private:
+    uint32_t _nowUs = 0;
+    bool _timestamps = true;
+};
+
+struct SimRf24Payload {
+    uint8_t length;
+    uint8_t data[32];
+};
+
+#define SIM_RF433_FRAMES 6             // Frames a scripted 433 MHz press sends
+
+// Radios that receive whatever the script injects and log what is sent. Every
+// nRF24 packet is acknowledged at once. 433 MHz codes go over the air as
+// jittered edges through the real frame detector.
+class SimRadio : public RadioBackend {
+public:
+    explicit SimRadio(SystemHal& system) : _system(system) {}
+
+    void injectIr(const PulseTrain& frame);
+    void injectRf24(const SimRf24Payload& payload) { _rf24Payloads.push(payload); }
+    bool injectRf433(const Rf433Code& code);
+    void setRf24Present(bool present) { _rf24Present = present; }
+
+    // Share of spectrum samples on [first, last] that see a carrier.
+    void setRf24Noise(uint8_t first, uint8_t last, uint8_t percent);
+
+    uint32_t transmissions() const { return _transmissions; }
+
+    bool begin(uint8_t band) override;
+    uint32_t nowUs() override { return _system.micros(); }
+    void setListening(uint8_t listenMask) override { _listenMask = listenMask; }
+    bool readIrFrame(PulseTrain& frame) override;
+    bool readRf24(uint8_t* payload, uint8_t& length) override;
+    uint32_t irWaitUs() override;
+    bool sendIr(const IrWaveform& waveform, bool repeat) override;
+    uint32_t dropped(uint8_t band) override;
+    bool readRf433(PulseTrain& train, uint8_t& repeats) override;
+    bool sendRf433(const IrWaveform& waveform, uint8_t repeats) override;
+    bool startRf24Sniff(const Rf24SniffConfig& config) override;
+    void stopRf24Sniff() override { _rf24Sniffing = false; }
+    void setRf24Channel(uint8_t channel) override { _rf24Channel = channel; }
+    bool readRf24Packet(Rf24Packet& packet) override;
+    bool startRf24Scan() override;
+    void stopRf24Scan() override { _rf24Scanning = false; }
+    bool readRf24Carrier() override;
+    void selectRf24Channel(uint8_t channel) override { _rf24Selected = channel; }
+    void setRf24Tx(const Rf24TxConfig&) override {}
+    bool beginRf24Tx() override { return _rf24Present; }
+    bool queueRf24(const uint8_t* payload, uint8_t length) override;
+    void pollRf24Tx(Rf24TxStatus& status) override;
+    void endRf24Tx() override { _rf24TxQueued = 0; }
+
+private:
+    SystemHal& _system;
+    uint8_t _listenMask = 0;
+    bool _rf24Present = true;
+    bool _rf24Sniffing = false;
+    bool _rf24Scanning = false;
+    uint8_t _rf24Channel = 0;
+    uint8_t _rf24Selected = RF24_DEFAULT_CHANNEL;
+    uint8_t _rf24TxQueued = 0;
+    uint8_t _rf24Noise[RF24_CHANNELS] = {};
+    uint32_t _noiseState = 1;
+    uint32_t _transmissions = 0;
+    uint32_t _irLastStartUs = 0;
+    uint32_t _irLastPeriodUs = 0;
+    SpscRing<PulseTrain, SIM_QUEUE_SIZE> _irFrames;
+    SpscRing<SimRf24Payload, SIM_QUEUE_SIZE> _rf24Payloads;
+    Rf433FrameDetector _rf433Detector;
+    Rf433Burst _rf433Burst;
+    SpscRing<Rf433Burst, SIM_QUEUE_SIZE> _rf433Bursts;
+};
+
+class SimPower : public PowerHal {
+public:
+    void setLevel(int level) { _level = level; }
+    int batteryLevel() override { return _level; }
+
+private:
+    int _level = 100;
+};
+
+class SimKeyboard : public KeyboardHal {
+public:
+    bool press(char key) { return _keys.push(key); }
+    void begin() override {}
+    bool read(char& key) override { return _keys.pop(key); }
+
+private:
+    SpscRing<char, SIM_KEY_QUEUE_SIZE> _keys;
+};
+
+// Presses latch until the next update(), like M5's wasPressed().
+class SimButtons : public ButtonsHal {
+public:
+    void press(HalButton button) { _pending |= 1 << button; }
+    void update() override {
+        _pressed = _pending;
+        _pending = 0;
+    }
+    bool wasPressed(HalButton button) override { return _pressed & (1 << button); }
+
+private:
+    uint8_t _pending = 0;
+    uint8_t _pressed = 0;
+};
+
+struct SimDevices {
+    SimSystem& system;
+    SimRadio& radio;
+    SimPower& power;
+    SimKeyboard& keyboard;
+    SimButtons& buttons;
+};
+
+// Timed input script, one event per line:
+//   <ms> key <c>            CardKB key press; key 0x<hex> for arrows, Enter, Esc
+//   <ms> remote <name>      types r, the name and Enter, selecting the remote
+//   <ms> button A|B|C       front button press
+//   <ms> ir <code>          IR frame, as NEC:32:20DF10EF or RAW:38:...
+//   <ms> rf24 <text>        2.4 GHz payload, heard on any channel when sniffing
+//   <ms> rf433 <hex> [bits] [protocol]   RCSwitch protocol numbers, default 24 bits p1
+//   <ms> noise <first> <last> <percent>   2.4 GHz carrier seen by the spectrum scan
+//   <ms> battery <percent>
+//   <ms> end                stop the run
+// Blank lines and lines starting with '#' are ignored.
+class SimScript {
+public:
+    bool load(const char* path);
+
+    // Applies every event due at `nowMs`. Returns false once the script ended.
+    bool apply(uint32_t nowMs, SimDevices& devices);
+
+    uint32_t lineCount() const { return _lineCount; }
+
+private:
+    bool dispatch(char* command, SimDevices& devices);
+
+    char* _text = nullptr;
+    char* _next = nullptr;
+    uint32_t _lineCount = 0;
+    bool _ended = false;
+};
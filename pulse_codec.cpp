@@ -0,0 +1,363 @@
+#include "pulse_codec.h"
+
+#define PULSE_NIBBLE_LITERAL 0xE
+#define PULSE_NIBBLE_REPEAT 0xF
+#define PULSE_REPEAT_MAX 255
+#define PULSE_REPEAT_MIN_PULSES 6      // Below this a repeat token costs more than it saves
+#define PULSE_REFINE_MAX_UNITS 16
+
+static uint16_t quantize(uint16_t duration, uint16_t unit) {
+    uint16_t units = (uint16_t)(((uint32_t)duration + unit / 2) / unit);
+    return units ? units : 1;
+}
+
+static uint32_t tolerance(uint32_t duration) {
+    uint32_t share = duration * PULSE_TOLERANCE_PCT / 100;
+    return share > PULSE_TOLERANCE_US ? share : PULSE_TOLERANCE_US;
+}
+
+// Replaces each duration with the mean of its cluster, so receiver jitter
+// does not make repeated frames look different.
+static void clusterDurations(const PulseTrain& train, uint16_t* cleaned) {
+    static uint16_t sorted[IR_MAX_PULSES];
+    for (uint16_t i = 0; i < train.count; i++) {
+        uint16_t j = i;
+        for (; j > 0 && sorted[j - 1] > train.durations[i]; j--) {
+            sorted[j] = sorted[j - 1];
+        }
+        sorted[j] = train.durations[i];
+    }
+
+    uint16_t first = 0;
+    while (first < train.count) {
+        uint16_t last = first;
+        uint32_t sum = 0;
+        while (last < train.count && (uint32_t)(sorted[last] - sorted[first]) <= 2 * tolerance(sorted[first])) {
+            sum += sorted[last++];
+        }
+        uint16_t mean = (uint16_t)((sum + (last - first) / 2) / (last - first));
+        for (uint16_t i = 0; i < train.count; i++) {
+            if (train.durations[i] >= sorted[first] && train.durations[i] <= sorted[last - 1]) {
+                cleaned[i] = mean;
+            }
+        }
+        first = last;
+    }
+}
+
+static bool unitFits(const uint16_t* durations, uint16_t count, uint16_t unit) {
+    for (uint16_t i = 0; i < count; i++) {
+        uint32_t quantized = (uint32_t)quantize(durations[i], unit) * unit;
+        uint32_t error = quantized > durations[i] ? quantized - durations[i] : durations[i] - quantized;
+        if (error > tolerance(durations[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// The coarsest unit that keeps every duration within tolerance. Protocols
+// are built on a base period, so it is usually the shortest pulse or a
+// fraction of it, refined against the short pulses.
+static uint16_t learnUnit(const uint16_t* durations, uint16_t count) {
+    uint16_t shortest = 0xFFFF;
+    for (uint16_t i = 0; i < count; i++) {
+        if (durations[i] < shortest) {
+            shortest = durations[i];
+        }
+    }
+
+    for (uint16_t divisor = 1; shortest / divisor >= PULSE_UNIT_MIN_US; divisor++) {
+        uint16_t unit = shortest / divisor;
+        uint32_t sumUs = 0;
+        uint32_t sumUnits = 0;
+        for (uint16_t i = 0; i < count; i++) {
+            uint16_t units = quantize(durations[i], unit);
+            if (units <= PULSE_REFINE_MAX_UNITS) {
+                sumUs += durations[i];
+                sumUnits += units;
+            }
+        }
+        uint16_t refined = sumUnits ? (uint16_t)((sumUs + sumUnits / 2) / sumUnits) : unit;
+        if (refined >= PULSE_UNIT_MIN_US && unitFits(durations, count, refined)) {
+            return refined;
+        }
+        if (unitFits(durations, count, unit)) {
+            return unit;
+        }
+    }
+    return PULSE_UNIT_MIN_US;
+}
+
+class CodeWriter {
+public:
+    explicit CodeWriter(PulseCode& out) : _out(out) { _out.length = 0; }
+
+    void byte(uint8_t value) {
+        if (_out.length < PULSE_CODE_MAX) {
+            _out.bytes[_out.length] = value;
+        }
+        _out.length++;
+        _lowNibble = false;
+    }
+
+    void varint(uint16_t value) {
+        while (value >= 0x80) {
+            byte((uint8_t)(value | 0x80));
+            value >>= 7;
+        }
+        byte((uint8_t)value);
+    }
+
+    void nibble(uint8_t value) {
+        if (!_lowNibble) {
+            byte((uint8_t)(value << 4));
+            _lowNibble = true;
+        } else {
+            if (_out.length <= PULSE_CODE_MAX) {
+                _out.bytes[_out.length - 1] |= value;
+            }
+            _lowNibble = false;
+        }
+    }
+
+    void nibbles(uint16_t value, uint8_t count) {
+        while (count-- > 0) {
+            nibble((value >> (count * 4)) & 0xF);
+        }
+    }
+
+    bool ok() const { return _out.length <= PULSE_CODE_MAX; }
+
+private:
+    PulseCode& _out;
+    bool _lowNibble = false;
+};
+
+bool encodePulses(const PulseTrain& train, PulseCode& out) {
+    static uint16_t units[IR_MAX_PULSES];
+    static uint16_t distinct[IR_MAX_PULSES];
+    static uint16_t uses[IR_MAX_PULSES];
+
+    out.length = 0;
+    if (train.count == 0 || train.count > IR_MAX_PULSES) {
+        return false;
+    }
+
+    // Cleaned durations first, then their quantized units in place
+
+    clusterDurations(train, units);
+    uint16_t unit = learnUnit(units, train.count);
+    uint16_t distinctCount = 0;
+    for (uint16_t i = 0; i < train.count; i++) {
+        units[i] = quantize(units[i], unit);
+        uint16_t d = 0;
+        while (d < distinctCount && distinct[d] != units[i]) {
+            d++;
+        }
+        if (d == distinctCount) {
+            distinct[distinctCount] = units[i];
+            uses[distinctCount++] = 0;
+        }
+        uses[d]++;
+    }
+
+    // Most used durations first; the rest are written as literals
+    uint16_t dict[PULSE_DICT_MAX];
+    uint8_t dictCount = 0;
+    while (dictCount < PULSE_DICT_MAX) {
+        uint16_t best = 0;
+        for (uint16_t d = 1; d < distinctCount; d++) {
+            if (uses[d] > uses[best]) {
+                best = d;
+            }
+        }
+        if (distinctCount == 0 || uses[best] == 0) {
+            break;
+        }
+        dict[dictCount++] = distinct[best];
+        uses[best] = 0;
+    }
+
+    CodeWriter writer(out);
+    writer.byte(PULSE_CODE_MAGIC);
+    writer.varint(unit);
+    writer.varint(train.count);
+    writer.byte(dictCount);
+    for (uint8_t d = 0; d < dictCount; d++) {
+        writer.varint(dict[d]);
+    }
+
+    uint16_t i = 0;
+    while (i < train.count) {
+        // Longest run that repeats the pulses just before it, e.g. a resent frame
+        uint16_t bestDistance = 0;
+        uint16_t bestLength = 0;
+        uint16_t maxDistance = i < PULSE_SPAN_MAX ? i : PULSE_SPAN_MAX;
+        for (uint16_t distance = 1; distance <= maxDistance && bestLength < PULSE_REPEAT_MAX; distance++) {
+            uint16_t length = 0;
+            while (i + length < train.count && length < PULSE_REPEAT_MAX &&
+                   units[i + length] == units[i + length - distance]) {
+                length++;
+            }
+            if (length > bestLength) {
+                bestLength = length;
+                bestDistance = distance;
+            }
+        }
+        if (bestLength >= PULSE_REPEAT_MIN_PULSES) {
+            writer.nibble(PULSE_NIBBLE_REPEAT);
+            writer.nibbles(bestDistance, 2);
+            writer.nibbles(bestLength, 2);
+            i += bestLength;
+            continue;
+        }
+
+        uint8_t d = 0;
+        while (d < dictCount && dict[d] != units[i]) {
+            d++;
+        }
+        if (d < dictCount) {
+            writer.nibble(d);
+        } else {
+            writer.nibble(PULSE_NIBBLE_LITERAL);
+            writer.nibbles(units[i], 4);
+        }
+        i++;
+    }
+
+    if (!writer.ok()) {
+        out.length = 0;
+        return false;
+    }
+    return true;
+}
+
+bool PulseDecoder::begin(const uint8_t* code, uint16_t length) {
+    _code = code;
+    _length = length;
+    _position = 0;
+    _lowNibble = false;
+    _emitted = 0;
+    _head = 0;
+    _distance = 0;
+    _copyRemaining = 0;
+    _count = 0;
+
+    if (length == 0 || code[_position++] != PULSE_CODE_MAGIC || !readVarint(_unit) || !readVarint(_count) ||
+        _unit == 0 || _position >= _length) {
+        _count = 0;
+        return false;
+    }
+    _dictCount = code[_position++];
+    if (_dictCount > PULSE_DICT_MAX) {
+        _count = 0;
+        return false;
+    }
+    for (uint8_t d = 0; d < _dictCount; d++) {
+        if (!readVarint(_dict[d])) {
+            _count = 0;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool PulseDecoder::readVarint(uint16_t& value) {
+    uint32_t result = 0;
+    for (uint8_t shift = 0; shift < 21; shift += 7) {
+        if (_position >= _length) {
+            return false;
+        }
+        uint8_t byte = _code[_position++];
+        result |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            value = (uint16_t)result;
+            return result <= 0xFFFF;
+        }
+    }
+    return false;
+}
+
+bool PulseDecoder::readNibble(uint8_t& nibble) {
+    if (_position >= _length) {
+        return false;
+    }
+    if (!_lowNibble) {
+        nibble = _code[_position] >> 4;
+        _lowNibble = true;
+    } else {
+        nibble = _code[_position++] & 0xF;
+        _lowNibble = false;
+    }
+    return true;
+}
+
+bool PulseDecoder::readNibbles(uint8_t count, uint16_t& value) {
+    value = 0;
+    uint8_t nibble;
+    while (count-- > 0) {
+        if (!readNibble(nibble)) {
+            return false;
+        }
+        value = (uint16_t)((value << 4) | nibble);
+    }
+    return true;
+}
+
+uint16_t PulseDecoder::emit(uint16_t units) {
+    _history[_head++ % PULSE_SPAN_MAX] = units;
+    _emitted++;
+    uint32_t duration = (uint32_t)units * _unit;
+    return duration > 0xFFFF ? 0xFFFF : (uint16_t)duration;
+}
+
+bool PulseDecoder::next(uint16_t& duration) {
+    if (_emitted >= _count) {
+        return false;
+    }
+
+    if (_copyRemaining == 0) {
+        uint8_t token;
+        if (!readNibble(token)) {
+            return false;
+        }
+        if (token < _dictCount) {
+            duration = emit(_dict[token]);
+            return true;
+        }
+        uint16_t value;
+        if (token == PULSE_NIBBLE_LITERAL) {
+            if (!readNibbles(4, value) || value == 0) {
+                return false;
+            }
+            duration = emit(value);
+            return true;
+        }
+        uint16_t length;
+        if (token != PULSE_NIBBLE_REPEAT || !readNibbles(2, value) || !readNibbles(2, length) ||
+            value == 0 || value > PULSE_SPAN_MAX || value > _emitted || length == 0) {
+            return false;
+        }
+        _distance = (uint8_t)value;
+        _copyRemaining = length;
+    }
+
+    _copyRemaining--;
+    duration = emit(_history[(uint8_t)(_head - _distance) % PULSE_SPAN_MAX]);
+    return true;
+}
+
+bool decodePulses(const uint8_t* code, uint16_t length, PulseTrain& out) {
+    static PulseDecoder decoder;
+    out.startUs = 0;
+    out.count = 0;
+    if (!decoder.begin(code, length) || decoder.pulseCount() > IR_MAX_PULSES) {
+        return false;
+    }
+    uint16_t duration;
+    while (decoder.next(duration)) {
+        out.durations[out.count++] = duration;
+    }
+    return out.count == decoder.pulseCount() && out.count > 0;
+}
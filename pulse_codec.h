@@ -0,0 +1,84 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "frame_assembler.h"
+
+// Compact storage form for raw mark/space timings.
+//
+//   magic, varint unit (us), varint pulse count,
+//   dictionary size, dictionary entries (varint units),
+//   nibble stream, high nibble first:
+//     0x0-0xD  dictionary entry
+//     0xE      literal: the next 4 nibbles are the duration in units
+//     0xF      repeat: the next 2 nibbles are a distance d, the 2 after
+//              that a length n; n pulses are copied from d pulses back,
+//              so n > d repeats the span
+//
+// Jittered durations are merged into clusters and quantized to a unit
+// learned from the capture, so the repeated frames of a held button
+// compress to one repeat token.
+
+#define PULSE_CODE_MAGIC 0xC7
+#define PULSE_DICT_MAX 14
+#define PULSE_SPAN_MAX 128             // Decoder history and furthest repeat, in pulses
+
+#ifndef PULSE_UNIT_MIN_US
+#define PULSE_UNIT_MIN_US 16           // Finest quantization, used when nothing coarser fits
+#endif
+
+#ifndef PULSE_TOLERANCE_US
+#define PULSE_TOLERANCE_US 60          // Jitter and quantization error always accepted
+#endif
+
+#ifndef PULSE_TOLERANCE_PCT
+#define PULSE_TOLERANCE_PCT 8          // Or this share of the duration, if larger
+#endif
+
+// Worst case: full dictionary and a literal for every pulse
+#define PULSE_CODE_MAX (8 + PULSE_DICT_MAX * 3 + (IR_MAX_PULSES * 5 + 1) / 2)
+
+struct PulseCode {
+    uint16_t length;
+    uint8_t bytes[PULSE_CODE_MAX];
+};
+
+bool encodePulses(const PulseTrain& train, PulseCode& out);
+
+// Yields the durations of a code one at a time, so a consumer never needs
+// the expanded train.
+class PulseDecoder {
+public:
+    bool begin(const uint8_t* code, uint16_t length);
+
+    // Returns false at the end of the train or on a corrupt code.
+    bool next(uint16_t& duration);
+
+    uint16_t pulseCount() const { return _count; }
+    uint16_t unitUs() const { return _unit; }
+
+private:
+    bool readNibble(uint8_t& nibble);
+    bool readNibbles(uint8_t count, uint16_t& value);
+    bool readVarint(uint16_t& value);
+    uint16_t emit(uint16_t units);
+
+    const uint8_t* _code = nullptr;
+    uint16_t _length = 0;
+    uint16_t _position = 0;
+    bool _lowNibble = false;
+
+    uint16_t _unit = 0;
+    uint16_t _count = 0;
+    uint16_t _emitted = 0;
+    uint8_t _dictCount = 0;
+    uint16_t _dict[PULSE_DICT_MAX];
+
+    uint16_t _history[PULSE_SPAN_MAX];
+    uint8_t _head = 0;
+    uint8_t _distance = 0;
+    uint16_t _copyRemaining = 0;
+};
+
+// Expands a whole code, for callers that do need the train.
+bool decodePulses(const uint8_t* code, uint16_t length, PulseTrain& out);
@@ -0,0 +1,354 @@
+#include "radio_hardware.h"
+
+#include <Arduino.h>
+#include <RF24.h>
+
+#include "ir_capture.h"
+#include "ir_transmit.h"
+#include "rf433_capture.h"
+#include "rf433_transmit.h"
+
+#define RF24_PAYLOAD_SIZE 32
+
+// Only the radio task may use these once it is running
+static IrTransmitter irTransmitter;
+static IrCapture irCapture;
+static RF24 radio(RF_CE_PIN, RF_CS_PIN);
+static Rf433Capture rf433Capture;
+static Rf433Transmitter rf433Transmitter;
+static Rf433Burst rf433Burst;
+
+bool HardwareRadioBackend::begin(uint8_t band) {
+    switch (band) {
+    case BAND_IR:
+        irCapture.begin(IR_RECEIVE_PIN);
+        return irTransmitter.begin(IR_SEND_PIN);
+    case BAND_RF24:
+        _rf24Ready = radio.begin();
+        if (_rf24Ready) {
+            radio.setPALevel(RF24_PA_LOW);
+            configureRf24();
+        }
+        return _rf24Ready;
+    case BAND_RF433:
+        rf433Capture.begin(RF_433_RECEIVE_PIN);
+        return rf433Transmitter.begin(RF_433_SEND_PIN);
+    }
+    return false;
+}
+
+uint32_t HardwareRadioBackend::nowUs() {
+    return micros();
+}
+
+// The setup begin() leaves the chip in, restored after sniffing and scanning
+void HardwareRadioBackend::configureRf24() {
+    radio.setChannel(_rf24Channel);
+    radio.setDataRate(RF24_1MBPS);
+    radio.setAutoAck(_txConfig.autoAck);
+    radio.setRetries(_txConfig.retryDelay, _txConfig.retryCount);
+    if (_txConfig.dynamicPayloads) {
+        radio.enableDynamicPayloads();
+    } else {
+        radio.disableDynamicPayloads();
+        radio.setPayloadSize(RF24_PAYLOAD_SIZE);
+    }
+    radio.setAddressWidth(RF24_ADDRESS_WIDTH);
+    for (uint8_t pipe = 2; pipe < RF24_PIPES; pipe++) {
+        radio.closeReadingPipe(pipe);
+    }
+    _rf24DynamicPayloads = _txConfig.dynamicPayloads;
+    _rf24PayloadSize = RF24_PAYLOAD_SIZE;
+}
+
+void HardwareRadioBackend::setListening(uint8_t listenMask) {
+    if (!(listenMask & RADIO_LISTEN_IR)) {
+        irCapture.flush();
+    }
+    if (!(listenMask & RADIO_LISTEN_RF433)) {
+        rf433Capture.flush();
+    }
+    _rf24Listening = _rf24Ready && (listenMask & RADIO_LISTEN_RF24);
+    if (rf24Retuning()) {
+        return;
+    }
+    if (_rf24Listening) {
+        radio.startListening();
+    } else if (_rf24Ready) {
+        radio.stopListening();
+    }
+}
+
+bool HardwareRadioBackend::readIrFrame(PulseTrain& frame) {
+    irCapture.service();
+    return irCapture.read(frame);
+}
+
+bool HardwareRadioBackend::readRf24(uint8_t* payload, uint8_t& length) {
+    if (!_rf24Listening || !radio.available()) {
+        return false;
+    }
+    // A full FIFO turns new packets away, so at least one was missed
+    if (radio.rxFifoFull()) {
+        _rf24Overruns++;
+    }
+    length = _rf24DynamicPayloads ? radio.getDynamicPayloadSize() : RF24_PAYLOAD_SIZE;
+    if (length == 0 || length > RF24_PAYLOAD_SIZE) {
+        // Corrupt dynamic length; the library has already flushed the FIFO
+        return false;
+    }
+    radio.read(payload, length);
+    return true;
+}
+
+bool HardwareRadioBackend::readRf433(PulseTrain& train, uint8_t& repeats) {
+    rf433Capture.service();
+    if (!rf433Capture.read(rf433Burst)) {
+        return false;
+    }
+    train = rf433Burst.train;
+    repeats = rf433Burst.repeats;
+    return true;
+}
+
+uint32_t HardwareRadioBackend::dropped(uint8_t band) {
+    switch (band) {
+    case BAND_IR:
+        return irCapture.droppedEdges() + irCapture.droppedFrames();
+    case BAND_RF24:
+        return _rf24Overruns;
+    case BAND_RF433:
+        return rf433Capture.droppedEdges() + rf433Capture.droppedBursts();
+    }
+    return 0;
+}
+
+uint32_t HardwareRadioBackend::irWaitUs() {
+    return irTransmitter.waitUs();
+}
+
+bool HardwareRadioBackend::sendIr(const IrWaveform& waveform, bool repeat) {
+    return irTransmitter.send(waveform, repeat);
+}
+
+bool HardwareRadioBackend::sendRf433(const IrWaveform& waveform, uint8_t repeats) {
+    rf433Transmitter.send(waveform, repeats);
+    return true;
+}
+
+bool HardwareRadioBackend::startRf24Sniff(const Rf24SniffConfig& config) {
+    if (!_rf24Ready) {
+        return false;
+    }
+    radio.stopListening();
+    _sniffConfig = config;
+    applySniff();
+    radio.setChannel(config.firstChannel);
+    radio.flush_rx();
+    radio.startListening();
+    _rf24Sniffing = true;
+    return true;
+}
+
+void HardwareRadioBackend::applySniff() {
+    const Rf24SniffConfig& config = _sniffConfig;
+    radio.setAutoAck(false);
+    radio.setDataRate((rf24_datarate_e)config.dataRate);
+    radio.setAddressWidth(RF24_ADDRESS_WIDTH);
+    _rf24DynamicPayloads = config.dynamicPayloads;
+    _rf24PayloadSize = config.payloadSize && config.payloadSize <= RF24_MAX_PAYLOAD ? config.payloadSize
+                                                                                    : RF24_MAX_PAYLOAD;
+    if (_rf24DynamicPayloads) {
+        radio.enableDynamicPayloads();
+    } else {
+        radio.disableDynamicPayloads();
+        radio.setPayloadSize(_rf24PayloadSize);
+    }
+    radio.openReadingPipe(0, config.pipe0Address);
+    radio.openReadingPipe(1, config.pipe1Address);
+    for (uint8_t pipe = 2; pipe < RF24_PIPES; pipe++) {
+        radio.openReadingPipe(pipe, &config.pipeLsb[pipe - 2]);
+    }
+}
+
+void HardwareRadioBackend::stopRf24Sniff() {
+    if (!_rf24Sniffing) {
+        return;
+    }
+    radio.stopListening();
+    configureRf24();
+    _rf24Sniffing = false;
+}
+
+void HardwareRadioBackend::setRf24Channel(uint8_t channel) {
+    // The chip only retunes in standby
+    radio.stopListening();
+    radio.setChannel(channel);
+    radio.startListening();
+    _rf24Tuned = channel;
+}
+
+bool HardwareRadioBackend::readRf24Packet(Rf24Packet& packet) {
+    uint8_t pipe;
+    if (!_rf24Sniffing || !radio.available(&pipe)) {
+        return false;
+    }
+    packet.fifoFull = radio.rxFifoFull();
+    packet.pipe = pipe;
+    packet.length = _rf24DynamicPayloads ? radio.getDynamicPayloadSize() : _rf24PayloadSize;
+    if (packet.length == 0 || packet.length > RF24_MAX_PAYLOAD) {
+        // Corrupt dynamic length; the library has already flushed the FIFO
+        packet.length = 0;
+        return true;
+    }
+    radio.read(packet.payload, packet.length);
+    return true;
+}
+
+bool HardwareRadioBackend::startRf24Scan() {
+    if (!_rf24Ready) {
+        return false;
+    }
+    radio.stopListening();
+    applyScan();
+    radio.flush_rx();
+    _rf24Tuned = _rf24Channel;
+    _rf24Scanning = true;
+    return true;
+}
+
+void HardwareRadioBackend::applyScan() {
+    radio.setAutoAck(false);
+    // The narrower receive filter keeps a carrier from spilling into neighbours
+    radio.setDataRate(RF24_1MBPS);
+}
+
+void HardwareRadioBackend::stopRf24Scan() {
+    if (!_rf24Scanning) {
+        return;
+    }
+    radio.stopListening();
+    radio.flush_rx();
+    configureRf24();
+    _rf24Scanning = false;
+}
+
+bool HardwareRadioBackend::readRf24Carrier() {
+    if (!_rf24Scanning) {
+        return false;
+    }
+    // The detector latches while listening and is read back in standby
+    radio.stopListening();
+    return radio.testRPD();
+}
+
+void HardwareRadioBackend::selectRf24Channel(uint8_t channel) {
+    _rf24Channel = channel < RF24_CHANNELS ? channel : RF24_CHANNELS - 1;
+    if (!_rf24Ready || rf24Retuning()) {
+        return;
+    }
+    radio.stopListening();
+    radio.setChannel(_rf24Channel);
+    if (_rf24Listening) {
+        radio.startListening();
+    }
+}
+
+void HardwareRadioBackend::setRf24Tx(const Rf24TxConfig& config) {
+    _txConfig = config;
+    if (!_rf24Ready || rf24Retuning()) {
+        return;
+    }
+    radio.stopListening();
+    configureRf24();
+    if (_rf24Listening) {
+        radio.startListening();
+    }
+}
+
+bool HardwareRadioBackend::beginRf24Tx() {
+    if (!_rf24Ready) {
+        return false;
+    }
+    radio.stopListening();
+    // Sniffing and scanning change far more than the channel; transmits use
+    // the normal setup and endRf24Tx() puts theirs back
+    if (rf24Retuning()) {
+        configureRf24();
+    }
+    radio.flush_tx();
+    return true;
+}
+
+bool HardwareRadioBackend::queueRf24(const uint8_t* payload, uint8_t length) {
+    if (radio.isFifo(true, false)) {
+        return false;
+    }
+    // Returns at once with room in the FIFO; false while a failed packet blocks it
+    return radio.writeFast(payload, length);
+}
+
+void HardwareRadioBackend::pollRf24Tx(Rf24TxStatus& status) {
+    // Empty first: anything that left before this read has its flag set by now
+    status.empty = radio.isFifo(true, true);
+    bool received;
+    radio.whatHappened(status.acked, status.failed, received);
+    status.retries = radio.getARC();
+    if (status.failed) {
+        radio.flush_tx();
+    }
+}
+
+void HardwareRadioBackend::endRf24Tx() {
+    radio.stopListening();
+    radio.flush_tx();
+    if (_rf24Sniffing) {
+        applySniff();
+    } else if (_rf24Scanning) {
+        applyScan();
+    }
+    if (rf24Retuning()) {
+        radio.setChannel(_rf24Tuned);
+    }
+    if (_rf24Listening || rf24Retuning()) {
+        radio.startListening();
+    }
+}
+
+// A delay lasts until the next tick, however far off it is. At the nRF24's
+// full rate three packets fill its FIFO in under a tick, so a busy mode
+// keeps polling until the tick is nearly over.
+static void stepUntilLateInTick(RadioService& service) {
+    TickType_t tick = xTaskGetTickCount();
+    while (xTaskGetTickCount() == tick) {
+        service.step();
+    }
+    uint32_t tickStart = micros();
+    while (micros() - tickStart < portTICK_PERIOD_MS * 1000 - RADIO_YIELD_US) {
+        service.step();
+    }
+}
+
+static void radioTaskLoop(void* parameter) {
+    RadioService* service = (RadioService*)parameter;
+    uint32_t sliceStart = micros();
+    for (;;) {
+        service->step();
+        // The nRF24 FIFO is three packets deep, so busy modes poll without
+        // sleeping, giving up one tick per slice to keep the idle task fed
+        if (service->busy() && micros() - sliceStart < RADIO_BUSY_SLICE_US) {
+            taskYIELD();
+            continue;
+        }
+        if (service->busy()) {
+            stepUntilLateInTick(*service);
+        }
+        vTaskDelay(1);
+        sliceStart = micros();
+    }
+}
+
+bool startRadioTask(RadioService& service) {
+    return xTaskCreatePinnedToCore(radioTaskLoop, "radio", RADIO_TASK_STACK, &service,
+                                   RADIO_TASK_PRIORITY, nullptr, RADIO_TASK_CORE) == pdPASS;
+}
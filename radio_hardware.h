@@ -0,0 +1,82 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "radio_service.h"
+
+#define IR_RECEIVE_PIN 35
+#define IR_SEND_PIN 9
+#define RF_CE_PIN 15
+#define RF_CS_PIN 5
+#define RF_433_RECEIVE_PIN 2
+#define RF_433_SEND_PIN 3
+
+#ifndef RADIO_TASK_CORE
+#define RADIO_TASK_CORE 0          // Arduino loop() runs on core 1
+#endif
+
+#ifndef RADIO_TASK_STACK
+#define RADIO_TASK_STACK 8192
+#endif
+
+#ifndef RADIO_TASK_PRIORITY
+#define RADIO_TASK_PRIORITY 2
+#endif
+
+#ifndef RADIO_BUSY_SLICE_US
+#define RADIO_BUSY_SLICE_US 50000  // Continuous polling before one tick off for the idle task
+#endif
+
+#ifndef RADIO_YIELD_US
+#define RADIO_YIELD_US 200         // Left of the tick when that tick off starts
+#endif
+
+// RadioBackend on the real IR, nRF24 and 433 MHz peripherals.
+class HardwareRadioBackend : public RadioBackend {
+public:
+    bool begin(uint8_t band) override;
+    uint32_t nowUs() override;
+    void setListening(uint8_t listenMask) override;
+    bool readIrFrame(PulseTrain& frame) override;
+    bool readRf24(uint8_t* payload, uint8_t& length) override;
+    uint32_t irWaitUs() override;
+    bool sendIr(const IrWaveform& waveform, bool repeat) override;
+    uint32_t dropped(uint8_t band) override;
+    bool readRf433(PulseTrain& train, uint8_t& repeats) override;
+    bool sendRf433(const IrWaveform& waveform, uint8_t repeats) override;
+    bool startRf24Sniff(const Rf24SniffConfig& config) override;
+    void stopRf24Sniff() override;
+    void setRf24Channel(uint8_t channel) override;
+    bool readRf24Packet(Rf24Packet& packet) override;
+    bool startRf24Scan() override;
+    void stopRf24Scan() override;
+    bool readRf24Carrier() override;
+    void selectRf24Channel(uint8_t channel) override;
+    void setRf24Tx(const Rf24TxConfig& config) override;
+    bool beginRf24Tx() override;
+    bool queueRf24(const uint8_t* payload, uint8_t length) override;
+    void pollRf24Tx(Rf24TxStatus& status) override;
+    void endRf24Tx() override;
+
+private:
+    void configureRf24();
+    void applySniff();
+    void applyScan();
+    bool rf24Retuning() const { return _rf24Sniffing || _rf24Scanning; }
+
+    bool _rf24Ready = false;
+    bool _rf24Listening = false;
+    bool _rf24Sniffing = false;
+    bool _rf24Scanning = false;
+    uint8_t _rf24Channel = RF24_DEFAULT_CHANNEL;   // Selected for listening and transmits
+    uint8_t _rf24Tuned = RF24_DEFAULT_CHANNEL;     // Where a sniff or scan has the receiver now
+    uint32_t _rf24Overruns = 0;                    // Reads that found the RX FIFO full
+    bool _rf24DynamicPayloads = false;
+    uint8_t _rf24PayloadSize = RF24_MAX_PAYLOAD;
+    Rf24SniffConfig _sniffConfig = {};
+    Rf24TxConfig _txConfig = {RF24_TX_RETRY_DELAY, RF24_TX_RETRY_COUNT, true, false, RF24_TX_RESENDS};
+};
+
+// Runs service.step() forever on a FreeRTOS task pinned to RADIO_TASK_CORE,
+// once per tick, or continuously while the service is busy.
+bool startRadioTask(RadioService& service);
@@ -0,0 +1,282 @@
+#include "radio_service.h"
+
+#include <string.h>
+
+#include "ir_codec.h"
+#include "trace.h"
+
+void RadioService::step() {
+    while (_commandWaiting || _commands.pop(_command)) {
+        _commandWaiting = !execute(_command);
+        if (_commandWaiting) {
+            break;
+        }
+    }
+    _irDue = _commandWaiting && _backend.irWaitUs() <= RADIO_MACRO_SPIN_US;
+    playMacro();
+    // A transmit borrows the nRF24 from sniffing or scanning until it is done
+    _rf24Tx.service(_backend);
+    while (_rf24Tx.popResult(_txResult)) {
+        _event.type = RADIO_TRANSMITTED;
+        _event.band = BAND_RF24;
+        _event.ok = _txResult.ok;
+        _event.hasFrame = false;
+        _event.timestampUs = _backend.nowUs();
+        _event.packets = _txResult.packets;
+        _event.retries = _txResult.retries;
+        recordClear(_event.record, "");
+        _event.record.band = BAND_RF24;
+        _events.push(_event);
+    }
+    if (_rf24Tx.idle()) {
+        _sniffer.service(_backend);
+        _spectrum.service(_backend);
+    }
+    pollReceivers();
+}
+
+bool RadioService::execute(const RadioCommand& command) {
+    TRACE_SCOPE(TRACE_RADIO_COMMAND, command.type);
+    if (command.type == RADIO_SET_LISTEN) {
+        _listenMask = command.listenMask;
+        _backend.setListening(_listenMask);
+        return true;
+    }
+    if (command.type == RADIO_SET_RF24_CHANNEL) {
+        _backend.selectRf24Channel(command.channel);
+        return true;
+    }
+    if (command.type == RADIO_SET_RF24_TX) {
+        _backend.setRf24Tx(command.rf24Tx);
+        _rf24Tx.configure(command.rf24Tx);
+        return true;
+    }
+    // The sniffer and the spectrum scan share the nRF24 receiver, so starting
+    // one stops the other
+    if (command.type == RADIO_SNIFF_START) {
+        _spectrum.stop(_backend);
+        _event.type = RADIO_SNIFF_STARTED;
+        _event.band = BAND_RF24;
+        _event.ok = _sniffer.start(command.sniff, _backend);
+        _event.hasFrame = false;
+        _event.timestampUs = _backend.nowUs();
+        recordClear(_event.record, "");
+        _events.push(_event);
+        return true;
+    }
+    if (command.type == RADIO_SPECTRUM_START) {
+        _sniffer.stop(_backend);
+        _event.type = RADIO_SPECTRUM_STARTED;
+        _event.band = BAND_RF24;
+        _event.ok = _spectrum.start(command.spectrum, _backend);
+        _event.hasFrame = false;
+        _event.timestampUs = _backend.nowUs();
+        recordClear(_event.record, "");
+        _events.push(_event);
+        return true;
+    }
+    if (command.type == RADIO_SNIFF_STOP) {
+        _sniffer.stop(_backend);
+        _backend.setListening(_listenMask);
+        return true;
+    }
+    if (command.type == RADIO_SPECTRUM_STOP) {
+        _spectrum.stop(_backend);
+        _backend.setListening(_listenMask);
+        return true;
+    }
+
+    if (command.type == RADIO_MACRO_START) {
+        if (_macro.active()) {
+            endMacro(false);
+        }
+        _macroOk = true;
+        _macro.start(*command.macro, _backend.nowUs());
+        return true;
+    }
+    if (command.type == RADIO_MACRO_STOP) {
+        if (_macro.active()) {
+            endMacro(false);
+        }
+        return true;
+    }
+
+    // A press sends its frame as many times as it was heard; a held
+    // button's repeat frame goes once
+    const ButtonRecord& record = command.record;
+    if (record.band == BAND_IR && !_commandWaiting) {
+        _irFramesLeft = command.irRepeat ? 1 : recordRepeats(record);
+    }
+    if (record.band == BAND_IR && _backend.irWaitUs() > 0) {
+        return false;
+    }
+    bool ok = transmit(record, command.waveform, command.irRepeat, command.message, command.messageLength);
+    if (ok && record.band == BAND_IR && --_irFramesLeft > 0) {
+        return false;
+    }
+    // nRF24 sends are reported from step() once every packet is settled
+    if (ok && record.band == BAND_RF24) {
+        return true;
+    }
+
+    _event.type = RADIO_TRANSMITTED;
+    _event.band = record.band;
+    _event.ok = ok;
+    _event.hasFrame = false;
+    _event.timestampUs = _backend.nowUs();
+    _event.packets = 0;
+    _event.retries = 0;
+    _event.record = record;
+    _events.push(_event);
+    return true;
+}
+
+bool RadioService::transmit(const ButtonRecord& record, const IrWaveform& waveform, bool irRepeat,
+                            const uint8_t* message, uint16_t messageLength) {
+    switch (record.band) {
+    case BAND_IR:
+        if (waveform.frameSymbols > 0) {
+            return _backend.sendIr(waveform, irRepeat);
+        }
+        break;
+    case BAND_RF24:
+        return _rf24Tx.submit(message, messageLength);
+    case BAND_RF433:
+        if (waveform.frameSymbols > 0) {
+            return _backend.sendRf433(waveform, recordRepeats(record));
+        }
+        break;
+    }
+    return false;
+}
+
+// Sends whatever is due straight from the compiled schedule; nothing else
+// happens between the sends of one step
+void RadioService::playMacro() {
+    if (!_macro.active()) {
+        _macroDue = false;
+        return;
+    }
+    const MacroSchedule& schedule = *_macro.schedule();
+    const MacroEvent* event;
+    uint32_t irWaitUs = 0;
+    while ((event = _macro.next()) != nullptr) {
+        const ButtonRecord& record = schedule.records[event->button];
+        // An IR send also waits out the period of the frame before it
+        irWaitUs = record.band == BAND_IR ? _backend.irWaitUs() : 0;
+        if (irWaitUs > 0 || !_macro.due(_backend.nowUs())) {
+            break;
+        }
+        _macroOk = transmit(record, schedule.waveforms[event->button], event->irRepeat, record.payload,
+                            record.payloadLength) && _macroOk;
+    }
+    if (_macro.done()) {
+        endMacro(_macroOk);
+        return;
+    }
+    uint32_t waitUs = _macro.waitUs(_backend.nowUs());
+    _macroDue = (waitUs > irWaitUs ? waitUs : irWaitUs) <= RADIO_MACRO_SPIN_US;
+}
+
+void RadioService::endMacro(bool ok) {
+    _event.type = RADIO_MACRO_DONE;
+    _event.band = BAND_IR;
+    _event.ok = ok;
+    _event.hasFrame = false;
+    _event.timestampUs = _backend.nowUs();
+    _event.lateUs = _macro.maxLateUs();
+    recordClear(_event.record, "");
+    _events.push(_event);
+    _macro.stop();
+    _macroDue = false;
+}
+
+// Every armed band gives up at most one capture per round, so a busy
+// receiver cannot starve the others, and each round goes out in the order
+// the frames started. Rounds stop while the event ring could not take a
+// whole one; captures then wait in the receivers' own queues.
+void RadioService::pollReceivers() {
+    for (uint8_t round = 0; round < RADIO_POLL_ROUNDS; round++) {
+        if (_events.capacity() - _events.size() < RADIO_BANDS) {
+            break;
+        }
+        uint8_t pending = 0;
+        for (uint8_t band = 0; band < RADIO_BANDS; band++) {
+            _captured[band] = (_listenMask & (1 << band)) && readCapture(band, _captures[band]);
+            pending += _captured[band];
+        }
+        if (pending == 0) {
+            break;
+        }
+        for (; pending > 0; pending--) {
+            uint8_t oldest = RADIO_BANDS;
+            for (uint8_t band = 0; band < RADIO_BANDS; band++) {
+                if (_captured[band] && (oldest == RADIO_BANDS ||
+                                        (int32_t)(_captures[band].timestampUs - _captures[oldest].timestampUs) < 0)) {
+                    oldest = band;
+                }
+            }
+            _captured[oldest] = false;
+            _events.push(_captures[oldest]);
+            TRACE_INSTANT(TRACE_RADIO_CAPTURE, oldest);
+        }
+    }
+
+    for (uint8_t band = 0; band < RADIO_BANDS; band++) {
+        _capturesDropped[band].store(_backend.dropped(band), std::memory_order_relaxed);
+    }
+}
+
+bool RadioService::readCapture(uint8_t band, RadioEvent& event) {
+    event.type = RADIO_CAPTURED;
+    event.band = band;
+    event.ok = true;
+
+    if (band == BAND_IR) {
+        while (_backend.readIrFrame(event.frame)) {
+            IrCode code;
+            decodeIr(event.frame, code);
+            // Repeat codes only say a button is still held
+            if (code.repeat) {
+                continue;
+            }
+            event.hasFrame = code.protocol == IR_PROTO_RAW;
+            event.timestampUs = event.frame.startUs;
+            recordClear(event.record, "");
+            recordFromIrCode(event.record, code);
+            return true;
+        }
+        return false;
+    }
+
+    if (band == BAND_RF24) {
+        // While sniffing, scanning or transmitting, the nRF24 receiver is not ours
+        uint8_t length = 0;
+        if (rf24Borrowed()) {
+            return false;
+        }
+        recordClear(event.record, "");
+        if (!_backend.readRf24(event.record.payload, length)) {
+            return false;
+        }
+        event.hasFrame = false;
+        event.timestampUs = _backend.nowUs();
+        event.record.band = BAND_RF24;
+        event.record.payloadLength = length;
+        return true;
+    }
+
+    uint8_t repeats;
+    if (!_backend.readRf433(event.frame, repeats)) {
+        return false;
+    }
+    // Replayed from the timings; the decode names it and keeps a fallback
+    // for when they are lost
+    Rf433Code code;
+    decodeRf433(event.frame, code);
+    event.hasFrame = true;
+    event.timestampUs = event.frame.startUs;
+    recordClear(event.record, "");
+    recordFromRf433Code(event.record, code, repeats);
+    return true;
+}
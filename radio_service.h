@@ -0,0 +1,208 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+#include "button_record.h"
+#include "frame_assembler.h"
+#include "ir_waveform.h"
+#include "macro.h"
+#include "rf433_codec.h"
+#include "rf24_sniffer.h"
+#include "rf24_spectrum.h"
+#include "rf24_tx_queue.h"
+#include "spsc_ring.h"
+
+#ifndef RADIO_COMMAND_QUEUE_SIZE
+#define RADIO_COMMAND_QUEUE_SIZE 8
+#endif
+
+#ifndef RADIO_EVENT_QUEUE_SIZE
+#define RADIO_EVENT_QUEUE_SIZE 8
+#endif
+
+#ifndef RADIO_POLL_ROUNDS
+#define RADIO_POLL_ROUNDS 4            // Captures taken per band each step
+#endif
+
+#ifndef RADIO_MACRO_SPIN_US
+#define RADIO_MACRO_SPIN_US 2000       // Poll continuously once a macro or waiting IR send is this close
+#endif
+
+#define RADIO_BANDS (BAND_RF433 + 1)
+#define RADIO_LISTEN_IR (1 << BAND_IR)
+#define RADIO_LISTEN_RF24 (1 << BAND_RF24)
+#define RADIO_LISTEN_RF433 (1 << BAND_RF433)
+#define RADIO_LISTEN_ALL (RADIO_LISTEN_IR | RADIO_LISTEN_RF24 | RADIO_LISTEN_RF433)
+
+enum RadioCommandType : uint8_t {
+    RADIO_TRANSMIT,                // Send `record` on its band: IR and 433 MHz from `waveform`, nRF24 from `message`
+    RADIO_SET_LISTEN,              // Arm the receivers in `listenMask`
+    RADIO_SNIFF_START,             // Capture nRF24 traffic as set up in `sniff`
+    RADIO_SNIFF_STOP,              // Back to normal nRF24 listening
+    RADIO_SPECTRUM_START,          // Sweep nRF24 channels as set up in `spectrum`
+    RADIO_SPECTRUM_STOP,           // Back to normal nRF24 listening
+    RADIO_SET_RF24_CHANNEL,        // Listen and transmit on `channel` from now on
+    RADIO_SET_RF24_TX,             // Retransmit and payload settings in `rf24Tx`
+    RADIO_MACRO_START,             // Play `macro`, which stays untouched until RADIO_MACRO_DONE
+    RADIO_MACRO_STOP
+};
+
+struct RadioCommand {
+    RadioCommandType type;
+    uint8_t listenMask;
+    bool irRepeat;                 // Send the repeat frame of a held button
+    uint8_t channel;
+    ButtonRecord record;
+    IrWaveform waveform;
+    Rf24SniffConfig sniff;
+    Rf24SpectrumConfig spectrum;
+    Rf24TxConfig rf24Tx;
+    const MacroSchedule* macro;
+    uint16_t messageLength;
+    uint8_t message[RF24_MESSAGE_MAX];
+};
+
+enum RadioEventType : uint8_t {
+    RADIO_CAPTURED,                // `record` holds a received frame, raw IR and 433 MHz timings in `frame`;
+                                   // `timestampUs` is when it started, so captures from every band sort together
+    RADIO_TRANSMITTED,             // `ok` reports whether the send succeeded
+    RADIO_SNIFF_STARTED,           // `ok` reports whether the receiver took the setup
+    RADIO_SPECTRUM_STARTED,        // `ok` reports whether the scan could start
+    RADIO_MACRO_DONE               // `ok` is false if a send failed or it was stopped; `lateUs` is the worst delay
+};
+
+struct RadioEvent {
+    RadioEventType type;
+    uint8_t band;
+    bool ok;
+    bool hasFrame;                 // `frame` holds timings worth storing (raw IR, every 433 MHz burst)
+    uint32_t timestampUs;
+    uint8_t packets;               // nRF24 transmits: packets sent and auto-retransmits needed
+    uint16_t retries;
+    uint32_t lateUs;
+    ButtonRecord record;
+    PulseTrain frame;
+};
+
+// Everything the service needs from the receivers and transmitters. The
+// firmware implements it on the real peripherals; a host can fake it.
+class RadioBackend {
+public:
+    virtual ~RadioBackend() {}
+    // Powers up one band's hardware. Called once at boot, before step() runs.
+    virtual bool begin(uint8_t band) = 0;
+    virtual uint32_t nowUs() = 0;
+    virtual void setListening(uint8_t listenMask) = 0;
+    virtual bool readIrFrame(PulseTrain& frame) = 0;
+    virtual bool readRf24(uint8_t* payload, uint8_t& length) = 0;
+
+    // IR frames keep their protocol's start-to-start period. irWaitUs() is
+    // the time until the next may start; sendIr() returns false without
+    // sending while it is not 0.
+    virtual uint32_t irWaitUs() = 0;
+    virtual bool sendIr(const IrWaveform& waveform, bool repeat) = 0;
+
+    // Captures a band's receiver lost since boot because its queue was full.
+    virtual uint32_t dropped(uint8_t band) = 0;
+
+    // 433 MHz bursts as the receiver heard them: `train` once, or `repeats`
+    // times over, ending with its sync gap. Sending plays a compiled train
+    // the same way.
+    virtual bool readRf433(PulseTrain& train, uint8_t& repeats) = 0;
+    virtual bool sendRf433(const IrWaveform& waveform, uint8_t repeats) = 0;
+
+    // nRF24 capture: every pipe open, auto-ack off so the sniffer never
+    // answers. stopRf24Sniff() restores the normal setup.
+    virtual bool startRf24Sniff(const Rf24SniffConfig& config) = 0;
+    virtual void stopRf24Sniff() = 0;
+    virtual void setRf24Channel(uint8_t channel) = 0;
+    virtual bool readRf24Packet(Rf24Packet& packet) = 0;
+
+    // Spectrum scan. Each sample listens from setRf24Channel() until
+    // readRf24Carrier(), which reports whether the received power detector
+    // saw a carrier in that time.
+    virtual bool startRf24Scan() = 0;
+    virtual void stopRf24Scan() = 0;
+    virtual bool readRf24Carrier() = 0;
+
+    // The channel normal listening and transmits use. Sniffing and scanning
+    // retune freely and come back to it.
+    virtual void selectRf24Channel(uint8_t channel) = 0;
+
+    // Pipelined nRF24 transmit. beginRf24Tx() leaves receive mode for the
+    // selected channel and normal setup; queueRf24() loads one packet into
+    // the TX FIFO without waiting and returns false when it is full;
+    // pollRf24Tx() reads and clears what happened since the last poll;
+    // endRf24Tx() drops anything left and goes back to receiving, sniffing
+    // or scanning.
+    virtual void setRf24Tx(const Rf24TxConfig& config) = 0;
+    virtual bool beginRf24Tx() = 0;
+    virtual bool queueRf24(const uint8_t* payload, uint8_t length) = 0;
+    virtual void pollRf24Tx(Rf24TxStatus& status) = 0;
+    virtual void endRf24Tx() = 0;
+};
+
+// Owns every radio. The UI submits commands and polls events through two
+// lock-free rings; step() runs on the radio task and is the only code that
+// touches the backend. Each ring has exactly one producer and one consumer,
+// so the UI and the radio task may live on different cores or threads.
+class RadioService {
+public:
+    explicit RadioService(RadioBackend& backend) : _backend(backend) {}
+
+    // UI side.
+    bool submit(const RadioCommand& command) { return _commands.push(command); }
+    bool poll(RadioEvent& event) { return _events.pop(event); }
+
+    // Radio side: executes queued commands, then services the receivers.
+    void step();
+
+    uint32_t droppedCommands() const { return _commands.dropped(); }
+    uint32_t droppedEvents() const { return _events.dropped(); }
+
+    // Captures `band` lost before reaching the event ring.
+    uint32_t droppedCaptures(uint8_t band) const { return _capturesDropped[band].load(std::memory_order_relaxed); }
+
+    // Sniffed packets are read here rather than through events.
+    Rf24Sniffer& sniffer() { return _sniffer; }
+    Rf24Spectrum& spectrum() { return _spectrum; }
+    const Rf24TxQueue& rf24Tx() const { return _rf24Tx; }
+
+    // True while a mode needs step() called continuously instead of on a tick.
+    bool busy() const { return rf24Borrowed() || _macroDue || _irDue; }
+
+private:
+    // False when the command has to wait for the IR transmitter; it is then
+    // run again from the next step(), ahead of anything queued behind it.
+    bool execute(const RadioCommand& command);
+    bool transmit(const ButtonRecord& record, const IrWaveform& waveform, bool irRepeat, const uint8_t* message,
+                  uint16_t messageLength);
+    void playMacro();
+    void endMacro(bool ok);
+    bool rf24Borrowed() const { return _sniffer.active() || _spectrum.active() || !_rf24Tx.idle(); }
+    void pollReceivers();
+    bool readCapture(uint8_t band, RadioEvent& event);
+
+    RadioBackend& _backend;
+    uint8_t _listenMask = 0;
+    SpscRing<RadioCommand, RADIO_COMMAND_QUEUE_SIZE> _commands;
+    SpscRing<RadioEvent, RADIO_EVENT_QUEUE_SIZE> _events;
+    Rf24Sniffer _sniffer;
+    Rf24Spectrum _spectrum;
+    Rf24TxQueue _rf24Tx;
+    Rf24TxResult _txResult;
+    MacroPlayer _macro;
+    bool _macroOk = true;
+    bool _macroDue = false;        // The next macro send is within RADIO_MACRO_SPIN_US
+    RadioCommand _command;
+    bool _commandWaiting = false;
+    uint8_t _irFramesLeft = 0;     // Of the waiting command's IR press
+    bool _irDue = false;           // The waiting command's IR send is within RADIO_MACRO_SPIN_US
+    RadioEvent _event;
+
+    // One round of captures, a slot per band, pushed oldest first
+    RadioEvent _captures[RADIO_BANDS];
+    bool _captured[RADIO_BANDS] = {};
+    std::atomic<uint32_t> _capturesDropped[RADIO_BANDS] = {};
+};
@@ -134,7 +134,6 @@ void sendIRSignal(uint32_t data, uint16_t nbits) {
   M5.Lcd.clear();
   M5.Lcd.print("Sending IR signal...");
   irsend.sendNEC(data, nbits);  // Send NEC formatted data (IRremote uses sendNEC directly)
-  delay(200);  // Delay for user feedback
 }
 
 // Complete RF Transmission
@@ -147,7 +146,6 @@ void sendRFSignal(String data) {
   } else {
     M5.Lcd.print("RF Signal Send Failed!");
   }
-  delay(200);  // Delay for user feedback
 }
 
 void scanRF() {
@@ -0,0 +1,200 @@
+#include "remote_library.h"
+
+#include <string.h>
+
+#define LIBRARY_ZERO_CHUNK 256
+
+uint32_t RemoteLibrary::hashName(const char* name) {
+    uint32_t hash = 2166136261UL;
+    for (size_t i = 0; i < BUTTON_NAME_MAX - 1 && name[i]; i++) {
+        hash ^= (uint8_t)name[i];
+        hash *= 16777619UL;
+    }
+    return hash;
+}
+
+static bool writeZeros(LibraryFile& file, uint32_t offset, uint32_t length) {
+    static const uint8_t zeros[LIBRARY_ZERO_CHUNK] = {};
+    while (length > 0) {
+        uint32_t chunk = length < LIBRARY_ZERO_CHUNK ? length : LIBRARY_ZERO_CHUNK;
+        if (!file.writeAt(offset, zeros, chunk)) {
+            return false;
+        }
+        offset += chunk;
+        length -= chunk;
+    }
+    return true;
+}
+
+bool RemoteLibrary::format(LibraryFile& file, uint32_t capacity) {
+    uint32_t slots = 1;
+    while (slots < capacity * 2) {
+        slots <<= 1;
+    }
+
+    LibraryHeader header = {};
+    header.magic = LIBRARY_MAGIC;
+    header.version = LIBRARY_VERSION;
+    header.recordSize = sizeof(ButtonRecord);
+    header.capacity = capacity;
+    header.indexSlots = slots;
+
+    // Reserve the index and record regions so raw timings land after them
+    uint32_t reserved = slots * sizeof(IndexSlot) + capacity * sizeof(ButtonRecord);
+    return file.writeAt(0, &header, sizeof(header)) && writeZeros(file, sizeof(header), reserved);
+}
+
+bool RemoteLibrary::rebuild(RemoteLibrary& from, LibraryFile& to, uint32_t capacity) {
+    static PulseCode raw;
+
+    if (capacity < from.count() || !format(to, capacity)) {
+        return false;
+    }
+
+    RemoteLibrary target;
+    if (!target.open(&to)) {
+        return false;
+    }
+
+    ButtonRecord record;
+    for (uint32_t i = 0; i < from.count(); i++) {
+        if (!from.recordAt(i, record)) {
+            return false;
+        }
+        raw.length = 0;
+        if (record.rawLength && !from.readRaw(record, raw)) {
+            return false;
+        }
+        if (!target.put(record, raw.length ? raw.bytes : nullptr, raw.length)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool RemoteLibrary::open(LibraryFile* file) {
+    _file = file;
+    _bytesRead = 0;
+    if (!read(0, &_header, sizeof(_header)) || _header.magic != LIBRARY_MAGIC ||
+        _header.version < LIBRARY_MIN_VERSION || _header.version > LIBRARY_VERSION || _header.recordSize != sizeof(ButtonRecord) ||
+        _header.indexSlots < _header.capacity || (_header.indexSlots & (_header.indexSlots - 1)) != 0) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void RemoteLibrary::close() {
+    _file = nullptr;
+    _header = {};
+}
+
+bool RemoteLibrary::read(uint32_t offset, void* buffer, size_t length) {
+    if (!_file || !_file->readAt(offset, buffer, length)) {
+        return false;
+    }
+    _bytesRead += length;
+    return true;
+}
+
+bool RemoteLibrary::locate(const char* name, uint32_t& slot, uint32_t& recordIndex, ButtonRecord& record) {
+    uint32_t hash = hashName(name);
+    uint32_t mask = _header.indexSlots - 1;
+    IndexSlot entry;
+
+    slot = hash & mask;
+    for (uint32_t probe = 0; probe < _header.indexSlots; probe++) {
+        if (!read(indexOffset() + slot * sizeof(IndexSlot), &entry, sizeof(entry)) || entry.record == 0) {
+            return false;
+        }
+        if (entry.hash == hash) {
+            if (recordAt(entry.record - 1, record) && strncmp(record.name, name, BUTTON_NAME_MAX - 1) == 0) {
+                recordIndex = entry.record - 1;
+                return true;
+            }
+        }
+        slot = (slot + 1) & mask;
+    }
+    return false;
+}
+
+bool RemoteLibrary::find(const char* name, ButtonRecord& record) {
+    uint32_t slot;
+    uint32_t index;
+    return isOpen() && locate(name, slot, index, record);
+}
+
+bool RemoteLibrary::put(const ButtonRecord& record, const uint8_t* raw, uint16_t rawLength) {
+    if (!isOpen() || _header.version != LIBRARY_VERSION) {
+        return false;
+    }
+
+    uint32_t slot;
+    uint32_t index;
+    ButtonRecord current;
+    bool existing = locate(record.name, slot, index, current);
+    if (!existing) {
+        if (full()) {
+            return false;
+        }
+        index = _header.count;
+    }
+
+    ButtonRecord stored = record;
+    stored.rawOffset = 0;
+    stored.rawLength = 0;
+    uint16_t replaced = existing ? current.rawLength : 0;
+    if (raw && rawLength) {
+        // Recaptures of the same button mostly fit where the last one was
+        bool inPlace = rawLength <= replaced;
+        stored.rawOffset = inPlace ? current.rawOffset : _header.rawBytes;
+        stored.rawLength = rawLength;
+        if (!_file->writeAt(rawOffset() + stored.rawOffset, raw, rawLength)) {
+            return false;
+        }
+        if (inPlace) {
+            replaced -= rawLength;
+        } else {
+            _header.rawBytes += rawLength;
+        }
+    }
+    _header.orphanBytes += replaced;
+
+    if (!_file->writeAt(recordsOffset() + index * sizeof(ButtonRecord), &stored, sizeof(stored))) {
+        return false;
+    }
+
+    if (!existing) {
+        IndexSlot entry = {hashName(record.name), index + 1};
+        if (!_file->writeAt(indexOffset() + slot * sizeof(IndexSlot), &entry, sizeof(entry))) {
+            return false;
+        }
+        _header.count++;
+    }
+
+    // Header last, so an interrupted write leaves the previous count in place
+    return _file->writeAt(0, &_header, sizeof(_header));
+}
+
+bool RemoteLibrary::recordAt(uint32_t index, ButtonRecord& record) {
+    if (index >= _header.count) {
+        return false;
+    }
+    return read(recordsOffset() + index * sizeof(ButtonRecord), &record, sizeof(record));
+}
+
+bool RemoteLibrary::readRaw(const ButtonRecord& record, PulseCode& out) {
+    static PulseTrain legacy;
+
+    out.length = 0;
+    if (record.rawLength == 0 || record.rawLength > PULSE_CODE_MAX ||
+        record.rawOffset + record.rawLength > _header.rawBytes ||
+        !read(rawOffset() + record.rawOffset, out.bytes, record.rawLength)) {
+        return false;
+    }
+    if (_header.version >= 2) {
+        out.length = record.rawLength;
+        return true;
+    }
+    return rawToPulseTrain(out.bytes, record.rawLength, legacy) && encodePulses(legacy, out);
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "button_record.h"
+#include "pulse_codec.h"
+
+#define LIBRARY_MAGIC 0x424C5052UL    // "RPLB"
+#define LIBRARY_VERSION 2            // 1 stored raw timings uncompressed
+#define LIBRARY_MIN_VERSION 1
+#define LIBRARY_EXTENSION ".rpl"
+
+#ifndef LIBRARY_INITIAL_CAPACITY
+#define LIBRARY_INITIAL_CAPACITY 32
+#endif
+
+#ifndef LIBRARY_COMPACT_BYTES
+#define LIBRARY_COMPACT_BYTES 4096     // Orphaned raw bytes before a library is worth rewriting
+#endif
+
+// Random-access file the library is stored in. Kept abstract so the format
+// code has no SD dependency.
+class LibraryFile {
+public:
+    virtual ~LibraryFile() {}
+    virtual bool readAt(uint32_t offset, void* buffer, size_t length) = 0;
+    virtual bool writeAt(uint32_t offset, const void* buffer, size_t length) = 0;
+};
+
+struct LibraryHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t recordSize;
+    uint32_t count;
+    uint32_t capacity;             // Record slots reserved before the raw region
+    uint32_t indexSlots;           // Power of two, twice the capacity
+    uint32_t rawBytes;
+    uint32_t orphanBytes;          // Raw bytes no record points at any more
+    uint32_t reserved;
+};
+
+static_assert(sizeof(LibraryHeader) == 32, "LibraryHeader must stay 32 bytes on disk");
+
+// Layout: header | hash index | fixed records | raw timing region.
+// The index is open-addressed on the FNV-1a hash of the button name, so a
+// lookup reads one or two 8-byte slots and a single record.
+class RemoteLibrary {
+public:
+    // Writes an empty library with room for `capacity` records.
+    static bool format(LibraryFile& file, uint32_t capacity = LIBRARY_INITIAL_CAPACITY);
+
+    // Rewrites every record of `from` into a fresh library with a new capacity,
+    // dropping raw timings orphaned by overwritten buttons. Older versions are
+    // converted to the current one on the way.
+    static bool rebuild(RemoteLibrary& from, LibraryFile& to, uint32_t capacity);
+
+    bool open(LibraryFile* file);
+    void close();
+    bool isOpen() const { return _file != nullptr; }
+
+    bool find(const char* name, ButtonRecord& record);
+
+    // Inserts or replaces the button with the same name. A replaced button's
+    // raw timings are overwritten in place when the new ones fit, otherwise
+    // appended and the old ones counted as orphaned. Fails when full(); the
+    // caller then rebuilds into a larger file. Older versions are read only
+    // until rebuilt.
+    bool put(const ButtonRecord& record, const uint8_t* raw, uint16_t rawLength);
+
+    bool recordAt(uint32_t index, ButtonRecord& record);
+    // Reads the compressed timings of a button, whatever the file version.
+    bool readRaw(const ButtonRecord& record, PulseCode& out);
+
+    uint16_t version() const { return _header.version; }
+    uint32_t count() const { return _header.count; }
+    uint32_t capacity() const { return _header.capacity; }
+    uint32_t rawBytes() const { return _header.rawBytes; }
+    uint32_t orphanBytes() const { return _header.orphanBytes; }
+    bool full() const { return _header.count >= _header.capacity; }
+
+    // True once orphaned raw bytes pass LIBRARY_COMPACT_BYTES and make up
+    // half the raw region; the caller then rebuilds at the same capacity.
+    bool needsCompaction() const {
+        return _header.orphanBytes >= LIBRARY_COMPACT_BYTES && _header.orphanBytes * 2 >= _header.rawBytes;
+    }
+
+    // Bytes fetched from the file since open(), for lookup cost measurements.
+    uint32_t bytesRead() const { return _bytesRead; }
+
+    static uint32_t hashName(const char* name);
+
+private:
+    struct IndexSlot {
+        uint32_t hash;
+        uint32_t record;           // Record index + 1, 0 = empty
+    };
+
+    uint32_t indexOffset() const { return sizeof(LibraryHeader); }
+    uint32_t recordsOffset() const { return indexOffset() + _header.indexSlots * sizeof(IndexSlot); }
+    uint32_t rawOffset() const { return recordsOffset() + _header.capacity * sizeof(ButtonRecord); }
+
+    bool read(uint32_t offset, void* buffer, size_t length);
+    bool locate(const char* name, uint32_t& slot, uint32_t& recordIndex, ButtonRecord& record);
+
+    LibraryFile* _file = nullptr;
+    LibraryHeader _header = {};
+    uint32_t _bytesRead = 0;
+};
@@ -0,0 +1,120 @@
+#include "rf24_sniffer.h"
+
+#include <string.h>
+
+#include "radio_service.h"
+
+void rf24SniffDefaults(Rf24SniffConfig& config) {
+    static const uint8_t pipe0[RF24_ADDRESS_WIDTH] = {0xE7, 0xE7, 0xE7, 0xE7, 0xE7};
+    static const uint8_t pipe1[RF24_ADDRESS_WIDTH] = {0xC2, 0xC2, 0xC2, 0xC2, 0xC2};
+    static const uint8_t lsb[RF24_PIPES - 2] = {0xC3, 0xC4, 0xC5, 0xC6};
+
+    config.firstChannel = 0;
+    config.lastChannel = RF24_CHANNELS - 1;
+    config.channelStep = 1;
+    config.dataRate = RF24_RATE_2MBPS;
+    config.dwellUs = RF24_SNIFF_DWELL_US;
+    config.dynamicPayloads = false;
+    config.payloadSize = RF24_MAX_PAYLOAD;
+    memcpy(config.pipe0Address, pipe0, sizeof(pipe0));
+    memcpy(config.pipe1Address, pipe1, sizeof(pipe1));
+    memcpy(config.pipeLsb, lsb, sizeof(lsb));
+}
+
+bool Rf24Sniffer::start(const Rf24SniffConfig& config, RadioBackend& backend) {
+    _config = config;
+    if (_config.lastChannel >= RF24_CHANNELS) {
+        _config.lastChannel = RF24_CHANNELS - 1;
+    }
+    if (_config.firstChannel > _config.lastChannel) {
+        _config.firstChannel = _config.lastChannel;
+    }
+    if (_config.channelStep == 0) {
+        _config.channelStep = 1;
+    }
+    if (!backend.startRf24Sniff(_config)) {
+        _active.store(false, std::memory_order_relaxed);
+        return false;
+    }
+    tune(backend, _config.firstChannel);
+    _active.store(true, std::memory_order_relaxed);
+    return true;
+}
+
+void Rf24Sniffer::stop(RadioBackend& backend) {
+    if (active()) {
+        backend.stopRf24Sniff();
+        _active.store(false, std::memory_order_relaxed);
+    }
+}
+
+void Rf24Sniffer::tune(RadioBackend& backend, uint8_t channel) {
+    backend.setRf24Channel(channel);
+    _channel.store(channel, std::memory_order_relaxed);
+    _hopAtUs = backend.nowUs() + _config.dwellUs;
+}
+
+void Rf24Sniffer::service(RadioBackend& backend) {
+    if (!active()) {
+        return;
+    }
+
+    // Timestamp each packet as it leaves the FIFO; the FIFO holds three, so
+    // this runs before anything slower
+    uint8_t channel = _channel.load(std::memory_order_relaxed);
+    while (backend.readRf24Packet(_packet)) {
+        if (_packet.fifoFull) {
+            _overflows.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (_packet.length == 0) {
+            continue;
+        }
+        _record.timestampUs = backend.nowUs();
+        _record.channel = channel;
+        _record.pipe = _packet.pipe;
+        _record.dataRate = _config.dataRate;
+        _record.length = _packet.length <= RF24_MAX_PAYLOAD ? _packet.length : RF24_MAX_PAYLOAD;
+        memcpy(_record.payload, _packet.payload, _record.length);
+        memset(_record.payload + _record.length, 0, RF24_MAX_PAYLOAD - _record.length);
+        _records.push(_record);
+    }
+
+    if (_config.dwellUs == 0 || (int32_t)(backend.nowUs() - _hopAtUs) < 0) {
+        return;
+    }
+    uint16_t next = channel + _config.channelStep;
+    tune(backend, next > _config.lastChannel ? _config.firstChannel : (uint8_t)next);
+}
+
+void Rf24ChannelCounts::clear() {
+    memset(packets, 0, sizeof(packets));
+    total = 0;
+}
+
+void Rf24ChannelCounts::add(const Rf24SniffRecord& record) {
+    if (record.channel < RF24_CHANNELS) {
+        packets[record.channel]++;
+        total++;
+    }
+}
+
+uint8_t Rf24ChannelCounts::busiest(uint8_t* channels, uint8_t count) const {
+    uint8_t found = 0;
+    for (uint8_t channel = 0; channel < RF24_CHANNELS; channel++) {
+        if (packets[channel] == 0) {
+            continue;
+        }
+        // Insertion into the short sorted list
+        uint8_t slot = found < count ? found++ : count;
+        while (slot > 0 && packets[channels[slot - 1]] < packets[channel]) {
+            if (slot < count) {
+                channels[slot] = channels[slot - 1];
+            }
+            slot--;
+        }
+        if (slot < count) {
+            channels[slot] = channel;
+        }
+    }
+    return found;
+}
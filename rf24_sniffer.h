@@ -0,0 +1,115 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+#include "spsc_ring.h"
+
+#define RF24_CHANNELS 126
+#define RF24_PIPES 6
+#define RF24_MAX_PAYLOAD 32
+#define RF24_ADDRESS_WIDTH 5
+
+#ifndef RF24_DEFAULT_CHANNEL
+#define RF24_DEFAULT_CHANNEL 76        // Listening and transmits until another is selected
+#endif
+
+#ifndef RF24_SNIFF_RING_SIZE
+#define RF24_SNIFF_RING_SIZE 128       // Packets buffered between radio task and UI
+#endif
+
+#ifndef RF24_SNIFF_DWELL_US
+#define RF24_SNIFF_DWELL_US 20000      // Default time on each channel
+#endif
+
+// Same order as the RF24 library's rf24_datarate_e.
+enum Rf24DataRate : uint8_t {
+    RF24_RATE_1MBPS,
+    RF24_RATE_2MBPS,
+    RF24_RATE_250KBPS
+};
+
+// Receiver setup for a capture. Addresses are LSB first, as the chip takes
+// them; pipes 2-5 share bytes 1-4 of pipe 1's address and set only the LSB.
+struct Rf24SniffConfig {
+    uint8_t firstChannel;
+    uint8_t lastChannel;
+    uint8_t channelStep;
+    uint8_t dataRate;              // Rf24DataRate
+    uint32_t dwellUs;              // Time on each channel; 0 stays on firstChannel
+    bool dynamicPayloads;
+    uint8_t payloadSize;           // Fixed size when not dynamic
+    uint8_t pipe0Address[RF24_ADDRESS_WIDTH];
+    uint8_t pipe1Address[RF24_ADDRESS_WIDTH];
+    uint8_t pipeLsb[RF24_PIPES - 2];
+};
+
+// Every channel at 2 Mbps, the chip's reset addresses on all six pipes.
+void rf24SniffDefaults(Rf24SniffConfig& config);
+
+// One packet as the receiver hands it over.
+struct Rf24Packet {
+    uint8_t pipe;
+    uint8_t length;
+    bool fifoFull;                 // The receive FIFO was full; later packets may be lost
+    uint8_t payload[RF24_MAX_PAYLOAD];
+};
+
+// One captured packet, as queued to the UI and written to the capture log.
+struct Rf24SniffRecord {
+    uint32_t timestampUs;
+    uint8_t channel;
+    uint8_t pipe;
+    uint8_t dataRate;
+    uint8_t length;
+    uint8_t payload[RF24_MAX_PAYLOAD];
+};
+
+static_assert(sizeof(Rf24SniffRecord) == 40, "Rf24SniffRecord is a fixed 40-byte log record");
+
+class RadioBackend;
+
+// Capture across pipes and channels. start(), stop() and service() run on
+// the radio task; the UI drains records with pop(). Payloads are kept as
+// received, binary included.
+class Rf24Sniffer {
+public:
+    bool start(const Rf24SniffConfig& config, RadioBackend& backend);
+    void stop(RadioBackend& backend);
+
+    // Drains the receive FIFO, then hops if the dwell time is up.
+    void service(RadioBackend& backend);
+
+    bool active() const { return _active.load(std::memory_order_relaxed); }
+    uint8_t channel() const { return _channel.load(std::memory_order_relaxed); }
+
+    // UI side.
+    bool pop(Rf24SniffRecord& record) { return _records.pop(record); }
+    uint32_t dropped() const { return _records.dropped(); }
+    uint32_t overflows() const { return _overflows.load(std::memory_order_relaxed); }
+
+private:
+    void tune(RadioBackend& backend, uint8_t channel);
+
+    Rf24SniffConfig _config = {};
+    uint32_t _hopAtUs = 0;
+    Rf24Packet _packet;
+    Rf24SniffRecord _record;
+    SpscRing<Rf24SniffRecord, RF24_SNIFF_RING_SIZE> _records;
+    std::atomic<bool> _active{false};
+    std::atomic<uint8_t> _channel{0};
+    std::atomic<uint32_t> _overflows{0};
+};
+
+// Per-channel packet counts kept by the consumer of the records.
+struct Rf24ChannelCounts {
+    uint32_t packets[RF24_CHANNELS];
+    uint32_t total;
+
+    void clear();
+    void add(const Rf24SniffRecord& record);
+
+    // Fills up to `count` channels that saw packets, busiest first; returns
+    // how many were filled.
+    uint8_t busiest(uint8_t* channels, uint8_t count) const;
+};
@@ -0,0 +1,89 @@
+#include "rf24_spectrum.h"
+
+#include "radio_service.h"
+
+void rf24SpectrumDefaults(Rf24SpectrumConfig& config) {
+    config.firstChannel = 0;
+    config.lastChannel = RF24_CHANNELS - 1;
+    config.listenUs = RF24_SPECTRUM_LISTEN_US;
+}
+
+bool Rf24Spectrum::start(const Rf24SpectrumConfig& config, RadioBackend& backend) {
+    _config = config;
+    if (_config.lastChannel >= RF24_CHANNELS) {
+        _config.lastChannel = RF24_CHANNELS - 1;
+    }
+    if (_config.firstChannel > _config.lastChannel) {
+        _config.firstChannel = _config.lastChannel;
+    }
+    if (!backend.startRf24Scan()) {
+        _active.store(false, std::memory_order_relaxed);
+        return false;
+    }
+    for (uint8_t channel = 0; channel < RF24_CHANNELS; channel++) {
+        _occupancy[channel].store(0, std::memory_order_relaxed);
+    }
+    _sweeps.store(0, std::memory_order_relaxed);
+    tune(backend, _config.firstChannel);
+    _active.store(true, std::memory_order_relaxed);
+    return true;
+}
+
+void Rf24Spectrum::stop(RadioBackend& backend) {
+    if (active()) {
+        backend.stopRf24Scan();
+        _active.store(false, std::memory_order_relaxed);
+    }
+}
+
+void Rf24Spectrum::tune(RadioBackend& backend, uint8_t channel) {
+    backend.setRf24Channel(channel);
+    _channel = channel;
+    _sampleAtUs = backend.nowUs() + _config.listenUs;
+}
+
+void Rf24Spectrum::update(uint8_t channel, bool carrier) {
+    int32_t target = carrier ? RF24_OCCUPANCY_FULL : 0;
+    int32_t current = _occupancy[channel].load(std::memory_order_relaxed);
+    // A plain mean over the first sweeps, so the start is not one sample's
+    // word, then the decaying average
+    uint32_t weight = sweeps() + 1;
+    if (weight > (1 << RF24_SPECTRUM_DECAY_SHIFT)) {
+        weight = 1 << RF24_SPECTRUM_DECAY_SHIFT;
+    }
+    current += (target - current) / (int32_t)weight;
+    _occupancy[channel].store((uint16_t)current, std::memory_order_relaxed);
+}
+
+void Rf24Spectrum::service(RadioBackend& backend) {
+    if (!active() || (int32_t)(backend.nowUs() - _sampleAtUs) < 0) {
+        return;
+    }
+    update(_channel, backend.readRf24Carrier());
+    if (_channel >= _config.lastChannel) {
+        _sweeps.fetch_add(1, std::memory_order_relaxed);
+        tune(backend, _config.firstChannel);
+    } else {
+        tune(backend, _channel + 1);
+    }
+}
+
+uint8_t Rf24Spectrum::quietest(uint8_t first, uint8_t last, uint8_t current) const {
+    if (last > RF24_SPECTRUM_SELECT_MAX) {
+        last = RF24_SPECTRUM_SELECT_MAX;
+    }
+    // A 2 Mbps transmission spans two channels, so neighbours count half
+    uint8_t best = current;
+    uint32_t bestScore = 0xFFFFFFFF;
+    for (int16_t channel = first; channel <= last; channel++) {
+        uint32_t own = occupancy(channel);
+        uint32_t below = channel > first ? occupancy(channel - 1) : own;
+        uint32_t above = channel < last ? occupancy(channel + 1) : own;
+        uint32_t score = own * 2 + below + above;
+        if (score < bestScore || (score == bestScore && channel == current)) {
+            best = (uint8_t)channel;
+            bestScore = score;
+        }
+    }
+    return best;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+#include "rf24_sniffer.h"
+
+#ifndef RF24_SPECTRUM_LISTEN_US
+#define RF24_SPECTRUM_LISTEN_US 200    // Receive time per sample; the RPD needs 170 us
+#endif
+
+#ifndef RF24_SPECTRUM_DECAY_SHIFT
+#define RF24_SPECTRUM_DECAY_SHIFT 4    // Each sweep moves a channel 1/16 of the way to its new sample
+#endif
+
+#ifndef RF24_SPECTRUM_SELECT_MAX
+#define RF24_SPECTRUM_SELECT_MAX 83    // Highest channel inside the 2.400-2.4835 GHz band
+#endif
+
+#define RF24_OCCUPANCY_FULL 0xFFFF     // A carrier on every sample
+
+struct Rf24SpectrumConfig {
+    uint8_t firstChannel;
+    uint8_t lastChannel;
+    uint16_t listenUs;
+};
+
+// Every channel, RF24_SPECTRUM_LISTEN_US each.
+void rf24SpectrumDefaults(Rf24SpectrumConfig& config);
+
+// Channel occupancy from the nRF24's received power detector. Each visit
+// listens on one channel and asks whether a carrier above -64 dBm was
+// heard; the answers feed a per-channel moving average with exponential
+// decay. start(), stop() and service() run on the radio task; the UI reads
+// occupancy() at any time.
+class Rf24Spectrum {
+public:
+    bool start(const Rf24SpectrumConfig& config, RadioBackend& backend);
+    void stop(RadioBackend& backend);
+
+    // Takes the sample due on the current channel, if any, and moves on.
+    void service(RadioBackend& backend);
+
+    bool active() const { return _active.load(std::memory_order_relaxed); }
+
+    // UI side. From 0 (never busy) to RF24_OCCUPANCY_FULL; kept after stop().
+    uint16_t occupancy(uint8_t channel) const { return _occupancy[channel].load(std::memory_order_relaxed); }
+    uint32_t sweeps() const { return _sweeps.load(std::memory_order_relaxed); }
+
+    // The channel in [first, last], capped at RF24_SPECTRUM_SELECT_MAX, with
+    // the least traffic on and next to it. Ties keep `current`.
+    uint8_t quietest(uint8_t first, uint8_t last, uint8_t current) const;
+
+private:
+    void tune(RadioBackend& backend, uint8_t channel);
+    void update(uint8_t channel, bool carrier);
+
+    Rf24SpectrumConfig _config = {};
+    uint8_t _channel = 0;
+    uint32_t _sampleAtUs = 0;
+    std::atomic<bool> _active{false};
+    std::atomic<uint32_t> _sweeps{0};
+    std::atomic<uint16_t> _occupancy[RF24_CHANNELS];
+};
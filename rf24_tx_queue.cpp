@@ -0,0 +1,172 @@
+#include "rf24_tx_queue.h"
+
+#include <string.h>
+
+#include "radio_service.h"
+
+void rf24TxDefaults(Rf24TxConfig& config) {
+    config.retryDelay = RF24_TX_RETRY_DELAY;
+    config.retryCount = RF24_TX_RETRY_COUNT;
+    config.autoAck = true;
+    config.dynamicPayloads = false;
+    config.resends = RF24_TX_RESENDS;
+}
+
+bool Rf24TxQueue::submit(const uint8_t* data, uint16_t length) {
+    if (length == 0 || length > RF24_MESSAGE_MAX) {
+        return false;
+    }
+    uint16_t count = length <= RF24_MAX_PAYLOAD ? 1 : (length + RF24_FRAGMENT_DATA - 1) / RF24_FRAGMENT_DATA;
+    if (RF24_TX_QUEUE_PACKETS - (_end - _first) < count) {
+        return false;
+    }
+
+    if (count == 1) {
+        Packet& single = packet(_end++);
+        single.length = (uint8_t)length;
+        single.resends = 0;
+        single.last = true;
+        memcpy(single.payload, data, length);
+        return true;
+    }
+
+    _messageId++;
+    for (uint16_t index = 0; index < count; index++) {
+        uint16_t offset = index * RF24_FRAGMENT_DATA;
+        uint16_t chunk = length - offset < RF24_FRAGMENT_DATA ? length - offset : RF24_FRAGMENT_DATA;
+        Packet& fragment = packet(_end++);
+        fragment.last = index == count - 1;
+        fragment.resends = 0;
+        fragment.length = (uint8_t)(RF24_FRAGMENT_HEADER + chunk);
+        fragment.payload[0] = _messageId;
+        fragment.payload[1] = (uint8_t)(index | (fragment.last ? RF24_FRAGMENT_LAST : 0));
+        memcpy(fragment.payload + RF24_FRAGMENT_HEADER, data + offset, chunk);
+    }
+    return true;
+}
+
+// Keeps the chip's FIFO full so packets leave back to back
+void Rf24TxQueue::load(RadioBackend& backend) {
+    while (_next != _end && _next - _first < RF24_TX_FIFO_DEPTH) {
+        Packet& next = packet(_next);
+        if (!backend.queueRf24(next.payload, next.length)) {
+            return;
+        }
+        _next++;
+        _sent.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void Rf24TxQueue::finish(bool acked, uint8_t retries) {
+    Packet& head = packet(_first++);
+    _message.ok = _message.ok && acked;
+    _message.packets++;
+    if (acked) {
+        _message.retries += retries;
+        _acked.fetch_add(1, std::memory_order_relaxed);
+        _retries.fetch_add(retries, std::memory_order_relaxed);
+        _retryHistogram[retries & 0xF].fetch_add(1, std::memory_order_relaxed);
+    } else {
+        _failed.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (head.last) {
+        _messages.fetch_add(1, std::memory_order_relaxed);
+        if (!_message.ok) {
+            _messagesFailed.fetch_add(1, std::memory_order_relaxed);
+        }
+        _results.push(_message);
+        _message = {true, 0, 0};
+    }
+}
+
+// The FIFO was flushed with the oldest packet still in it. It goes again
+// while it has resends left; otherwise its whole message is given up.
+void Rf24TxQueue::failHead() {
+    _next = _first;
+    Packet& head = packet(_first);
+    if (head.resends < _config.resends) {
+        head.resends++;
+        _resent.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    bool last;
+    do {
+        last = packet(_first).last;
+        finish(false, 0);
+    } while (!last);
+}
+
+void Rf24TxQueue::end(RadioBackend& backend) {
+    backend.endRf24Tx();
+    _transmitting = false;
+    _next = _first;
+}
+
+void Rf24TxQueue::service(RadioBackend& backend) {
+    if (_first == _end) {
+        if (_transmitting) {
+            end(backend);
+        }
+        return;
+    }
+
+    uint32_t now = backend.nowUs();
+    if (!_transmitting) {
+        if (!backend.beginRf24Tx()) {
+            while (_first != _end) {
+                finish(false, 0);
+            }
+            return;
+        }
+        _transmitting = true;
+        _next = _first;
+        _progressUs = now;
+    }
+
+    load(backend);
+    Rf24TxStatus status;
+    backend.pollRf24Tx(status);
+
+    // Packets leave the FIFO in order and only once acknowledged, so an empty
+    // FIFO settles every one in flight, however many flags were merged. The
+    // retransmit count is only known for the latest.
+    if (status.empty) {
+        while (_first != _next) {
+            finish(true, _first + 1 == _next ? status.retries : 0);
+        }
+    } else {
+        if (status.acked && _first != _next) {
+            finish(true, status.retries);
+        }
+        if (status.failed && _first != _next) {
+            failHead();
+        }
+    }
+    if (status.acked || status.failed || status.empty) {
+        _progressUs = now;
+    } else if (now - _progressUs > RF24_TX_TIMEOUT_US) {
+        _timeouts.fetch_add(1, std::memory_order_relaxed);
+        end(backend);
+        failHead();
+        return;
+    }
+
+    if (_first == _end) {
+        end(backend);
+    }
+}
+
+void Rf24TxQueue::stats(Rf24TxStats& out) const {
+    out.messages = _messages.load(std::memory_order_relaxed);
+    out.messagesFailed = _messagesFailed.load(std::memory_order_relaxed);
+    out.packets = _sent.load(std::memory_order_relaxed);
+    out.acked = _acked.load(std::memory_order_relaxed);
+    out.failed = _failed.load(std::memory_order_relaxed);
+    out.resent = _resent.load(std::memory_order_relaxed);
+    out.retries = _retries.load(std::memory_order_relaxed);
+    out.timeouts = _timeouts.load(std::memory_order_relaxed);
+    for (uint8_t i = 0; i < 16; i++) {
+        out.retryHistogram[i] = _retryHistogram[i].load(std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+#include "rf24_sniffer.h"
+#include "spsc_ring.h"
+
+#ifndef RF24_TX_QUEUE_PACKETS
+#define RF24_TX_QUEUE_PACKETS 32       // Packets waiting or in flight; a power of two
+#endif
+
+#ifndef RF24_TX_RETRY_DELAY
+#define RF24_TX_RETRY_DELAY 5          // Auto-retransmit delay, (n + 1) * 250 us
+#endif
+
+#ifndef RF24_TX_RETRY_COUNT
+#define RF24_TX_RETRY_COUNT 15         // Auto-retransmits before the chip gives up on a packet
+#endif
+
+#ifndef RF24_TX_RESENDS
+#define RF24_TX_RESENDS 2              // Further tries from the queue after the chip gives up
+#endif
+
+#ifndef RF24_TX_TIMEOUT_US
+#define RF24_TX_TIMEOUT_US 100000      // No progress for this long resets the transmitter
+#endif
+
+#define RF24_TX_FIFO_DEPTH 3
+#define RF24_TX_RESULTS 8
+#define RF24_FRAGMENT_HEADER 2
+#define RF24_FRAGMENT_DATA (RF24_MAX_PAYLOAD - RF24_FRAGMENT_HEADER)
+#define RF24_FRAGMENT_LAST 0x80
+#define RF24_MESSAGE_MAX (RF24_FRAGMENT_DATA * 8)
+
+struct Rf24TxConfig {
+    uint8_t retryDelay;            // 0-15, (n + 1) * 250 us between auto-retransmits
+    uint8_t retryCount;            // 0-15
+    bool autoAck;
+    bool dynamicPayloads;          // Otherwise every packet is padded to 32 bytes
+    uint8_t resends;
+};
+
+// RF24_TX_* settings, auto-ack on, fixed payloads so captured packets
+// replay exactly as they were heard.
+void rf24TxDefaults(Rf24TxConfig& config);
+
+// What the transmitter did since the last poll.
+struct Rf24TxStatus {
+    bool empty;                    // TX FIFO empty, sampled before the flags
+    bool acked;                    // At least one packet went out (TX_DS)
+    bool failed;                   // The oldest packet ran out of retransmits (MAX_RT); the FIFO was flushed
+    uint8_t retries;               // Auto-retransmits of the latest packet (ARC)
+};
+
+// One finished message.
+struct Rf24TxResult {
+    bool ok;
+    uint8_t packets;
+    uint16_t retries;
+};
+
+struct Rf24TxStats {
+    uint32_t messages;
+    uint32_t messagesFailed;
+    uint32_t packets;              // Loaded into the FIFO, resends included
+    uint32_t acked;
+    uint32_t failed;               // Given up on, or dropped with a failed message
+    uint32_t resent;
+    uint32_t retries;              // Auto-retransmits over all acked packets
+    uint32_t timeouts;
+    uint32_t retryHistogram[16];   // Acked packets by auto-retransmits needed
+};
+
+// Pipelined nRF24 transmit queue, run on the radio task. Messages up to one
+// payload go out as a single packet, byte for byte; longer ones are split
+// into fragments of a message id, an index with RF24_FRAGMENT_LAST on the
+// final one, and RF24_FRAGMENT_DATA bytes. Up to three packets sit in the
+// chip's FIFO so it transmits back to back while the queue waits for
+// acknowledgements.
+class Rf24TxQueue {
+public:
+    void configure(const Rf24TxConfig& config) { _config = config; }
+
+    // False when the message is empty, too long or does not fit; nothing is
+    // queued then.
+    bool submit(const uint8_t* data, uint16_t length);
+
+    // Loads the FIFO and collects what the chip reports.
+    void service(RadioBackend& backend);
+
+    bool idle() const { return _first == _end && !_transmitting; }
+    bool popResult(Rf24TxResult& result) { return _results.pop(result); }
+
+    // Safe from any task.
+    void stats(Rf24TxStats& out) const;
+
+private:
+    struct Packet {
+        uint8_t length;
+        uint8_t resends;
+        bool last;                 // Ends its message
+        uint8_t payload[RF24_MAX_PAYLOAD];
+    };
+
+    Packet& packet(uint32_t index) { return _packets[index & (RF24_TX_QUEUE_PACKETS - 1)]; }
+    void load(RadioBackend& backend);
+    void finish(bool acked, uint8_t retries);
+    void failHead();
+    void end(RadioBackend& backend);
+
+    Rf24TxConfig _config = {RF24_TX_RETRY_DELAY, RF24_TX_RETRY_COUNT, true, false, RF24_TX_RESENDS};
+    Packet _packets[RF24_TX_QUEUE_PACKETS];
+    uint32_t _first = 0;           // Oldest packet not yet finished
+    uint32_t _next = 0;            // Next to load; [_first, _next) are in the FIFO
+    uint32_t _end = 0;
+    bool _transmitting = false;
+    uint32_t _progressUs = 0;
+    uint8_t _messageId = 0;
+
+    Rf24TxResult _message = {true, 0, 0};
+    SpscRing<Rf24TxResult, RF24_TX_RESULTS> _results;
+
+    std::atomic<uint32_t> _messages{0};
+    std::atomic<uint32_t> _messagesFailed{0};
+    std::atomic<uint32_t> _sent{0};
+    std::atomic<uint32_t> _acked{0};
+    std::atomic<uint32_t> _failed{0};
+    std::atomic<uint32_t> _resent{0};
+    std::atomic<uint32_t> _retries{0};
+    std::atomic<uint32_t> _timeouts{0};
+    std::atomic<uint32_t> _retryHistogram[16] = {};
+};
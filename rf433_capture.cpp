@@ -0,0 +1,54 @@
+#include "rf433_capture.h"
+
+#include <Arduino.h>
+#include <driver/gpio.h>
+
+#include "spsc_ring.h"
+
+static SpscRing<IrEdge, RF433_EDGE_RING_SIZE> rf433EdgeRing;
+static SpscRing<Rf433Burst, RF433_BURST_QUEUE_SIZE> rf433BurstQueue;
+static gpio_num_t rf433CapturePin;
+
+// OOK receivers drive the data pin high while the carrier is present
+static void IRAM_ATTR onRf433Edge() {
+    IrEdge edge;
+    edge.timestampUs = micros();
+    edge.mark = gpio_get_level(rf433CapturePin) != 0;
+    rf433EdgeRing.push(edge);
+}
+
+void Rf433Capture::begin(uint8_t pin) {
+    rf433CapturePin = (gpio_num_t)pin;
+    _detector.reset();
+    pinMode(pin, INPUT);
+    attachInterrupt(digitalPinToInterrupt(pin), onRf433Edge, CHANGE);
+}
+
+void Rf433Capture::service() {
+    IrEdge edge;
+    while (rf433EdgeRing.pop(edge)) {
+        if (_detector.pushEdge(edge, _scratch)) {
+            rf433BurstQueue.push(_scratch);
+        }
+    }
+    if (_detector.poll(micros(), _scratch)) {
+        rf433BurstQueue.push(_scratch);
+    }
+}
+
+bool Rf433Capture::read(Rf433Burst& burst) {
+    return rf433BurstQueue.pop(burst);
+}
+
+void Rf433Capture::flush() {
+    while (rf433BurstQueue.pop(_scratch)) {
+    }
+}
+
+uint32_t Rf433Capture::droppedEdges() const {
+    return rf433EdgeRing.dropped();
+}
+
+uint32_t Rf433Capture::droppedBursts() const {
+    return rf433BurstQueue.dropped();
+}
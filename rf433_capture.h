@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "rf433_detector.h"
+
+#ifndef RF433_EDGE_RING_SIZE
+#define RF433_EDGE_RING_SIZE 1024      // Edges buffered between radio task passes; receivers idle noisy
+#endif
+
+#ifndef RF433_BURST_QUEUE_SIZE
+#define RF433_BURST_QUEUE_SIZE 4
+#endif
+
+// Always-on 433 MHz capture. A GPIO edge interrupt timestamps every level
+// change of the receiver's data pin into a lock-free ring; service() drains
+// it through the frame detector.
+class Rf433Capture {
+public:
+    void begin(uint8_t pin);
+
+    // Drains pending edges into bursts. Call from the radio task as often as possible.
+    void service();
+
+    bool read(Rf433Burst& burst);
+
+    // Discards every queued burst.
+    void flush();
+
+    uint32_t droppedEdges() const;
+    uint32_t droppedBursts() const;
+    uint32_t framesRejected() const { return _detector.framesRejected(); }
+
+private:
+    Rf433FrameDetector _detector;
+    Rf433Burst _scratch;
+};
@@ -0,0 +1,254 @@
+#include "rf433_codec.h"
+
+#include <stdio.h>
+
+struct Rf433PulsePair {
+    uint8_t high;                  // Pulses at the first level, then at the second
+    uint8_t low;
+};
+
+struct Rf433Protocol {
+    uint8_t protocol;
+    uint16_t pulseUs;
+    Rf433PulsePair sync;
+    Rf433PulsePair zero;
+    Rf433PulsePair one;
+    bool inverted;                 // First level is low: the line idles high
+};
+
+// RCSwitch's table. A receiver frames a normal protocol as the bit pairs
+// and the sync mark, the sync space being the gap; an inverted one as the
+// sync's short mark followed by the bit pairs, space first.
+static constexpr Rf433Protocol kRf433Protocols[] = {
+    // proto pulse  sync       zero     one      inverted
+    {1,    350, {1, 31},  {1, 3},  {3, 1},  false},
+    {2,    650, {1, 10},  {1, 2},  {2, 1},  false},
+    {3,    100, {30, 71}, {4, 11}, {9, 6},  false},
+    {4,    380, {1, 6},   {1, 3},  {3, 1},  false},
+    {5,    500, {6, 14},  {1, 2},  {2, 1},  false},
+    {6,    450, {23, 1},  {1, 2},  {2, 1},  true},    // HT6P20B
+    {7,    150, {2, 62},  {1, 6},  {6, 1},  false},   // HS2303-PT
+    {10,   365, {18, 1},  {3, 1},  {1, 3},  true},    // 1ByOne doorbell
+    {11,   270, {36, 1},  {1, 2},  {2, 1},  true},    // HT12E
+    {12,   320, {36, 1},  {1, 2},  {2, 1},  true},    // SM5212
+};
+
+// Decodes `pulses` durations, a frame without its gap; `gapUs` is 0 when
+// the train did not carry one.
+typedef bool (*Rf433Decoder)(const uint16_t* durations, uint16_t pulses, uint32_t gapUs, Rf433Code& code);
+
+static const Rf433Protocol* findProtocol(uint8_t protocol) {
+    for (const Rf433Protocol& entry : kRf433Protocols) {
+        if (entry.protocol == protocol) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+static bool rf433Match(uint32_t measured, uint32_t expected) {
+    uint32_t tolerance = expected * RF433_TOLERANCE_PCT / 100 + RF433_TOLERANCE_US;
+    return measured + tolerance >= expected && measured <= expected + tolerance;
+}
+
+static uint32_t rf433Distance(uint32_t measured, uint32_t expected) {
+    return measured > expected ? measured - expected : expected - measured;
+}
+
+uint16_t rf433NominalPulseUs(uint8_t protocol) {
+    const Rf433Protocol* entry = findProtocol(protocol);
+    return entry ? entry->pulseUs : 0;
+}
+
+// The two durations of a bit, in transmission order, against one pair.
+// Cross-multiplied so the unknown pulse width drops out.
+static uint32_t pairError(uint32_t first, uint32_t second, const Rf433PulsePair& pair) {
+    uint32_t a = first * pair.low;
+    uint32_t b = second * pair.high;
+    return a > b ? a - b : b - a;
+}
+
+// Fits one table protocol: bits are told apart by their mark/space ratio,
+// the pulse width is learned from the whole frame, then every duration has
+// to land on it. Returns how far the frame is off, in thousandths of its
+// length, then how far the pulse is from the nominal one; -1 when the frame
+// does not fit.
+static int32_t fitProtocol(const Rf433Protocol& protocol, const uint16_t* durations, uint16_t pulses,
+                           uint32_t gapUs, Rf433Code& code) {
+    uint16_t bits = (pulses - 1) / 2;
+    uint16_t firstBit = protocol.inverted ? 1 : 0;
+    uint16_t syncIndex = protocol.inverted ? 0 : pulses - 1;
+    uint8_t syncUnits = protocol.inverted ? protocol.sync.low : protocol.sync.high;
+    uint8_t gapUnits = protocol.inverted ? protocol.sync.high : protocol.sync.low;
+
+    uint64_t value = 0;
+    uint32_t units = syncUnits;
+    uint32_t totalUs = durations[syncIndex];
+    for (uint16_t bit = 0; bit < bits; bit++) {
+        uint16_t first = durations[firstBit + 2 * bit];
+        uint16_t second = durations[firstBit + 2 * bit + 1];
+        bool one = pairError(first, second, protocol.one) < pairError(first, second, protocol.zero);
+        const Rf433PulsePair& pair = one ? protocol.one : protocol.zero;
+        value = (value << 1) | one;
+        units += pair.high + pair.low;
+        totalUs += first + second;
+    }
+    uint32_t pulseUs = totalUs / units;
+
+    if (!rf433Match(durations[syncIndex], syncUnits * pulseUs) ||
+        (gapUs && !rf433Match(gapUs, gapUnits * pulseUs))) {
+        return -1;
+    }
+    uint32_t errorUs = rf433Distance(durations[syncIndex], syncUnits * pulseUs);
+    for (uint16_t bit = 0; bit < bits; bit++) {
+        const Rf433PulsePair& pair = (value >> (bits - 1 - bit)) & 1 ? protocol.one : protocol.zero;
+        uint16_t first = durations[firstBit + 2 * bit];
+        uint16_t second = durations[firstBit + 2 * bit + 1];
+        if (!rf433Match(first, pair.high * pulseUs) || !rf433Match(second, pair.low * pulseUs)) {
+            return -1;
+        }
+        errorUs += rf433Distance(first, pair.high * pulseUs) + rf433Distance(second, pair.low * pulseUs);
+    }
+
+    code.protocol = protocol.protocol;
+    code.bits = (uint8_t)bits;
+    code.pulseUs = (uint16_t)pulseUs;
+    code.value = value;
+    uint32_t error = (uint32_t)((uint64_t)errorUs * 1000 / totalUs);
+    uint32_t distance = rf433Distance(pulseUs, protocol.pulseUs) * 1000 / protocol.pulseUs;
+    return (int32_t)(error * 1024 + (distance < 1023 ? distance : 1023));
+}
+
+// Protocols 11 and 12 differ only in pulse width, so for the same fit the
+// closest one wins
+static bool decodePulseTable(const uint16_t* durations, uint16_t pulses, uint32_t gapUs, Rf433Code& code) {
+    int32_t best = -1;
+    Rf433Code candidate;
+    for (const Rf433Protocol& protocol : kRf433Protocols) {
+        int32_t score = fitProtocol(protocol, durations, pulses, gapUs, candidate);
+        if (score >= 0 && (best < 0 || score < best)) {
+            best = score;
+            code = candidate;
+        }
+    }
+    return best >= 0;
+}
+
+// Any code of short and long pulses where a bit is one of each, long mark
+// for a one. The trailing mark is a sync of unknown width.
+static bool decodePulseWidth(const uint16_t* durations, uint16_t pulses, uint32_t, Rf433Code& code) {
+    uint16_t shortUs = 0xFFFF;
+    uint16_t longUs = 0;
+    for (uint16_t i = 0; i + 1 < pulses; i++) {
+        shortUs = durations[i] < shortUs ? durations[i] : shortUs;
+        longUs = durations[i] > longUs ? durations[i] : longUs;
+    }
+    if ((uint32_t)longUs * 2 < (uint32_t)shortUs * 3) {
+        return false;
+    }
+
+    uint16_t bits = (pulses - 1) / 2;
+    uint64_t value = 0;
+    for (uint16_t bit = 0; bit < bits; bit++) {
+        uint16_t mark = durations[2 * bit];
+        uint16_t space = durations[2 * bit + 1];
+        bool one = rf433Match(mark, longUs) && rf433Match(space, shortUs);
+        if (!one && !(rf433Match(mark, shortUs) && rf433Match(space, longUs))) {
+            return false;
+        }
+        value = (value << 1) | one;
+    }
+    code.protocol = RF433_PROTO_PWM;
+    code.bits = (uint8_t)bits;
+    code.pulseUs = shortUs;
+    code.value = value;
+    return true;
+}
+
+// Tried in order; another scheme is one more function here
+static const Rf433Decoder kRf433Decoders[] = {decodePulseTable, decodePulseWidth};
+
+bool decodeRf433(const PulseTrain& train, Rf433Code& code) {
+    code = {RF433_PROTO_RAW, 0, 0, 0};
+
+    // The frame ends at the first space long enough to be a gap
+    uint16_t pulses = train.count;
+    uint32_t gapUs = 0;
+    for (uint16_t i = 1; i < train.count; i += 2) {
+        if (train.durations[i] >= RF433_FRAME_GAP_US) {
+            pulses = i;
+            gapUs = train.durations[i];
+            break;
+        }
+    }
+    uint16_t bits = (pulses - 1) / 2;
+    if ((pulses & 1) == 0 || bits < RF433_MIN_BITS || bits > RF433_MAX_BITS) {
+        return false;
+    }
+
+    for (Rf433Decoder decoder : kRf433Decoders) {
+        if (decoder(train.durations, pulses, gapUs, code)) {
+            return true;
+        }
+    }
+    code = {RF433_PROTO_RAW, 0, 0, 0};
+    return false;
+}
+
+bool encodeRf433(const Rf433Code& code, PulseTrain& train) {
+    const Rf433Protocol* protocol = findProtocol(code.protocol);
+    if (!protocol || code.bits == 0 || code.bits > RF433_MAX_BITS) {
+        return false;
+    }
+    uint32_t pulseUs = code.pulseUs ? code.pulseUs : protocol->pulseUs;
+    const Rf433PulsePair& sync = protocol->sync;
+    uint8_t longest = sync.high > sync.low ? sync.high : sync.low;
+    if (longest * pulseUs > 0xFFFF) {
+        return false;
+    }
+
+    train.startUs = 0;
+    train.count = 0;
+    if (protocol->inverted) {
+        train.durations[train.count++] = (uint16_t)(sync.low * pulseUs);
+    }
+    for (int8_t bit = code.bits - 1; bit >= 0; bit--) {
+        const Rf433PulsePair& pair = (code.value >> bit) & 1 ? protocol->one : protocol->zero;
+        train.durations[train.count++] = (uint16_t)(pair.high * pulseUs);
+        train.durations[train.count++] = (uint16_t)(pair.low * pulseUs);
+    }
+    if (!protocol->inverted) {
+        train.durations[train.count++] = (uint16_t)(sync.high * pulseUs);
+    }
+    train.durations[train.count++] = (uint16_t)((protocol->inverted ? sync.high : sync.low) * pulseUs);
+    return true;
+}
+
+bool compileRf433Code(const Rf433Code& code, IrWaveform& out) {
+    static PulseTrain frame;
+    return encodeRf433(code, frame) && compileRf433Raw(frame, out);
+}
+
+bool compileRf433Raw(const PulseTrain& train, IrWaveform& out) {
+    uint32_t lengthUs = 0;
+    for (uint16_t i = 0; i < train.count; i++) {
+        lengthUs += train.durations[i];
+    }
+    if (!compileIrWaveform(train, nullptr, IR_DEFAULT_CARRIER_KHZ, lengthUs, out)) {
+        return false;
+    }
+    out.carrierKhz = 0;
+    return true;
+}
+
+size_t formatRf433Code(const Rf433Code& code, char* out, size_t outLen) {
+    int written;
+    if (code.protocol == RF433_PROTO_PWM) {
+        written = snprintf(out, outLen, "pwm %llX/%u %uus", (unsigned long long)code.value, code.bits,
+                           code.pulseUs);
+    } else {
+        written = snprintf(out, outLen, "p%u %llX/%u %uus", code.protocol, (unsigned long long)code.value,
+                           code.bits, code.pulseUs ? code.pulseUs : rf433NominalPulseUs(code.protocol));
+    }
+    return written < 0 || (size_t)written >= outLen ? 0 : (size_t)written;
+}
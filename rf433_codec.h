@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "frame_assembler.h"
+#include "ir_waveform.h"
+
+#ifndef RF433_FRAME_GAP_US
+#define RF433_FRAME_GAP_US 2000        // Space long enough to be a sync gap between frames
+#endif
+
+#ifndef RF433_TOLERANCE_PCT
+#define RF433_TOLERANCE_PCT 30         // Timing error accepted against a protocol
+#endif
+
+#ifndef RF433_TOLERANCE_US
+#define RF433_TOLERANCE_US 80          // Plus this much; receivers skew marks against spaces
+#endif
+
+#ifndef RF433_TX_REPEATS
+#define RF433_TX_REPEATS 10            // Frames per press when the capture did not say
+#endif
+
+#define RF433_TX_MAX_REPEATS 20
+#define RF433_MIN_BITS 8
+#define RF433_MAX_BITS 64
+
+// 1-12 are RCSwitch's protocol numbers, so records saved through it replay
+// unchanged. RF433_PROTO_PWM is any other two-width pulse code.
+#define RF433_PROTO_RAW 0
+#define RF433_PROTO_PWM 100
+
+struct Rf433Code {
+    uint8_t protocol;
+    uint8_t bits;
+    uint16_t pulseUs;              // Measured base pulse; 0 = the protocol's nominal one
+    uint64_t value;                // First bit in the most significant position, as RCSwitch
+};
+
+uint16_t rf433NominalPulseUs(uint8_t protocol);
+
+// Decodes the first frame of a train: marks and spaces as the receiver
+// framed them, optionally followed by the sync gap. Each decoder in the
+// table is tried in turn; on failure `code` is RF433_PROTO_RAW.
+bool decodeRf433(const PulseTrain& train, Rf433Code& code);
+
+// One frame of a table protocol ending with its sync gap, so repeating the
+// train reproduces the transmission.
+bool encodeRf433(const Rf433Code& code, PulseTrain& train);
+
+// Compiled for the 433 MHz transmitter, which ignores the carrier. Frames
+// are sent back to back; the gap is part of the train.
+bool compileRf433Code(const Rf433Code& code, IrWaveform& out);
+bool compileRf433Raw(const PulseTrain& train, IrWaveform& out);
+
+// "p1 ABCDEF/24 350us"
+size_t formatRf433Code(const Rf433Code& code, char* out, size_t outLen);
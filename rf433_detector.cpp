@@ -0,0 +1,180 @@
+#include "rf433_detector.h"
+
+#include <string.h>
+
+static bool widthMatch(uint16_t measured, uint16_t reference) {
+    uint32_t tolerance = (uint32_t)reference * RF433_TOLERANCE_PCT / 100 + RF433_TOLERANCE_US;
+    return measured + tolerance >= reference && measured <= reference + tolerance;
+}
+
+void Rf433FrameDetector::reset() {
+    _level = false;
+    _hasPending = false;
+    _idle = true;
+    _inFrame = false;
+    _frames = 0;
+    _burst.count = 0;
+    _changing = false;
+}
+
+bool Rf433FrameDetector::pushEdge(const IrEdge& edge, Rf433Burst& out) {
+    bool mark = edge.mark != 0;
+    // Repeated level means we missed an edge; keep timing from the first one
+    if (mark == _level) {
+        return false;
+    }
+    uint32_t duration = edge.timestampUs - _levelSinceUs;
+    _level = mark;
+
+    if (duration < RF433_GLITCH_US && !_idle) {
+        // The level that just ended was a spike: the pulse before it goes on
+        _glitches++;
+        if (_hasPending) {
+            _levelSinceUs = _pendingSinceUs;
+            _hasPending = false;
+        } else {
+            _idle = true;
+        }
+        return false;
+    }
+    if (_idle) {
+        _idle = !mark;
+        _levelSinceUs = edge.timestampUs;
+        return false;
+    }
+
+    bool ended = _hasPending && commit(_pendingSinceUs, _pendingUs, _pendingMark, out);
+    _hasPending = true;
+    _pendingMark = !mark;
+    _pendingSinceUs = _levelSinceUs;
+    _pendingUs = duration;
+    _levelSinceUs = edge.timestampUs;
+    return ended;
+}
+
+bool Rf433FrameDetector::poll(uint32_t nowUs, Rf433Burst& out) {
+    if (_idle || _level || nowUs - _levelSinceUs < RF433_BURST_GAP_US) {
+        return false;
+    }
+    if (_hasPending) {
+        commit(_pendingSinceUs, _pendingUs, _pendingMark, out);
+        _hasPending = false;
+    }
+    _idle = true;
+    bool ended = _inFrame && closeFrame(0, out);
+    return endBurst(out) || ended;
+}
+
+bool Rf433FrameDetector::commit(uint32_t startUs, uint32_t duration, bool mark, Rf433Burst& out) {
+    if (!_inFrame) {
+        // Only the leading edge of a mark can open a frame
+        if (!mark) {
+            return false;
+        }
+        _inFrame = true;
+        _overflow = false;
+        _frame.startUs = startUs;
+        _frame.count = 0;
+    } else if (!mark && duration >= RF433_FRAME_GAP_US) {
+        return closeFrame(duration, out);
+    }
+
+    if (_frame.count >= IR_MAX_PULSES || duration > 0xFFFF) {
+        _overflow = true;
+        return false;
+    }
+    _frame.durations[_frame.count++] = (uint16_t)duration;
+    return false;
+}
+
+// Noise makes frames of every width; real ones use a handful
+bool Rf433FrameDetector::frameValid() const {
+    if (_overflow || _frame.count < RF433_MIN_FRAME_PULSES) {
+        return false;
+    }
+    uint16_t widths[RF433_MAX_WIDTHS];
+    uint8_t count = 0;
+    for (uint16_t i = 0; i < _frame.count; i++) {
+        uint8_t width = 0;
+        while (width < count && !widthMatch(_frame.durations[i], widths[width])) {
+            width++;
+        }
+        if (width == count) {
+            if (count == RF433_MAX_WIDTHS) {
+                return false;
+            }
+            widths[count++] = _frame.durations[i];
+        }
+    }
+    return true;
+}
+
+bool Rf433FrameDetector::sameFrame(uint16_t offset) const {
+    for (uint16_t i = 0; i < _frame.count; i++) {
+        if (!widthMatch(_frame.durations[i], _burst.durations[offset + i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// `gapUs` is 0 when the frame was the last one and the silence after it
+// says nothing about its sync
+bool Rf433FrameDetector::closeFrame(uint32_t gapUs, Rf433Burst& out) {
+    _inFrame = false;
+    if (!frameValid()) {
+        _framesRejected++;
+        return endBurst(out);
+    }
+
+    bool ended = false;
+    if (_frames > 0 && _frame.count + 1 != _frameLength) {
+        if (_frames == 1) {
+            // Transmitters often start mid-frame, leaving the first one short
+            _frames = 0;
+            _burst.count = 0;
+        } else {
+            ended = endBurst(out);
+        }
+    }
+    if (_frames > 0 && !sameFrame(_lastOffset)) {
+        _changing = true;
+    }
+    appendFrame(gapUs);
+    return ended;
+}
+
+void Rf433FrameDetector::appendFrame(uint32_t gapUs) {
+    if (_frames == 0) {
+        _frameLength = _frame.count + 1;
+        _burst.startUs = _frame.startUs;
+    }
+    if (gapUs == 0) {
+        gapUs = _frames > 0 ? _burst.durations[_lastOffset + _frameLength - 1] : RF433_BURST_GAP_US;
+    }
+    // Once the burst is full, further frames are only counted
+    if (_burst.count + _frameLength <= IR_MAX_PULSES) {
+        _lastOffset = _burst.count;
+        memcpy(_burst.durations + _burst.count, _frame.durations, _frame.count * sizeof(_frame.durations[0]));
+        _burst.count += _frame.count;
+        _burst.durations[_burst.count++] = gapUs > 0xFFFF ? 0xFFFF : (uint16_t)gapUs;
+    }
+    if (_frames < 0xFF) {
+        _frames++;
+    }
+}
+
+bool Rf433FrameDetector::endBurst(Rf433Burst& out) {
+    bool ended = _frames >= RF433_MIN_FRAMES;
+    if (ended) {
+        out.train.startUs = _burst.startUs;
+        out.train.count = _changing ? _burst.count : _frameLength;
+        memcpy(out.train.durations, _burst.durations, out.train.count * sizeof(_burst.durations[0]));
+        out.repeats = _changing ? 1 : (_frames < RF433_TX_MAX_REPEATS ? _frames : RF433_TX_MAX_REPEATS);
+        _bursts++;
+    }
+    _frames = 0;
+    _burst.count = 0;
+    _changing = false;
+    return ended;
+}
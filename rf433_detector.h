@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "frame_assembler.h"
+#include "rf433_codec.h"
+
+#ifndef RF433_GLITCH_US
+#define RF433_GLITCH_US 60             // Shorter pulses are receiver noise and merged away
+#endif
+
+#ifndef RF433_BURST_GAP_US
+#define RF433_BURST_GAP_US 40000       // Silence that ends a button press
+#endif
+
+#ifndef RF433_MIN_FRAME_PULSES
+#define RF433_MIN_FRAME_PULSES (2 * RF433_MIN_BITS + 1)
+#endif
+
+#ifndef RF433_MAX_WIDTHS
+#define RF433_MAX_WIDTHS 6             // Distinct pulse widths a real frame may use
+#endif
+
+#define RF433_MIN_FRAMES 2             // A frame heard once is not told from noise
+
+// What a press transmitted, ready to replay: `train` sent `repeats` times.
+// Frames that repeat unchanged leave one frame and its gap; frames that
+// change from one to the next (rolling counters, toggle bits) leave every
+// frame that fitted, in order, sent once.
+struct Rf433Burst {
+    uint8_t repeats;
+    PulseTrain train;
+};
+
+// Turns timestamped edges from a 433 MHz OOK receiver into bursts. Pulses
+// under RF433_GLITCH_US are merged into their neighbours; frames are cut at
+// sync gaps and kept only if they are long enough and use few distinct
+// widths, which receiver noise does not; a press is reported once the same
+// frame shape has been heard RF433_MIN_FRAMES times. Has no hardware
+// dependencies so edge streams can be replayed on a host.
+class Rf433FrameDetector {
+public:
+    // Feeds one edge. Returns true when it ended a burst, copied to `out`.
+    bool pushEdge(const IrEdge& edge, Rf433Burst& out);
+
+    // Ends the pending burst once the line has been quiet for RF433_BURST_GAP_US.
+    bool poll(uint32_t nowUs, Rf433Burst& out);
+
+    void reset();
+
+    uint32_t bursts() const { return _bursts; }
+    uint32_t framesRejected() const { return _framesRejected; }
+    uint32_t glitches() const { return _glitches; }
+
+private:
+    bool commit(uint32_t startUs, uint32_t duration, bool mark, Rf433Burst& out);
+    bool closeFrame(uint32_t gapUs, Rf433Burst& out);
+    bool frameValid() const;
+    bool sameFrame(uint16_t offset) const;
+    void appendFrame(uint32_t gapUs);
+    bool endBurst(Rf433Burst& out);
+
+    // Line state, one pulse behind so a glitch can still be undone
+    bool _level = false;
+    uint32_t _levelSinceUs = 0;
+    bool _hasPending = false;
+    bool _pendingMark = false;
+    uint32_t _pendingSinceUs = 0;
+    uint32_t _pendingUs = 0;
+    bool _idle = true;
+
+    bool _inFrame = false;
+    bool _overflow = false;
+    PulseTrain _frame;
+
+    PulseTrain _burst;             // Whole frames with their gaps, as heard
+    uint8_t _frames = 0;
+    uint16_t _frameLength = 0;     // Pulses per frame, gap included
+    uint16_t _lastOffset = 0;      // Where the latest frame starts in _burst
+    bool _changing = false;        // Some frame differed from the one before
+
+    uint32_t _bursts = 0;
+    uint32_t _framesRejected = 0;
+    uint32_t _glitches = 0;
+};
@@ -0,0 +1,34 @@
+#include "rf433_transmit.h"
+
+#include <Arduino.h>
+#include <driver/gpio.h>
+
+bool Rf433Transmitter::begin(uint8_t pin) {
+    _pin = pin;
+    pinMode(pin, OUTPUT);
+    digitalWrite(pin, LOW);
+    _ready = true;
+    return true;
+}
+
+void Rf433Transmitter::send(const IrWaveform& waveform, uint8_t repeats) {
+    if (!_ready || waveform.frameSymbols == 0) {
+        return;
+    }
+    gpio_num_t pin = (gpio_num_t)_pin;
+    uint32_t edgeUs = micros();
+    for (uint8_t repeat = 0; repeat < repeats; repeat++) {
+        for (uint16_t i = 0; i < waveform.frameSymbols; i++) {
+            const IrSymbol& symbol = waveform.symbols[i];
+            bool levels[2] = {symbol.level0(), symbol.level1()};
+            uint16_t durations[2] = {symbol.duration0(), symbol.duration1()};
+            for (uint8_t half = 0; half < 2 && durations[half] > 0; half++) {
+                gpio_set_level(pin, levels[half]);
+                edgeUs += durations[half];
+                while ((int32_t)(micros() - edgeUs) < 0) {
+                }
+            }
+        }
+    }
+    gpio_set_level(pin, 0);
+}
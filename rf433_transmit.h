@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "ir_waveform.h"
+
+// 433 MHz OOK transmitter. The RMT channels all go to the IR transmitter,
+// so levels are driven from the CPU; each edge is timed from the start of
+// the send rather than from the edge before, so a late edge does not push
+// every later one back.
+class Rf433Transmitter {
+public:
+    bool begin(uint8_t pin);
+
+    // Plays the compiled frame `repeats` times back to back. Blocks until done.
+    void send(const IrWaveform& waveform, uint8_t repeats);
+
+private:
+    uint8_t _pin = 0;
+    bool _ready = false;
+};
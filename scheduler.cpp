@@ -0,0 +1,162 @@
+#include "scheduler.h"
+
+#include "trace.h"
+
+#define SCHEDULER_IDLE_US 10000    // Reported when nothing is armed
+
+int8_t Scheduler::add(const char* name, TaskFunction function, uint32_t periodUs) {
+    if (_taskCount >= SCHEDULER_MAX_TASKS) {
+        return -1;
+    }
+    int8_t id = (int8_t)_taskCount++;
+    Task& task = _tasks[id];
+    task.name = name;
+    task.function = function;
+    task.periodUs = periodUs;
+    task.heapPos = -1;
+    task.enabled = periodUs > 0;
+    task.stats = {0, 0, 0};
+
+    if (periodUs > 0) {
+        task.deadlineUs = _clock();
+        push(id);
+    }
+    return id;
+}
+
+void Scheduler::runIn(int8_t id, uint32_t delayUs) {
+    if (id < 0 || id >= _taskCount) {
+        return;
+    }
+    remove(id);
+    _tasks[id].enabled = true;
+    _tasks[id].deadlineUs = _clock() + delayUs;
+    push(id);
+}
+
+void Scheduler::setPeriod(int8_t id, uint32_t periodUs) {
+    if (id >= 0 && id < _taskCount) {
+        _tasks[id].periodUs = periodUs;
+    }
+}
+
+void Scheduler::cancel(int8_t id) {
+    if (id >= 0 && id < _taskCount) {
+        _tasks[id].enabled = false;
+        remove(id);
+    }
+}
+
+bool Scheduler::armed(int8_t id) const {
+    return id >= 0 && id < _taskCount && _tasks[id].heapPos >= 0;
+}
+
+bool Scheduler::heapLess(uint8_t a, uint8_t b) const {
+    return before(_tasks[_heap[a]].deadlineUs, _tasks[_heap[b]].deadlineUs);
+}
+
+void Scheduler::heapSwap(uint8_t a, uint8_t b) {
+    int8_t id = _heap[a];
+    _heap[a] = _heap[b];
+    _heap[b] = id;
+    _tasks[_heap[a]].heapPos = (int8_t)a;
+    _tasks[_heap[b]].heapPos = (int8_t)b;
+}
+
+void Scheduler::siftUp(uint8_t pos) {
+    while (pos > 0) {
+        uint8_t parent = (pos - 1) / 2;
+        if (!heapLess(pos, parent)) {
+            break;
+        }
+        heapSwap(pos, parent);
+        pos = parent;
+    }
+}
+
+void Scheduler::siftDown(uint8_t pos) {
+    for (;;) {
+        uint8_t smallest = pos;
+        uint8_t left = 2 * pos + 1;
+        uint8_t right = left + 1;
+        if (left < _heapSize && heapLess(left, smallest)) {
+            smallest = left;
+        }
+        if (right < _heapSize && heapLess(right, smallest)) {
+            smallest = right;
+        }
+        if (smallest == pos) {
+            return;
+        }
+        heapSwap(pos, smallest);
+        pos = smallest;
+    }
+}
+
+void Scheduler::push(int8_t id) {
+    uint8_t pos = _heapSize++;
+    _heap[pos] = id;
+    _tasks[id].heapPos = (int8_t)pos;
+    siftUp(pos);
+}
+
+void Scheduler::remove(int8_t id) {
+    int8_t pos = _tasks[id].heapPos;
+    if (pos < 0) {
+        return;
+    }
+    uint8_t last = --_heapSize;
+    if (pos != last) {
+        heapSwap((uint8_t)pos, last);
+    }
+    _tasks[id].heapPos = -1;
+    if (pos < _heapSize) {
+        siftDown((uint8_t)pos);
+        siftUp((uint8_t)pos);
+    }
+}
+
+uint32_t Scheduler::runDue() {
+    // Bounded so a task that keeps re-arming itself cannot starve the caller
+    for (uint8_t budget = _taskCount; budget > 0 && _heapSize > 0; budget--) {
+        int8_t id = _heap[0];
+        Task& task = _tasks[id];
+        uint32_t start = _clock();
+        if (before(start, task.deadlineUs)) {
+            break;
+        }
+
+        remove(id);
+        uint32_t late = start - task.deadlineUs;
+        {
+            TRACE_SCOPE(TRACE_TASK, id);
+            task.function();
+        }
+        uint32_t elapsed = _clock() - start;
+
+        task.stats.runs++;
+        if (elapsed > task.stats.maxRunUs) {
+            task.stats.maxRunUs = elapsed;
+        }
+        if (late > task.stats.maxLateUs) {
+            task.stats.maxLateUs = late;
+        }
+
+        // Periodic tasks keep their cadence unless they overran a whole period
+        if (task.enabled && task.periodUs > 0 && task.heapPos < 0) {
+            task.deadlineUs += task.periodUs;
+            uint32_t now = _clock();
+            if (before(task.deadlineUs, now)) {
+                task.deadlineUs = now + task.periodUs;
+            }
+            push(id);
+        }
+    }
+
+    if (_heapSize == 0) {
+        return SCHEDULER_IDLE_US;
+    }
+    uint32_t now = _clock();
+    uint32_t next = _tasks[_heap[0]].deadlineUs;
+    return before(now, next) ? next - now : 0;
+}
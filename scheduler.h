@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifndef SCHEDULER_MAX_TASKS
+#define SCHEDULER_MAX_TASKS 16
+#endif
+
+struct TaskStats {
+    uint32_t runs;
+    uint32_t maxRunUs;             // Longest single run
+    uint32_t maxLateUs;            // Worst delay between deadline and start
+};
+
+// Cooperative deadline scheduler. Armed tasks sit in a min-heap ordered by
+// deadline; runDue() runs whatever is due and reports how long the caller
+// may sleep. The clock is injected so the scheduler runs against a fake
+// clock on a host.
+class Scheduler {
+public:
+    typedef uint32_t (*Clock)();
+    typedef void (*TaskFunction)();
+
+    explicit Scheduler(Clock clock) : _clock(clock) {}
+
+    // Periodic tasks are armed to run immediately. A period of zero makes a
+    // one-shot task that only runs after runIn(). Returns -1 when full.
+    int8_t add(const char* name, TaskFunction function, uint32_t periodUs);
+
+    // Arms (or re-arms) a task to run once the delay has elapsed.
+    void runIn(int8_t id, uint32_t delayUs);
+    void setPeriod(int8_t id, uint32_t periodUs);
+    void cancel(int8_t id);
+    bool armed(int8_t id) const;
+
+    // Runs every due task, earliest deadline first, and returns the time
+    // until the next deadline.
+    uint32_t runDue();
+
+    const TaskStats& stats(int8_t id) const { return _tasks[id].stats; }
+    const char* name(int8_t id) const { return _tasks[id].name; }
+    uint8_t taskCount() const { return _taskCount; }
+    uint32_t now() const { return _clock(); }
+
+private:
+    struct Task {
+        const char* name;
+        TaskFunction function;
+        uint32_t periodUs;
+        uint32_t deadlineUs;
+        int8_t heapPos;            // -1 when not armed
+        bool enabled;              // Cleared by cancel(), even from inside the task
+        TaskStats stats;
+    };
+
+    static bool before(uint32_t a, uint32_t b) { return (int32_t)(a - b) < 0; }
+    bool heapLess(uint8_t a, uint8_t b) const;
+    void heapSwap(uint8_t a, uint8_t b);
+    void siftUp(uint8_t pos);
+    void siftDown(uint8_t pos);
+    void push(int8_t id);
+    void remove(int8_t id);
+
+    Clock _clock;
+    Task _tasks[SCHEDULER_MAX_TASKS];
+    int8_t _heap[SCHEDULER_MAX_TASKS];
+    uint8_t _taskCount = 0;
+    uint8_t _heapSize = 0;
+};
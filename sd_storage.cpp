@@ -0,0 +1,108 @@
+#include "sd_storage.h"
+
+#include <SD.h>
+
+bool SdStorageFile::open(fs::FS& fs, const char* path, StorageMode mode) {
+    close();
+    // "r+" keeps existing contents; FILE_WRITE would truncate the library
+    const char* modes[] = {"r", "r+", "w+"};
+    _file = fs.open(path, modes[mode]);
+    return (bool)_file;
+}
+
+void SdStorageFile::close() {
+    if (_file) {
+        _file.close();
+    }
+}
+
+bool SdStorageFile::available() {
+    return _file.available() > 0;
+}
+
+size_t SdStorageFile::readLine(char* line, size_t maxLength) {
+    return _file.readBytesUntil('\n', line, maxLength);
+}
+
+size_t SdStorageFile::read(void* buffer, size_t maxLength) {
+    int length = _file.read((uint8_t*)buffer, maxLength);
+    return length > 0 ? (size_t)length : 0;
+}
+
+bool SdStorageFile::readAt(uint32_t offset, void* buffer, size_t length) {
+    if (!_file.seek(offset)) {
+        return false;
+    }
+    return _file.read((uint8_t*)buffer, length) == length;
+}
+
+bool SdStorageFile::writeAt(uint32_t offset, const void* buffer, size_t length) {
+    if (!_file.seek(offset)) {
+        return false;
+    }
+    return _file.write((const uint8_t*)buffer, length) == length;
+}
+
+bool SdStorageDir::open(fs::FS& fs, const char* path) {
+    close();
+    _dir = fs.open(path);
+    if (_dir && !_dir.isDirectory()) {
+        close();
+    }
+    return (bool)_dir;
+}
+
+void SdStorageDir::close() {
+    if (_dir) {
+        _dir.close();
+    }
+}
+
+bool SdStorageDir::next(char* name, size_t size) {
+    for (fs::File entry = _dir.openNextFile(); entry; entry = _dir.openNextFile()) {
+        if (!entry.isDirectory() && entry.name()[0] != '.') {
+            snprintf(name, size, "%s", entry.name());
+            return true;
+        }
+    }
+    return false;
+}
+
+// Room for both handle pools, and the entry each listing opens as it steps
+bool SdStorage::begin() {
+    return SD.begin(SS, SPI, 4000000, "/sd", STORAGE_MAX_OPEN_FILES + STORAGE_MAX_OPEN_DIRS * 2);
+}
+
+bool SdStorage::exists(const char* path) {
+    return SD.exists(path);
+}
+
+bool SdStorage::mkdir(const char* path) {
+    return SD.mkdir(path);
+}
+
+bool SdStorage::remove(const char* path) {
+    return SD.remove(path);
+}
+
+bool SdStorage::rename(const char* from, const char* to) {
+    return SD.rename(from, to);
+}
+
+StorageFile* SdStorage::open(const char* path, StorageMode mode) {
+    for (SdStorageFile& file : _files) {
+        if (!file.isOpen()) {
+            return file.open(SD, path, mode) ? &file : nullptr;
+        }
+    }
+    return nullptr;
+}
+
+StorageDir* SdStorage::openDir(const char* path) {
+    for (SdStorageDir& dir : _dirs) {
+        if (!dir.isOpen()) {
+            return dir.open(SD, path) ? &dir : nullptr;
+        }
+    }
+    return nullptr;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <FS.h>
+
+#include "hal.h"
+
+// StorageFile backed by an fs::File handle.
+class SdStorageFile : public StorageFile {
+public:
+    bool open(fs::FS& fs, const char* path, StorageMode mode);
+    bool isOpen() { return (bool)_file; }
+
+    void close() override;
+    bool available() override;
+    size_t readLine(char* line, size_t maxLength) override;
+    size_t read(void* buffer, size_t maxLength) override;
+    bool readAt(uint32_t offset, void* buffer, size_t length) override;
+    bool writeAt(uint32_t offset, const void* buffer, size_t length) override;
+
+private:
+    fs::File _file;
+};
+
+// StorageDir backed by an fs::File directory handle.
+class SdStorageDir : public StorageDir {
+public:
+    bool open(fs::FS& fs, const char* path);
+    bool isOpen() { return (bool)_dir; }
+
+    void close() override;
+    bool next(char* name, size_t size) override;
+
+private:
+    fs::File _dir;
+};
+
+// StorageHal on the SD card, handing out fixed pools of file and directory
+// handles.
+class SdStorage : public StorageHal {
+public:
+    bool begin() override;
+    bool exists(const char* path) override;
+    bool mkdir(const char* path) override;
+    bool remove(const char* path) override;
+    bool rename(const char* from, const char* to) override;
+    StorageFile* open(const char* path, StorageMode mode) override;
+    StorageDir* openDir(const char* path) override;
+
+private:
+    SdStorageFile _files[STORAGE_MAX_OPEN_FILES];
+    SdStorageDir _dirs[STORAGE_MAX_OPEN_DIRS];
+};
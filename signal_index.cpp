@@ -0,0 +1,252 @@
+#include "signal_index.h"
+
+#include <string.h>
+
+#define SIGNAL_INDEX_ZERO_CHUNK 256
+#define SIGNAL_INDEX_MAX_REMOTE_SLOTS 0x10000   // Signal slots keep a remote's slot in 16 bits
+
+static uint32_t hashRemote(const char* name) {
+    uint32_t hash = 2166136261UL;
+    for (size_t i = 0; i < REMOTE_NAME_MAX - 1 && name[i]; i++) {
+        hash ^= (uint8_t)name[i];
+        hash *= 16777619UL;
+    }
+    return hash;
+}
+
+static uint32_t slotsFor(uint32_t capacity) {
+    uint32_t slots = 1;
+    while (slots < capacity * 2) {
+        slots <<= 1;
+    }
+    return slots;
+}
+
+uint32_t SignalIndex::fileSize(uint32_t capacity, uint32_t remoteCapacity) {
+    return sizeof(SignalIndexHeader) + slotsFor(remoteCapacity) * sizeof(RemoteSlot) +
+           slotsFor(capacity) * sizeof(SignalSlot);
+}
+
+bool SignalIndex::format(LibraryFile& file, uint32_t capacity, uint32_t remoteCapacity, uint32_t& offset,
+                         uint32_t maxBytes) {
+    static const uint8_t zeros[SIGNAL_INDEX_ZERO_CHUNK] = {};
+    uint32_t remoteSlots = slotsFor(remoteCapacity);
+    if (capacity == 0 || remoteCapacity == 0 || remoteSlots > SIGNAL_INDEX_MAX_REMOTE_SLOTS) {
+        return false;
+    }
+
+    // The header's bytes are zeroed first, so the file is written front to back
+    uint32_t size = fileSize(capacity, remoteCapacity);
+    uint32_t end = size - offset > maxBytes ? offset + maxBytes : size;
+    while (offset < end) {
+        uint32_t chunk = end - offset < SIGNAL_INDEX_ZERO_CHUNK ? end - offset : SIGNAL_INDEX_ZERO_CHUNK;
+        if (!file.writeAt(offset, zeros, chunk)) {
+            return false;
+        }
+        offset += chunk;
+    }
+    if (offset < size) {
+        return true;
+    }
+
+    SignalIndexHeader header = {};
+    header.magic = SIGNAL_INDEX_MAGIC;
+    header.version = SIGNAL_INDEX_VERSION;
+    header.slotSize = sizeof(SignalSlot);
+    header.capacity = capacity;
+    header.slots = slotsFor(capacity);
+    header.remoteCapacity = remoteCapacity;
+    header.remoteSlots = remoteSlots;
+    return file.writeAt(0, &header, sizeof(header));
+}
+
+bool SignalIndex::open(LibraryFile* file) {
+    _file = file;
+    _bytesRead = 0;
+    if (!read(0, &_header, sizeof(_header)) || _header.magic != SIGNAL_INDEX_MAGIC ||
+        _header.version != SIGNAL_INDEX_VERSION || _header.slotSize != sizeof(SignalSlot) ||
+        _header.slots < _header.capacity * 2 || (_header.slots & (_header.slots - 1)) != 0 ||
+        _header.remoteSlots < _header.remoteCapacity * 2 || (_header.remoteSlots & (_header.remoteSlots - 1)) != 0 ||
+        _header.remoteSlots > SIGNAL_INDEX_MAX_REMOTE_SLOTS) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void SignalIndex::close() {
+    _file = nullptr;
+    _header = {};
+}
+
+bool SignalIndex::read(uint32_t offset, void* buffer, size_t length) {
+    if (!_file || !_file->readAt(offset, buffer, length)) {
+        return false;
+    }
+    _bytesRead += length;
+    return true;
+}
+
+bool SignalIndex::writeHeader() {
+    return _file->writeAt(0, &_header, sizeof(_header));
+}
+
+bool SignalIndex::locateRemote(const char* remote, uint32_t& slot, RemoteSlot& entry) {
+    uint32_t mask = _header.remoteSlots - 1;
+    slot = hashRemote(remote) & mask;
+    for (uint32_t probe = 0; probe < _header.remoteSlots; probe++) {
+        if (!read(remotesOffset() + slot * sizeof(RemoteSlot), &entry, sizeof(entry))) {
+            return false;
+        }
+        if (entry.name[0] == '\0' || strncmp(entry.name, remote, REMOTE_NAME_MAX - 1) == 0) {
+            return true;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return false;
+}
+
+bool SignalIndex::add(const char* remote, const char* button, const Fingerprint& fingerprint) {
+    if (!isOpen() || remote[0] == '\0') {
+        return false;
+    }
+    uint32_t remoteSlot;
+    RemoteSlot remoteEntry;
+    if (!locateRemote(remote, remoteSlot, remoteEntry)) {
+        return false;
+    }
+    bool newRemote = remoteEntry.name[0] == '\0';
+    if (newRemote && _header.remoteCount >= _header.remoteCapacity) {
+        return false;
+    }
+
+    uint32_t mask = _header.slots - 1;
+    uint32_t slot = fingerprint.key & mask;
+    SignalSlot entry;
+    for (uint32_t probe = 0; probe < _header.slots; probe++) {
+        if (!read(signalsOffset() + slot * sizeof(SignalSlot), &entry, sizeof(entry))) {
+            return false;
+        }
+        if (entry.remote == 0) {
+            break;
+        }
+        // Indexed already, by a save or an earlier pass over the library
+        if (!newRemote && entry.remote == remoteSlot + 1 && entry.key == fingerprint.key &&
+            entry.length == fingerprint.length && entry.band == fingerprint.band &&
+            strncmp(entry.button, button, BUTTON_NAME_MAX - 1) == 0) {
+            return true;
+        }
+        slot = (slot + 1) & mask;
+    }
+    if (entry.remote != 0 || _header.count >= _header.capacity) {
+        return false;
+    }
+
+    if (newRemote) {
+        memset(&remoteEntry, 0, sizeof(remoteEntry));
+        strncpy(remoteEntry.name, remote, REMOTE_NAME_MAX - 1);
+        if (!_file->writeAt(remotesOffset() + remoteSlot * sizeof(RemoteSlot), &remoteEntry, sizeof(remoteEntry))) {
+            return false;
+        }
+        _header.remoteCount++;
+    }
+
+    memset(&entry, 0, sizeof(entry));
+    entry.key = fingerprint.key;
+    entry.length = fingerprint.length;
+    entry.remote = (uint16_t)(remoteSlot + 1);
+    entry.band = fingerprint.band;
+    strncpy(entry.button, button, BUTTON_NAME_MAX - 1);
+    if (!_file->writeAt(signalsOffset() + slot * sizeof(SignalSlot), &entry, sizeof(entry))) {
+        return false;
+    }
+    _header.count++;
+    return writeHeader();
+}
+
+// Raw timings are only expanded for buttons with no decoded value
+bool SignalIndex::add(const char* remote, const ButtonRecord& record, const PulseCode* raw) {
+    static PulseTrain train;
+    Fingerprint fingerprint;
+    if (!fingerprintRecord(record, nullptr, fingerprint) &&
+        (!raw || !raw->length || !decodePulses(raw->bytes, raw->length, train) ||
+         !fingerprintRecord(record, &train, fingerprint))) {
+        return true;
+    }
+    return add(remote, record.name, fingerprint);
+}
+
+bool SignalIndex::addLibrary(const char* remote, RemoteLibrary& library, uint32_t& next, uint32_t maxRecords) {
+    static PulseCode raw;
+    ButtonRecord record;
+    for (uint32_t i = 0; i < maxRecords && next < library.count(); i++, next++) {
+        raw.length = 0;
+        if (!library.recordAt(next, record) || (record.rawLength && !library.readRaw(record, raw)) ||
+            !add(remote, record, raw.length ? &raw : nullptr)) {
+            return false;
+        }
+    }
+    return next < library.count() || markIndexed(remote, library);
+}
+
+bool SignalIndex::markIndexed(const char* remote, const RemoteLibrary& library) {
+    uint32_t slot;
+    RemoteSlot entry;
+    if (!isOpen() || !locateRemote(remote, slot, entry)) {
+        return false;
+    }
+    bool newRemote = entry.name[0] == '\0';
+    if (newRemote && library.count() == 0) {
+        return true;
+    }
+    if (newRemote && _header.remoteCount >= _header.remoteCapacity) {
+        return false;
+    }
+    if (newRemote) {
+        memset(&entry, 0, sizeof(entry));
+        strncpy(entry.name, remote, REMOTE_NAME_MAX - 1);
+        _header.remoteCount++;
+    }
+    entry.count = library.count();
+    entry.rawBytes = library.rawBytes();
+    return _file->writeAt(remotesOffset() + slot * sizeof(RemoteSlot), &entry, sizeof(entry)) &&
+           (!newRemote || writeHeader());
+}
+
+bool SignalIndex::current(const char* remote, const RemoteLibrary& library) {
+    uint32_t slot;
+    RemoteSlot entry;
+    if (!isOpen() || !locateRemote(remote, slot, entry)) {
+        return false;
+    }
+    if (entry.name[0] == '\0') {
+        return library.count() == 0;
+    }
+    return entry.count == library.count() && entry.rawBytes == library.rawBytes();
+}
+
+uint8_t SignalIndex::find(const Fingerprint& fingerprint, SignalHit* hits, uint8_t maxHits) {
+    if (!isOpen()) {
+        return 0;
+    }
+    uint32_t mask = _header.slots - 1;
+    uint32_t slot = fingerprint.key & mask;
+    uint8_t found = 0;
+    SignalSlot entry;
+    RemoteSlot remote;
+    for (uint32_t probe = 0; probe < _header.slots && found < maxHits; probe++) {
+        if (!read(signalsOffset() + slot * sizeof(SignalSlot), &entry, sizeof(entry)) || entry.remote == 0) {
+            break;
+        }
+        if (entry.key == fingerprint.key && entry.length == fingerprint.length && entry.band == fingerprint.band &&
+            read(remotesOffset() + (entry.remote - 1) * sizeof(RemoteSlot), &remote, sizeof(remote))) {
+            memcpy(hits[found].remote, remote.name, REMOTE_NAME_MAX);
+            hits[found].remote[REMOTE_NAME_MAX - 1] = '\0';
+            memcpy(hits[found].button, entry.button, BUTTON_NAME_MAX);
+            hits[found].button[BUTTON_NAME_MAX - 1] = '\0';
+            found++;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return found;
+}
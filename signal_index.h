@@ -0,0 +1,123 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "button_cache.h"
+#include "button_record.h"
+#include "fingerprint.h"
+#include "pulse_codec.h"
+#include "remote_library.h"
+
+#define SIGNAL_INDEX_MAGIC 0x58444953UL   // "SIDX"
+#define SIGNAL_INDEX_VERSION 1
+
+#ifndef SIGNAL_INDEX_MAX_HITS
+#define SIGNAL_INDEX_MAX_HITS 4        // Remotes named for one signal
+#endif
+
+struct SignalIndexHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t slotSize;
+    uint32_t count;                // Signal slots in use
+    uint32_t capacity;             // Signals before the index is full()
+    uint32_t slots;                // Power of two, at least twice the capacity
+    uint32_t remoteCount;
+    uint32_t remoteCapacity;
+    uint32_t remoteSlots;          // Power of two, at least twice the remote capacity
+};
+
+static_assert(sizeof(SignalIndexHeader) == 32, "SignalIndexHeader must stay 32 bytes on disk");
+
+struct SignalHit {
+    char remote[REMOTE_NAME_MAX];
+    char button[BUTTON_NAME_MAX];
+};
+
+// Which remotes hold a signal, across every library on the card.
+// Layout: header | remote table | signal table, both open-addressed. A
+// remote's slot keeps the library size it was indexed at, so a changed
+// file can be told without reading its buttons. A signal's slot holds the
+// fingerprint key, the remote's slot and the button name, so a lookup
+// reads a few 32-byte slots and the remotes they point to.
+//
+// Entries are only added: one for a button that was since overwritten
+// stays until the index is rebuilt, so callers check hits against the
+// library before trusting them.
+class SignalIndex {
+public:
+    static uint32_t fileSize(uint32_t capacity, uint32_t remoteCapacity);
+
+    // Writes an empty index up to `maxBytes` a call, from `offset` on, so a
+    // large one can be laid out over many task runs. The header goes last,
+    // so open() fails on a file cut short. Done once `offset` reaches
+    // fileSize(); false on a write error.
+    static bool format(LibraryFile& file, uint32_t capacity, uint32_t remoteCapacity, uint32_t& offset,
+                       uint32_t maxBytes = 0xFFFFFFFF);
+
+    bool open(LibraryFile* file);
+    void close();
+    bool isOpen() const { return _file != nullptr; }
+
+    // Fails when the index is full() or the remote table is.
+    bool add(const char* remote, const char* button, const Fingerprint& fingerprint);
+
+    // Fingerprints a stored button, raw timings and all. A button with no
+    // usable signal is left out and counts as added.
+    bool add(const char* remote, const ButtonRecord& record, const PulseCode* raw);
+
+    // Adds up to `maxRecords` buttons of `library` from `next` on. Once the
+    // last is in, the library's size is recorded and `next` is its count.
+    bool addLibrary(const char* remote, RemoteLibrary& library, uint32_t& next, uint32_t maxRecords);
+
+    // Records the library's size as indexed; a library with no buttons that
+    // was never indexed is left out.
+    bool markIndexed(const char* remote, const RemoteLibrary& library);
+
+    // True when the library is the size it was indexed at, or is empty and
+    // was never indexed.
+    bool current(const char* remote, const RemoteLibrary& library);
+
+    // Fills up to `maxHits` remotes and buttons holding the signal, in the
+    // order they were indexed. Returns the number found.
+    uint8_t find(const Fingerprint& fingerprint, SignalHit* hits, uint8_t maxHits);
+
+    uint32_t count() const { return _header.count; }
+    uint32_t capacity() const { return _header.capacity; }
+    uint32_t remoteCount() const { return _header.remoteCount; }
+    bool full() const { return _header.count >= _header.capacity || _header.remoteCount >= _header.remoteCapacity; }
+
+    // Bytes fetched from the file since open(), for lookup cost measurements.
+    uint32_t bytesRead() const { return _bytesRead; }
+
+private:
+    struct RemoteSlot {
+        char name[REMOTE_NAME_MAX];    // Empty = free
+        uint32_t count;            // Library size when indexed
+        uint32_t rawBytes;
+    };
+
+    struct SignalSlot {
+        uint32_t key;
+        uint16_t length;
+        uint16_t remote;           // Remote slot + 1, 0 = free
+        uint8_t band;
+        uint8_t reserved[3];
+        char button[BUTTON_NAME_MAX];
+    };
+
+    static_assert(sizeof(SignalSlot) == 32, "SignalSlot must stay 32 bytes on disk");
+
+    uint32_t remotesOffset() const { return sizeof(SignalIndexHeader); }
+    uint32_t signalsOffset() const { return remotesOffset() + _header.remoteSlots * sizeof(RemoteSlot); }
+
+    bool read(uint32_t offset, void* buffer, size_t length);
+    bool writeHeader();
+    // Slot of `remote`, or the free one it would go in
+    bool locateRemote(const char* remote, uint32_t& slot, RemoteSlot& entry);
+
+    LibraryFile* _file = nullptr;
+    SignalIndexHeader _header = {};
+    uint32_t _bytesRead = 0;
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef SCRATCH_ARENA_SIZE
+#define SCRATCH_ARENA_SIZE 8192
+#endif
+
+// Bump allocator over a static block. Scratch buffers are carved out for
+// the duration of one operation and released together by an ArenaScope,
+// so per-operation temporaries never reach the heap.
+class StaticArena {
+public:
+    StaticArena(uint8_t* memory, size_t size) : _memory(memory), _size(size) {}
+
+    // Returns nullptr when the block is exhausted.
+    void* allocate(size_t size, size_t align = alignof(max_align_t)) {
+        size_t start = (_used + align - 1) & ~(align - 1);
+        if (start > _size || size > _size - start) {
+            _failures++;
+            return nullptr;
+        }
+        _used = start + size;
+        if (_used > _highWater) {
+            _highWater = _used;
+        }
+        return _memory + start;
+    }
+
+    template <typename T>
+    T* allocate(size_t count = 1) {
+        return static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+    }
+
+    size_t mark() const { return _used; }
+    void rewind(size_t mark) { _used = mark < _used ? mark : _used; }
+
+    size_t used() const { return _used; }
+    size_t size() const { return _size; }
+    size_t highWater() const { return _highWater; }
+    uint32_t failures() const { return _failures; }
+
+private:
+    uint8_t* _memory;
+    size_t _size;
+    size_t _used = 0;
+    size_t _highWater = 0;
+    uint32_t _failures = 0;
+};
+
+// Releases everything allocated from the arena since construction.
+class ArenaScope {
+public:
+    explicit ArenaScope(StaticArena& arena) : _arena(arena), _mark(arena.mark()) {}
+    ~ArenaScope() { _arena.rewind(_mark); }
+
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+private:
+    StaticArena& _arena;
+    size_t _mark;
+};
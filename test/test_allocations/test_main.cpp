@@ -0,0 +1,103 @@
+// The firmware on the simulator HAL must not touch the heap once it is up:
+// pio test -e native -f test_allocations
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <unity.h>
+
+#include "../../app.h"
+#include "../../ir_codec.h"
+#include "../../ui_framebuffer.h"
+#include "../../native/host_storage.h"
+#include "../../native/sim_hal.h"
+
+#define SCREEN_WIDTH 320
+#define SCREEN_HEIGHT 240
+#define LIBRARY_PATH "/remote_names/tv.rpl"
+
+static uint16_t canvas[SCREEN_WIDTH * SCREEN_HEIGHT];
+static uint16_t panel[SCREEN_WIDTH * SCREEN_HEIGHT];
+static char sdRoot[] = "/tmp/test_allocations_XXXXXX";
+
+static SimSystem* system_;
+static HostStorage* storage;
+static SimRadio* radio;
+static SimKeyboard* keyboard;
+static SimButtons* buttons;
+
+static void runUntilMs(uint32_t ms) {
+    while (system_->micros() / 1000 < ms) {
+        appLoop();
+    }
+}
+
+static void type(const char* keys) {
+    for (; *keys; keys++) {
+        keyboard->press(*keys);
+    }
+}
+
+// Boots the app once on a fresh SD root and selects the remote "tv"
+static void boot() {
+    TEST_ASSERT_TRUE(mkdtemp(sdRoot) != nullptr);
+    system_ = new SimSystem();
+    storage = new HostStorage(sdRoot);
+    radio = new SimRadio(*system_);
+    keyboard = new SimKeyboard();
+    buttons = new SimButtons();
+    static FramebufferSurface display(canvas, panel, SCREEN_WIDTH, SCREEN_HEIGHT);
+    static SimPower power;
+    static Hal hal = {*system_, *storage, *radio, display, power, *keyboard, *buttons};
+    system_->setTimestamps(false);
+
+    appSetup(hal);
+    runUntilMs(4500);
+    type("rtv\r");
+    runUntilMs(5000);
+}
+
+void setUp() {
+    if (!system_) {
+        boot();
+    }
+}
+
+void tearDown() {}
+
+// Capture an IR press, save it from the front button, open the browser and
+// play it back: the same counter the soak bench reads must not move
+void test_capture_save_playback_does_not_allocate() {
+    static PulseTrain frame;
+    IrCode code = {IR_PROTO_NEC, 32, false, 0x20DF10EFULL};
+    TEST_ASSERT_TRUE(encodeIr(code, frame));
+    const uint32_t allocationsBefore = system_->allocations();
+    const uint32_t transmissionsBefore = radio->transmissions();
+
+    radio->injectIr(frame);
+    runUntilMs(5100);
+    buttons->press(BUTTON_C);
+    runUntilMs(6000);
+    type("b");
+    runUntilMs(6200);
+    type("\r");
+    runUntilMs(7000);
+
+    TEST_ASSERT_TRUE(storage->exists(LIBRARY_PATH));
+    TEST_ASSERT_EQUAL_UINT32(transmissionsBefore + 1, radio->transmissions());
+    TEST_ASSERT_EQUAL_UINT32(allocationsBefore, system_->allocations());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_capture_save_playback_does_not_allocate);
+    int failures = UNITY_END();
+    if (storage) {
+        char dir[64];
+        snprintf(dir, sizeof(dir), "%s/remote_names", sdRoot);
+        storage->remove(LIBRARY_PATH);
+        rmdir(dir);
+        rmdir(sdRoot);
+    }
+    return failures;
+}
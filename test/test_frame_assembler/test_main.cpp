@@ -0,0 +1,186 @@
+// Recorded edge streams through the capture pipeline, edge ring to frame
+// queue, on a host: pio test -e native -f test_frame_assembler
+
+#include <unity.h>
+
+#include "../../frame_assembler.h"
+#include "../../ir_codec.h"
+
+#define POLL_US 10000              // The radio task's tick while idle
+#define MAX_FRAMES 1100
+
+static IrFramePipeline* pipeline;
+static IrCode received[MAX_FRAMES];
+static uint32_t receivedCount;
+static uint32_t pollUs;
+static uint32_t noise;
+
+// Receivers stretch marks and shrink spaces by up to ~100 us
+static uint16_t skew(uint16_t duration, bool mark) {
+    noise = noise * 1103515245 + 12345;
+    int32_t offset = (int32_t)((noise >> 16) % 61) + (mark ? 20 : -80);
+    return (uint16_t)(duration + offset);
+}
+
+static void readFrames() {
+    static PulseTrain frame;
+    while (pipeline->read(frame)) {
+        IrCode code;
+        decodeIr(frame, code);
+        if (receivedCount < MAX_FRAMES) {
+            received[receivedCount] = code;
+        }
+        receivedCount++;
+    }
+}
+
+// Services the pipeline on every poll up to `untilUs`, reading what it queues
+static void serviceUntil(uint32_t untilUs) {
+    while ((int32_t)(untilUs - pollUs) >= 0) {
+        pipeline->service(pollUs);
+        readFrames();
+        pollUs += POLL_US;
+    }
+}
+
+// Pushes one frame's edges from `startUs`, ending with the line going idle,
+// servicing on the way when `polled`. Returns the time of the last edge.
+static uint32_t pushFrame(const IrCode& code, uint32_t startUs, bool polled) {
+    static PulseTrain train;
+    TEST_ASSERT_TRUE(encodeIr(code, train));
+    uint32_t edgeUs = startUs;
+    for (uint16_t i = 0; i <= train.count; i++) {
+        if (polled) {
+            serviceUntil(edgeUs);
+        }
+        bool mark = (i & 1) == 0 && i < train.count;
+        pipeline->pushEdge({edgeUs, (uint8_t)mark});
+        edgeUs += i < train.count ? skew(train.durations[i], mark) : 0;
+    }
+    return edgeUs;
+}
+
+static void assertNoLoss() {
+    TEST_ASSERT_EQUAL_UINT32(0, pipeline->droppedEdges());
+    TEST_ASSERT_EQUAL_UINT32(0, pipeline->droppedFrames());
+}
+
+void setUp() {
+    delete pipeline;
+    pipeline = new IrFramePipeline();
+    receivedCount = 0;
+    pollUs = 0;
+    noise = 1;
+}
+
+void tearDown() {}
+
+void test_single_frame() {
+    IrCode code = {IR_PROTO_NEC, 32, false, 0x20DF10EFULL};
+    uint32_t endUs = pushFrame(code, 1000, true);
+    serviceUntil(endUs + IR_FRAME_GAP_US + POLL_US);
+
+    assertNoLoss();
+    TEST_ASSERT_EQUAL_UINT32(1, receivedCount);
+    TEST_ASSERT_EQUAL(IR_PROTO_NEC, received[0].protocol);
+    TEST_ASSERT_FALSE(received[0].repeat);
+    TEST_ASSERT_TRUE(received[0].value == code.value);
+}
+
+// A button held for two minutes: the frame, then a repeat code every period
+void test_held_button_loses_nothing() {
+    IrCode code = {IR_PROTO_NEC, 32, false, 0x20DF10EFULL};
+    const uint32_t periodUs = irRepeatPeriodUs(IR_PROTO_NEC);
+    const uint32_t repeats = 1000;
+    uint32_t startUs = 1000;
+    for (uint32_t r = 0; r <= repeats; r++, startUs += periodUs) {
+        code.repeat = r > 0;
+        pushFrame(code, startUs, true);
+    }
+    serviceUntil(startUs + IR_FRAME_GAP_US + POLL_US);
+
+    assertNoLoss();
+    TEST_ASSERT_EQUAL_UINT32(1 + repeats, receivedCount);
+    TEST_ASSERT_FALSE(received[0].repeat);
+    TEST_ASSERT_TRUE(received[0].value == 0x20DF10EFULL);
+    for (uint32_t r = 1; r <= repeats; r++) {
+        TEST_ASSERT_EQUAL(IR_PROTO_NEC, received[r].protocol);
+        TEST_ASSERT_TRUE(received[r].repeat);
+    }
+}
+
+// Presses of every protocol back to back, each after the one before has
+// had its period
+void test_mixed_protocols_in_order() {
+    static const IrCode codes[] = {
+        {IR_PROTO_NEC, 32, false, 0x20DF10EFULL},
+        {IR_PROTO_SONY, 12, false, 0xA90ULL},
+        {IR_PROTO_RC5, 14, false, 0x314CULL},
+        {IR_PROTO_RC6, 21, false, 0x10000CULL},
+        {IR_PROTO_SAMSUNG, 32, false, 0xE0E040BFULL},
+        {IR_PROTO_PANASONIC, 48, false, 0x40040100BCBDULL},
+    };
+    const size_t count = sizeof(codes) / sizeof(codes[0]);
+    uint32_t startUs = 1000;
+    for (size_t i = 0; i < count; i++) {
+        pushFrame(codes[i], startUs, true);
+        startUs += irRepeatPeriodUs(codes[i].protocol);
+    }
+    serviceUntil(startUs + IR_FRAME_GAP_US + POLL_US);
+
+    assertNoLoss();
+    TEST_ASSERT_EQUAL_UINT32(count, receivedCount);
+    for (size_t i = 0; i < count; i++) {
+        TEST_ASSERT_EQUAL(codes[i].protocol, received[i].protocol);
+        TEST_ASSERT_TRUE(codes[i].value == received[i].value);
+    }
+}
+
+// The consumer stalls until the edge ring is nearly full; the backlog has
+// to come out through the frame queue, which holds far fewer frames
+void test_stalled_consumer_catches_up() {
+    IrCode code = {IR_PROTO_NEC, 32, false, 0};
+    const uint32_t periodUs = irRepeatPeriodUs(IR_PROTO_NEC);
+    const size_t frameEdges = 2 * 34;
+    uint32_t frames = 0;
+    uint32_t startUs = 1000;
+    while (pipeline->pendingEdges() + frameEdges <= IR_EDGE_RING_SIZE) {
+        code.value = 0x20DF0000ULL | frames << 8 | (uint8_t)~frames;
+        pushFrame(code, startUs, false);
+        startUs += periodUs;
+        frames++;
+    }
+    TEST_ASSERT_TRUE(frames > IR_FRAME_QUEUE_SIZE);
+
+    pollUs = startUs;
+    serviceUntil(startUs + IR_FRAME_GAP_US + 2 * frames * POLL_US);
+
+    assertNoLoss();
+    TEST_ASSERT_EQUAL_UINT32(frames, receivedCount);
+    for (uint32_t i = 0; i < frames; i++) {
+        TEST_ASSERT_TRUE(received[i].value == (0x20DF0000ULL | i << 8 | (uint8_t)~i));
+    }
+}
+
+// Past the edge ring's size the loss is counted, never silent
+void test_overflow_is_counted() {
+    IrCode code = {IR_PROTO_NEC, 32, false, 0x20DF10EFULL};
+    const uint32_t periodUs = irRepeatPeriodUs(IR_PROTO_NEC);
+    const uint32_t frames = 2 * IR_EDGE_RING_SIZE / (2 * 34);
+    uint32_t startUs = 1000;
+    for (uint32_t i = 0; i < frames; i++, startUs += periodUs) {
+        pushFrame(code, startUs, false);
+    }
+    TEST_ASSERT_TRUE(pipeline->pendingEdges() <= IR_EDGE_RING_SIZE);
+    TEST_ASSERT_TRUE(pipeline->droppedEdges() > 0);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_single_frame);
+    RUN_TEST(test_held_button_loses_nothing);
+    RUN_TEST(test_mixed_protocols_in_order);
+    RUN_TEST(test_stalled_consumer_catches_up);
+    RUN_TEST(test_overflow_is_counted);
+    return UNITY_END();
+}
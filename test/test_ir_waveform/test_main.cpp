@@ -0,0 +1,156 @@
+// Compiled IR symbols against the protocols' published timings, in 1 us
+// ticks: pio test -e native -f test_ir_waveform
+
+#include <string.h>
+#include <unity.h>
+
+#include "../../ir_waveform.h"
+
+#define MAX_HALVES (IR_WAVEFORM_MAX_SYMBOLS * 2)
+
+// Marks positive, spaces negative, up to the end marker
+static uint16_t flatten(const IrSymbol* symbols, uint16_t count, int32_t* halves) {
+    uint16_t length = 0;
+    for (uint16_t i = 0; i < count; i++) {
+        if (symbols[i].duration0() == 0) {
+            break;
+        }
+        halves[length++] = symbols[i].level0() ? symbols[i].duration0() : -(int32_t)symbols[i].duration0();
+        if (symbols[i].duration1() == 0) {
+            break;
+        }
+        halves[length++] = symbols[i].level1() ? symbols[i].duration1() : -(int32_t)symbols[i].duration1();
+    }
+    return length;
+}
+
+// Header, then one mark/space pair per bit of `bits` ('1' or '0'), written
+// out from the protocol's timings rather than the codec's table
+static uint16_t pulseDistance(int32_t* out, int32_t headerMark, int32_t headerSpace, const char* bits,
+                              int32_t oneMark, int32_t oneSpace, int32_t zeroMark, int32_t zeroSpace,
+                              int32_t stopMark) {
+    uint16_t length = 0;
+    out[length++] = headerMark;
+    out[length++] = -headerSpace;
+    for (const char* bit = bits; *bit; bit++) {
+        out[length++] = *bit == '1' ? oneMark : zeroMark;
+        out[length++] = -(*bit == '1' ? oneSpace : zeroSpace);
+    }
+    if (stopMark) {
+        out[length++] = stopMark;
+    } else {
+        length--;                  // No space after the last bit
+    }
+    return length;
+}
+
+static void assertHalves(const int32_t* expected, uint16_t expectedLength, const IrSymbol* symbols, uint16_t count) {
+    int32_t actual[MAX_HALVES];
+    uint16_t length = flatten(symbols, count, actual);
+    TEST_ASSERT_EQUAL_UINT32(expectedLength, length);
+    for (uint16_t i = 0; i < length; i++) {
+        TEST_ASSERT_EQUAL_INT32(expected[i], actual[i]);
+    }
+}
+
+static IrWaveform waveform;
+
+static void compile(IrProtocol protocol, uint8_t bits, uint64_t value) {
+    IrCode code = {protocol, bits, false, value};
+    TEST_ASSERT_TRUE(compileIrCode(code, waveform));
+}
+
+void setUp() {}
+void tearDown() {}
+
+// 0x20DF10EF: address 0x04 and command 0x08, each followed by its inverse
+void test_nec_frame() {
+    int32_t expected[MAX_HALVES];
+    uint16_t length = pulseDistance(expected, 9000, 4500, "00100000110111110001000011101111", 560, 1690, 560, 560,
+                                    560);
+    compile(IR_PROTO_NEC, 32, 0x20DF10EFULL);
+    assertHalves(expected, length, waveform.symbols, waveform.frameSymbols);
+    TEST_ASSERT_EQUAL_UINT32(38, waveform.carrierKhz);
+    TEST_ASSERT_EQUAL_UINT32(108000, waveform.periodUs);
+}
+
+void test_nec_repeat() {
+    static const int32_t expected[] = {9000, -2250, 560};
+    compile(IR_PROTO_NEC, 32, 0x20DF10EFULL);
+    TEST_ASSERT_TRUE(waveform.repeatSymbols > 0);
+    assertHalves(expected, 3, waveform.repeat(), waveform.repeatCount());
+}
+
+// Power, 12-bit: a 2.4 ms header and width-coded marks
+void test_sony() {
+    int32_t expected[MAX_HALVES];
+    uint16_t length = pulseDistance(expected, 2400, 600, "101010010000", 1200, 600, 600, 600, 0);
+    compile(IR_PROTO_SONY, 12, 0xA90);
+    assertHalves(expected, length, waveform.symbols, waveform.frameSymbols);
+    TEST_ASSERT_EQUAL_UINT32(0, waveform.repeatSymbols);
+    TEST_ASSERT_EQUAL_UINT32(40, waveform.carrierKhz);
+    TEST_ASSERT_EQUAL_UINT32(45000, waveform.periodUs);
+}
+
+// 1 1 0 00101 001100: address 5, command 12, toggle clear. A one is space
+// then mark; the first space is the idle line and is not sent.
+void test_rc5() {
+    static const int32_t expected[] = {
+        889, -889, 1778, -889, 889, -889, 889, -1778, 1778, -1778,
+        1778, -889, 889, -1778, 889, -889, 1778, -889, 889,
+    };
+    compile(IR_PROTO_RC5, 14, 0x314C);
+    assertHalves(expected, sizeof(expected) / sizeof(expected[0]), waveform.symbols, waveform.frameSymbols);
+    TEST_ASSERT_EQUAL_UINT32(36, waveform.carrierKhz);
+    TEST_ASSERT_EQUAL_UINT32(114000, waveform.periodUs);
+}
+
+// Mode 0, address 0, command 12: leader, start bit, three mode bits and a
+// double-width toggle bit. A one is mark then space.
+void test_rc6() {
+    static const int32_t expected[] = {
+        2664, -888, 444, -888, 444, -444, 444, -444, 444, -888, 888,
+        -444, 444, -444, 444, -444, 444, -444, 444, -444, 444, -444, 444, -444, 444, -444, 444,
+        -444, 444, -444, 444, -444, 444,
+        -444, 888, -444, 444, -888, 444, -444, 444,
+    };
+    compile(IR_PROTO_RC6, 21, 0x10000C);
+    assertHalves(expected, sizeof(expected) / sizeof(expected[0]), waveform.symbols, waveform.frameSymbols);
+    TEST_ASSERT_EQUAL_UINT32(36, waveform.carrierKhz);
+    TEST_ASSERT_EQUAL_UINT32(107000, waveform.periodUs);
+}
+
+// Power: NEC timings with a 4.5 ms header mark and no repeat code
+void test_samsung() {
+    int32_t expected[MAX_HALVES];
+    uint16_t length = pulseDistance(expected, 4500, 4500, "11100000111000000100000010111111", 560, 1690, 560, 560,
+                                    560);
+    compile(IR_PROTO_SAMSUNG, 32, 0xE0E040BFULL);
+    assertHalves(expected, length, waveform.symbols, waveform.frameSymbols);
+    TEST_ASSERT_EQUAL_UINT32(0, waveform.repeatSymbols);
+    TEST_ASSERT_EQUAL_UINT32(108000, waveform.periodUs);
+}
+
+// A gap longer than one 15-bit half is split across halves of one level
+void test_long_space_is_split() {
+    static PulseTrain frame;
+    frame.count = 3;
+    frame.durations[0] = 500;
+    frame.durations[1] = 40000;
+    frame.durations[2] = 500;
+    static const int32_t expected[] = {500, -IR_SYMBOL_MAX_TICKS, -(40000 - IR_SYMBOL_MAX_TICKS), 500};
+    TEST_ASSERT_TRUE(compileIrRaw(frame, 38, waveform));
+    assertHalves(expected, 4, waveform.symbols, waveform.frameSymbols);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_nec_frame);
+    RUN_TEST(test_nec_repeat);
+    RUN_TEST(test_sony);
+    RUN_TEST(test_rc5);
+    RUN_TEST(test_rc6);
+    RUN_TEST(test_samsung);
+    RUN_TEST(test_long_space_is_split);
+    return UNITY_END();
+}
@@ -0,0 +1,172 @@
+// Scheduler on a fake clock: pio test -e native -f test_scheduler
+
+#include <string.h>
+#include <unity.h>
+
+#include "../../scheduler.h"
+
+static uint32_t fakeNowUs;
+static char runOrder[16];
+static uint8_t runCount;
+
+static uint32_t fakeClock() {
+    return fakeNowUs;
+}
+
+static void record(char name) {
+    if (runCount < sizeof(runOrder) - 1) {
+        runOrder[runCount++] = name;
+        runOrder[runCount] = '\0';
+    }
+}
+
+static Scheduler* scheduler;
+static int8_t selfId;
+
+static void taskA() { record('A'); }
+static void taskB() { record('B'); }
+static void taskC() { record('C'); }
+
+static void cancelsItself() {
+    record('X');
+    scheduler->cancel(selfId);
+}
+
+static void rearmsItself() {
+    record('R');
+    scheduler->runIn(selfId, 700);
+}
+
+static void overruns() {
+    record('O');
+    fakeNowUs += 2500;
+}
+
+// Steps the fake clock to `untilUs`, sleeping as long as runDue() says
+static void runUntil(uint32_t untilUs) {
+    while ((int32_t)(untilUs - fakeNowUs) > 0) {
+        uint32_t sleepUs = scheduler->runDue();
+        uint32_t leftUs = untilUs - fakeNowUs;
+        fakeNowUs += sleepUs < leftUs ? (sleepUs ? sleepUs : 1) : leftUs;
+    }
+    scheduler->runDue();
+}
+
+void setUp() {
+    fakeNowUs = 0;
+    runCount = 0;
+    runOrder[0] = '\0';
+    delete scheduler;
+    scheduler = new Scheduler(fakeClock);
+}
+
+void tearDown() {}
+
+void test_one_shots_run_in_deadline_order() {
+    int8_t a = scheduler->add("a", taskA, 0);
+    int8_t b = scheduler->add("b", taskB, 0);
+    int8_t c = scheduler->add("c", taskC, 0);
+    scheduler->runIn(a, 300);
+    scheduler->runIn(b, 100);
+    scheduler->runIn(c, 200);
+    TEST_ASSERT_EQUAL_UINT32(100, scheduler->runDue());
+
+    fakeNowUs = 300;
+    scheduler->runDue();
+    TEST_ASSERT_EQUAL_STRING("BCA", runOrder);
+    TEST_ASSERT_FALSE(scheduler->armed(a));
+}
+
+void test_periodic_tasks_keep_their_cadence() {
+    scheduler->add("a", taskA, 1000);
+    scheduler->add("b", taskB, 400);
+    runUntil(1999);
+    // a at 0 and 1000; b at 0, 400, 800, 1200 and 1600
+    TEST_ASSERT_EQUAL_STRING("ABBBABB", runOrder);
+    TEST_ASSERT_EQUAL_UINT32(2, scheduler->stats(0).runs);
+    TEST_ASSERT_EQUAL_UINT32(5, scheduler->stats(1).runs);
+    TEST_ASSERT_EQUAL_UINT32(0, scheduler->stats(1).maxLateUs);
+}
+
+void test_cancel_disarms() {
+    int8_t a = scheduler->add("a", taskA, 500);
+    int8_t b = scheduler->add("b", taskB, 0);
+    scheduler->runIn(b, 200);
+    scheduler->cancel(a);
+    scheduler->cancel(b);
+    TEST_ASSERT_FALSE(scheduler->armed(a));
+    TEST_ASSERT_FALSE(scheduler->armed(b));
+    runUntil(5000);
+    TEST_ASSERT_EQUAL_STRING("", runOrder);
+}
+
+void test_cancel_from_inside_the_task_stops_a_periodic_one() {
+    selfId = scheduler->add("x", cancelsItself, 100);
+    runUntil(1000);
+    TEST_ASSERT_EQUAL_STRING("X", runOrder);
+    TEST_ASSERT_FALSE(scheduler->armed(selfId));
+}
+
+void test_rearm_moves_the_deadline() {
+    int8_t a = scheduler->add("a", taskA, 0);
+    scheduler->runIn(a, 100);
+    fakeNowUs = 50;
+    scheduler->runIn(a, 500);
+    runUntil(549);
+    TEST_ASSERT_EQUAL_STRING("", runOrder);
+    runUntil(550);
+    TEST_ASSERT_EQUAL_STRING("A", runOrder);
+    scheduler->runIn(a, 10);
+    runUntil(1000);
+    TEST_ASSERT_EQUAL_STRING("AA", runOrder);
+}
+
+// A runIn() from inside a periodic task wins over its period
+void test_rearm_from_inside_the_task_overrides_the_period() {
+    selfId = scheduler->add("r", rearmsItself, 100);
+    runUntil(1500);
+    // At 0, 700 and 1400
+    TEST_ASSERT_EQUAL_STRING("RRR", runOrder);
+}
+
+void test_overrun_skips_missed_periods() {
+    int8_t o = scheduler->add("o", overruns, 1000);
+    scheduler->runDue();
+    TEST_ASSERT_EQUAL_UINT32(2500, fakeNowUs);
+    // Due again a whole period after it finished, not three times at once
+    TEST_ASSERT_EQUAL_UINT32(1000, scheduler->runDue());
+    TEST_ASSERT_TRUE(scheduler->armed(o));
+    TEST_ASSERT_EQUAL_UINT32(2500, scheduler->stats(o).maxRunUs);
+}
+
+void test_deadlines_order_across_clock_wrap() {
+    fakeNowUs = 0xFFFFFF00UL;
+    int8_t a = scheduler->add("a", taskA, 0);
+    int8_t b = scheduler->add("b", taskB, 0);
+    scheduler->runIn(a, 0x200);    // Past the wrap
+    scheduler->runIn(b, 0x80);     // Before it
+    runUntil(0x100);
+    TEST_ASSERT_EQUAL_STRING("BA", runOrder);
+}
+
+void test_late_start_is_recorded() {
+    int8_t a = scheduler->add("a", taskA, 0);
+    scheduler->runIn(a, 100);
+    fakeNowUs = 350;
+    scheduler->runDue();
+    TEST_ASSERT_EQUAL_UINT32(250, scheduler->stats(a).maxLateUs);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_one_shots_run_in_deadline_order);
+    RUN_TEST(test_periodic_tasks_keep_their_cadence);
+    RUN_TEST(test_cancel_disarms);
+    RUN_TEST(test_cancel_from_inside_the_task_stops_a_periodic_one);
+    RUN_TEST(test_rearm_moves_the_deadline);
+    RUN_TEST(test_rearm_from_inside_the_task_overrides_the_period);
+    RUN_TEST(test_overrun_skips_missed_periods);
+    RUN_TEST(test_deadlines_order_across_clock_wrap);
+    RUN_TEST(test_late_start_is_recorded);
+    return UNITY_END();
+}
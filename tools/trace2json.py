@@ -0,0 +1,125 @@
+#!/usr/bin/env python3
+"""Converts trace dumps from a serial log into Chrome trace JSON.
+
+Usage: trace2json.py [serial.log] > trace.json
+
+Every dump in the log is taken, since the rings start over after each one.
+Other log lines are skipped, as is anything before the "TRACE " prefix,
+so timestamped logs work as they are. Open the result in ui.perfetto.dev
+or chrome://tracing.
+"""
+
+import json
+import struct
+import sys
+
+PREFIX = "TRACE "
+RECORD = struct.Struct("<IIHBB")   # timestampUs, argument, event, core, phase; as TraceRecord
+PHASES = {0: "B", 1: "E", 2: "i"}
+TASK_EVENT = 0
+
+
+def parse(lines):
+    names = {}
+    tasks = {}
+    dumps = []
+    for line in lines:
+        at = line.find(PREFIX)
+        if at < 0:
+            continue
+        words = line[at + len(PREFIX):].split(None, 2)
+        if not words:
+            continue
+        if words[0] == "START":
+            dumps.append([])
+        elif words[0] == "EVENT" and len(words) == 3:
+            names[int(words[1])] = words[2].strip()
+        elif words[0] == "TASK" and len(words) == 3:
+            tasks[int(words[1])] = words[2].strip()
+        elif words[0] == "R" and len(words) >= 2 and dumps:
+            data = bytes.fromhex(words[1])
+            for offset in range(0, len(data) - RECORD.size + 1, RECORD.size):
+                dumps[-1].append(RECORD.unpack_from(data, offset))
+    return names, tasks, dumps
+
+
+def unwrap(records, sinceUs):
+    """Timestamps are 32-bit microseconds; lays each core's out on one line.
+
+    Records of one core come oldest first, but a task preempted while
+    writing may land a few microseconds out of order, so only a step back
+    of more than half the range counts as a wrap. A dump starts after
+    `sinceUs`, the end of the one before.
+    """
+    events = []
+    last = {}
+    for timestampUs, argument, event, core, phase in records:
+        previous = last.get(core)
+        if previous is None:
+            absolute = (sinceUs & ~0xFFFFFFFF) + timestampUs
+            if absolute + 0x80000000 < sinceUs:
+                absolute += 0x100000000
+        else:
+            delta = (timestampUs - previous[1]) & 0xFFFFFFFF
+            if delta >= 0x80000000:
+                delta -= 0x100000000
+            absolute = previous[0] + delta
+        last[core] = (absolute, timestampUs)
+        events.append((absolute, argument, event, core, phase))
+    return events
+
+
+def convert(names, tasks, dumps):
+    trace = []
+    cores = set()
+    sinceUs = 0
+    for records in dumps:
+        events = unwrap(records, sinceUs)
+        if events:
+            sinceUs = max(event[0] for event in events)
+        # Sorted per core by time, an end whose begin was overwritten is dropped
+        depth = {}
+        for timestampUs, argument, event, core, phase in sorted(events, key=lambda e: (e[3], e[0])):
+            cores.add(core)
+            name = names.get(event, "event %d" % event)
+            if event == TASK_EVENT:
+                name = tasks.get(argument, "task %d" % argument)
+            kind = PHASES.get(phase)
+            if kind == "E":
+                if depth.get(core, 0) == 0:
+                    continue
+                depth[core] -= 1
+            elif kind == "B":
+                depth[core] = depth.get(core, 0) + 1
+            elif kind is None:
+                continue
+            entry = {"name": name, "ph": kind, "ts": timestampUs, "pid": 0, "tid": core}
+            if kind != "E":
+                entry["args"] = {"argument": argument}
+            if kind == "i":
+                entry["s"] = "t"
+            trace.append(entry)
+
+    for core in sorted(cores):
+        trace.append({"name": "thread_name", "ph": "M", "pid": 0, "tid": core,
+                      "args": {"name": "core %d" % core}})
+    return {"traceEvents": trace, "displayTimeUnit": "ms"}
+
+
+def main():
+    if len(sys.argv) > 2:
+        sys.stderr.write(__doc__)
+        return 2
+    source = open(sys.argv[1], errors="replace") if len(sys.argv) == 2 else sys.stdin
+    with source:
+        names, tasks, dumps = parse(source)
+    if not dumps:
+        sys.stderr.write("No trace dump found.\n")
+        return 1
+    json.dump(convert(names, tasks, dumps), sys.stdout)
+    sys.stdout.write("\n")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
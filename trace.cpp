@@ -0,0 +1,111 @@
+#include "trace.h"
+
+#include <atomic>
+#include <stdio.h>
+#include <string.h>
+
+static_assert((TRACE_RING_SIZE & (TRACE_RING_SIZE - 1)) == 0, "TRACE_RING_SIZE must be a power of two");
+
+// One per core, so the cores never contend for a slot
+struct TraceRing {
+    TraceRecord records[TRACE_RING_SIZE];
+    std::atomic<uint32_t> head{0};
+};
+
+static const char* const kTraceEventNames[TRACE_EVENT_COUNT] = {
+    "task",
+    "RadioService::execute",
+    "capture",
+    "scanIR",
+    "scanRF24",
+    "scanRF433",
+    "sendIRSignal",
+    "sendRF24Signal",
+    "sendRF433Waveform",
+    "saveRemoteData",
+    "loadRemoteButton",
+    "SdButtonStore::load",
+    "SdButtonStore::store",
+    "Ui::render",
+    "importTask",
+    "indexTask",
+    "findKnownRemote",
+};
+
+static TraceRing traceRings[TRACE_CORES];
+static TraceClock traceClock = nullptr;
+static TraceCore traceCore = nullptr;
+static std::atomic<bool> tracePaused{false};
+
+void traceBegin(TraceClock clock, TraceCore core) {
+    traceCore = core;
+    traceClock = clock;
+}
+
+void traceRecord(uint16_t event, uint8_t phase, uint32_t argument) {
+    if (!traceClock || tracePaused.load(std::memory_order_relaxed)) {
+        return;
+    }
+    uint8_t core = traceCore();
+    TraceRing& ring = traceRings[core < TRACE_CORES ? core : 0];
+    uint32_t slot = ring.head.fetch_add(1, std::memory_order_relaxed);
+    TraceRecord& record = ring.records[slot & (TRACE_RING_SIZE - 1)];
+    record.timestampUs = traceClock();
+    record.argument = argument;
+    record.event = event;
+    record.core = core;
+    record.phase = phase;
+}
+
+uint32_t traceRecorded() {
+    uint32_t total = 0;
+    for (const TraceRing& ring : traceRings) {
+        total += ring.head.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+static void hexRecord(const TraceRecord& record, char* out) {
+    static const char kDigits[] = "0123456789abcdef";
+    uint8_t bytes[sizeof(TraceRecord)];
+    memcpy(bytes, &record, sizeof(bytes));
+    for (size_t i = 0; i < sizeof(bytes); i++) {
+        out[2 * i] = kDigits[bytes[i] >> 4];
+        out[2 * i + 1] = kDigits[bytes[i] & 0x0F];
+    }
+}
+
+// Records go out little-endian, as both the ESP32 and the host store them
+void traceDump(void (*writeLine)(const char* line)) {
+    char line[sizeof(TRACE_DUMP_PREFIX "R ") + 2 * sizeof(TraceRecord) * TRACE_DUMP_RECORDS];
+    tracePaused.store(true, std::memory_order_relaxed);
+
+    snprintf(line, sizeof(line), TRACE_DUMP_PREFIX "START %u %u", TRACE_CORES, TRACE_RING_SIZE);
+    writeLine(line);
+    for (uint16_t event = 0; event < TRACE_EVENT_COUNT; event++) {
+        snprintf(line, sizeof(line), TRACE_DUMP_PREFIX "EVENT %u %s", event, kTraceEventNames[event]);
+        writeLine(line);
+    }
+
+    for (TraceRing& ring : traceRings) {
+        uint32_t head = ring.head.load(std::memory_order_acquire);
+        uint32_t count = head < TRACE_RING_SIZE ? head : TRACE_RING_SIZE;
+        size_t prefix = strlen(TRACE_DUMP_PREFIX "R ");
+        memcpy(line, TRACE_DUMP_PREFIX "R ", prefix);
+        size_t length = prefix;
+        for (uint32_t slot = head - count; slot != head; slot++) {
+            hexRecord(ring.records[slot & (TRACE_RING_SIZE - 1)], line + length);
+            length += 2 * sizeof(TraceRecord);
+            if (length == sizeof(line) - 1 || slot + 1 == head) {
+                line[length] = '\0';
+                writeLine(line);
+                length = prefix;
+            }
+        }
+        ring.head.store(0, std::memory_order_release);
+    }
+
+    snprintf(line, sizeof(line), TRACE_DUMP_PREFIX "END");
+    writeLine(line);
+    tracePaused.store(false, std::memory_order_relaxed);
+}
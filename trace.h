@@ -0,0 +1,99 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Tracing is compiled in only with -D TRACE_ENABLED=1 (the trace env);
+// otherwise the macros below expand to nothing.
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 0
+#endif
+
+#ifndef TRACE_RING_SIZE
+#define TRACE_RING_SIZE 1024           // Records kept per core, oldest overwritten; a power of two
+#endif
+
+#ifndef TRACE_CORES
+#define TRACE_CORES 2
+#endif
+
+#define TRACE_DUMP_PREFIX "TRACE "
+#define TRACE_DUMP_RECORDS 4           // Records per dump line
+
+// Add new events at the end, with their name in trace.cpp
+enum TraceEvent : uint16_t {
+    TRACE_TASK,                    // A scheduler task; argument is its id
+    TRACE_RADIO_COMMAND,           // Argument is the RadioCommandType
+    TRACE_RADIO_CAPTURE,           // Instant; argument is the band
+    TRACE_SCAN_IR,
+    TRACE_SCAN_RF24,
+    TRACE_SCAN_RF433,
+    TRACE_SEND_IR,                 // Argument is 1 for a held button
+    TRACE_SEND_RF24,               // Argument is the payload length
+    TRACE_SEND_RF433,
+    TRACE_SAVE_REMOTE_DATA,        // Argument is the band
+    TRACE_LOAD_REMOTE_BUTTON,
+    TRACE_SD_LOAD,                 // Argument is the library slot when loaded by index
+    TRACE_SD_STORE,                // Argument is the band
+    TRACE_UI_RENDER,
+    TRACE_IMPORT,                  // Argument is the number of files imported so far
+    TRACE_SIGNAL_INDEX,            // Argument is the IndexStage
+    TRACE_SIGNAL_FIND,             // Argument is the band
+    TRACE_EVENT_COUNT
+};
+
+enum TracePhase : uint8_t {
+    TRACE_PHASE_BEGIN,
+    TRACE_PHASE_END,
+    TRACE_PHASE_INSTANT
+};
+
+// Fixed-size, so a dump is the records' bytes as they are in memory
+struct TraceRecord {
+    uint32_t timestampUs;
+    uint32_t argument;
+    uint16_t event;
+    uint8_t core;
+    uint8_t phase;
+};
+
+static_assert(sizeof(TraceRecord) == 12, "TraceRecord is dumped byte for byte");
+
+typedef uint32_t (*TraceClock)();
+typedef uint8_t (*TraceCore)();
+
+// Nothing is recorded before this.
+void traceBegin(TraceClock clock, TraceCore core);
+
+// Lock-free: a slot is claimed with one atomic add on the caller's core, so
+// tasks preempting each other there each get their own.
+void traceRecord(uint16_t event, uint8_t phase, uint32_t argument);
+
+// Writes every ring out as text lines for tools/trace2json.py: the event
+// names, then the records as hex, oldest first. Recording pauses meanwhile
+// and the rings start over afterwards, so each dump covers the time since
+// the last one.
+void traceDump(void (*writeLine)(const char* line));
+
+// Records written since the last dump, overwritten ones included.
+uint32_t traceRecorded();
+
+// Records a begin when built and the matching end when it goes out of scope
+class TraceScope {
+public:
+    TraceScope(uint16_t event, uint32_t argument) : _event(event) { traceRecord(event, TRACE_PHASE_BEGIN, argument); }
+    ~TraceScope() { traceRecord(_event, TRACE_PHASE_END, 0); }
+
+private:
+    uint16_t _event;
+};
+
+#if TRACE_ENABLED
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(event, argument) TraceScope TRACE_CONCAT(traceScope, __LINE__)((event), (argument))
+#define TRACE_INSTANT(event, argument) traceRecord((event), TRACE_PHASE_INSTANT, (argument))
+#else
+#define TRACE_SCOPE(event, argument) do {} while (0)
+#define TRACE_INSTANT(event, argument) do {} while (0)
+#endif
@@ -0,0 +1,144 @@
+#include "ui.h"
+
+#include <string.h>
+
+int8_t Ui::addWidget(const UiRect& rect, uint8_t textSize, uint16_t foreground, uint16_t background) {
+    if (_widgetCount >= UI_MAX_WIDGETS) {
+        return -1;
+    }
+    Widget& widget = _widgets[_widgetCount];
+    widget.rect = rect;
+    widget.textSize = textSize ? textSize : 1;
+    widget.foreground = foreground;
+    widget.background = background;
+    widget.visible = true;
+    widget.dirty = true;
+    widget.text[0] = '\0';
+    return (int8_t)_widgetCount++;
+}
+
+void Ui::setText(int8_t id, const char* text) {
+    if (id < 0 || id >= _widgetCount) {
+        return;
+    }
+    Widget& widget = _widgets[id];
+    if (strncmp(widget.text, text, UI_TEXT_MAX - 1) == 0) {
+        return;
+    }
+    strncpy(widget.text, text, UI_TEXT_MAX - 1);
+    widget.text[UI_TEXT_MAX - 1] = '\0';
+    widget.dirty = true;
+}
+
+void Ui::appendText(int8_t id, const char* text) {
+    if (id < 0 || id >= _widgetCount || text[0] == '\0') {
+        return;
+    }
+    Widget& widget = _widgets[id];
+    size_t used = strlen(widget.text);
+    if (used >= UI_TEXT_MAX - 1) {
+        return;
+    }
+    strncat(widget.text, text, UI_TEXT_MAX - 1 - used);
+    widget.dirty = true;
+}
+
+void Ui::setVisible(int8_t id, bool visible) {
+    if (id < 0 || id >= _widgetCount || _widgets[id].visible == visible) {
+        return;
+    }
+    _widgets[id].visible = visible;
+    _widgets[id].dirty = true;
+}
+
+void Ui::setColors(int8_t id, uint16_t foreground, uint16_t background) {
+    if (id < 0 || id >= _widgetCount) {
+        return;
+    }
+    Widget& widget = _widgets[id];
+    if (widget.foreground != foreground || widget.background != background) {
+        widget.foreground = foreground;
+        widget.background = background;
+        widget.dirty = true;
+    }
+}
+
+void Ui::invalidate() {
+    for (uint8_t i = 0; i < _widgetCount; i++) {
+        _widgets[i].dirty = true;
+    }
+}
+
+bool Ui::intersects(const UiRect& a, const UiRect& b) {
+    return a.x < b.x + b.w && b.x < a.x + a.w && a.y < b.y + b.h && b.y < a.y + a.h;
+}
+
+// Wraps at the widget width and at '\n'; lines past the bottom are cut off
+void Ui::draw(const Widget& widget) {
+    _surface.fillRect(widget.rect, widget.background);
+
+    int16_t glyphWidth = UI_GLYPH_WIDTH * widget.textSize;
+    int16_t lineHeight = UI_GLYPH_HEIGHT * widget.textSize;
+    uint16_t perLine = glyphWidth > 0 ? (uint16_t)(widget.rect.w / glyphWidth) : 0;
+    if (perLine == 0) {
+        return;
+    }
+
+    const char* cursor = widget.text;
+    int16_t y = widget.rect.y;
+    while (*cursor && y + lineHeight <= widget.rect.y + widget.rect.h) {
+        uint16_t length = 0;
+        while (cursor[length] && cursor[length] != '\n' && length < perLine) {
+            length++;
+        }
+        if (length > 0) {
+            _surface.drawText(widget.rect.x, y, cursor, length, widget.textSize, widget.foreground);
+        }
+        cursor += length;
+        if (*cursor == '\n') {
+            cursor++;
+        }
+        y += lineHeight;
+    }
+}
+
+uint32_t Ui::push(const UiRect& rect) {
+    _surface.push(rect);
+    return (uint32_t)rect.w * (uint32_t)rect.h;
+}
+
+uint32_t Ui::render() {
+    uint32_t pixels = 0;
+
+    // Erase widgets that were hidden, then repaint anything visible beneath them
+    for (uint8_t i = 0; i < _widgetCount; i++) {
+        Widget& hidden = _widgets[i];
+        if (!hidden.dirty || hidden.visible) {
+            continue;
+        }
+        _surface.fillRect(hidden.rect, hidden.background);
+        pixels += push(hidden.rect);
+        hidden.dirty = false;
+        for (uint8_t j = 0; j < _widgetCount; j++) {
+            if (_widgets[j].visible && intersects(hidden.rect, _widgets[j].rect)) {
+                _widgets[j].dirty = true;
+            }
+        }
+    }
+
+    for (uint8_t i = 0; i < _widgetCount; i++) {
+        Widget& widget = _widgets[i];
+        if (!widget.dirty) {
+            continue;
+        }
+        draw(widget);
+        pixels += push(widget.rect);
+        widget.dirty = false;
+        _stats.widgetsDrawn++;
+    }
+
+    _stats.frames++;
+    _stats.pixelsPushed += pixels;
+    _stats.lastFramePixels = pixels;
+    return pixels;
+}
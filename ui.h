@@ -0,0 +1,92 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifndef UI_MAX_WIDGETS
+#define UI_MAX_WIDGETS 16
+#endif
+
+#ifndef UI_TEXT_MAX
+#define UI_TEXT_MAX 160
+#endif
+
+#define UI_GLYPH_WIDTH 6           // Default GFX font cell at text size 1
+#define UI_GLYPH_HEIGHT 8
+
+// RGB565 colours
+#define UI_BLACK 0x0000
+#define UI_WHITE 0xFFFF
+#define UI_RED 0xF800
+#define UI_LIGHTCYAN 0xE7FF
+#define UI_DARKGREY 0x7BEF
+
+struct UiRect {
+    int16_t x;
+    int16_t y;
+    int16_t w;
+    int16_t h;
+};
+
+// Drawing target. Draw calls go to an off-screen buffer; push() copies one
+// rectangle of it to the panel.
+class UiSurface {
+public:
+    virtual ~UiSurface() {}
+    virtual int16_t width() = 0;
+    virtual int16_t height() = 0;
+    virtual void fillRect(const UiRect& rect, uint16_t color) = 0;
+    virtual void drawText(int16_t x, int16_t y, const char* text, uint16_t length, uint8_t size, uint16_t color) = 0;
+    virtual void push(const UiRect& rect) = 0;
+};
+
+struct UiStats {
+    uint32_t frames;
+    uint32_t widgetsDrawn;
+    uint32_t pixelsPushed;
+    uint32_t lastFramePixels;
+};
+
+// Retained-mode UI. Widgets are text boxes whose content is compared on
+// every update, so render() redraws and pushes only the ones that changed.
+class Ui {
+public:
+    explicit Ui(UiSurface& surface) : _surface(surface) {}
+
+    int8_t addWidget(const UiRect& rect, uint8_t textSize, uint16_t foreground, uint16_t background);
+
+    void setText(int8_t id, const char* text);
+    void appendText(int8_t id, const char* text);
+    void setVisible(int8_t id, bool visible);
+    void setColors(int8_t id, uint16_t foreground, uint16_t background);
+    const char* text(int8_t id) const { return _widgets[id].text; }
+    bool visible(int8_t id) const { return _widgets[id].visible; }
+
+    // Forces a full redraw on the next render().
+    void invalidate();
+
+    // Draws the changed widgets and pushes their rectangles. Returns the
+    // number of pixels pushed.
+    uint32_t render();
+
+    const UiStats& stats() const { return _stats; }
+
+private:
+    struct Widget {
+        UiRect rect;
+        uint8_t textSize;
+        uint16_t foreground;
+        uint16_t background;
+        bool visible;
+        bool dirty;
+        char text[UI_TEXT_MAX];
+    };
+
+    static bool intersects(const UiRect& a, const UiRect& b);
+    void draw(const Widget& widget);
+    uint32_t push(const UiRect& rect);
+
+    UiSurface& _surface;
+    Widget _widgets[UI_MAX_WIDGETS];
+    uint8_t _widgetCount = 0;
+    UiStats _stats = {0, 0, 0, 0};
+};
@@ -0,0 +1,52 @@
+#include "ui_framebuffer.h"
+
+bool FramebufferSurface::clip(const UiRect& rect, UiRect& out) const {
+    int16_t x0 = rect.x < 0 ? 0 : rect.x;
+    int16_t y0 = rect.y < 0 ? 0 : rect.y;
+    int16_t x1 = rect.x + rect.w > _width ? _width : rect.x + rect.w;
+    int16_t y1 = rect.y + rect.h > _height ? _height : rect.y + rect.h;
+    if (x0 >= x1 || y0 >= y1) {
+        return false;
+    }
+    out = {x0, y0, (int16_t)(x1 - x0), (int16_t)(y1 - y0)};
+    return true;
+}
+
+void FramebufferSurface::fillRect(const UiRect& rect, uint16_t color) {
+    UiRect area;
+    if (!clip(rect, area)) {
+        return;
+    }
+    for (int16_t y = area.y; y < area.y + area.h; y++) {
+        for (int16_t x = area.x; x < area.x + area.w; x++) {
+            _canvas[y * _width + x] = color;
+        }
+    }
+}
+
+void FramebufferSurface::drawText(int16_t x, int16_t y, const char* text, uint16_t length, uint8_t size, uint16_t color) {
+    int16_t cellWidth = UI_GLYPH_WIDTH * size;
+    int16_t cellHeight = UI_GLYPH_HEIGHT * size;
+    for (uint16_t i = 0; i < length; i++) {
+        if (text[i] == ' ') {
+            continue;
+        }
+        // Leave a one-pixel gap like the real font so neighbours stay distinct
+        UiRect glyph = {(int16_t)(x + i * cellWidth), y, (int16_t)(cellWidth - size), (int16_t)(cellHeight - size)};
+        fillRect(glyph, color);
+    }
+}
+
+void FramebufferSurface::push(const UiRect& rect) {
+    UiRect area;
+    _pushes++;
+    if (!clip(rect, area)) {
+        return;
+    }
+    for (int16_t y = area.y; y < area.y + area.h; y++) {
+        for (int16_t x = area.x; x < area.x + area.w; x++) {
+            _panel[y * _width + x] = _canvas[y * _width + x];
+        }
+    }
+    _pixelsPushed += (uint32_t)area.w * (uint32_t)area.h;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "ui.h"
+
+// In-memory surface for host builds. Glyphs are drawn as solid cells, which
+// is enough to check what changes on screen and how many pixels are pushed.
+class FramebufferSurface : public UiSurface {
+public:
+    FramebufferSurface(uint16_t* canvas, uint16_t* panel, int16_t width, int16_t height)
+        : _canvas(canvas), _panel(panel), _width(width), _height(height) {}
+
+    int16_t width() override { return _width; }
+    int16_t height() override { return _height; }
+    void fillRect(const UiRect& rect, uint16_t color) override;
+    void drawText(int16_t x, int16_t y, const char* text, uint16_t length, uint8_t size, uint16_t color) override;
+    void push(const UiRect& rect) override;
+
+    const uint16_t* panel() const { return _panel; }
+    uint32_t pushes() const { return _pushes; }
+    uint32_t pixelsPushed() const { return _pixelsPushed; }
+
+private:
+    bool clip(const UiRect& rect, UiRect& out) const;
+
+    uint16_t* _canvas;
+    uint16_t* _panel;
+    int16_t _width;
+    int16_t _height;
+    uint32_t _pushes = 0;
+    uint32_t _pixelsPushed = 0;
+};
@@ -0,0 +1,78 @@
+#include "ui_heatmap.h"
+
+#include <string.h>
+
+void UiHeatmap::begin(const UiRect& rect, uint8_t columns, uint8_t rowHeight) {
+    _rect = rect;
+    _columns = columns < UI_HEATMAP_MAX_COLUMNS ? columns : UI_HEATMAP_MAX_COLUMNS;
+    _rowHeight = rowHeight ? rowHeight : 1;
+    int16_t rows = rect.h / _rowHeight;
+    _rows = rows < UI_HEATMAP_MAX_ROWS ? (uint8_t)rows : UI_HEATMAP_MAX_ROWS;
+    _cursor = 0;
+    memset(_levels, 0, sizeof(_levels));
+}
+
+// Black, blue, cyan, yellow, red
+uint16_t UiHeatmap::heatColor(uint8_t level) {
+    static const uint8_t anchors[5][3] = {{0, 0, 0}, {0, 0, 200}, {0, 200, 255}, {255, 230, 0}, {255, 0, 0}};
+    uint8_t segment = level >> 6;
+    uint8_t t = level & 0x3F;
+    uint8_t rgb[3];
+    for (uint8_t i = 0; i < 3; i++) {
+        int16_t from = anchors[segment][i];
+        int16_t to = anchors[segment + 1][i];
+        rgb[i] = (uint8_t)(from + (to - from) * t / 0x3F);
+    }
+    return (uint16_t)(((rgb[0] & 0xF8) << 8) | ((rgb[1] & 0xFC) << 3) | (rgb[2] >> 3));
+}
+
+UiRect UiHeatmap::rowRect(uint8_t row) const {
+    return {_rect.x, (int16_t)(_rect.y + row * _rowHeight), _rect.w, (int16_t)_rowHeight};
+}
+
+void UiHeatmap::drawRow(uint8_t row) {
+    UiRect cell = rowRect(row);
+    for (uint8_t column = 0; column < _columns; column++) {
+        int16_t left = _rect.x + column * _rect.w / _columns;
+        int16_t right = _rect.x + (column + 1) * _rect.w / _columns;
+        if (right > left) {
+            cell.x = left;
+            cell.w = right - left;
+            _surface.fillRect(cell, heatColor(_levels[row][column]));
+        }
+    }
+}
+
+void UiHeatmap::drawMarker() {
+    UiRect marker = rowRect(_cursor);
+    _surface.fillRect(marker, UI_BLACK);
+    marker.h = 1;
+    _surface.fillRect(marker, UI_DARKGREY);
+}
+
+void UiHeatmap::addRow(const uint8_t* levels) {
+    if (_rows == 0) {
+        return;
+    }
+    uint8_t row = _cursor;
+    memcpy(_levels[row], levels, _columns);
+    drawRow(row);
+    _surface.push(rowRect(row));
+
+    _cursor = (uint8_t)((_cursor + 1) % _rows);
+    drawMarker();
+    _surface.push(rowRect(_cursor));
+}
+
+void UiHeatmap::redraw() {
+    _surface.fillRect(_rect, UI_BLACK);
+    for (uint8_t row = 0; row < _rows; row++) {
+        if (row != _cursor) {
+            drawRow(row);
+        }
+    }
+    if (_rows > 0) {
+        drawMarker();
+    }
+    _surface.push(_rect);
+}
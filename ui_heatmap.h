@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "ui.h"
+
+#ifndef UI_HEATMAP_MAX_COLUMNS
+#define UI_HEATMAP_MAX_COLUMNS 128
+#endif
+
+#ifndef UI_HEATMAP_MAX_ROWS
+#define UI_HEATMAP_MAX_ROWS 64
+#endif
+
+// Waterfall of level rows (0-255, drawn cold to hot) that is not a Ui
+// widget: it draws straight onto the surface. Rather than scrolling, each
+// new row overwrites the oldest one at a cursor that wraps from the bottom
+// to the top, with a marker line below it, so a frame pushes two strips
+// however tall the history is.
+class UiHeatmap {
+public:
+    explicit UiHeatmap(UiSurface& surface) : _surface(surface) {}
+
+    // Spreads `columns` cells across `rect` and clears the history.
+    void begin(const UiRect& rect, uint8_t columns, uint8_t rowHeight);
+
+    void addRow(const uint8_t* levels);
+
+    // Repaints the whole history, e.g. after something was drawn over it.
+    void redraw();
+
+    static uint16_t heatColor(uint8_t level);
+
+private:
+    UiRect rowRect(uint8_t row) const;
+    void drawRow(uint8_t row);
+    void drawMarker();
+
+    UiSurface& _surface;
+    UiRect _rect = {0, 0, 0, 0};
+    uint8_t _columns = 0;
+    uint8_t _rowHeight = 1;
+    uint8_t _rows = 0;
+    uint8_t _cursor = 0;           // Row the next addRow() overwrites
+    uint8_t _levels[UI_HEATMAP_MAX_ROWS][UI_HEATMAP_MAX_COLUMNS];
+};
@@ -0,0 +1,31 @@
+#include "ui_m5.h"
+
+bool M5CanvasSurface::begin() {
+    // A full-screen 16-bit sprite; PSRAM keeps it out of internal RAM
+    _canvas.setColorDepth(16);
+    _canvas.setPsram(true);
+    if (!_canvas.createSprite(_display.width(), _display.height())) {
+        return false;
+    }
+    _canvas.setTextWrap(false);
+    _canvas.fillSprite(TFT_BLACK);
+    return true;
+}
+
+void M5CanvasSurface::fillRect(const UiRect& rect, uint16_t color) {
+    _canvas.fillRect(rect.x, rect.y, rect.w, rect.h, color);
+}
+
+void M5CanvasSurface::drawText(int16_t x, int16_t y, const char* text, uint16_t length, uint8_t size, uint16_t color) {
+    _canvas.setTextSize(size);
+    _canvas.setTextColor(color);
+    _canvas.setCursor(x, y);
+    _canvas.write((const uint8_t*)text, length);
+}
+
+void M5CanvasSurface::push(const UiRect& rect) {
+    // pushSprite honours the panel's clip rectangle, so only this area is sent
+    _display.setClipRect(rect.x, rect.y, rect.w, rect.h);
+    _canvas.pushSprite(&_display, 0, 0);
+    _display.clearClipRect();
+}
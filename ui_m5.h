@@ -0,0 +1,24 @@
+#pragma once
+
+#include <M5Unified.h>
+
+#include "ui.h"
+
+// UiSurface drawing into an M5Canvas sprite and pushing clipped rectangles
+// of it to the panel.
+class M5CanvasSurface : public UiSurface {
+public:
+    explicit M5CanvasSurface(M5GFX& display) : _display(display), _canvas(&display) {}
+
+    bool begin();
+
+    int16_t width() override { return _display.width(); }
+    int16_t height() override { return _display.height(); }
+    void fillRect(const UiRect& rect, uint16_t color) override;
+    void drawText(int16_t x, int16_t y, const char* text, uint16_t length, uint8_t size, uint16_t color) override;
+    void push(const UiRect& rect) override;
+
+private:
+    M5GFX& _display;
+    M5Canvas _canvas;
+};